@@ -31,6 +31,7 @@ class cond {
   cond &operator=(const cond &); // not implemented
   static void throw_init_error(int errcode) __attribute__((noreturn));
   static void throw_wait_error(int errcode) __attribute__((noreturn));
+  static void throw_timedwait_error(int errcode) __attribute__((noreturn));
   static void throw_signal_error(int errcode) __attribute__((noreturn));
   static void throw_broadcast_error(int errcode) __attribute__((noreturn));
 public:
@@ -46,6 +47,10 @@ public:
   void wait(mutex &);
   void wait(pthread_mutex_t *);
 
+  // Like wait(), but gives up after SECONDS seconds.  Returns false
+  // if the timeout expired.
+  bool timed_wait(mutex &, unsigned seconds);
+
   // Wake up at least one waiter.
   void signal();
 
@@ -23,7 +23,7 @@
 namespace cxxll {
 
 struct elf_exception : std::runtime_error {
-  elf_exception();		// uses elf_errmsg
+  elf_exception();		// generic message
   elf_exception(const char *);
   static void raise(const char *msg, ...)
     __attribute__((format(printf, 1, 2), noreturn));
@@ -18,6 +18,9 @@
 
 #pragma once
 
+#include <cxxll/const_stringref.hpp>
+
+#include <string>
 #include <tr1/memory>
 #include <vector>
 
@@ -25,6 +28,7 @@ namespace cxxll {
 
 class elf_symbol_definition;
 class elf_symbol_reference;
+struct elf_symbol_batch;
 
 class elf_image {
   struct impl;
@@ -35,6 +39,23 @@ public:
   elf_image(const void *, size_t);
   ~elf_image();
 
+  // Selects the symbols returned by symbol_range and symbols().
+  typedef enum {
+    // Only the dynamic symbol table (SHT_DYNSYM).
+    dynsym_only = 1,
+    // The dynamic symbol table and the non-local symbols from the
+    // full symbol table (SHT_SYMTAB).
+    global_symbols,
+    // All symbol tables.
+    all_symbols
+  } symbol_selection;
+
+  // Converts between symbol_selection values and their string
+  // representation ("dynsym", "global", "all").  Throws runtime_error
+  // if the conversion fails.
+  static symbol_selection symbol_selection_from_string(const char *);
+  static const char *to_string(symbol_selection);
+
   // Fields from the ELF header.
   unsigned char ei_class() const;
   unsigned char ei_data() const;
@@ -50,6 +71,12 @@ public:
   // instead).
   const char *arch() const;
 
+  // Appends the selected symbols to the batch, in the order of
+  // symbol_range.  Unlike symbol_range, symbols with empty names are
+  // skipped (they were never loaded into the database).
+  void symbols(elf_symbol_batch &,
+	       symbol_selection = all_symbols) const;
+
   // Iterates over the program header.
   class program_header_range {
     struct state;
@@ -78,16 +105,33 @@ public:
     struct state;
     std::tr1::shared_ptr<state> state_;
   public:
-    symbol_range(const elf_image &);
+    explicit symbol_range(const elf_image &,
+			  symbol_selection = all_symbols);
     ~symbol_range();
 
     // Advances to the next symbol.
     bool next();
 
     // These return a null pointer if the iterator is not position at
-    // information of this kind.
+    // information of this kind.  The objects are reused by next()
+    // unless the caller keeps a reference.
     std::tr1::shared_ptr<elf_symbol_definition> definition() const;
     std::tr1::shared_ptr<elf_symbol_reference> reference() const;
+
+    // Accessors for the current symbol which do not copy.  The
+    // strings point into the ELF image.
+    bool is_definition() const;
+    const_stringref symbol_name() const;
+    // vda_name for definitions, vna_name for references.
+    const_stringref version_name() const;
+    unsigned char type() const;
+    unsigned char binding() const;
+    unsigned char other() const;
+    unsigned long long value() const;
+    // Only meaningful for definitions.
+    unsigned short section() const;
+    unsigned xsection() const;
+    bool default_version() const;
   };
 
   // Iterates over strings in the dynamic section.
@@ -119,7 +163,8 @@ public:
   };
 };
 
-// Call this to initialize the subsystem.
+// Call this to initialize the subsystem.  (Retained for
+// compatibility, the parser does not need global initialization.)
 void elf_image_init();
 
 } // namespace cxxll
@@ -32,6 +32,9 @@ struct elf_symbol {
 
   // Returns the string describing the attribute (in lower case).
   const char *visibility() const;
+
+  // Same as visibility(), but for a STV_* value.
+  static const char *visibility_name(unsigned char);
 };
 
 } // namespace cxxll
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cxxll/const_stringref.hpp>
+
+#include <vector>
+
+namespace cxxll {
+
+// Columnar storage for the symbols of an ELF image.  Strings are
+// stored NUL-terminated in a single arena, and the columns contain
+// offsets into it.  Filled by elf_image::symbols().
+struct elf_symbol_batch {
+  // Column value for an absent string (an unversioned symbol).
+  static const unsigned no_string = ~0U;
+
+  // Columns shared by definitions and references.  All vectors have
+  // the same length.
+  struct symbols {
+    std::vector<unsigned> name;
+    std::vector<unsigned> version;
+    std::vector<unsigned char> type;
+    std::vector<unsigned char> binding;
+    std::vector<unsigned char> visibility; // STV_* value
+
+    size_t size() const;
+  };
+
+  struct definitions : symbols {
+    std::vector<unsigned long long> value;
+    std::vector<unsigned short> section;
+    std::vector<unsigned> xsection;
+    std::vector<bool> default_version;
+
+    // Returns true if xsection is present for the row.
+    bool has_xsection(size_t) const;
+  };
+
+  std::vector<char> arena;
+  definitions defs;
+  symbols refs;
+
+  elf_symbol_batch();
+  ~elf_symbol_batch();
+
+  // Removes all rows and strings.
+  void clear();
+
+  // Copies the string into the arena and returns its offset.
+  unsigned add_string(const_stringref);
+
+  // Returns the string at the offset, or NULL for no_string.
+  const char *string(unsigned) const;
+};
+
+inline size_t
+elf_symbol_batch::symbols::size() const
+{
+  return name.size();
+}
+
+inline const char *
+elf_symbol_batch::string(unsigned offset) const
+{
+  if (offset == no_string) {
+    return NULL;
+  }
+  return arena.data() + offset;
+}
+
+} // namespace cxxll
@@ -72,6 +72,10 @@ public:
   // The pointer is invalidated by a call to next().
   const char *name_ptr() const;
 
+  // Similar to name(), but without copying or computing the length.
+  // The reference is invalidated by a call to next().
+  const_stringref name_ref() const;
+
   // Returns the attributes.  Only valid with state() == START.
   std::map<std::string, std::string> attributes() const;
 
@@ -82,6 +86,10 @@ public:
   // Only valid with state() == START.
   std::string attribute(const char *name) const;
 
+  // Similar to attribute(), but returns NULL if the attribute is not
+  // present.  The pointer is invalidated by a call to next().
+  const char *attribute_ptr(const char *name) const;
+
   // Returns the contents of a text node.
   // Only valid with state() == TEXT.
   std::string text() const;
@@ -90,11 +98,19 @@ public:
   // The pointer is invalidated by a call to next().
   const char *text_ptr() const;
 
+  // Similar to text(), but without copying or computing the length.
+  // The reference is invalidated by a call to next().
+  const_stringref text_ref() const;
+
   // Consumes the current sequence of TEXT nodes and returns its
   // concatenation.  Afterwards, the new position is on a non-TEXT
   // node.
   std::string text_and_next();
 
+  // Similar to text_and_next(), but overwrites the passed-in string
+  // (whose storage is reused).
+  void text_and_next(std::string &);
+
   // Skips over the current element (and its contents), or the current
   // sequence of TEXT nodes.
   void skip();
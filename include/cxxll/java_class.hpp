@@ -18,12 +18,36 @@
 
 #pragma once
 
+#include <cxxll/const_stringref.hpp>
+
+#include <map>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace cxxll {
 
 class java_class {
+public:
+  // A field or method.  The name and descriptor indexes refer to
+  // CONSTANT_Utf8 entries in the constant pool.
+  struct member {
+    unsigned short access_flags;
+    unsigned short name_index;
+    unsigned short descriptor_index;
+  };
+
+  // A decoded CONSTANT_Fieldref, CONSTANT_Methodref or
+  // CONSTANT_InterfaceMethodref entry.  The strings refer to storage
+  // of the java_class object.
+  struct member_ref {
+    unsigned char tag;
+    const_stringref class_name;
+    const_stringref name;
+    const_stringref descriptor;
+  };
+
+private:
   const std::vector<unsigned char> *buffer_;
   
   unsigned short minor_version_;
@@ -35,9 +59,24 @@ class java_class {
   unsigned short super_class_;
 
   std::vector<unsigned> interface_indexes;
+  std::vector<member> fields_;
+  std::vector<member> methods_;
+  std::vector<unsigned short> member_reference_indexes;
 
-  std::string class_name(unsigned short index) const;
-  std::string utf8_string(unsigned short index) const;
+  // Constant pool indexes of the names of referenced classes, sorted
+  // by name and without duplicates.
+  std::vector<unsigned short> class_name_indexes;
+
+  // CONSTANT_Utf8 entries which are not valid UTF-8 as stored, after
+  // conversion from modified UTF-8.  Usually empty.
+  std::map<unsigned short, std::string> converted_strings;
+
+  const_stringref class_name(unsigned short index) const;
+  size_t constant_offset(unsigned short index, unsigned char tag) const;
+  void parse_members(size_t &offset, std::vector<member> &);
+  void sort_class_names();
+  struct class_name_less;
+  struct class_name_equal;
 
 public:
   // Returns true if the vector seems to contain a Java class.
@@ -48,6 +87,11 @@ public:
   explicit java_class(const std::vector<unsigned char> *);
   ~java_class();
 
+  // Parses another Java class, reusing the storage of this object.
+  // If an exception is thrown, the object must not be used until a
+  // later call to reset() succeeds.
+  void reset(const std::vector<unsigned char> *);
+
   // The underlying vector with the bytecode.
   const std::vector<unsigned char> &buffer() const;
 
@@ -70,20 +114,65 @@ public:
     CONSTANT_Long = 5,
     CONSTANT_Double = 6,
     CONSTANT_NameAndType = 12,
-    CONSTANT_Utf8 = 1
+    CONSTANT_Utf8 = 1,
+    CONSTANT_MethodHandle = 15,
+    CONSTANT_MethodType = 16,
+    CONSTANT_Dynamic = 17,
+    CONSTANT_InvokeDynamic = 18,
+    CONSTANT_Module = 19,
+    CONSTANT_Package = 20
   };
 
+  // Version of the class file format.
+  unsigned short major_version() const;
+  unsigned short minor_version() const;
+
+  // The string accessors returning const_stringref refer to the
+  // class file buffer or to storage of this object, and remain valid
+  // until the object is destroyed or reset.  Strings are converted
+  // from modified UTF-8 only if the bytes in the class file are not
+  // already valid UTF-8 (which means that they can contain NUL
+  // characters).
+
   unsigned short access_flags() const;
   std::string this_class() const;
+  const_stringref this_class_ref() const;
+  // The empty string for java/lang/Object.
   std::string super_class() const;
+  const_stringref super_class_ref() const;
 
-  // Returns a vector containing the names of all referenced classes.
+  // Returns a vector containing the names of all referenced classes,
+  // sorted and without duplicates.
   std::vector<std::string> class_references() const;
 
+  // Returns the number of distinct referenced classes and the name of
+  // the reference with the specified number, in the order of
+  // class_references().
+  unsigned class_reference_count() const;
+  const_stringref class_reference(unsigned index) const;
+
   // Returns the number of implemented interfaces and the name of the
   // implemented interface with the specified number.
   unsigned interface_count() const;
   std::string interface(unsigned index) const;
+  const_stringref interface_ref(unsigned index) const;
+
+  // Returns the number of fields and methods defined by the class,
+  // and the field or method with the specified number.
+  unsigned field_count() const;
+  const member &field(unsigned index) const;
+  unsigned method_count() const;
+  const member &method(unsigned index) const;
+
+  // Returns the CONSTANT_Utf8 entry at the constant pool index.
+  std::string utf8_string(unsigned short index) const;
+  const_stringref utf8_ref(unsigned short index) const;
+
+  // Returns the number of field and method references in the
+  // constant pool, and decodes the reference with the specified
+  // number.
+  unsigned member_reference_count() const;
+  void member_reference(unsigned index, member_ref &) const;
 
   // Thrown if the class format is malformed.
   class exception : public std::exception {
@@ -101,10 +190,58 @@ java_class::buffer() const
   return *buffer_;
 }
 
+inline unsigned short
+java_class::major_version() const
+{
+  return major_version_;
+}
+
+inline unsigned short
+java_class::minor_version() const
+{
+  return minor_version_;
+}
+
 inline unsigned short
 java_class::access_flags() const
 {
   return access_flags_;
 }
 
+inline unsigned
+java_class::field_count() const
+{
+  return fields_.size();
+}
+
+inline const java_class::member &
+java_class::field(unsigned index) const
+{
+  return fields_.at(index);
+}
+
+inline unsigned
+java_class::method_count() const
+{
+  return methods_.size();
+}
+
+inline const java_class::member &
+java_class::method(unsigned index) const
+{
+  return methods_.at(index);
+}
+
+inline unsigned
+java_class::class_reference_count() const
+{
+  return class_name_indexes.size();
+}
+
+inline unsigned
+java_class::member_reference_count() const
+{
+  return member_reference_indexes.size();
+}
+
 }
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cxxll/const_stringref.hpp>
+
+#include <vector>
+
+namespace cxxll {
+
+class java_class;
+
+// Columnar storage for the parsed data of several Java classes.
+// Strings are stored NUL-terminated in a single arena, and the
+// columns contain offsets into it.  The interfaces and class
+// references of row N are the elements of their columns starting at
+// the *_end value of row N - 1 (or zero) up to the *_end value of
+// row N.  Members and member references use the same scheme.
+struct java_class_batch {
+  // Length of a SHA-256 digest in the digest column.
+  static const unsigned digest_size = 32;
+
+  // Fields or methods, one element per member except for end, which
+  // has one element per class.
+  struct members {
+    std::vector<unsigned> end;
+    std::vector<unsigned short> access_flags;
+    std::vector<unsigned> name;
+    std::vector<unsigned> descriptor;
+
+    size_t size() const;
+    unsigned begin(size_t row) const;
+  };
+
+  // Field and method references from the constant pool, in the same
+  // layout as members.  The tag is the constant pool tag
+  // (java_class::CONSTANT_Fieldref etc.).
+  struct member_references {
+    std::vector<unsigned> end;
+    std::vector<unsigned char> tag;
+    std::vector<unsigned> class_name;
+    std::vector<unsigned> name;
+    std::vector<unsigned> descriptor;
+
+    size_t size() const;
+    unsigned begin(size_t row) const;
+  };
+
+  std::vector<char> arena;
+  std::vector<unsigned char> digest; // digest_size bytes per row
+  std::vector<unsigned> name;
+  std::vector<unsigned> super_class;
+  std::vector<unsigned short> access_flags;
+  std::vector<unsigned short> major_version;
+  std::vector<unsigned short> minor_version;
+  std::vector<unsigned> interfaces_end;
+  std::vector<unsigned> interfaces;
+  std::vector<unsigned> references_end;
+  std::vector<unsigned> references;
+  members fields;
+  members methods;
+  member_references member_refs;
+
+  java_class_batch();
+  ~java_class_batch();
+
+  // Returns the number of classes.
+  size_t size() const;
+
+  // Removes all rows and strings.
+  void clear();
+
+  // Adds a row for the class, with the SHA-256 digest of its buffer.
+  // The class references exclude the class itself,
+  // java/lang/Object and java/lang/String, and are deduplicated.
+  // Throws java_class::exception if the class is malformed or a name
+  // contains a NUL character, without adding a partial row.
+  void add(const java_class &);
+
+  // Adds the rows of the other batch, after the existing rows.
+  void append(const java_class_batch &);
+
+  // Copies the string into the arena and returns its offset.
+  unsigned add_string(const_stringref);
+
+  // Returns the string at the offset.
+  const char *string(unsigned) const;
+
+  // Returns the start of the digest for the row.
+  const unsigned char *digest_of(size_t row) const;
+
+  // Returns the index range of the row in the interfaces and
+  // references columns.
+  unsigned interfaces_begin(size_t row) const;
+  unsigned references_begin(size_t row) const;
+
+private:
+  struct mark;
+  static void append_offsets(std::vector<unsigned> &,
+			     const std::vector<unsigned> &, unsigned delta);
+  static void append_members(members &, const members &, unsigned arena);
+  void add_members(const java_class &, members &, bool methods);
+  unsigned add_name(const_stringref);
+};
+
+inline size_t
+java_class_batch::members::size() const
+{
+  return name.size();
+}
+
+inline unsigned
+java_class_batch::members::begin(size_t row) const
+{
+  return row == 0 ? 0 : end[row - 1];
+}
+
+inline size_t
+java_class_batch::member_references::size() const
+{
+  return name.size();
+}
+
+inline unsigned
+java_class_batch::member_references::begin(size_t row) const
+{
+  return row == 0 ? 0 : end[row - 1];
+}
+
+inline size_t
+java_class_batch::size() const
+{
+  return name.size();
+}
+
+inline const char *
+java_class_batch::string(unsigned offset) const
+{
+  return arena.data() + offset;
+}
+
+inline const unsigned char *
+java_class_batch::digest_of(size_t row) const
+{
+  return digest.data() + row * digest_size;
+}
+
+inline unsigned
+java_class_batch::interfaces_begin(size_t row) const
+{
+  return row == 0 ? 0 : interfaces_end[row - 1];
+}
+
+inline unsigned
+java_class_batch::references_begin(size_t row) const
+{
+  return row == 0 ? 0 : references_end[row - 1];
+}
+
+} // namespace cxxll
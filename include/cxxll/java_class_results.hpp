@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cxxll/java_class_batch.hpp>
+
+#include <string>
+#include <tr1/memory>
+#include <utility>
+#include <vector>
+
+namespace cxxll {
+
+class java_class;
+
+// Parsed Java classes, and the errors encountered while parsing
+// them.
+struct java_class_results {
+  java_class_batch batch;
+  std::vector<std::pair<std::string, std::string> > errors; // path, message
+  // Reused for all classes, so that its storage is allocated once.
+  std::tr1::shared_ptr<java_class> parser;
+
+  java_class_results();
+  ~java_class_results();
+
+  // Analyzes the Java class in DATA.  PATH is the name of the class
+  // within its archive (or empty).
+  void add(const std::vector<unsigned char> &data, const std::string &path);
+  void add_error(const std::string &path, const char *message);
+
+  // Adds the classes and errors of OTHER after the existing ones.
+  void append(const java_class_results &other);
+};
+
+// Parses the CLASSES class files in the ZIP archive in DATA, whose
+// central directory must have been read successfully up to the last
+// class file.  PREFIX is prepended to the entry names in errors.  The
+// class files are split into contiguous chunks, and the chunks run on
+// up to THREADS threads, including the current one.  The additional
+// threads count against a process-wide limit of THREADS - 1, so that
+// concurrent calls do not multiply the number of threads.  The
+// classes and errors are appended to RESULTS in the order of the
+// archive entries, so that the caller can store a single batch for
+// the archive.
+void parse_zip_classes(const unsigned char *data, size_t length,
+		       const std::string &prefix, unsigned long long classes,
+		       unsigned threads, java_class_results &results);
+
+// Parses the class files in the ZIP archive in DATA, descending into
+// nested *.jar, *.war and *.ear archives (with limits on the depth
+// and on the memory for decompressing them).  Paths within nested
+// archives are separated by "!/".  All classes and errors are
+// appended to RESULTS.  THREADS is passed to parse_zip_classes().
+void parse_java_archive(const unsigned char *data, size_t length,
+			unsigned threads, java_class_results &results);
+
+} // namespace cxxll
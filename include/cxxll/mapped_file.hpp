@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace cxxll {
+
+// Read-only, private memory mapping of a file.  The mapping remains
+// valid if the file is replaced or removed.
+class mapped_file {
+  mapped_file(const mapped_file &); // not implemented
+  mapped_file &operator=(const mapped_file &); // not implemented
+  const unsigned char *data_;
+  size_t size_;
+public:
+  // Maps the file at PATH.  Throws os_exception on error.
+  explicit mapped_file(const char *path);
+
+  // Unmaps the file.
+  ~mapped_file();
+
+  // Returns a pointer to the start of the mapping.  This is NULL if
+  // the file is empty.
+  const unsigned char *data() const;
+
+  // Returns the length of the file, in bytes.
+  size_t size() const;
+};
+
+inline const unsigned char *
+mapped_file::data() const
+{
+  return data_;
+}
+
+inline size_t
+mapped_file::size() const
+{
+  return size_;
+}
+
+} // namespace cxxll
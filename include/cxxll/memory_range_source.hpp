@@ -30,6 +30,7 @@ public:
   ~memory_range_source();
 
   size_t read(unsigned char *, size_t);
+  const_stringref borrow(size_t);
 };
 
 } // namespace cxxll
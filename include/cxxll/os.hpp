@@ -70,6 +70,14 @@ std::string realpath(const char *path);
 // past.
 double ticks();
 
+// Copies data from the IN descriptor to the OUT descriptor, starting
+// at the current file offsets, until end-of-file is reached on IN.
+// Uses copy_file_range(2), sendfile(2) or splice(2) if the
+// descriptors allow it, so that the data does not pass through user
+// space.  Non-blocking descriptors are waited for with poll(2).
+// Returns the number of bytes copied.  Throws os_exception on error.
+unsigned long long copy_fd_to_fd(int in, int out);
+
 // Turns an errno code into a string.  Uses ERROR(nnn) for unknown
 // errors.  Can throw std::bad_alloc.
 std::string error_string(int);
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "pg_query.hpp"
+#include "pgresult_handle.hpp"
+
+#include <string>
+
+namespace cxxll {
+
+class pgconn_handle;
+
+// Server-side cursor which retrieves the rows of a query in batches,
+// so that large result sets can be processed in constant memory.
+// Results are in binary format, as with pg_query_binary().  Decode
+// the current row with pg_response(result(), row(), ...).
+//
+// Cursors live inside a transaction.  If the connection is idle when
+// the query is declared, the cursor starts a transaction of its own
+// and commits it after the last row (or on destruction).  Other
+// statements can be executed on the connection while the cursor is
+// open, but they must not end the transaction.
+class pg_cursor {
+  pg_cursor(const pg_cursor &); // not implemented
+  pg_cursor &operator=(const pg_cursor &); // not implemented
+
+  pgconn_handle &conn_;
+  std::string name_;
+  std::string fetch_;
+  pgresult_handle res_;
+  int row_;
+  bool open_;
+  bool own_transaction_;
+
+  // Returns the DECLARE statement for SQL, starting a transaction if
+  // necessary.
+  std::string begin(const char *sql);
+
+  // Marks the cursor as open.
+  void declared();
+
+  // Closes the cursor and ends the transaction if we started it.
+  void finish();
+public:
+  // Prepares a cursor on the connection.  BATCH rows are fetched at a
+  // time.
+  explicit pg_cursor(pgconn_handle &, unsigned batch = 10000);
+
+  // Closes the cursor if it is still open.
+  ~pg_cursor() throw();
+
+  // Declares the cursor for the query SQL.  Up to three parameters
+  // are supported, with the same types as pg_query().
+  void declare(const char *sql);
+  template <class T1>
+  void declare(const char *sql, const T1 &);
+  template <class T1, class T2>
+  void declare(const char *sql, const T1 &, const T2 &);
+  template <class T1, class T2, class T3>
+  void declare(const char *sql, const T1 &, const T2 &, const T3 &);
+
+  // Advances to the next row.  Returns false if all rows have been
+  // consumed.
+  bool next();
+
+  // Returns the result set which contains the current row.
+  pgresult_handle &result();
+
+  // Returns the index of the current row in result().
+  int row() const;
+};
+
+template <class T1> void
+pg_cursor::declare(const char *sql, const T1 &t1)
+{
+  pg_private::pg_query<T1>(1, conn_, res_, begin(sql).c_str(), t1);
+  declared();
+}
+
+template <class T1, class T2> void
+pg_cursor::declare(const char *sql, const T1 &t1, const T2 &t2)
+{
+  pg_private::pg_query<T1, T2>(1, conn_, res_, begin(sql).c_str(), t1, t2);
+  declared();
+}
+
+template <class T1, class T2, class T3> void
+pg_cursor::declare(const char *sql, const T1 &t1, const T2 &t2, const T3 &t3)
+{
+  pg_private::pg_query<T1, T2, T3>
+    (1, conn_, res_, begin(sql).c_str(), t1, t2, t3);
+  declared();
+}
+
+inline pgresult_handle &
+pg_cursor::result()
+{
+  return res_;
+}
+
+inline int
+pg_cursor::row() const
+{
+  return row_;
+}
+
+} // namespace cxxll
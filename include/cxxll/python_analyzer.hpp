@@ -24,24 +24,40 @@
 
 namespace cxxll {
 
+class python_analyzer_pool;
+
 // Extractor for Python imports.  First call parse() with the Python
 // program, then error() or imports() to obtain the list of imports.
 // Member functions may throw os_exception in case of unexpected
-// errors.
+// errors.  The parsing happens in the interpreters of a
+// python_analyzer_pool, so creating analyzers is cheap.
 class python_analyzer {
   struct impl;
   std::tr1::shared_ptr<impl> impl_;
   python_analyzer(const python_analyzer &); // not implemented
   python_analyzer &operator=(const python_analyzer &); // not implemented
 public:
-  // Throws os_exception if no Python interpreter can be found.
+  // Uses the process-wide pool.
   python_analyzer();
+
+  // Uses the specified pool, which must outlive this object.
+  explicit python_analyzer(python_analyzer_pool &);
+
   ~python_analyzer();
 
   // Parses the Python source code SOURCE.  Returns true on success,
-  // false on failure.
+  // false on failure.  Throws os_exception if no Python interpreter
+  // can be found.
   bool parse(const std::vector<unsigned char> &source);
 
+  // Starts parsing SOURCE in the background.  The results of a
+  // previous parse are discarded.
+  void submit(const std::vector<unsigned char> &source);
+
+  // Waits for the parse started by submit() and returns its outcome,
+  // like parse().
+  bool wait();
+
   // Returns true if the previous call to parse() was successful.
   bool good() const;
 
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <tr1/memory>
+#include <string>
+#include <vector>
+
+namespace cxxll {
+
+// Pool of long-lived Python interpreters which parse source code on
+// behalf of python_analyzer.  Parse requests can be submitted from
+// any thread.  Worker threads pick up queued requests in batches and
+// pipeline each batch to their interpreters.  Interpreters which
+// terminate unexpectedly are restarted.  Recent results are memoized
+// by the SHA-256 digest of the source code, so identical sources
+// (for example, in several versions of a package) are parsed only
+// once.
+class python_analyzer_pool {
+  struct impl;
+  std::tr1::shared_ptr<impl> impl_;
+  python_analyzer_pool(const python_analyzer_pool &); // not implemented
+  python_analyzer_pool &operator=(const python_analyzer_pool &); // not implemented
+public:
+  // Outcome of parsing a single piece of source code.
+  struct result {
+    std::string error;		// empty on success
+    unsigned error_line;	// zero on success
+    unsigned version;		// Python version which produced the result
+    std::vector<std::string> imports;
+    std::vector<std::string> attributes;
+    std::vector<std::string> functions;
+    std::vector<std::string> classes;
+
+    result();
+  };
+
+  // A submitted parse request.
+  class request;
+  typedef std::tr1::shared_ptr<request> request_ptr;
+
+  // Creates a pool which uses up to WORKERS worker threads, each
+  // with its own set of interpreters.  Threads and interpreters are
+  // started on demand.  Interpreters of a worker which has been idle
+  // for IDLE_TIMEOUT seconds are shut down (zero disables this).
+  explicit python_analyzer_pool(unsigned workers,
+				unsigned idle_timeout = 60);
+
+  // Stops the worker threads and terminates the interpreters.
+  ~python_analyzer_pool();
+
+  // Returns the process-wide pool, with one worker per online CPU.
+  // The pool is created on first use.
+  static python_analyzer_pool &shared();
+
+  // Destroys the process-wide pool, terminating its interpreters.
+  // Must not be called while it is still in use.
+  static void shared_deinit();
+
+  // Returns the number of running interpreters.
+  unsigned interpreters() const;
+
+  // Queues a copy of SOURCE for parsing and returns immediately.
+  // Returns the memoized request if the same source code has been
+  // submitted before.
+  request_ptr submit(const std::vector<unsigned char> &source);
+
+  // Waits until the request has been processed and returns its
+  // result.  Throws os_exception if no interpreter could be started,
+  // or if the interpreter terminated repeatedly while processing the
+  // request.
+  const result &wait(const request_ptr &);
+};
+
+} // namespace cxxll
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <tr1/memory>
+#include <string>
+#include <vector>
+
+namespace cxxll {
+
+// Native extractor for the Python properties which python_analyzer
+// reports: imports, attribute references, and (nested) function and
+// class definitions.  It works on the token level and does not need
+// a Python interpreter.  Besides the tokens, brackets, indentation
+// and import statements, it checks how adjacent tokens fit together,
+// and which Python versions can accept the syntax, but it does not
+// parse the complete grammar.  For source code it cannot handle
+// reliably (f-strings, unusual encodings, non-ASCII identifiers,
+// tokenization or indentation errors, token sequences which no
+// Python version accepts, soft keywords such as "match"), scan()
+// fails, and the caller should use python_analyzer instead.
+class python_scanner {
+  struct impl;
+  std::tr1::shared_ptr<impl> impl_;
+  python_scanner(const python_scanner &); // not implemented
+  python_scanner &operator=(const python_scanner &); // not implemented
+public:
+  python_scanner();
+  ~python_scanner();
+
+  // Scans the Python source code SOURCE.  Returns true if the
+  // results are available, false if the source has to be analyzed by
+  // a Python interpreter.
+  bool scan(const std::vector<unsigned char> &source);
+
+  // The results of the last successful scan(), in the same form as
+  // the python_analyzer results.  Imports are listed in source order,
+  // the other names sorted and without duplicates.
+  const std::vector<std::string> &imports() const;
+  const std::vector<std::string> &attributes() const;
+  const std::vector<std::string> &functions() const;
+  const std::vector<std::string> &classes() const;
+};
+
+} // namespace cxxll
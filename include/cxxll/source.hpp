@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <cxxll/const_stringref.hpp>
+
 #include <cstddef>
 
 namespace cxxll {
@@ -28,6 +30,14 @@ struct source {
 
   // Returns 0 on end-of-stream.  Must throw an exception on error.
   virtual size_t read(unsigned char *, size_t) = 0;
+
+  // Consumes up to LENGTH bytes without copying them, by returning a
+  // reference to data held by the source itself.  The data remains
+  // valid until the next call to a member function.  An empty result
+  // does not indicate end-of-stream; it means that read() has to be
+  // used instead.  The default implementation returns an empty
+  // reference.
+  virtual const_stringref borrow(size_t length);
 };
 
 // Read the required amount of bytes.  Throws eof_exception if not
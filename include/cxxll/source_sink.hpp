@@ -20,13 +20,28 @@
 
 #pragma once
 
+#include <cstddef>
+
 namespace cxxll {
 
 class source;
 class sink;
 
+// Default buffer size for copy_source_to_sink.  Large enough to
+// amortize the per-call overhead of system calls and hashing.
+const size_t copy_buffer_size = 64 * 1024;
+
 // Copies bytes from SOURCE to SINK.  Returns the total number of
-// bytes copied.
+// bytes copied.  Uses a buffer of copy_buffer_size bytes on the
+// stack.
 unsigned long long copy_source_to_sink(source &, sink &);
 
+// Copies bytes from SOURCE to SINK, in chunks of at most BUFFER_SIZE
+// bytes, using the caller-supplied BUFFER.  If the source supports
+// source::borrow(), the data is passed to the sink without an
+// intermediate copy.  Returns the total number of bytes copied.
+unsigned long long copy_source_to_sink(source &, sink &,
+				       unsigned char *buffer,
+				       size_t buffer_size);
+
 } // namespace cxxll
@@ -33,6 +33,7 @@ struct string_source : source {
   ~string_source();
 
   virtual size_t read(unsigned char *, size_t);
+  virtual const_stringref borrow(size_t);
 };
 
 } // namespace cxxll
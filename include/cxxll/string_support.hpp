@@ -40,6 +40,9 @@ whitespace(char ch)
 // Removes leading and trailing whitespace.
 std::string strip(const std::string &);
 
+// Removes leading and trailing whitespace, modifying the argument.
+void strip_inplace(std::string &);
+
 template <unsigned N> bool
 starts_with(const std::string &s, const char (&pattern)[N])
 {
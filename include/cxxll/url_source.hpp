@@ -36,6 +36,11 @@ public:
   explicit url_source(const std::string &url);
   ~url_source();
 
+  // Requests only the bytes from FIRST to LAST (inclusive).  Must be
+  // called before connect().  The server may ignore the range and
+  // return the full document.
+  void range(unsigned long long first, unsigned long long last);
+
   // Establishes the connection.  This fixes all connection
   // parameters.
   void connect();
@@ -18,13 +18,17 @@
 
 #pragma once
 
+#include <stdexcept>
 #include <string>
 #include <tr1/memory>
 #include <vector>
 
 namespace cxxll {
 
-// Parses a blob into a ZIP file.
+// Parses a blob into a ZIP file.  The entries are enumerated from the
+// central directory at the end of the blob, so skipping an entry does
+// not require decompressing it.  Stored and deflated entries are
+// supported, including the ZIP64 extensions.
 class zip_file {
   struct impl;
   std::tr1::shared_ptr<impl> impl_;
@@ -34,21 +38,44 @@ public:
   // Returns true if the vector starts with the PK\003\004 signature
   // (although this is optional).
   static bool has_signature(const std::vector<unsigned char> &); 
+  static bool has_signature(const unsigned char *, size_t);
 
   // Does not take ownership of the pointer.
   explicit zip_file(const std::vector<unsigned char> *);
+
+  // Reads the ZIP file from the memory range, without copying it.
+  zip_file(const unsigned char *, size_t);
   ~zip_file();
 
   // Calls this to load the first and subsequent file entries.
+  // Throws zip_file::exception if the central directory is corrupted.
   bool next();
 
   // Returns the name of the current entry.
   std::string name() const;
 
-  // Loads the data for the current entry into the vector.  Only works
-  // once per entry.
+  // Returns the uncompressed size of the current entry, as recorded
+  // in the central directory.
+  unsigned long long size() const;
+
+  // Decompresses the data for the current entry into the vector,
+  // replacing its previous contents.  Throws zip_file::exception if
+  // the entry cannot be decompressed or its checksum does not match.
   void data(std::vector<unsigned char> &);
+
+  // If the current entry is stored without compression, checks its
+  // CRC, sets the pointer and length to its location within the ZIP
+  // buffer, and returns true.  Returns false for compressed entries.
+  bool data_in_place(const unsigned char *&, size_t &);
+
+  // Thrown if the ZIP file is malformed or uses unsupported features.
+  class exception : public std::exception {
+    std::string what_;
+  public:
+    explicit exception(const char *);
+    ~exception() throw();
+    const char *what() const throw();
+  };
 };
 
 } // namespace cxxll
-
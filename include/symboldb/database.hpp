@@ -18,8 +18,10 @@
 
 #pragma once
 
+#include <cxxll/elf_image.hpp>
 #include <cxxll/tagged.hpp>
 
+#include <map>
 #include <stdexcept>
 #include <string>
 #include <tr1/memory>
@@ -31,10 +33,11 @@ namespace cxxll {
   class rpm_package_info;
   class rpm_script;
   class rpm_trigger;
-  class elf_image;
   class elf_symbol_definition;
   class elf_symbol_reference;
+  struct elf_symbol_batch;
   class java_class;
+  struct java_class_batch;
   class maven_url;
 }
 
@@ -129,6 +132,11 @@ public:
   // Returns 0 if the package ID was not found.
   package_id package_by_digest(const std::vector<unsigned char> &digest);
 
+  // Looks up a package ID by the SHA1HEADER hash (40 hexadecimal
+  // characters, see rpm_package_info::hash).  Returns 0 if the
+  // package ID was not found.
+  package_id package_by_header_hash(const std::string &hash);
+
   // Adds a dependency for the package.
   void add_package_dependency(package_id, const cxxll::rpm_dependency &);
 
@@ -161,14 +169,19 @@ public:
 
   // Loading ELF-related tables.
 
-  // Populates the elf_file table.  SONAME can be NULL.
-  // Loads the elf_program_header table as well.
-  void add_elf_image(contents_id, const cxxll::elf_image &, const char *soname);
+  // Populates the elf_file table.  SONAME can be NULL.  SYMBOLS
+  // records which symbols are loaded for the image.  Loads the
+  // elf_program_header table as well.
+  void add_elf_image(contents_id, const cxxll::elf_image &, const char *soname,
+		     cxxll::elf_image::symbol_selection symbols);
 
   void add_elf_symbol_definition(contents_id,
 				 const cxxll::elf_symbol_definition &);
   void add_elf_symbol_reference(contents_id,
 				const cxxll::elf_symbol_reference &);
+  // Loads all definitions and references in the batch, using one
+  // COPY statement per table.
+  void add_elf_symbols(contents_id, const cxxll::elf_symbol_batch &);
   void add_elf_needed(contents_id, const char *);
   void add_elf_rpath(contents_id, const char *);
   void add_elf_runpath(contents_id, const char *);
@@ -183,6 +196,10 @@ public:
 
   // Java support.
   void add_java_class(contents_id, const cxxll::java_class &);
+  // Adds all classes in the batch, as if by add_java_class().  The
+  // batch is staged using COPY, and the number of statements does
+  // not depend on the number of classes.
+  void add_java_classes(contents_id, const cxxll::java_class_batch &);
   void add_java_error(contents_id,
 		      const char *message, const std::string &path);
   void add_maven_url(contents_id, const cxxll::maven_url &);
@@ -222,6 +239,10 @@ public:
   // Update packet-set-wide helper tables (such as ELF linkage).
   void update_package_set_caches(package_set_id);
 
+  // Writes a columnar snapshot of the package set to PATH, for use
+  // with set_snapshot.
+  void write_set_snapshot(package_set_id, const char *path);
+
   // Returns true if the URL has been cached with expected length and
   // modification time, and overwrites data.  Returns false otherwise.
   bool url_cache_fetch(const char *url, size_t expected_length,
@@ -272,6 +293,71 @@ public:
     // The path within the RPM file.
     const std::string &file_name() const;
   };
+
+  // Iterates over the symbols exported by the DSOs in the package
+  // set, ordered by architecture, soname, symbol name and version
+  // (byte-wise).  Position-independent executables are not DSOs for
+  // this purpose.  Each combination is returned once.  The rows are
+  // fetched in batches from a server-side cursor, so this has to be
+  // used within a transaction.
+  class exported_symbols {
+    struct impl;
+    std::tr1::shared_ptr<impl> impl_;
+    exported_symbols(const exported_symbols &); // not implemented
+    exported_symbols &operator=(const exported_symbols &); // not implemented
+  public:
+    exported_symbols(database &, package_set_id);
+    ~exported_symbols();
+
+    bool next();
+
+    const std::string &arch() const;
+
+    // The soname, or the file name if the DSO lacks a soname.
+    const std::string &soname() const;
+
+    const std::string &name() const;
+
+    // Empty for unversioned symbols.
+    const std::string &version() const;
+    bool default_version() const;
+
+    // STT_* constant.
+    int type() const;
+  };
+
+  // Number of files in the package set which depend on a DSO,
+  // according to elf_closure.  Keyed by architecture and soname (as
+  // in exported_symbols).
+  typedef std::map<std::pair<std::string, std::string>, long long>
+    dso_consumer_map;
+  void dso_consumers(package_set_id, dso_consumer_map &);
+
+  // Obtains the ELF files with the specified build ID.  A stripped
+  // binary and its separate debugging information under
+  // /usr/lib/debug share the build ID, so both are returned.  Call
+  // next() until it returns false, and use the accessors to obtain
+  // the location of individual files.
+  class files_with_build_id {
+    struct impl;
+    std::tr1::shared_ptr<impl> impl_;
+    files_with_build_id(const files_with_build_id &); // not implemented
+    files_with_build_id &operator=(const files_with_build_id &); // not implemented
+  public:
+    files_with_build_id(database &, const std::vector<unsigned char> &);
+    ~files_with_build_id();
+
+    bool next();
+
+    package_id package() const;
+    contents_id contents() const;
+
+    // The NEVRA of the package.
+    const std::string &nevra() const;
+
+    // The path within the RPM file.
+    const std::string &file_name() const;
+  };
 };
 
 template <class RandomAccessIterator> database::advisory_lock
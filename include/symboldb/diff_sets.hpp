@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+class symboldb_options;
+class database;
+
+// Compares the symbols exported by the DSOs in the package sets
+// OLD_SET and NEW_SET and prints the removed, added and changed
+// symbols.  Returns the process exit status.
+int symboldb_diff_sets(const symboldb_options &, database &,
+		       const char *old_set, const char *new_set);
+
+// Same, but writes the differences to OUT instead of standard
+// output.
+int symboldb_diff_sets(const symboldb_options &, database &,
+		       const char *old_set, const char *new_set, FILE *out);
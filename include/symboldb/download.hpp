@@ -35,6 +35,11 @@ struct download_options {
     only_cache			// only use the cache, no network
   } cache_mode;
 
+  // If not zero, only the first PREFIX bytes are needed.  The network
+  // request is limited to this range, and the partial data is not
+  // stored in the cache.
+  unsigned long long prefix;
+
   download_options();
 };
 
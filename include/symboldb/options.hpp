@@ -19,6 +19,7 @@
 #pragma once
 
 #include "download.hpp"
+#include <cxxll/elf_image.hpp>
 #include <cxxll/file_cache.hpp>
 #include <cxxll/regex_handle.hpp>
 
@@ -38,6 +39,10 @@ public:
   std::string cache_path;
   unsigned download_threads;
 
+  // Number of threads which analyze the files within one RPM.  With
+  // 1 (the default), files are processed sequentially.
+  unsigned load_threads;
+
   bool no_net;
 
   // If true, incomplete package sets with download errors are still
@@ -50,6 +55,18 @@ public:
   // Delete RPMs if they were downloaded just before loading.
   bool transient_rpms;
 
+  // Download RPM headers first and skip the payload if the header
+  // hash is already present in the database.
+  bool header_fast_track;
+
+  // Symbol tables loaded from ELF files.  The default is to load all
+  // symbols.
+  cxxll::elf_image::symbol_selection elf_symbols;
+
+  // Sets elf_symbols from its string representation.  Throws
+  // usage_error if the string is invalid.
+  void set_elf_symbols(const char *);
+
   symboldb_options();
   ~symboldb_options();
 
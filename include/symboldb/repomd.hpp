@@ -65,14 +65,26 @@ struct repomd {
     std::tr1::shared_ptr<impl> impl_;
     primary_xml(const primary_xml &); // not implemented
     primary_xml &operator=(const primary_xml &); // not implemented
+    void init(const repomd &, const download_options &, database &,
+	      const char *type);
   public:
     // Download the primary.xml file from the repository.  You can use
     // download_options::always_cache because usually, the file name
     // embeds a hash of the file, so if we have a matching entry in
     // the cache, we know that it has the right contents.
     primary_xml(const repomd &, const download_options &, database &);
+
+    // Downloads and decompresses another metadata file, such as
+    // "primary_db".  Throws runtime_error if there is no TYPE entry
+    // in a supported compression format.
+    primary_xml(const repomd &, const download_options &, database &,
+		const char *type);
     ~primary_xml();
 
+    // Returns true if the repository has a TYPE entry in a supported
+    // compression format.
+    static bool available(const repomd &, const char *type);
+
     // Returns the full URL for the (compressed) primary.xml file.
     const std::string &url();
 
@@ -101,5 +113,37 @@ struct repomd {
     // From <location>, Already combined with the base URL or the
     // xml:base algorithm, accordingq to the yum algorithm.
     const std::string &href() const;
+
+    // From <rpm:header-range>.  The (exclusive) end offset of the
+    // main RPM header in the file, or 0 if the element is missing.
+    // The RPM prefix up to this offset suffices to compute the
+    // header hash.
+    unsigned long long header_end() const;
+  };
+
+  // Iterator over an (uncompressed) primary_db SQLite database.
+  // Provides the same accessors as the primary class.
+  class primary_db {
+    struct impl;
+    std::tr1::shared_ptr<impl> impl_;
+  public:
+    // PATH is the file name of the database.  BASE_URL is the URL
+    // relative to which non-absolute URLs are interpreted.
+    primary_db(const char *path, const char *base_url);
+
+    // Copies the database from SOURCE (usually a primary_xml object
+    // for "primary_db") to a temporary file, which is removed by the
+    // destructor.
+    primary_db(cxxll::source *, const char *base_url);
+    ~primary_db();
+
+    // Advances the iterator to the next package.
+    bool next();
+
+    // Accessors for package attributes.
+    const cxxll::rpm_package_info &info() const; // without hash
+    const cxxll::checksum &checksum() const;
+    const std::string &href() const;
+    unsigned long long header_end() const;
   };
 };
@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cxxll/const_stringref.hpp>
+
+#include <tr1/memory>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+
+// Read-only columnar snapshot of a package set, written by
+// write_set_snapshot() and accessed through a memory mapping.
+//
+// Each table is stored as a set of columns of 32-bit integers.
+// Strings are replaced by indices into a dictionary of unique
+// strings, which is sorted by byte order, so that comparisons of
+// string IDs are equivalent to string comparisons.  The
+// definitions and references tables are sorted by (name, version,
+// ELF file), the packages table by NEVRA, and the files table by
+// name, so that they can be searched with equal_range().
+//
+// The file starts with a header which contains a magic value, the
+// format version, and the offset and length of each section.  All
+// integers are stored in host byte order.
+class set_snapshot {
+  struct impl;
+  std::tr1::shared_ptr<impl> impl_;
+public:
+  // Sections of the file.  The numeric values are part of the file
+  // format.
+  enum section {
+    string_offsets,	// uint64_t, string_count() + 1 elements
+    string_data,	// characters
+    package_name,
+    package_nevra,
+    package_arch,
+    elf_type,		// e_type
+    elf_machine,	// e_machine
+    elf_class,		// ei_class
+    elf_arch,
+    elf_soname,		// empty if not present
+    elf_interp,		// empty if not present
+    file_package,
+    file_name,
+    file_mode,
+    file_user,
+    file_group,
+    file_elf,		// none if not an ELF file
+    definition_elf,
+    definition_name,
+    definition_version,	// empty if unversioned
+    definition_type,
+    definition_binding,
+    definition_visibility,
+    definition_default_version, // 1 for foo@@VERS, 0 for foo@VERS and
+				// unversioned definitions
+    reference_elf,
+    reference_name,
+    reference_version,	// empty if unversioned
+    reference_type,
+    reference_binding,
+    reference_visibility,
+    program_header_elf,
+    program_header_type,
+    program_header_flags, // PF_R, PF_W, PF_X
+    needed_elf,
+    needed_name,
+    closure_file,
+    closure_needed,
+    section_count
+  };
+
+  // Magic value at the start of the file, and the format version.
+  static const char magic[8];
+  static const uint32_t version = 1;
+
+  // Header at the start of the file, followed by section_count
+  // entries.  Section offsets are aligned to 8 bytes.
+  struct file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t sections;
+  };
+  struct section_entry {
+    uint64_t offset;
+    uint64_t length;		// number of elements
+  };
+
+  // Row index which indicates the absence of a referenced row.
+  static const uint32_t none = 0xFFFFFFFFU;
+
+  // Tables.  The string columns contain string IDs, and the
+  // reference columns contain row indices in the referenced table.
+  struct packages_table {
+    size_t size;
+    const uint32_t *name;
+    const uint32_t *nevra;
+    const uint32_t *arch;
+  };
+  struct elf_files_table {
+    size_t size;
+    const uint32_t *type;
+    const uint32_t *machine;
+    const uint32_t *elf_class;
+    const uint32_t *arch;
+    const uint32_t *soname;
+    const uint32_t *interp;
+  };
+  struct files_table {
+    size_t size;
+    const uint32_t *package;
+    const uint32_t *name;
+    const uint32_t *mode;
+    const uint32_t *user;
+    const uint32_t *group;
+    const uint32_t *elf;
+  };
+  struct definitions_table {
+    size_t size;
+    const uint32_t *elf;
+    const uint32_t *name;
+    const uint32_t *version;
+    const uint32_t *type;
+    const uint32_t *binding;
+    const uint32_t *visibility;
+    const uint32_t *default_version;
+  };
+  struct references_table {
+    size_t size;
+    const uint32_t *elf;
+    const uint32_t *name;
+    const uint32_t *version;
+    const uint32_t *type;
+    const uint32_t *binding;
+    const uint32_t *visibility;
+  };
+  struct program_headers_table {
+    size_t size;
+    const uint32_t *elf;
+    const uint32_t *type;
+    const uint32_t *flags;
+  };
+  struct needed_table {
+    size_t size;
+    const uint32_t *elf;
+    const uint32_t *name;
+  };
+  // ELF closure.  Both columns refer to the files table.
+  struct closure_table {
+    size_t size;
+    const uint32_t *file;
+    const uint32_t *needed;
+  };
+
+  // Maps the snapshot at PATH and validates its structure.  Throws
+  // os_exception if the file cannot be opened, and
+  // std::runtime_error if it is not a valid snapshot.
+  explicit set_snapshot(const char *path);
+  ~set_snapshot();
+
+  // Returns the number of strings in the dictionary.  ID 0 is the
+  // empty string.
+  size_t string_count() const;
+
+  // Returns the string with the ID.  The reference stays valid as
+  // long as this object exists.
+  cxxll::const_stringref string(uint32_t) const;
+
+  // Looks up the ID of STR.  Returns false if the string does not
+  // occur in the snapshot.
+  bool find_string(cxxll::const_stringref str, uint32_t &id) const;
+
+  // Returns the half-open range of the IDs of all strings which
+  // start with PREFIX.
+  std::pair<uint32_t, uint32_t> prefix_range(cxxll::const_stringref) const;
+
+  const packages_table &packages() const;
+  const elf_files_table &elf_files() const;
+  const files_table &files() const;
+  const definitions_table &definitions() const;
+  const references_table &references() const;
+  const program_headers_table &program_headers() const;
+  const needed_table &needed() const;
+  const closure_table &closure() const;
+
+  // Scans.  These append the indices of the matching rows to ROWS,
+  // in increasing order.  The loops are written so that the
+  // compiler can vectorize them.
+
+  // Rows with COLUMN[i] == VALUE.
+  static void select_equal(const uint32_t *column, size_t size,
+			   uint32_t value, std::vector<uint32_t> &rows);
+
+  // Rows with FIRST <= COLUMN[i] < LAST.  Combined with
+  // prefix_range(), this matches string prefixes.
+  static void select_range(const uint32_t *column, size_t size,
+			   uint32_t first, uint32_t last,
+			   std::vector<uint32_t> &rows);
+
+  // Rows with (COLUMN[i] & MASK) != 0.
+  static void select_bits(const uint32_t *column, size_t size,
+			  uint32_t mask, std::vector<uint32_t> &rows);
+
+  // Returns the half-open row range with COLUMN[i] == VALUE.  COLUMN
+  // must be sorted.
+  static std::pair<size_t, size_t>
+  equal_range(const uint32_t *column, size_t size, uint32_t value);
+};
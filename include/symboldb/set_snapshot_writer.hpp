@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <symboldb/set_snapshot.hpp>
+
+// Writes a set_snapshot file.  The file is created under a temporary
+// name and replaces PATH when commit() is called, so that existing
+// readers are not disturbed.
+class set_snapshot_writer {
+  struct impl;
+  std::tr1::shared_ptr<impl> impl_;
+public:
+  // Creates the temporary file.  Throws os_exception on error.
+  explicit set_snapshot_writer(const char *path);
+
+  // Removes the temporary file if commit() has not been called.
+  ~set_snapshot_writer();
+
+  // Adds the string to the dictionary and returns its ID.  The first
+  // string must be empty, and the strings must be strictly
+  // increasing in byte order.  All strings have to be added before
+  // the first column is written.
+  uint32_t add_string(cxxll::const_stringref);
+
+  // Writes the column for SECTION, which must not be one of the
+  // string sections.  Each column must be written exactly once.
+  void write(set_snapshot::section, const std::vector<uint32_t> &);
+
+  // Writes the file header and renames the file to its final name.
+  // The file permissions follow the umask, as for open(2).
+  void commit();
+};
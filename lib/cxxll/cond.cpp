@@ -19,6 +19,9 @@
 #include <cxxll/cond.hpp>
 #include <cxxll/os_exception.hpp>
 
+#include <errno.h>
+#include <time.h>
+
 void
 cxxll::cond::throw_init_error(int errcode)
 {
@@ -31,6 +34,12 @@ cxxll::cond::throw_wait_error(int errcode)
   throw os_exception(errcode).function(pthread_cond_wait).defaults();
 }
 
+void
+cxxll::cond::throw_timedwait_error(int errcode)
+{
+  throw os_exception(errcode).function(pthread_cond_timedwait).defaults();
+}
+
 void
 cxxll::cond::throw_signal_error(int errcode)
 {
@@ -42,3 +51,22 @@ cxxll::cond::throw_broadcast_error(int errcode)
 {
   throw os_exception(errcode).function(pthread_cond_broadcast).defaults();
 }
+
+bool
+cxxll::cond::timed_wait(mutex &mut, unsigned seconds)
+{
+  // pthread_cond_timedwait() uses the realtime clock by default.
+  timespec deadline;
+  if (clock_gettime(CLOCK_REALTIME, &deadline) != 0) {
+    throw os_exception().function(clock_gettime).defaults();
+  }
+  deadline.tv_sec += seconds;
+  int ret = pthread_cond_timedwait(&cond_, mut.get(), &deadline);
+  if (ret == ETIMEDOUT) {
+    return false;
+  }
+  if (ret != 0) {
+    throw_timedwait_error(ret);
+  }
+  return true;
+}
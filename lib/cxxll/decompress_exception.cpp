@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/decompress_exception.hpp>
+
+using namespace cxxll;
+
+decompress_exception::decompress_exception(const char *msg)
+  : what_(msg ? msg : "decompression error")
+{
+}
+
+decompress_exception::~decompress_exception() throw()
+{
+}
+
+const char *
+decompress_exception::what() const throw()
+{
+  return what_.c_str();
+}
@@ -19,8 +19,6 @@
 #include <cxxll/elf_exception.hpp>
 #include <cxxll/raise.hpp>
 
-#include <libelf.h>
-
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,7 +26,7 @@
 using namespace cxxll;
 
 elf_exception::elf_exception()
-  : std::runtime_error(elf_errmsg(-1))
+  : std::runtime_error("invalid ELF image")
 {
 }
 
@@ -40,12 +40,15 @@
 #include <cxxll/elf_image.hpp>
 #include <cxxll/elf_symbol_definition.hpp>
 #include <cxxll/elf_symbol_reference.hpp>
+#include <cxxll/elf_symbol_batch.hpp>
 #include <cxxll/elf_exception.hpp>
+#include <cxxll/raise.hpp>
+
+#include <elf.h>
+#include <algorithm>
+#include <map>
 
-#include <libelf.h>
-#include <gelf.h>
 #include <string.h>
-#include <stdio.h>
 
 using namespace cxxll;
 
@@ -82,10 +85,107 @@ get_arch(unsigned char ei_class, unsigned short e_machine)
   return NULL;
 }
 
+namespace {
+  // Region of the ELF image (typically the contents of a section).
+  // The offset is relative to the start of the image.
+  struct extent {
+    unsigned long long offset;
+    unsigned long long size;
+
+    extent()
+      : offset(0), size(0)
+    {
+    }
+
+    extent(unsigned long long o, unsigned long long s)
+      : offset(o), size(s)
+    {
+    }
+
+    bool empty() const
+    {
+      return size == 0;
+    }
+
+    // Returns true if an object of LENGTH bytes at POS fits into the
+    // extent.
+    bool contains(unsigned long long pos, unsigned long long length) const
+    {
+      return pos <= size && length <= size - pos;
+    }
+  };
+
+  // Decoded section header.
+  struct section_header {
+    unsigned type;
+    unsigned long long flags;
+    unsigned long long offset;
+    unsigned long long size;
+    unsigned link;
+    unsigned info;
+    unsigned long long entsize;
+  };
+
+  // Decoded program header.
+  struct program_header {
+    unsigned type;
+    unsigned flags;
+    unsigned long long offset;
+    unsigned long long vaddr;
+    unsigned long long paddr;
+    unsigned long long filesz;
+    unsigned long long memsz;
+    unsigned long long align;
+  };
+
+  // Sizes of the on-disk structures which differ between ELFCLASS32
+  // and ELFCLASS64.
+  struct class_layout {
+    unsigned ehdr;
+    unsigned shdr;
+    unsigned phdr;
+    unsigned sym;
+    unsigned dyn;
+  };
+
+  const class_layout layout32 = {52, 40, 32, 16, 8};
+  const class_layout layout64 = {64, 64, 56, 24, 16};
+
+  // Sizes of the version structures (identical for both classes).
+  enum {
+    VERSYM_SIZE = 2,
+    VERNEED_SIZE = 16,
+    VERNAUX_SIZE = 16,
+    VERDEF_SIZE = 20,
+    VERDAUX_SIZE = 8,
+    NHDR_SIZE = 12
+  };
+}
+
 struct elf_image::impl {
-  Elf *elf;
+  const unsigned char *start;
+  size_t size;
+  bool msb;			// big endian
+  bool is64;
+  const class_layout *layout;
   size_t phnum;
   size_t shnum;
+  size_t shstrndx;
+  std::vector<section_header> sections;
+  std::vector<program_header> segments;
+
+  // Section index, built once by index_sections() so that the
+  // iterators do not have to scan the section headers repeatedly.
+  std::vector<size_t> symbol_tables; // SHT_SYMTAB and SHT_DYNSYM
+  std::vector<size_t> note_sections; // allocated SHT_NOTE
+  // Companion sections of a symbol table, indexed by the section
+  // index of the symbol table (zero if missing).
+  std::vector<size_t> versym_of;
+  std::vector<size_t> xndx_of;
+  size_t verneed;
+  size_t verdef;
+  // First section with file data at a given offset.
+  std::map<unsigned long long, size_t> by_offset;
   unsigned char ei_class;
   unsigned char ei_data;
   unsigned short e_type;
@@ -94,135 +194,476 @@ struct elf_image::impl {
   std::string interp;
   std::vector<unsigned char> build_id;
 
-  impl(const void *start, size_t size)
-    : elf(NULL)
-  {
-    char *p = const_cast<char *>(static_cast<const char *>(start));
-    elf = elf_memory(p, size);
-    if (elf == NULL) {
-      throw elf_exception();
-    }
+  impl(const void *start, size_t size);
+
+  // Bounds-checked accessors for the raw image.  Multi-byte values
+  // are converted from the byte order of the image.
+  void check(unsigned long long offset, unsigned long long length) const;
+  unsigned u8(unsigned long long offset) const;
+  unsigned u16(unsigned long long offset) const;
+  unsigned u32(unsigned long long offset) const;
+  unsigned long long u64(unsigned long long offset) const;
+  // 32-bit or 64-bit value, depending on the ELF class.
+  unsigned long long word(unsigned long long offset) const;
+
+  // Reads an integer at offset POS within the extent E.
+  unsigned u16(const extent &e, unsigned long long pos) const;
+  unsigned u32(const extent &e, unsigned long long pos) const;
+
+  // Returns the contents of the section, or an empty extent if the
+  // section index is invalid, the section has no data in the file,
+  // or the data is out of bounds.  (This mirrors the behavior of
+  // elf_getdata.)
+  extent section_data(size_t index) const;
+
+  // Returns the NUL-terminated string at OFFSET in the string table
+  // section INDEX.  Throws elf_exception if the string is invalid.
+  const_stringref string(size_t index, unsigned long long offset) const;
+
+  // Returns the section index whose file offset is OFFSET, or 0 if
+  // there is no such section.
+  size_t section_at_offset(unsigned long long offset) const;
+
+  void read_section_headers(unsigned long long shoff, unsigned e_shnum,
+			    unsigned e_shstrndx);
+  void read_program_headers(unsigned long long phoff, unsigned e_phnum);
+  void index_sections();
+  void set_interp();
+  void set_build_id();
+  bool set_build_id_from_notes(const extent &, unsigned long long align);
+};
 
-    GElf_Ehdr ehdr_mem;
-    GElf_Ehdr *ehdr = gelf_getehdr (elf, &ehdr_mem);
-    if (ehdr == NULL) {
-      elf_exception::raise("cannot read ELF header: %s", elf_errmsg (-1));
-    }
-    ei_class = ehdr->e_ident[EI_CLASS];
-    ei_data = ehdr->e_ident[EI_DATA];
-    e_type = ehdr->e_type;
-    e_machine = ehdr->e_machine;
-    arch = get_arch(ei_class, e_machine);
-
-    if (elf_getshdrnum (elf, &shnum) < 0) {
-      throw elf_exception();
-    }
-    if (elf_getphdrnum (elf, &phnum) < 0) {
-      throw elf_exception();
-    }
+elf_image::impl::impl(const void *s, size_t sz)
+  : start(static_cast<const unsigned char *>(s)), size(sz),
+    msb(false), is64(false), layout(&layout32), phnum(0), shnum(0),
+    shstrndx(0), verneed(0), verdef(0)
+{
+  if (size < EI_NIDENT || memcmp(start, ELFMAG, SELFMAG) != 0) {
+    throw elf_exception("not an ELF image");
+  }
+  ei_class = start[EI_CLASS];
+  ei_data = start[EI_DATA];
+  switch (ei_class) {
+  case ELFCLASS32:
+    is64 = false;
+    layout = &layout32;
+    break;
+  case ELFCLASS64:
+    is64 = true;
+    layout = &layout64;
+    break;
+  default:
+    elf_exception::raise("invalid ELF class: %u", ei_class);
+  }
+  switch (ei_data) {
+  case ELFDATA2LSB:
+    msb = false;
+    break;
+  case ELFDATA2MSB:
+    msb = true;
+    break;
+  default:
+    elf_exception::raise("invalid ELF data encoding: %u", ei_data);
+  }
+  if (size < layout->ehdr) {
+    throw elf_exception("cannot read ELF header: truncated image");
+  }
 
-    set_interp();
-    set_build_id();
+  e_type = u16(16);
+  e_machine = u16(18);
+  arch = get_arch(ei_class, e_machine);
+  unsigned long long phoff;
+  unsigned long long shoff;
+  unsigned e_phnum;
+  unsigned e_shnum;
+  unsigned e_shstrndx;
+  if (is64) {
+    phoff = u64(32);
+    shoff = u64(40);
+    e_phnum = u16(56);
+    e_shnum = u16(60);
+    e_shstrndx = u16(62);
+  } else {
+    phoff = u32(28);
+    shoff = u32(32);
+    e_phnum = u16(44);
+    e_shnum = u16(48);
+    e_shstrndx = u16(50);
   }
 
-  ~impl()
-  {
-    elf_end(elf);
+  read_section_headers(shoff, e_shnum, e_shstrndx);
+  read_program_headers(phoff, e_phnum);
+  index_sections();
+  set_interp();
+  set_build_id();
+}
+
+inline void
+elf_image::impl::check(unsigned long long offset,
+		       unsigned long long length) const
+{
+  if (offset > size || length > size - offset) {
+    elf_exception::raise("access to offset %llu (length %llu) beyond end"
+			 " of ELF image (%zu bytes)", offset, length, size);
   }
+}
 
-  void set_interp();
-  void set_build_id();
-  void set_build_id_from_section(Elf_Data *data);
-};
+inline unsigned
+elf_image::impl::u8(unsigned long long offset) const
+{
+  check(offset, 1);
+  return start[offset];
+}
+
+inline unsigned
+elf_image::impl::u16(unsigned long long offset) const
+{
+  check(offset, 2);
+  const unsigned char *p = start + offset;
+  if (msb) {
+    return (p[0] << 8) | p[1];
+  }
+  return p[0] | (p[1] << 8);
+}
+
+inline unsigned
+elf_image::impl::u32(unsigned long long offset) const
+{
+  check(offset, 4);
+  const unsigned char *p = start + offset;
+  if (msb) {
+    return (static_cast<unsigned>(p[0]) << 24) | (p[1] << 16)
+      | (p[2] << 8) | p[3];
+  }
+  return p[0] | (p[1] << 8) | (p[2] << 16)
+    | (static_cast<unsigned>(p[3]) << 24);
+}
+
+inline unsigned long long
+elf_image::impl::u64(unsigned long long offset) const
+{
+  unsigned long long first = u32(offset);
+  unsigned long long second = u32(offset + 4);
+  if (msb) {
+    return (first << 32) | second;
+  }
+  return (second << 32) | first;
+}
+
+inline unsigned long long
+elf_image::impl::word(unsigned long long offset) const
+{
+  if (is64) {
+    return u64(offset);
+  }
+  return u32(offset);
+}
+
+inline unsigned
+elf_image::impl::u16(const extent &e, unsigned long long pos) const
+{
+  if (!e.contains(pos, 2)) {
+    throw elf_exception("read beyond end of section");
+  }
+  return u16(e.offset + pos);
+}
+
+inline unsigned
+elf_image::impl::u32(const extent &e, unsigned long long pos) const
+{
+  if (!e.contains(pos, 4)) {
+    throw elf_exception("read beyond end of section");
+  }
+  return u32(e.offset + pos);
+}
 
 void
-elf_image::impl::set_interp()
+elf_image::impl::read_section_headers(unsigned long long shoff,
+				      unsigned e_shnum, unsigned e_shstrndx)
+{
+  if (shoff == 0) {
+    return;
+  }
+  const unsigned shdr = layout->shdr;
+  check(shoff, shdr);
+  shnum = e_shnum;
+  shstrndx = e_shstrndx;
+  // Extended numbering: the real values are stored in the first
+  // section header.
+  if (shnum == 0) {
+    shnum = word(shoff + (is64 ? 32 : 20)); // sh_size
+  }
+  if (shstrndx == SHN_XINDEX) {
+    shstrndx = u32(shoff + (is64 ? 40 : 24)); // sh_link
+  }
+  if (shnum > (size - shoff) / shdr) {
+    elf_exception::raise("section header table (%zu entries)"
+			 " extends beyond end of image", shnum);
+  }
+
+  sections.resize(shnum);
+  for (size_t i = 0; i < shnum; ++i) {
+    unsigned long long p = shoff + i * shdr;
+    section_header &sh(sections[i]);
+    sh.type = u32(p + 4);
+    if (is64) {
+      sh.flags = u64(p + 8);
+      sh.offset = u64(p + 24);
+      sh.size = u64(p + 32);
+      sh.link = u32(p + 40);
+      sh.info = u32(p + 44);
+      sh.entsize = u64(p + 56);
+    } else {
+      sh.flags = u32(p + 8);
+      sh.offset = u32(p + 16);
+      sh.size = u32(p + 20);
+      sh.link = u32(p + 24);
+      sh.info = u32(p + 28);
+      sh.entsize = u32(p + 36);
+    }
+  }
+}
+
+void
+elf_image::impl::read_program_headers(unsigned long long phoff,
+				      unsigned e_phnum)
 {
+  if (phoff == 0) {
+    return;
+  }
+  phnum = e_phnum;
+  if (phnum == PN_XNUM && !sections.empty()) {
+    phnum = sections.front().info;
+  }
+  const unsigned phdr = layout->phdr;
+  if (phoff > size || phnum > (size - phoff) / phdr) {
+    elf_exception::raise("program header table (%zu entries)"
+			 " extends beyond end of image", phnum);
+  }
+
+  segments.resize(phnum);
   for (size_t i = 0; i < phnum; ++i) {
-    GElf_Phdr mem;
-    GElf_Phdr *phdr = gelf_getphdr (elf, i, &mem);
-    if (phdr != NULL && phdr->p_type == PT_INTERP) {
-      size_t maxsize;
-      char *fileptr = elf_rawfile (elf, &maxsize);
-      if (fileptr == NULL || phdr->p_offset >= maxsize) {
-	throw elf_exception();
-      }
-      interp = fileptr + phdr->p_offset;
-      break;
+    unsigned long long p = phoff + i * phdr;
+    program_header &ph(segments[i]);
+    ph.type = u32(p);
+    if (is64) {
+      ph.flags = u32(p + 4);
+      ph.offset = u64(p + 8);
+      ph.vaddr = u64(p + 16);
+      ph.paddr = u64(p + 24);
+      ph.filesz = u64(p + 32);
+      ph.memsz = u64(p + 40);
+      ph.align = u64(p + 48);
+    } else {
+      ph.offset = u32(p + 4);
+      ph.vaddr = u32(p + 8);
+      ph.paddr = u32(p + 12);
+      ph.filesz = u32(p + 16);
+      ph.memsz = u32(p + 20);
+      ph.flags = u32(p + 24);
+      ph.align = u32(p + 28);
     }
   }
 }
 
+extent
+elf_image::impl::section_data(size_t index) const
+{
+  if (index == 0 || index >= sections.size()) {
+    return extent();
+  }
+  const section_header &sh(sections[index]);
+  if (sh.type == SHT_NOBITS || sh.offset > size
+      || sh.size > size - sh.offset) {
+    return extent();
+  }
+  return extent(sh.offset, sh.size);
+}
+
+const_stringref
+elf_image::impl::string(size_t index, unsigned long long offset) const
+{
+  if (index >= sections.size() || sections[index].type != SHT_STRTAB) {
+    elf_exception::raise("invalid string table section %zu", index);
+  }
+  extent e(section_data(index));
+  if (offset >= e.size) {
+    elf_exception::raise("invalid offset %llu into string table %zu",
+			 offset, index);
+  }
+  const char *p = reinterpret_cast<const char *>(start + e.offset + offset);
+  const void *nul = memchr(p, '\0', e.size - offset);
+  if (nul == NULL) {
+    elf_exception::raise("unterminated string at offset %llu"
+			 " in string table %zu", offset, index);
+  }
+  return const_stringref(p, static_cast<const char *>(nul) - p);
+}
+
 void
-elf_image::impl::set_build_id()
+elf_image::impl::index_sections()
 {
-  // See handle_notes() in readelf.c (from elfutils).
-  if (shnum == 0) {
-    Elf_Scn *scn = NULL;
-    while (true) {
-      scn = elf_nextscn(elf, scn);
-      if (scn == NULL) {
-	break;
+  versym_of.resize(sections.size());
+  xndx_of.resize(sections.size());
+  for (size_t i = 1; i < sections.size(); ++i) {
+    const section_header &sh(sections[i]);
+    switch (sh.type) {
+    case SHT_SYMTAB:
+    case SHT_DYNSYM:
+      symbol_tables.push_back(i);
+      break;
+    case SHT_NOTE:
+      if (sh.flags & SHF_ALLOC) {
+	note_sections.push_back(i);
+      }
+      break;
+    case SHT_GNU_versym:
+      if (sh.link < sections.size()) {
+	versym_of[sh.link] = i;
       }
-      GElf_Shdr shdr_mem;
-      GElf_Shdr *shdr = gelf_getshdr(scn, &shdr_mem);
-      if (shdr == NULL || shdr->sh_type != SHT_NOTE
-	  || (shdr->sh_flags & SHF_ALLOC) == 0) {
-	continue;
+      break;
+    case SHT_SYMTAB_SHNDX:
+      if (sh.link < sections.size()) {
+	xndx_of[sh.link] = i;
       }
+      break;
+    case SHT_GNU_verneed:
+      verneed = i;
+      break;
+    case SHT_GNU_verdef:
+      verdef = i;
+      break;
+    }
+    if (sh.type != SHT_NOBITS) {
+      // Matches gelf_offscn in libelf: the first section wins.
+      by_offset.insert(std::make_pair(sh.offset, i));
+    }
+  }
+}
+
+size_t
+elf_image::impl::section_at_offset(unsigned long long offset) const
+{
+  std::map<unsigned long long, size_t>::const_iterator p
+    = by_offset.find(offset);
+  if (p == by_offset.end()) {
+    return 0;
+  }
+  return p->second;
+}
 
-      Elf_Data *data = elf_getdata (scn, NULL);
-      if (data != NULL) {
-	set_build_id_from_section(data);
-	return;
+void
+elf_image::impl::set_interp()
+{
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const program_header &ph(segments[i]);
+    if (ph.type == PT_INTERP) {
+      if (ph.offset >= size) {
+	throw elf_exception("PT_INTERP segment beyond end of image");
+      }
+      const char *p = reinterpret_cast<const char *>(start + ph.offset);
+      const void *nul = memchr(p, '\0', size - ph.offset);
+      if (nul == NULL) {
+	throw elf_exception("unterminated PT_INTERP segment");
       }
+      interp.assign(p, static_cast<const char *>(nul));
+      break;
     }
-    return;
   }
+}
 
-  // Look at the program header if no section headers are present.
-  for (size_t i = 0; i < phnum; ++i) {
-    GElf_Phdr mem;
-    GElf_Phdr *phdr = gelf_getphdr (elf, i, &mem);
-    if (phdr == NULL || phdr->p_type != PT_NOTE) {
+void
+elf_image::impl::set_build_id()
+{
+  // Prefer the program header.  There can be multiple PT_NOTE
+  // segments, and the build ID is not necessarily in the first one.
+  bool have_notes = false;
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const program_header &ph(segments[i]);
+    if (ph.type != PT_NOTE) {
+      continue;
+    }
+    have_notes = true;
+    if (ph.offset > size || ph.filesz > size - ph.offset) {
       continue;
     }
-    Elf_Data *data =
-      elf_getdata_rawchunk (elf, phdr->p_offset, phdr->p_filesz, ELF_T_NHDR);
-    if (data != NULL) {
-      set_build_id_from_section(data);
+    if (set_build_id_from_notes(extent(ph.offset, ph.filesz), ph.align)) {
+      return;
+    }
+  }
+  if (have_notes) {
+    return;
+  }
+
+  // Fall back to allocated note sections (relocatable objects do
+  // not have a program header).
+  for (size_t i = 0; i < note_sections.size(); ++i) {
+    extent e(section_data(note_sections[i]));
+    if (!e.empty() && set_build_id_from_notes(e, 4)) {
       return;
     }
   }
 }
 
-void
-elf_image::impl::set_build_id_from_section(Elf_Data *data)
-{
-  // See handle_notes_data() in readelf.c (from elfutils).
-  size_t offset = 0;
-  GElf_Nhdr nhdr;
-  size_t name_offset;
-  size_t desc_offset;
-  while (offset < data->d_size) {
-    offset = gelf_getnote(data, offset, &nhdr, &name_offset, &desc_offset);
-    if (offset == 0) {
+bool
+elf_image::impl::set_build_id_from_notes(const extent &e,
+					 unsigned long long align)
+{
+  // See handle_notes_data() in readelf.c (from elfutils).  Notes
+  // are 4-byte aligned, except in segments with 8-byte alignment.
+  const unsigned long long mask = align == 8 ? 7 : 3;
+  unsigned long long pos = 0;
+  while (e.contains(pos, NHDR_SIZE)) {
+    unsigned long long namesz = u32(e, pos);
+    unsigned long long descsz = u32(e, pos + 4);
+    unsigned type = u32(e, pos + 8);
+    unsigned long long name_pos = pos + NHDR_SIZE;
+    unsigned long long desc_pos = (name_pos + namesz + mask) & ~mask;
+    if (!e.contains(name_pos, namesz) || !e.contains(desc_pos, descsz)) {
       break;
     }
-    const char *name = static_cast<const char *>(data->d_buf) + name_offset;
-    if (strcmp(name, "GNU") == 0 && nhdr.n_type == 3) {
-      const unsigned char *desc =
-	static_cast<unsigned char *>(data->d_buf) + desc_offset;
-      build_id.assign(desc, desc + nhdr.n_descsz);
-      return;
+    if (namesz == 4 && type == NT_GNU_BUILD_ID
+	&& memcmp(start + e.offset + name_pos, "GNU", 4) == 0) {
+      const unsigned char *desc = start + e.offset + desc_pos;
+      build_id.assign(desc, desc + descsz);
+      return true;
     }
+    pos = (desc_pos + descsz + mask) & ~mask;
+  }
+  return false;
+}
+
+elf_image::symbol_selection
+elf_image::symbol_selection_from_string(const char *str)
+{
+  if (strcmp(str, "dynsym") == 0) {
+    return dynsym_only;
+  } else if (strcmp(str, "global") == 0) {
+    return global_symbols;
+  } else if (strcmp(str, "all") == 0) {
+    return all_symbols;
+  }
+  raise<std::runtime_error>("unknown symbol selection: "
+			    + std::string(str));
+}
+
+const char *
+elf_image::to_string(symbol_selection selection)
+{
+  switch (selection) {
+  case dynsym_only:
+    return "dynsym";
+  case global_symbols:
+    return "global";
+  case all_symbols:
+    return "all";
   }
+  raise<std::logic_error>("invalid symbol selection");
 }
 
 void
 cxxll::elf_image_init()
 {
-  elf_version(EV_CURRENT);
 }
 
 elf_image::elf_image(const void *start, size_t size)
@@ -282,7 +723,7 @@ elf_image::build_id() const
 struct elf_image::program_header_range::state {
   std::tr1::shared_ptr<elf_image::impl> impl_;
   size_t cnt;
-  GElf_Phdr mem;
+  const program_header *current;
 
   state(std::tr1::shared_ptr<elf_image::impl>);
   bool next();
@@ -290,23 +731,19 @@ struct elf_image::program_header_range::state {
 
 inline
 elf_image::program_header_range::state::state(std::tr1::shared_ptr<elf_image::impl> i)
+  : cnt(0), current(NULL)
 {
   std::swap(impl_, i);
-  memset(&mem, 0, sizeof(mem));
-  cnt = 0;
 }
 
 inline bool
 elf_image::program_header_range::state::next()
 {
-  if (cnt >= impl_->phnum) {
+  if (cnt >= impl_->segments.size()) {
     return false;
   }
-  GElf_Phdr *phdr = gelf_getphdr (impl_->elf, cnt, &mem);
+  current = &impl_->segments[cnt];
   ++cnt;
-  if (phdr == NULL) {
-    return false;
-  }
   return true;
 }
 
@@ -328,356 +765,323 @@ elf_image::program_header_range::next()
 unsigned long long
 elf_image::program_header_range::type() const
 {
-  return state_->mem.p_type;
+  return state_->current->type;
 }
 
 unsigned long long
 elf_image::program_header_range::file_offset() const
 {
-  return state_->mem.p_offset;
+  return state_->current->offset;
 }
 
 unsigned long long
 elf_image::program_header_range::virt_addr() const
 {
-  return state_->mem.p_vaddr;
+  return state_->current->vaddr;
 }
 
 unsigned long long
 elf_image::program_header_range::phys_addr() const
 {
-  return state_->mem.p_paddr;
+  return state_->current->paddr;
 }
 
 unsigned long long
 elf_image::program_header_range::file_size() const
 {
-  return state_->mem.p_filesz;
+  return state_->current->filesz;
 }
 
 unsigned long long
 elf_image::program_header_range::memory_size() const
 {
-  return state_->mem.p_memsz;
+  return state_->current->memsz;
 }
 
 unsigned int
 elf_image::program_header_range::align() const
 {
-  return state_->mem.p_align;
+  return state_->current->align;
 }
 
 bool
 elf_image::program_header_range::readable() const
 {
-  return (state_->mem.p_flags & PF_R) != 0;
+  return (state_->current->flags & PF_R) != 0;
 }
 
 bool
 elf_image::program_header_range::writable() const
 {
-  return (state_->mem.p_flags & PF_W) != 0;
+  return (state_->current->flags & PF_W) != 0;
 }
 
 bool
 elf_image::program_header_range::executable() const
 {
-  return (state_->mem.p_flags & PF_X) != 0;
+  return (state_->current->flags & PF_X) != 0;
 }
 
 //////////////////////////////////////////////////////////////////////
 // elf_image::symbol_range
 
 struct elf_image::symbol_range::state {
+  symbol_selection selection;
+
   // The following are set up by next_section().
-  bool eof;
-  Elf_Scn *scn;
-  GElf_Shdr *shdr;
-  GElf_Shdr shdr_mem;
-  
+  size_t table;			// position in impl::symbol_tables
+  size_t scn;			// index of the current symbol table
+
   // The following are set up by init_section().
   unsigned nsyms;
-  Elf_Data *data;
-  Elf_Data *xndx_data;
-  Elf_Data *versym_data;
-  Elf_Data *verneed_data;
-  Elf_Data *verdef_data;
-  Elf32_Word verneed_stridx;
-  Elf32_Word verdef_stridx;
+  extent data;
+  extent xndx_data;
+  extent versym_data;
+  extent verneed_data;
+  extent verdef_data;
+  unsigned verneed_stridx;
+  unsigned verdef_stridx;
+  bool skip_local;		// skip STB_LOCAL symbols
 
   // These are updated by next().
   unsigned cnt;
+  bool is_def;
+  const_stringref name;
+  const_stringref version;
+  unsigned char type;
+  unsigned char binding;
+  unsigned char other;
+  unsigned long long value;
+  unsigned short section;
+  unsigned xsection;
+  bool default_version;
+
+  // Materialized on demand by definition() and reference().
   std::tr1::shared_ptr<elf_symbol_definition> def;
   std::tr1::shared_ptr<elf_symbol_reference> ref;
 
-  state()
-    : eof(false), scn(NULL), nsyms(0), cnt(0)
+  state(symbol_selection sel)
+    : selection(sel), table(0), scn(0), nsyms(0),
+      verneed_stridx(0), verdef_stridx(0), skip_local(false),
+      cnt(0), is_def(false), type(0), binding(0), other(0), value(0),
+      section(0), xsection(0), default_version(false)
   {
   }
 
   bool next(impl *parent);
   bool next_section(impl *parent);
   bool init_section(impl *parent);
+  bool find_verneed(impl *parent, unsigned versym);
+  void find_verdef(impl *parent, unsigned versym);
 };
 
 bool
 elf_image::symbol_range::state::next_section(impl *parent)
 {
-  if (eof) {
-    return false;
-  }
-
-  while ((scn = elf_nextscn (parent->elf, scn)) != NULL) {
-    shdr = gelf_getshdr (scn, &shdr_mem);
-    if (shdr != NULL && (shdr->sh_type == (GElf_Word) SHT_DYNSYM 
-			 || shdr->sh_type == (GElf_Word) SHT_SYMTAB)) {
-      if (init_section(parent)) {
-	return true;
-      }
+  while (table < parent->symbol_tables.size()) {
+    scn = parent->symbol_tables[table];
+    ++table;
+    if (selection == dynsym_only
+	&& parent->sections[scn].type != SHT_DYNSYM) {
+      continue;
+    }
+    if (init_section(parent)) {
+      return true;
     }
   }
-  eof = true;
   return false;
 }
 
 bool
 elf_image::symbol_range::state::init_section(impl *parent)
 {
-  int class_ = gelf_getclass (parent->elf);
-  xndx_data = NULL;
-  versym_data = NULL;
-  verneed_data = NULL;
-  verdef_data = NULL;
-  verneed_stridx = 0;
-  verdef_stridx = 0;
-
   /* Get the data of the section.  */
-  data = elf_getdata (scn, NULL);
-  if (data == NULL)
+  data = parent->section_data(scn);
+  if (data.empty())
     return false;
 
-  /* Find out whether we have other sections we might need.  */
-  Elf_Scn *runscn = NULL;
-  while ((runscn = elf_nextscn (parent->elf, runscn)) != NULL)
-    {
-      GElf_Shdr runshdr_mem;
-      GElf_Shdr *runshdr = gelf_getshdr (runscn, &runshdr_mem);
+  /* Look up the companion sections in the section index.  */
+  versym_data = parent->section_data(parent->versym_of[scn]);
+  xndx_data = parent->section_data(parent->xndx_of[scn]);
+  verneed_data = parent->section_data(parent->verneed);
+  verneed_stridx = parent->sections[parent->verneed].link;
+  verdef_data = parent->section_data(parent->verdef);
+  verdef_stridx = parent->sections[parent->verdef].link;
+
+  unsigned link = parent->sections[scn].link;
+  if (link == 0 || link >= parent->sections.size())
+    elf_exception::raise("invalid sh_link value in section %zu", scn);
+
+  /* Now we can compute the number of entries in the section.  */
+  nsyms = data.size / parent->layout->sym;
+  cnt = 0;
 
-      if (runshdr != NULL)
+  /* In SHT_SYMTAB, the local symbols come first, and sh_info is the
+     index of the first non-local symbol.  */
+  skip_local = selection == global_symbols
+    && parent->sections[scn].type == SHT_SYMTAB;
+  if (skip_local)
+    cnt = std::min<unsigned long long>(parent->sections[scn].info, nsyms);
+  return true;
+}
+
+bool
+elf_image::symbol_range::state::find_verneed(impl *parent, unsigned versym)
+{
+  /* Walk the list of needed versions and their auxiliary entries.  */
+  unsigned long long vn_offset = 0;
+  while (verneed_data.contains(vn_offset, VERNEED_SIZE))
+    {
+      unsigned long long vn_aux = parent->u32(verneed_data, vn_offset + 8);
+      unsigned long long vn_next = parent->u32(verneed_data, vn_offset + 12);
+      unsigned long long vna_offset = vn_offset + vn_aux;
+      while (verneed_data.contains(vna_offset, VERNAUX_SIZE))
 	{
-	  if (runshdr->sh_type == SHT_GNU_versym
-	      && runshdr->sh_link == elf_ndxscn (scn))
-	    /* Bingo, found the version information.  Now get the data.  */
-	    versym_data = elf_getdata (runscn, NULL);
-	  else if (runshdr->sh_type == SHT_GNU_verneed)
-	    {
-	      /* This is the information about the needed versions.  */
-	      verneed_data = elf_getdata (runscn, NULL);
-	      verneed_stridx = runshdr->sh_link;
-	    }
-	  else if (runshdr->sh_type == SHT_GNU_verdef)
+	  unsigned vna_other = parent->u16(verneed_data, vna_offset + 6);
+	  if (vna_other == versym)
 	    {
-	      /* This is the information about the defined versions.  */
-	      verdef_data = elf_getdata (runscn, NULL);
-	      verdef_stridx = runshdr->sh_link;
+	      /* Found it.  */
+	      version = parent->string
+		(verneed_stridx, parent->u32(verneed_data, vna_offset + 8));
+	      return true;
 	    }
-	  else if (runshdr->sh_type == SHT_SYMTAB_SHNDX
-	      && runshdr->sh_link == elf_ndxscn (scn))
-	    /* Extended section index.  */
-	    xndx_data = elf_getdata (runscn, NULL);
+	  unsigned long long vna_next =
+	    parent->u32(verneed_data, vna_offset + 12);
+	  if (vna_next == 0)
+	    break;
+	  vna_offset += vna_next;
 	}
+      if (vn_next == 0)
+	break;
+      vn_offset += vn_next;
     }
+  return false;
+}
 
-  /* Get the section header string table index.  */
-  size_t shstrndx;
-  if (elf_getshdrstrndx (parent->elf, &shstrndx) < 0)
-    throw elf_exception("cannot get section header string table index");
-
-  GElf_Shdr glink_mem;
-  GElf_Shdr *glink = gelf_getshdr (elf_getscn (parent->elf, shdr->sh_link),
-				   &glink_mem);
-  if (glink == NULL)
-    elf_exception::raise("invalid sh_link value in section %zu",
-				  elf_ndxscn (scn));
-
-  /* Now we can compute the number of entries in the section.  */
-  nsyms = data->d_size / (class_ == ELFCLASS32
-			  ? sizeof (Elf32_Sym)
-			  : sizeof (Elf64_Sym));
-  cnt = 0;
-  return true;
+void
+elf_image::symbol_range::state::find_verdef(impl *parent, unsigned versym)
+{
+  unsigned long long vd_offset = 0;
+  while (verdef_data.contains(vd_offset, VERDEF_SIZE))
+    {
+      if (parent->u16(verdef_data, vd_offset + 4) == (versym & 0x7fff))
+	{
+	  /* Found the definition.  */
+	  unsigned long long vda_offset =
+	    vd_offset + parent->u32(verdef_data, vd_offset + 12);
+	  if (verdef_data.contains(vda_offset, VERDAUX_SIZE))
+	    version = parent->string
+	      (verdef_stridx, parent->u32(verdef_data, vda_offset));
+	  // The hidden bit marks foo@VERS; only foo@@VERS (the bit is
+	  // clear) is the default version.
+	  default_version = (versym & 0x8000) == 0;
+	  return;
+	}
+      unsigned long long vd_next = parent->u32(verdef_data, vd_offset + 16);
+      if (vd_next == 0)
+	break;
+      vd_offset += vd_next;
+    }
 }
 
 bool
 elf_image::symbol_range::state::next(impl *parent)
 {
-  def.reset();
-  ref.reset();
-
-  GElf_Sym sym_mem;
-  GElf_Sym *sym;
-  Elf32_Word xndx;
+  const unsigned symsize = parent->layout->sym;
+  unsigned long long sym;
+  unsigned st_shndx;
+  unsigned xndx;
 
   while (true) {
     if (cnt >= nsyms) {
       if (!next_section(parent)) {
 	return false;
       }
+      continue;
+    }
+    sym = data.offset + static_cast<unsigned long long>(cnt) * symsize;
+    if (skip_local
+	&& ELF64_ST_BIND(parent->u8(sym + (parent->is64 ? 4 : 12)))
+	== STB_LOCAL) {
+      ++cnt;
+      continue;
     }
-    sym = gelf_getsymshndx (data, xndx_data, cnt, &sym_mem, &xndx);
-    if (sym != NULL) {
+    st_shndx = parent->u16(sym + (parent->is64 ? 6 : 14));
+    if (st_shndx != SHN_XINDEX) {
+      break;
+    }
+    // The real section index is stored in the SHT_SYMTAB_SHNDX
+    // section.  Skip the symbol if it is not available.
+    if (xndx_data.contains(cnt * 4ULL, 4)) {
+      xndx = parent->u32(xndx_data, cnt * 4ULL);
       break;
     }
     ++cnt;
   }
 
   /* Determine the real section index.  */
-  if (sym->st_shndx != SHN_XINDEX)
-    xndx = sym->st_shndx;
+  if (st_shndx != SHN_XINDEX)
+    xndx = st_shndx;
   bool check_def = xndx != SHN_UNDEF;
 
-  elf_symbol_definition def_new;
-  elf_symbol_reference ref_new;
-  if (versym_data != NULL)
+  version = const_stringref();
+  default_version = false;
+  if (versym_data.contains(cnt * 2ULL, VERSYM_SIZE))
     {
       /* Get the version information.  */
-      GElf_Versym versym_mem;
-      GElf_Versym *versym = gelf_getversym (versym_data, cnt, &versym_mem);
+      unsigned versym = parent->u16(versym_data, cnt * 2ULL);
 
-      if (versym != NULL && ((*versym & 0x8000) != 0 || *versym > 1))
+      if ((versym & 0x8000) != 0 || versym > 1)
 	{
 	  bool is_nobits = false;
 
-	  if (xndx < SHN_LORESERVE || sym->st_shndx == SHN_XINDEX)
-	    {
-	      GElf_Shdr symshdr_mem;
-	      GElf_Shdr *symshdr =
-		gelf_getshdr (elf_getscn (parent->elf, xndx), &symshdr_mem);
-
-	      is_nobits = (symshdr != NULL
-			   && symshdr->sh_type == SHT_NOBITS);
-	    }
+	  if (xndx < SHN_LORESERVE || st_shndx == SHN_XINDEX)
+	    is_nobits = xndx < parent->sections.size()
+	      && parent->sections[xndx].type == SHT_NOBITS;
 
 	  if (is_nobits || ! check_def)
 	    {
-	      /* We must test both.  */
-	      GElf_Vernaux vernaux_mem;
-	      GElf_Vernaux *vernaux = NULL;
-	      size_t vn_offset = 0;
-
-	      GElf_Verneed verneed_mem;
-	      GElf_Verneed *verneed = gelf_getverneed (verneed_data, 0,
-						       &verneed_mem);
-	      while (verneed != NULL)
-		{
-		  size_t vna_offset = vn_offset;
-
-		  vernaux = gelf_getvernaux (verneed_data,
-					     vna_offset += verneed->vn_aux,
-					     &vernaux_mem);
-		  while (vernaux != NULL
-			 && vernaux->vna_other != *versym
-			 && vernaux->vna_next != 0)
-		    {
-		      /* Update the offset.  */
-		      vna_offset += vernaux->vna_next;
-
-		      vernaux = (vernaux->vna_next == 0
-				 ? NULL
-				 : gelf_getvernaux (verneed_data,
-						    vna_offset,
-						    &vernaux_mem));
-		    }
-
-		  /* Check whether we found the version.  */
-		  if (vernaux != NULL && vernaux->vna_other == *versym)
-		    /* Found it.  */
-		    break;
-
-		  vn_offset += verneed->vn_next;
-		  verneed = (verneed->vn_next == 0
-			     ? NULL
-			     : gelf_getverneed (verneed_data, vn_offset,
-						&verneed_mem));
-		}
-
-	      if (vernaux != NULL && vernaux->vna_other == *versym)
-		{
-		  ref_new.vna_name =
-		    elf_strptr (parent->elf, verneed_stridx,
-				vernaux->vna_name);
-		  ref_new.vna_other = vernaux->vna_other;
-		  check_def = 0;
-		}
+	      if (find_verneed(parent, versym))
+		check_def = false;
 	      else if (! is_nobits)
 		elf_exception::raise("bad dynamic symbol %u", cnt);
 	      else
-		check_def = 1;
+		check_def = true;
 	    }
 
-	  if (check_def && *versym != 0x8001)
-	    {
-	      /* We must test both.  */
-	      size_t vd_offset = 0;
-
-	      GElf_Verdef verdef_mem;
-	      GElf_Verdef *verdef = gelf_getverdef (verdef_data, 0,
-						    &verdef_mem);
-	      while (verdef != NULL)
-		{
-		  if (verdef->vd_ndx == (*versym & 0x7fff))
-		    /* Found the definition.  */
-		    break;
-
-		  vd_offset += verdef->vd_next;
-		  verdef = (verdef->vd_next == 0
-			    ? NULL
-			    : gelf_getverdef (verdef_data, vd_offset,
-					      &verdef_mem));
-		}
-
-	      if (verdef != NULL)
-		{
-		  GElf_Verdaux verdaux_mem;
-		  GElf_Verdaux *verdaux
-		    = gelf_getverdaux (verdef_data,
-				       vd_offset + verdef->vd_aux,
-				       &verdaux_mem);
-		      
-		  if (verdaux != NULL)
-		    def_new.vda_name =
-		      elf_strptr (parent->elf, verdef_stridx,
-				  verdaux->vda_name);
-		  if (*versym & 0x8000)
-		    def_new.default_version = true;
-		  // FIXME: printf ((*versym & 0x8000) ? "@%s" : "@@%s",
-		  // FIXME: clarify @/@@ difference
-		}
-	    }
+	  if (check_def && versym != 0x8001)
+	    find_verdef(parent, versym);
 	}
     }
 
-  elf_symbol *psymbol;
+  is_def = check_def;
   if (check_def) {
-    def_new.section = sym->st_shndx;
-    def_new.xsection = xndx;
-    def.reset(new elf_symbol_definition(def_new));
-    psymbol = def.get();
+    section = st_shndx;
+    xsection = xndx;
+  } else {
+    section = 0;
+    xsection = 0;
+  }
+  unsigned st_info;
+  if (parent->is64) {
+    st_info = parent->u8(sym + 4);
+    other = parent->u8(sym + 5);
+    value = parent->u64(sym + 8);
   } else {
-    ref.reset(new elf_symbol_reference(ref_new));
-    psymbol = ref.get();
-  }
-  psymbol->type = GELF_ST_TYPE (sym->st_info);
-  psymbol->binding = GELF_ST_BIND (sym->st_info);
-  psymbol->symbol_name =
-    elf_strptr (parent->elf, shdr->sh_link, sym->st_name);
-  psymbol->other = sym->st_other;
+    value = parent->u32(sym + 4);
+    st_info = parent->u8(sym + 12);
+    other = parent->u8(sym + 13);
+  }
+  type = ELF64_ST_TYPE(st_info);
+  binding = ELF64_ST_BIND(st_info);
+  name = parent->string(parent->sections[scn].link, parent->u32(sym));
   ++cnt;
   return true;
 }
 
-elf_image::symbol_range::symbol_range(const elf_image &image)
-  : impl_(image.impl_), state_(new state)
+elf_image::symbol_range::symbol_range(const elf_image &image,
+				     symbol_selection selection)
+  : impl_(image.impl_), state_(new state(selection))
 {
 }
 
@@ -694,52 +1098,185 @@ elf_image::symbol_range::next()
 std::tr1::shared_ptr<elf_symbol_definition>
 elf_image::symbol_range::definition() const
 {
+  if (!state_->is_def) {
+    return std::tr1::shared_ptr<elf_symbol_definition>();
+  }
+  // Reuse the previous object if nobody else holds a reference to it.
+  if (!state_->def || !state_->def.unique()) {
+    state_->def.reset(new elf_symbol_definition);
+  }
+  elf_symbol_definition &def(*state_->def);
+  state_->name.str(def.symbol_name);
+  state_->version.str(def.vda_name);
+  def.type = state_->type;
+  def.binding = state_->binding;
+  def.other = state_->other;
+  def.value = state_->value;
+  def.section = state_->section;
+  def.xsection = state_->xsection;
+  def.default_version = state_->default_version;
   return state_->def;
 }
 
 std::tr1::shared_ptr<elf_symbol_reference>
 elf_image::symbol_range::reference() const
 {
+  if (state_->is_def) {
+    return std::tr1::shared_ptr<elf_symbol_reference>();
+  }
+  if (!state_->ref || !state_->ref.unique()) {
+    state_->ref.reset(new elf_symbol_reference);
+  }
+  elf_symbol_reference &ref(*state_->ref);
+  state_->name.str(ref.symbol_name);
+  state_->version.str(ref.vna_name);
+  ref.type = state_->type;
+  ref.binding = state_->binding;
+  ref.other = state_->other;
   return state_->ref;
 }
 
+bool
+elf_image::symbol_range::is_definition() const
+{
+  return state_->is_def;
+}
+
+const_stringref
+elf_image::symbol_range::symbol_name() const
+{
+  return state_->name;
+}
+
+const_stringref
+elf_image::symbol_range::version_name() const
+{
+  return state_->version;
+}
+
+unsigned char
+elf_image::symbol_range::type() const
+{
+  return state_->type;
+}
+
+unsigned char
+elf_image::symbol_range::binding() const
+{
+  return state_->binding;
+}
+
+unsigned char
+elf_image::symbol_range::other() const
+{
+  return state_->other;
+}
+
+unsigned long long
+elf_image::symbol_range::value() const
+{
+  return state_->value;
+}
+
+unsigned short
+elf_image::symbol_range::section() const
+{
+  return state_->section;
+}
+
+unsigned
+elf_image::symbol_range::xsection() const
+{
+  return state_->xsection;
+}
+
+bool
+elf_image::symbol_range::default_version() const
+{
+  return state_->default_version;
+}
+
+void
+elf_image::symbols(elf_symbol_batch &batch,
+		   symbol_selection selection) const
+{
+  // Version names repeat a lot, so they are stored only once.  The
+  // key is the location of the string in the image.
+  std::map<const char *, unsigned> versions;
+  symbol_range range(*this, selection);
+  while (range.next()) {
+    const_stringref name(range.symbol_name());
+    if (name.empty()) {
+      continue;
+    }
+    const_stringref version(range.version_name());
+    unsigned version_offset = elf_symbol_batch::no_string;
+    if (!version.empty()) {
+      std::map<const char *, unsigned>::iterator p
+	= versions.find(version.data());
+      if (p == versions.end()) {
+	version_offset = batch.add_string(version);
+	versions[version.data()] = version_offset;
+      } else {
+	version_offset = p->second;
+      }
+    }
+    elf_symbol_batch::symbols *cols;
+    if (range.is_definition()) {
+      elf_symbol_batch::definitions &defs(batch.defs);
+      defs.value.push_back(range.value());
+      defs.section.push_back(range.section());
+      defs.xsection.push_back(range.xsection());
+      defs.default_version.push_back(range.default_version());
+      cols = &defs;
+    } else {
+      cols = &batch.refs;
+    }
+    cols->name.push_back(batch.add_string(name));
+    cols->version.push_back(version_offset);
+    cols->type.push_back(range.type());
+    cols->binding.push_back(range.binding());
+    cols->visibility.push_back(ELF64_ST_VISIBILITY(range.other()));
+  }
+}
+
 //////////////////////////////////////////////////////////////////////
 // elf_image::dynamic_section_range
 
 struct elf_image::dynamic_section_range::state {
   std::tr1::shared_ptr<impl> impl_;
-  GElf_Shdr *shdr;
-  Elf_Data *data;
+  extent data;
+  unsigned link;
   size_t cnt;
   size_t entries;
-  GElf_Shdr shdr_mem;
   unsigned long long tag;
   std::string text;
   unsigned long long number;
   kind type;
 
   state(const elf_image &image)
-    : impl_(image.impl_), cnt(0), entries(0), number(0), type(other)
+    : impl_(image.impl_), link(0), cnt(0), entries(0), tag(0), number(0),
+      type(other)
   {
-    for (size_t i = 0; i < impl_->phnum; ++i) {
-      GElf_Phdr phdr_mem;
-      GElf_Phdr *phdr = gelf_getphdr (impl_->elf, i, &phdr_mem);
-      if (phdr != NULL && phdr->p_type == PT_DYNAMIC) {
-	Elf_Scn *scn = gelf_offscn (impl_->elf, phdr->p_offset);
-	shdr = gelf_getshdr (scn, &shdr_mem);
-	if (shdr != NULL && shdr->sh_type == SHT_DYNAMIC) {
+    for (size_t i = 0; i < impl_->segments.size(); ++i) {
+      const program_header &ph(impl_->segments[i]);
+      if (ph.type == PT_DYNAMIC) {
+	size_t scn = impl_->section_at_offset(ph.offset);
+	if (scn != 0 && impl_->sections[scn].type == SHT_DYNAMIC) {
 	  // Section found, use it for processing if not empty.
-	  data = elf_getdata (scn, NULL);
-	  if (data != NULL) {
-	    entries = shdr->sh_size / shdr->sh_entsize;
+	  const section_header &sh(impl_->sections[scn]);
+	  data = impl_->section_data(scn);
+	  link = sh.link;
+	  if (!data.empty() && sh.entsize != 0) {
+	    entries = sh.size / sh.entsize;
+	  }
+	  if (entries > data.size / impl_->layout->dyn) {
+	    entries = data.size / impl_->layout->dyn;
 	  }
-	  break;
-	} else {
-	  shdr = NULL;
 	}
+	break;
       }
     }
-
   }
 
   bool next()
@@ -748,11 +1285,19 @@ struct elf_image::dynamic_section_range::state {
     text.clear();
     number = 0;
     while (cnt < entries) {
-      GElf_Dyn dynmem;
-      GElf_Dyn *dyn = gelf_getdyn (data, cnt, &dynmem);
+      unsigned long long entry = data.offset + cnt * impl_->layout->dyn;
       ++cnt;
-      tag = dyn->d_tag;
-      switch (dyn->d_tag) {
+      unsigned long long d_val;
+      if (impl_->is64) {
+	tag = impl_->u64(entry);
+	d_val = impl_->u64(entry + 8);
+      } else {
+	// d_tag is signed.
+	tag = static_cast<long long>
+	  (static_cast<int>(impl_->u32(entry)));
+	d_val = impl_->u32(entry + 4);
+      }
+      switch (tag) {
       case DT_NEEDED:
 	type = needed;
 	break;
@@ -767,10 +1312,10 @@ struct elf_image::dynamic_section_range::state {
 	break;
       default:
 	type = other;
-	number = dyn->d_un.d_val;
+	number = d_val;
 	return true;
       }
-      text = elf_strptr (impl_->elf, shdr->sh_link, dyn->d_un.d_val);
+      impl_->string(link, d_val).str(text);
       return true;
     }
     return false;
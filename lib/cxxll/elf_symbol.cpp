@@ -21,7 +21,7 @@
 
 #include <stdexcept>
 
-#include <gelf.h>
+#include <elf.h>
 #include <assert.h>
 
 using namespace cxxll;
@@ -38,7 +38,13 @@ elf_symbol::~elf_symbol()
 const char *
 elf_symbol::visibility() const
 {
-  switch (GELF_ST_VISIBILITY(other)) {
+  return visibility_name(ELF64_ST_VISIBILITY(other));
+}
+
+const char *
+elf_symbol::visibility_name(unsigned char stv)
+{
+  switch (stv) {
   case STV_DEFAULT:
     return "default";
   case STV_INTERNAL:
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/elf_symbol_batch.hpp>
+#include <cxxll/raise.hpp>
+
+#include <elf.h>
+
+#include <stdexcept>
+
+using namespace cxxll;
+
+const unsigned elf_symbol_batch::no_string;
+
+bool
+elf_symbol_batch::definitions::has_xsection(size_t row) const
+{
+  return section.at(row) == SHN_XINDEX;
+}
+
+elf_symbol_batch::elf_symbol_batch()
+{
+}
+
+elf_symbol_batch::~elf_symbol_batch()
+{
+}
+
+void
+elf_symbol_batch::clear()
+{
+  // Keep the allocated capacity, batches are typically reused.
+  arena.clear();
+  refs.name.clear();
+  refs.version.clear();
+  refs.type.clear();
+  refs.binding.clear();
+  refs.visibility.clear();
+  defs.name.clear();
+  defs.version.clear();
+  defs.type.clear();
+  defs.binding.clear();
+  defs.visibility.clear();
+  defs.value.clear();
+  defs.section.clear();
+  defs.xsection.clear();
+  defs.default_version.clear();
+}
+
+unsigned
+elf_symbol_batch::add_string(const_stringref str)
+{
+  size_t offset = arena.size();
+  if (offset + str.size() >= no_string) {
+    raise<std::length_error>("elf_symbol_batch string arena overflow");
+  }
+  arena.insert(arena.end(), str.data(), str.data() + str.size());
+  arena.push_back('\0');
+  return offset;
+}
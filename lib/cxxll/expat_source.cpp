@@ -410,8 +410,26 @@ expat_source::name_ptr() const
   return impl_->upcoming_.data() + impl_->elem_start_;
 }
 
+const_stringref
+expat_source::name_ref() const
+{
+  impl_->check_state(START);
+  return const_stringref(impl_->upcoming_.data() + impl_->elem_start_,
+			 impl_->elem_len_);
+}
+
 std::string
 expat_source::attribute(const char *name) const
+{
+  const char *value = attribute_ptr(name);
+  if (value == NULL) {
+    return std::string();
+  }
+  return std::string(value);
+}
+
+const char *
+expat_source::attribute_ptr(const char *name) const
 {
   size_t name_len = strlen(name);
   impl_->check_state(START);
@@ -421,13 +439,12 @@ expat_source::attribute(const char *name) const
     ++p;
     size_t plen = strlen(p);
     if (plen == name_len && memcmp(name, p, plen) == 0) {
-      p += plen + 1;
-      return std::string(p);
+      return p + plen + 1;
     }
     p += plen + 1; // key
     p += strlen(p) + 1; // value
   }
-  return std::string();
+  return NULL;
 }
 
 std::map<std::string, std::string>
@@ -470,19 +487,34 @@ expat_source::text_ptr() const
   return impl_->upcoming_.data() + impl_->elem_start_;
 }
 
+const_stringref
+expat_source::text_ref() const
+{
+  impl_->check_state(TEXT);
+  return const_stringref(impl_->upcoming_.data() + impl_->elem_start_,
+			 impl_->elem_len_);
+}
+
 std::string
 expat_source::text_and_next()
+{
+  std::string result;
+  text_and_next(result);
+  return result;
+}
+
+void
+expat_source::text_and_next(std::string &result)
 {
   impl_->check_state(TEXT);
   const char *p = impl_->upcoming_.data() + impl_->elem_start_;
-  std::string result(p, impl_->elem_len_);
+  result.assign(p, impl_->elem_len_);
   next();
   while (impl_->state_ == TEXT) {
     p = impl_->upcoming_.data() + impl_->elem_start_;
     result.append(p, impl_->elem_len_);
     next();
   }
-  return result;
 }
 
 void
@@ -28,7 +28,7 @@
 using namespace cxxll;
 
 enum {
-  BUFFER_SIZE = 4096
+  BUFFER_SIZE = 64 * 1024
 };
 
 struct gunzip_source::impl {
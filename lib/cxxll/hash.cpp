@@ -18,6 +18,8 @@
 
 #include <cxxll/hash.hpp>
 #include <cxxll/fd_handle.hpp>
+#include <cxxll/fd_source.hpp>
+#include <cxxll/source_sink.hpp>
 #include <cxxll/os.hpp>
 #include <cxxll/checksum.hpp>
 #include <cxxll/raise.hpp>
@@ -163,14 +165,8 @@ cxxll::hash_file(hash_sink::type t,
   fd_handle fd;
   fd.open_read_only(path);
 
-  unsigned char buf[8192];
-  while (true) {
-    size_t ret = fd.read(buf, sizeof(buf));
-    if (ret == 0) {
-      break;
-    }
-    sink.write(const_stringref(buf, ret));
-  }
+  fd_source source(fd.get());
+  copy_source_to_sink(source, sink);
   sink.digest(digest);
 }
 
@@ -181,14 +177,8 @@ cxxll::hash_file(hash_sink::type t, const char *path, checksum &csum)
   fd_handle fd;
   fd.open_read_only(path);
 
-  unsigned char buf[8192];
-  while (true) {
-    size_t ret = fd.read(buf, sizeof(buf));
-    if (ret == 0) {
-      break;
-    }
-    sink.write(const_stringref(buf, ret));
-  }
+  fd_source source(fd.get());
+  copy_source_to_sink(source, sink);
   sink.digest(csum.value);
   csum.type = t;
   csum.length = sink.octets();
@@ -19,8 +19,116 @@
 #include <cxxll/java_class.hpp>
 #include <cxxll/vector_extract.hpp>
 
+#include <algorithm>
 #include <cstdio>
 
+namespace {
+  // Returns the length of the valid UTF-8 sequence at P, or zero if
+  // there is none.
+  unsigned
+  utf8_sequence_length(const unsigned char *p, const unsigned char *end)
+  {
+    unsigned char ch = *p;
+    if (ch < 0x80) {
+      return 1;
+    }
+    unsigned len;
+    unsigned char min = 0x80, max = 0xBF; // for the second byte
+    if (ch >= 0xC2 && ch <= 0xDF) {
+      len = 2;
+    } else if (ch >= 0xE0 && ch <= 0xEF) {
+      len = 3;
+      if (ch == 0xE0) {
+	min = 0xA0;
+      } else if (ch == 0xED) {
+	max = 0x9F;		// no surrogates
+      }
+    } else if (ch >= 0xF0 && ch <= 0xF4) {
+      len = 4;
+      if (ch == 0xF0) {
+	min = 0x90;
+      } else if (ch == 0xF4) {
+	max = 0x8F;
+      }
+    } else {
+      return 0;
+    }
+    if (static_cast<size_t>(end - p) < len || p[1] < min || p[1] > max) {
+      return 0;
+    }
+    for (unsigned i = 2; i < len; ++i) {
+      if ((p[i] & 0xC0) != 0x80) {
+	return 0;
+      }
+    }
+    return len;
+  }
+
+  // Returns true if the string is not valid UTF-8.  This is the case
+  // if modified UTF-8 encodes NUL characters or supplementary
+  // characters, or if the string is malformed.
+  bool
+  needs_conversion(const unsigned char *p, const unsigned char *end)
+  {
+    while (p != end) {
+      if (*p < 0x80) {
+	++p;
+      } else {
+	unsigned len = utf8_sequence_length(p, end);
+	if (len == 0) {
+	  return true;
+	}
+	p += len;
+      }
+    }
+    return false;
+  }
+
+  // Returns true if P starts a three-byte surrogate with a second
+  // byte between MIN and MAX.
+  bool
+  is_surrogate(const unsigned char *p, const unsigned char *end,
+	       unsigned char min, unsigned char max)
+  {
+    return end - p >= 3 && p[0] == 0xED && p[1] >= min && p[1] <= max
+      && (p[2] & 0xC0) == 0x80;
+  }
+
+  // Converts modified UTF-8 to UTF-8.  Invalid bytes are replaced
+  // with U+FFFD.
+  void
+  convert_modified_utf8(const unsigned char *p, const unsigned char *end,
+			std::string &result)
+  {
+    result.clear();
+    while (p != end) {
+      if (end - p >= 2 && p[0] == 0xC0 && p[1] == 0x80) {
+	result += '\0';
+	p += 2;
+      } else if (is_surrogate(p, end, 0xA0, 0xAF)
+		 && is_surrogate(p + 3, end, 0xB0, 0xBF)) {
+	unsigned high = ((p[1] & 0x0F) << 6) | (p[2] & 0x3F);
+	unsigned low = ((p[4] & 0x0F) << 6) | (p[5] & 0x3F);
+	unsigned cp = 0x10000 + (high << 10) + low;
+	result += static_cast<char>(0xF0 | (cp >> 18));
+	result += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+	result += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+	result += static_cast<char>(0x80 | (cp & 0x3F));
+	p += 6;
+      } else {
+	unsigned len = utf8_sequence_length(p, end);
+	if (len == 0) {
+	  result += "\xEF\xBF\xBD";
+	  ++p;
+	} else {
+	  result.append(reinterpret_cast<const char *>(p), len);
+	  p += len;
+	}
+      }
+    }
+  }
+}
+
 bool
 cxxll::java_class::has_signature(const std::vector<unsigned char> &vec)
 {
@@ -37,8 +145,26 @@ cxxll::java_class::has_signature(const std::vector<unsigned char> &vec)
 }
 
 cxxll::java_class::java_class(const std::vector<unsigned char> *vec)
-  : buffer_(vec)
 {
+  reset(vec);
+}
+
+cxxll::java_class::~java_class()
+{
+}
+
+void
+cxxll::java_class::reset(const std::vector<unsigned char> *vec)
+{
+  buffer_ = vec;
+  constant_pool_offsets.clear();
+  interface_indexes.clear();
+  fields_.clear();
+  methods_.clear();
+  member_reference_indexes.clear();
+  class_name_indexes.clear();
+  converted_strings.clear();
+
   size_t offset = 0;
   try {
     {
@@ -65,14 +191,25 @@ cxxll::java_class::java_class(const std::vector<unsigned char> *vec)
 	switch (tag) {
 	case CONSTANT_Class:
 	case CONSTANT_String:
+	case CONSTANT_MethodType:
+	case CONSTANT_Module:
+	case CONSTANT_Package:
 	  offset += 2;
 	  break;
+	case CONSTANT_MethodHandle:
+	  offset += 3;
+	  break;
 	case CONSTANT_Fieldref:
-	case CONSTANT_Float:
-	case CONSTANT_Integer:
 	case CONSTANT_InterfaceMethodref:
 	case CONSTANT_Methodref:
+	  member_reference_indexes.push_back(i);
+	  offset += 4;
+	  break;
+	case CONSTANT_Float:
+	case CONSTANT_Integer:
 	case CONSTANT_NameAndType:
+	case CONSTANT_Dynamic:
+	case CONSTANT_InvokeDynamic:
 	  offset += 4;
 	  break;
 	case CONSTANT_Long:
@@ -86,6 +223,13 @@ cxxll::java_class::java_class(const std::vector<unsigned char> *vec)
 	  {
 	    unsigned short len;
 	    big_endian::extract(*vec, offset, len);
+	    if (len > vec->size() - offset) {
+	      throw exception("UTF-8 string extends past end of class file");
+	    }
+	    const unsigned char *p = vec->data() + offset;
+	    if (needs_conversion(p, p + len)) {
+	      convert_modified_utf8(p, p + len, converted_strings[i]);
+	    }
 	    offset += len;
 	  }
 	  break;
@@ -115,8 +259,11 @@ cxxll::java_class::java_class(const std::vector<unsigned char> *vec)
       }
     }
 
-    // TODO: fields, methods, attributes
+    parse_members(offset, fields_);
+    parse_members(offset, methods_);
+    // The class attributes are not needed.
 
+    sort_class_names();
   } catch (std::out_of_range &) {
     char buf[64];
     snprintf(buf, sizeof(buf), "index out of range at %zu", offset);
@@ -124,59 +271,161 @@ cxxll::java_class::java_class(const std::vector<unsigned char> *vec)
   }
 }
 
-cxxll::java_class::~java_class()
+std::string
+cxxll::java_class::this_class() const
 {
+  return this_class_ref().str();
 }
 
-std::string
-cxxll::java_class::this_class() const
+cxxll::const_stringref
+cxxll::java_class::this_class_ref() const
 {
   return class_name(this_class_);
 }
 
 std::string
 cxxll::java_class::super_class() const
+{
+  return super_class_ref().str();
+}
+
+cxxll::const_stringref
+cxxll::java_class::super_class_ref() const
 {
   if (super_class_ == 0) {
-    return std::string();
+    return const_stringref();
   }
   return class_name(super_class_);
 }
 
-std::string
-cxxll::java_class::class_name(unsigned short idx) const
+void
+cxxll::java_class::parse_members(size_t &offset, std::vector<member> &members)
+{
+  unsigned short count;
+  big_endian::extract(*buffer_, offset, count);
+  members.resize(count);
+  for (unsigned i = 0; i < count; ++i) {
+    member &m(members[i]);
+    big_endian::extract(*buffer_, offset, m.access_flags);
+    big_endian::extract(*buffer_, offset, m.name_index);
+    big_endian::extract(*buffer_, offset, m.descriptor_index);
+    unsigned short attributes;
+    big_endian::extract(*buffer_, offset, attributes);
+    for (unsigned j = 0; j < attributes; ++j) {
+      offset += 2;		// attribute_name_index
+      unsigned length;
+      big_endian::extract(*buffer_, offset, length);
+      if (length > buffer_->size() - offset) {
+	throw exception("attribute extends past end of class file");
+      }
+      offset += length;
+    }
+  }
+}
+
+struct cxxll::java_class::class_name_less {
+  const java_class &jc;
+  explicit class_name_less(const java_class &j)
+    : jc(j)
+  {
+  }
+
+  bool operator()(unsigned short left, unsigned short right) const
+  {
+    return jc.utf8_ref(left) < jc.utf8_ref(right);
+  }
+};
+
+struct cxxll::java_class::class_name_equal {
+  const java_class &jc;
+  explicit class_name_equal(const java_class &j)
+    : jc(j)
+  {
+  }
+
+  bool operator()(unsigned short left, unsigned short right) const
+  {
+    return jc.utf8_ref(left) == jc.utf8_ref(right);
+  }
+};
+
+void
+cxxll::java_class::sort_class_names()
+{
+  for (unsigned i = 0, end = constant_pool_offsets.size(); i < end; ++i) {
+    size_t offset = constant_pool_offsets[i];
+    if (offset != 0 && buffer()[offset] == CONSTANT_Class) {
+      ++offset;
+      unsigned short name_idx;
+      big_endian::extract(buffer(), offset, name_idx);
+      constant_offset(name_idx, CONSTANT_Utf8); // checks the index
+      class_name_indexes.push_back(name_idx);
+    }
+  }
+  std::sort(class_name_indexes.begin(), class_name_indexes.end(),
+	    class_name_less(*this));
+  class_name_indexes.erase
+    (std::unique(class_name_indexes.begin(), class_name_indexes.end(),
+		 class_name_equal(*this)),
+     class_name_indexes.end());
+}
+
+// Returns the offset of the constant pool entry after its tag.
+// Throws if the entry does not have the expected tag.
+size_t
+cxxll::java_class::constant_offset(unsigned short idx, unsigned char tag) const
 {
   if (idx == 0) {
     throw exception("zero constant pool index");
   }
-  size_t offset = constant_pool_offsets.at(idx - 1);
-  unsigned char tag;
-  extract(buffer(), offset, tag);
-  if (tag != CONSTANT_Class) {
-    throw exception("class tag expected");
+  if (idx > constant_pool_offsets.size()) {
+    throw exception("constant pool index out of range");
   }
+  size_t offset = constant_pool_offsets[idx - 1];
+  if (offset == 0 || buffer()[offset] != tag) {
+    switch (tag) {
+    case CONSTANT_Class:
+      throw exception("class tag expected");
+    case CONSTANT_Utf8:
+      throw exception("UTF-8 tag expected");
+    case CONSTANT_NameAndType:
+      throw exception("name-and-type tag expected");
+    default:
+      throw exception("unexpected constant pool tag");
+    }
+  }
+  return offset + 1;
+}
+
+cxxll::const_stringref
+cxxll::java_class::class_name(unsigned short idx) const
+{
+  size_t offset = constant_offset(idx, CONSTANT_Class);
   unsigned short name_idx;
   big_endian::extract(buffer(), offset, name_idx);
-  return utf8_string(name_idx);
+  return utf8_ref(name_idx);
 }
 
 std::string
 cxxll::java_class::utf8_string(unsigned short idx) const
 {
-  if (idx == 0) {
-    throw exception("zero constant pool index");
-  }
-  size_t offset = constant_pool_offsets.at(idx - 1);
-  unsigned char tag;
-  extract(buffer(), offset, tag);
-  if (tag != CONSTANT_Utf8) {
-    throw exception("UTF-8 tag expected");
+  return utf8_ref(idx).str();
+}
+
+cxxll::const_stringref
+cxxll::java_class::utf8_ref(unsigned short idx) const
+{
+  // The constructor has checked that the string is within bounds.
+  const unsigned char *p =
+    buffer().data() + constant_offset(idx, CONSTANT_Utf8);
+  if (!converted_strings.empty()) {
+    std::map<unsigned short, std::string>::const_iterator it
+      = converted_strings.find(idx);
+    if (it != converted_strings.end()) {
+      return it->second;
+    }
   }
-  unsigned short len;
-  big_endian::extract(buffer(), offset, len);
-  std::string result;
-  extract(buffer(), offset, len, result);
-  return result;
+  return const_stringref(p + 2, (p[0] << 8) | p[1]);
 }
 
 unsigned
@@ -187,6 +436,12 @@ cxxll::java_class::interface_count() const
 
 std::string
 cxxll::java_class::interface(unsigned index) const
+{
+  return interface_ref(index).str();
+}
+
+cxxll::const_stringref
+cxxll::java_class::interface_ref(unsigned index) const
 {
   return class_name(interface_indexes.at(index));
 }
@@ -195,19 +450,41 @@ std::vector<std::string>
 cxxll::java_class::class_references() const
 {
   std::vector<std::string> result;
-  for (std::vector<unsigned>::const_iterator
-	 p = constant_pool_offsets.begin(), end = constant_pool_offsets.end();
+  result.reserve(class_name_indexes.size());
+  for (std::vector<unsigned short>::const_iterator
+	 p = class_name_indexes.begin(), end = class_name_indexes.end();
        p != end; ++p) {
-    if (*p != 0 && buffer().at(*p) == CONSTANT_Class) {
-      size_t offset = *p + 1;
-      unsigned short name_idx;
-      big_endian::extract(buffer(), offset, name_idx);
-      result.push_back(utf8_string(name_idx));
-    }
+    result.push_back(utf8_ref(*p).str());
   }
   return result;
 }
 
+cxxll::const_stringref
+cxxll::java_class::class_reference(unsigned index) const
+{
+  return utf8_ref(class_name_indexes.at(index));
+}
+
+void
+cxxll::java_class::member_reference(unsigned index,
+				    member_ref &ref) const
+{
+  unsigned short idx = member_reference_indexes.at(index);
+  size_t offset = constant_pool_offsets[idx - 1];
+  ref.tag = buffer()[offset];
+  ++offset;
+  unsigned short class_idx, name_and_type_idx;
+  big_endian::extract(buffer(), offset, class_idx);
+  big_endian::extract(buffer(), offset, name_and_type_idx);
+  ref.class_name = class_name(class_idx);
+  offset = constant_offset(name_and_type_idx, CONSTANT_NameAndType);
+  unsigned short name_idx, descriptor_idx;
+  big_endian::extract(buffer(), offset, name_idx);
+  big_endian::extract(buffer(), offset, descriptor_idx);
+  ref.name = utf8_ref(name_idx);
+  ref.descriptor = utf8_ref(descriptor_idx);
+}
+
 //////////////////////////////////////////////////////////////////////
 // cxxll::java_class::exception
 
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cxxll/java_class_batch.hpp>
+#include <cxxll/java_class.hpp>
+#include <cxxll/hash.hpp>
+#include <cxxll/raise.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace cxxll;
+
+const unsigned java_class_batch::digest_size;
+
+java_class_batch::java_class_batch()
+{
+}
+
+java_class_batch::~java_class_batch()
+{
+}
+
+void
+java_class_batch::clear()
+{
+  arena.clear();
+  digest.clear();
+  name.clear();
+  super_class.clear();
+  access_flags.clear();
+  major_version.clear();
+  minor_version.clear();
+  interfaces_end.clear();
+  interfaces.clear();
+  references_end.clear();
+  references.clear();
+  fields = members();
+  methods = members();
+  member_refs = member_references();
+}
+
+// The column sizes before a row is added, so that a partially added
+// row can be removed again.
+struct java_class_batch::mark {
+  size_t arena, rows, interfaces, references, fields, methods, member_refs;
+
+  explicit mark(const java_class_batch &b)
+    : arena(b.arena.size()), rows(b.name.size()),
+      interfaces(b.interfaces.size()), references(b.references.size()),
+      fields(b.fields.size()), methods(b.methods.size()),
+      member_refs(b.member_refs.size())
+  {
+  }
+
+  static void reset(members &m, size_t rows, size_t size)
+  {
+    m.end.resize(rows);
+    m.access_flags.resize(size);
+    m.name.resize(size);
+    m.descriptor.resize(size);
+  }
+
+  void reset(java_class_batch &b) const
+  {
+    b.arena.resize(arena);
+    b.digest.resize(rows * digest_size);
+    b.name.resize(rows);
+    b.super_class.resize(rows);
+    b.access_flags.resize(rows);
+    b.major_version.resize(rows);
+    b.minor_version.resize(rows);
+    b.interfaces_end.resize(rows);
+    b.interfaces.resize(interfaces);
+    b.references_end.resize(rows);
+    b.references.resize(references);
+    reset(b.fields, rows, fields);
+    reset(b.methods, rows, methods);
+    b.member_refs.end.resize(rows);
+    b.member_refs.tag.resize(member_refs);
+    b.member_refs.class_name.resize(member_refs);
+    b.member_refs.name.resize(member_refs);
+    b.member_refs.descriptor.resize(member_refs);
+  }
+};
+
+void
+java_class_batch::add_members(const java_class &jc, members &m, bool methods)
+{
+  unsigned count = methods ? jc.method_count() : jc.field_count();
+  for (unsigned i = 0; i < count; ++i) {
+    const java_class::member &member(methods ? jc.method(i) : jc.field(i));
+    m.access_flags.push_back(member.access_flags);
+    m.name.push_back(add_name(jc.utf8_ref(member.name_index)));
+    m.descriptor.push_back(add_name(jc.utf8_ref(member.descriptor_index)));
+  }
+  m.end.push_back(m.name.size());
+}
+
+void
+java_class_batch::add(const java_class &jc)
+{
+  std::vector<unsigned char> dig(hash(hash_sink::sha256, jc.buffer()));
+  mark before(*this);
+  try {
+    const_stringref this_class(jc.this_class_ref());
+    name.push_back(add_name(this_class));
+    super_class.push_back(add_name(jc.super_class_ref()));
+    digest.insert(digest.end(), dig.begin(), dig.end());
+    access_flags.push_back(jc.access_flags());
+    major_version.push_back(jc.major_version());
+    minor_version.push_back(jc.minor_version());
+
+    for (unsigned i = 0, end = jc.interface_count(); i < end; ++i) {
+      interfaces.push_back(add_name(jc.interface_ref(i)));
+    }
+    interfaces_end.push_back(interfaces.size());
+
+    // The class references are already sorted and deduplicated.
+    for (unsigned i = 0, end = jc.class_reference_count(); i < end; ++i) {
+      const_stringref ref(jc.class_reference(i));
+      if (ref != "java/lang/Object" && ref != "java/lang/String"
+	  && ref != this_class) {
+	references.push_back(add_name(ref));
+      }
+    }
+    references_end.push_back(references.size());
+
+    add_members(jc, fields, false);
+    add_members(jc, methods, true);
+
+    java_class::member_ref ref;
+    for (unsigned i = 0, end = jc.member_reference_count(); i < end; ++i) {
+      jc.member_reference(i, ref);
+      member_refs.tag.push_back(ref.tag);
+      member_refs.class_name.push_back(add_name(ref.class_name));
+      member_refs.name.push_back(add_name(ref.name));
+      member_refs.descriptor.push_back(add_name(ref.descriptor));
+    }
+    member_refs.end.push_back(member_refs.name.size());
+  } catch (...) {
+    before.reset(*this);
+    throw;
+  }
+}
+
+void
+java_class_batch::append_offsets(std::vector<unsigned> &target,
+				 const std::vector<unsigned> &source,
+				 unsigned delta)
+{
+  target.reserve(target.size() + source.size());
+  for (std::vector<unsigned>::const_iterator p = source.begin(),
+	 end = source.end(); p != end; ++p) {
+    target.push_back(*p + delta);
+  }
+}
+
+void
+java_class_batch::append_members(members &target, const members &source,
+				 unsigned arena)
+{
+  append_offsets(target.end, source.end, target.size());
+  target.access_flags.insert(target.access_flags.end(),
+			     source.access_flags.begin(),
+			     source.access_flags.end());
+  append_offsets(target.name, source.name, arena);
+  append_offsets(target.descriptor, source.descriptor, arena);
+}
+
+void
+java_class_batch::append(const java_class_batch &other)
+{
+  if (arena.size() + other.arena.size() >= ~0U) {
+    raise<std::length_error>("java_class_batch string arena overflow");
+  }
+  mark before(*this);
+  try {
+    unsigned delta = arena.size();
+    arena.insert(arena.end(), other.arena.begin(), other.arena.end());
+    digest.insert(digest.end(), other.digest.begin(), other.digest.end());
+    append_offsets(name, other.name, delta);
+    append_offsets(super_class, other.super_class, delta);
+    access_flags.insert(access_flags.end(),
+			other.access_flags.begin(), other.access_flags.end());
+    major_version.insert(major_version.end(), other.major_version.begin(),
+			 other.major_version.end());
+    minor_version.insert(minor_version.end(), other.minor_version.begin(),
+			 other.minor_version.end());
+    append_offsets(interfaces_end, other.interfaces_end, interfaces.size());
+    append_offsets(interfaces, other.interfaces, delta);
+    append_offsets(references_end, other.references_end, references.size());
+    append_offsets(references, other.references, delta);
+    append_members(fields, other.fields, delta);
+    append_members(methods, other.methods, delta);
+    append_offsets(member_refs.end, other.member_refs.end, member_refs.size());
+    member_refs.tag.insert(member_refs.tag.end(),
+			   other.member_refs.tag.begin(),
+			   other.member_refs.tag.end());
+    append_offsets(member_refs.class_name, other.member_refs.class_name,
+		   delta);
+    append_offsets(member_refs.name, other.member_refs.name, delta);
+    append_offsets(member_refs.descriptor, other.member_refs.descriptor,
+		   delta);
+  } catch (...) {
+    before.reset(*this);
+    throw;
+  }
+}
+
+unsigned
+java_class_batch::add_string(const_stringref str)
+{
+  size_t offset = arena.size();
+  if (offset + str.size() >= ~0U) {
+    raise<std::length_error>("java_class_batch string arena overflow");
+  }
+  arena.insert(arena.end(), str.data(), str.data() + str.size());
+  arena.push_back('\0');
+  return offset;
+}
+
+unsigned
+java_class_batch::add_name(const_stringref str)
+{
+  // The arena cannot represent embedded NUL characters, and neither
+  // can PostgreSQL.
+  if (memchr(str.data(), '\0', str.size()) != NULL) {
+    throw java_class::exception("NUL character in name");
+  }
+  return add_string(str);
+}
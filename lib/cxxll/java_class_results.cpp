@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/java_class_results.hpp>
+#include <cxxll/java_class.hpp>
+#include <cxxll/mutex.hpp>
+#include <cxxll/raise.hpp>
+#include <cxxll/string_support.hpp>
+#include <cxxll/task.hpp>
+#include <cxxll/zip_file.hpp>
+
+#include <stdexcept>
+
+using namespace cxxll;
+
+java_class_results::java_class_results()
+{
+}
+
+java_class_results::~java_class_results()
+{
+}
+
+void
+java_class_results::add(const std::vector<unsigned char> &data,
+			const std::string &path)
+{
+  try {
+    if (parser) {
+      parser->reset(&data);
+    } else {
+      parser.reset(new java_class(&data));
+    }
+    batch.add(*parser);
+  } catch (java_class::exception &e) {
+    add_error(path, e.what());
+  }
+}
+
+void
+java_class_results::add_error(const std::string &path, const char *message)
+{
+  errors.push_back(std::make_pair(path, std::string(message)));
+}
+
+void
+java_class_results::append(const java_class_results &other)
+{
+  batch.append(other.batch);
+  errors.insert(errors.end(), other.errors.begin(), other.errors.end());
+}
+
+namespace {
+  // Decompresses and parses a contiguous range of the class files in
+  // a ZIP archive.  Each chunk uses its own zip_file object, so that
+  // the chunks of an archive can be processed in parallel.
+  struct zip_class_chunk {
+    const unsigned char *data;
+    size_t length;
+    std::string prefix;		// for the entry names
+    unsigned long long begin;	// index of the first class file
+    unsigned long long end;	// index after the last class file
+    java_class_results *results;
+    std::string error;		// exception from a worker thread
+
+    zip_class_chunk()
+      : data(NULL), length(0), begin(0), end(0), results(NULL)
+    {
+    }
+
+    void run() throw();
+  };
+
+  void
+  zip_class_chunk::run() throw()
+  {
+    try {
+      zip_file zip(data, length);
+      std::vector<unsigned char> buffer;
+      unsigned long long index = 0;
+      // The caller has checked the directory up to the last class
+      // file, so next() does not fail here.
+      while (index < end && zip.next()) {
+	std::string name(zip.name());
+	if (!ends_with(name, ".class")) {
+	  continue;
+	}
+	if (index++ < begin) {
+	  continue;
+	}
+	name.insert(0, prefix);
+	try {
+	  zip.data(buffer);
+	} catch (zip_file::exception &e) {
+	  results->add_error(name, e.what());
+	  continue;
+	}
+	if (java_class::has_signature(buffer)) {
+	  results->add(buffer, name);
+	}
+      }
+    } catch (std::exception &e) {
+      error = e.what();
+    }
+  }
+
+  // Parsing chunks smaller than this on separate threads is not
+  // worth the overhead.
+  const unsigned long long min_classes_per_chunk = 256;
+
+  // Number of chunk threads running in the process.
+  mutex chunk_threads_mutex;
+  unsigned chunk_threads;
+
+  // Reserves up to WANTED chunk threads while keeping the total at or
+  // below LIMIT, and releases them on destruction.
+  class chunk_thread_reservation {
+    unsigned count_;
+    // Not implemented.
+    chunk_thread_reservation(const chunk_thread_reservation &);
+    chunk_thread_reservation &operator=(const chunk_thread_reservation &);
+  public:
+    chunk_thread_reservation(unsigned wanted, unsigned limit);
+    ~chunk_thread_reservation();
+
+    // Number of reserved threads.
+    unsigned count() const;
+  };
+
+  chunk_thread_reservation::chunk_thread_reservation(unsigned wanted,
+						     unsigned limit)
+  {
+    mutex::locker ml(&chunk_threads_mutex);
+    unsigned available = limit > chunk_threads ? limit - chunk_threads : 0;
+    count_ = wanted < available ? wanted : available;
+    chunk_threads += count_;
+  }
+
+  chunk_thread_reservation::~chunk_thread_reservation()
+  {
+    mutex::locker ml(&chunk_threads_mutex);
+    chunk_threads -= count_;
+  }
+
+  unsigned
+  chunk_thread_reservation::count() const
+  {
+    return count_;
+  }
+}
+
+void
+cxxll::parse_zip_classes(const unsigned char *data, size_t length,
+			 const std::string &prefix, unsigned long long classes,
+			 unsigned threads, java_class_results &results)
+{
+  if (classes == 0) {
+    return;
+  }
+  unsigned long long wanted = classes / min_classes_per_chunk;
+  if (wanted > threads) {
+    wanted = threads;
+  }
+  if (wanted == 0) {
+    wanted = 1;
+  }
+  // The first chunk runs on the current thread and does not need a
+  // reservation.
+  chunk_thread_reservation reservation(wanted - 1, threads - 1);
+  unsigned count = reservation.count() + 1;
+  std::vector<zip_class_chunk> chunks(count);
+  // The first chunk adds to RESULTS directly, the others are appended
+  // once all chunks have finished.
+  std::vector<java_class_results> later(count - 1);
+  for (unsigned i = 0; i < count; ++i) {
+    zip_class_chunk &chunk(chunks[i]);
+    chunk.data = data;
+    chunk.length = length;
+    chunk.prefix = prefix;
+    chunk.begin = classes * i / count;
+    chunk.end = classes * (i + 1) / count;
+    chunk.results = i == 0 ? &results : &later[i - 1];
+  }
+
+  std::vector<std::tr1::shared_ptr<task> > tasks;
+  try {
+    for (unsigned i = 1; i < count; ++i) {
+      tasks.push_back(std::tr1::shared_ptr<task>
+		      (new task(std::tr1::bind(&zip_class_chunk::run,
+					       &chunks[i]))));
+    }
+  } catch (...) {
+    for (std::vector<std::tr1::shared_ptr<task> >::iterator
+	   p = tasks.begin(), end = tasks.end(); p != end; ++p) {
+      (*p)->wait();
+    }
+    throw;
+  }
+  chunks.front().run();
+  for (std::vector<std::tr1::shared_ptr<task> >::iterator
+	 p = tasks.begin(), end = tasks.end(); p != end; ++p) {
+    (*p)->wait();
+  }
+
+  for (std::vector<zip_class_chunk>::iterator
+	 p = chunks.begin(), end = chunks.end(); p != end; ++p) {
+    if (!p->error.empty()) {
+      raise<std::runtime_error>(p->error);
+    }
+  }
+  for (std::vector<java_class_results>::iterator
+	 p = later.begin(), end = later.end(); p != end; ++p) {
+    results.append(*p);
+  }
+}
+
+namespace {
+  // Limits for descending into archives nested in a ZIP file.  The
+  // byte budget covers nested archives which have to be decompressed
+  // into memory, summed over the whole outer file.  Stored archives
+  // are read in place and do not count against it.
+  struct zip_budget {
+    unsigned depth;
+    unsigned long long bytes;
+    unsigned threads;		// for parsing class files
+
+    explicit zip_budget(unsigned thr)
+      : depth(4), bytes(256ULL << 20), threads(thr)
+    {
+    }
+  };
+
+  bool
+  is_nested_archive(const std::string &name)
+  {
+    return ends_with(name, ".jar") || ends_with(name, ".war")
+      || ends_with(name, ".ear");
+  }
+
+  void parse_zip_entries(const unsigned char *, size_t,
+			 const std::string &archive,
+			 zip_budget &, java_class_results &);
+
+  // Processes the current entry of ZIP, which is an archive named
+  // PATH.
+  void
+  parse_nested_zip(zip_file &zip, const std::string &path,
+		   zip_budget &budget, java_class_results &results)
+  {
+    if (budget.depth == 0) {
+      results.add_error(path, "archive nesting too deep");
+      return;
+    }
+    const unsigned char *data;
+    size_t length;
+    std::vector<unsigned char> buffer;
+    try {
+      if (!zip.data_in_place(data, length)) {
+	if (zip.size() > budget.bytes) {
+	  results.add_error(path, "nested archive size limit exceeded");
+	  return;
+	}
+	zip.data(buffer);
+	budget.bytes -= buffer.size();
+	data = buffer.data();
+	length = buffer.size();
+      }
+    } catch (zip_file::exception &e) {
+      results.add_error(path, e.what());
+      return;
+    }
+    if (!zip_file::has_signature(data, length)) {
+      return;
+    }
+    --budget.depth;
+    parse_zip_entries(data, length, path, budget, results);
+    ++budget.depth;
+  }
+
+  // Processes the entries of the ZIP archive in DATA.  ARCHIVE is the
+  // path of a nested archive (which is used as a prefix of the entry
+  // names), or empty.  Nested archives are processed first, then the
+  // class files.
+  void
+  parse_zip_entries(const unsigned char *data, size_t length,
+		    const std::string &archive,
+		    zip_budget &budget, java_class_results &results)
+  {
+    std::string prefix;
+    if (!archive.empty()) {
+      prefix = archive + "!/";
+    }
+    zip_file zip(data, length);
+    unsigned long long classes = 0;
+    while (true) {
+      try {
+	if (!zip.next()) {
+	  break;
+	}
+      } catch (zip_file::exception &e) {
+	results.add_error(archive, e.what());
+	// Exit the loop because the file is likely corrupted
+	// significantly.
+	break;
+      }
+      // Only class files and nested archives are analyzed, so other
+      // entries are not decompressed at all.
+      std::string name(zip.name());
+      if (is_nested_archive(name)) {
+	parse_nested_zip(zip, prefix + name, budget, results);
+      } else if (ends_with(name, ".class")) {
+	++classes;
+      }
+    }
+    parse_zip_classes(data, length, prefix, classes, budget.threads, results);
+  }
+}
+
+void
+cxxll::parse_java_archive(const unsigned char *data, size_t length,
+			  unsigned threads, java_class_results &results)
+{
+  zip_budget budget(threads);
+  parse_zip_entries(data, length, std::string(), budget, results);
+}
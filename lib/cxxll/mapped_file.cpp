@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/mapped_file.hpp>
+#include <cxxll/fd_handle.hpp>
+#include <cxxll/os_exception.hpp>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace cxxll;
+
+mapped_file::mapped_file(const char *path)
+  : data_(NULL), size_(0)
+{
+  fd_handle fd;
+  fd.open_read_only(path);
+  struct stat st;
+  if (fstat(fd.get(), &st) != 0) {
+    throw os_exception().function(::fstat).fd(fd.get()).path(path);
+  }
+  if (st.st_size == 0) {
+    return;
+  }
+  if (static_cast<unsigned long long>(st.st_size) != size_t(st.st_size)) {
+    throw os_exception().message("file too large to map").path(path)
+      .length(st.st_size);
+  }
+  void *ret = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+  if (ret == MAP_FAILED) {
+    throw os_exception().function(::mmap).fd(fd.get()).path(path)
+      .length(st.st_size);
+  }
+  data_ = static_cast<const unsigned char *>(ret);
+  size_ = st.st_size;
+}
+
+mapped_file::~mapped_file()
+{
+  if (data_ != NULL) {
+    munmap(const_cast<unsigned char *>(data_), size_);
+  }
+}
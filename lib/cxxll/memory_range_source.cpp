@@ -41,3 +41,12 @@ memory_range_source::read(unsigned char *buffer, size_t length)
   p += to_copy;
   return to_copy;
 }
+
+const_stringref
+memory_range_source::borrow(size_t length)
+{
+  size_t to_borrow = std::min(length, static_cast<size_t>(end - p));
+  const_stringref result(p, to_borrow);
+  p += to_borrow;
+  return result;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/os.hpp>
+#include <cxxll/os_exception.hpp>
+
+#include <symboldb_config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cxxll;
+
+namespace {
+  // Upper bound for the length argument of the kernel copy functions.
+  const size_t chunk_size = 1U << 30;
+
+  // Buffer size for the read/write fallback.
+  const size_t buffer_size = 64 * 1024;
+
+  // Error codes which indicate that the kernel cannot perform the
+  // copy operation for this combination of descriptors.  The data
+  // has to be copied using a different method.
+  bool
+  unsupported(int err)
+  {
+    return err == EINVAL || err == ENOSYS || err == EXDEV
+      || err == EOPNOTSUPP || err == EBADF;
+  }
+
+  // Error codes for a non-blocking descriptor which is not ready.
+  // The kernel copy functions cannot tell which descriptor caused
+  // this, so they leave it to read_write(), which can poll the
+  // right one.  Nothing has been transferred in this case.
+  bool
+  would_block(int err)
+  {
+    return err == EAGAIN || err == EWOULDBLOCK;
+  }
+
+  // Blocks until FD is ready for EVENTS (POLLIN or POLLOUT).
+  void
+  wait_for(int fd, short events)
+  {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    while (::poll(&pfd, 1, -1) < 0) {
+      if (errno != EINTR) {
+	throw os_exception().fd(fd).function(::poll).defaults();
+      }
+    }
+  }
+
+  // The try_* functions return true if the end of the input has been
+  // reached, and false if the method is not supported.  COUNT is
+  // updated with the number of bytes copied in either case.
+
+#ifdef HAVE_COPY_FILE_RANGE
+  bool
+  try_copy_file_range(int in, int out, unsigned long long &count)
+  {
+    bool progress = false;
+    while (true) {
+      ssize_t ret = ::copy_file_range(in, NULL, out, NULL, chunk_size, 0);
+      if (ret < 0) {
+	if (errno == EINTR) {
+	  continue;
+	}
+	if (unsupported(errno) || would_block(errno)) {
+	  return false;
+	}
+	throw os_exception().fd(in).count(chunk_size)
+	  .function(::copy_file_range).defaults();
+      }
+      if (ret == 0) {
+	// Some kernels report end-of-file immediately for special
+	// files.  Let another method confirm it.
+	return progress;
+      }
+      progress = true;
+      count += ret;
+    }
+  }
+#endif
+
+  bool
+  try_sendfile(int in, int out, unsigned long long &count)
+  {
+    while (true) {
+      ssize_t ret = ::sendfile(out, in, NULL, chunk_size);
+      if (ret < 0) {
+	if (errno == EINTR) {
+	  continue;
+	}
+	if (unsupported(errno) || would_block(errno)) {
+	  return false;
+	}
+	throw os_exception().fd(in).count(chunk_size)
+	  .function(::sendfile).defaults();
+      }
+      if (ret == 0) {
+	return true;
+      }
+      count += ret;
+    }
+  }
+
+  bool
+  try_splice(int in, int out, unsigned long long &count)
+  {
+    while (true) {
+      ssize_t ret = ::splice(in, NULL, out, NULL, chunk_size, SPLICE_F_MOVE);
+      if (ret < 0) {
+	if (errno == EINTR) {
+	  continue;
+	}
+	if (unsupported(errno) || would_block(errno)) {
+	  return false;
+	}
+	throw os_exception().fd(in).count(chunk_size)
+	  .function(::splice).defaults();
+      }
+      if (ret == 0) {
+	return true;
+      }
+      count += ret;
+    }
+  }
+
+  void
+  read_write(int in, int out, unsigned long long &count)
+  {
+    char buf[buffer_size];
+    while (true) {
+      ssize_t ret = ::read(in, buf, sizeof(buf));
+      if (ret < 0) {
+	if (errno == EINTR) {
+	  continue;
+	}
+	if (would_block(errno)) {
+	  wait_for(in, POLLIN);
+	  continue;
+	}
+	throw os_exception().fd(in).count(sizeof(buf))
+	  .function(::read).defaults();
+      }
+      if (ret == 0) {
+	return;
+      }
+      count += ret;
+      const char *p = buf;
+      while (ret > 0) {
+	ssize_t written = ::write(out, p, ret);
+	if (written == 0) {
+	  written = -1;
+	  errno = ENOSPC;
+	}
+	if (written < 0) {
+	  if (errno == EINTR) {
+	    continue;
+	  }
+	  if (would_block(errno)) {
+	    wait_for(out, POLLOUT);
+	    continue;
+	  }
+	  throw os_exception().fd(out).count(ret)
+	    .function(::write).defaults();
+	}
+	p += written;
+	ret -= written;
+      }
+    }
+  }
+
+  bool
+  is_type(int fd, unsigned type)
+  {
+    struct stat64 st;
+    return fstat64(fd, &st) == 0 && (st.st_mode & S_IFMT) == type;
+  }
+}
+
+unsigned long long
+cxxll::copy_fd_to_fd(int in, int out)
+{
+  unsigned long long count = 0;
+  // copy_file_range and sendfile need a regular file as input.  Each
+  // method continues at the current file offsets, so a fallback after
+  // partial progress is safe.
+  if (is_type(in, S_IFREG)) {
+#ifdef HAVE_COPY_FILE_RANGE
+    if (try_copy_file_range(in, out, count)) {
+      return count;
+    }
+#endif
+    if (try_sendfile(in, out, count)) {
+      return count;
+    }
+  }
+  if (is_type(in, S_IFIFO) || is_type(out, S_IFIFO)) {
+    if (try_splice(in, out, count)) {
+      return count;
+    }
+  }
+  read_write(in, out, count);
+  return count;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/pg_cursor.hpp>
+#include <cxxll/pgconn_handle.hpp>
+#include <cxxll/pg_exception.hpp>
+
+#include <stdio.h>
+
+using namespace cxxll;
+
+pg_cursor::pg_cursor(pgconn_handle &conn, unsigned batch)
+  : conn_(conn), row_(-1), open_(false), own_transaction_(false)
+{
+  // The object address is unique among the live cursors.
+  char buf[64];
+  snprintf(buf, sizeof(buf), "cxxll_cursor_%lx",
+	   (unsigned long) this);
+  name_ = buf;
+  snprintf(buf, sizeof(buf), "FETCH %u FROM ", batch);
+  fetch_ = buf;
+  fetch_ += name_;
+}
+
+pg_cursor::~pg_cursor() throw()
+{
+  try {
+    finish();
+  } catch (pg_exception &) {
+  }
+}
+
+std::string
+pg_cursor::begin(const char *sql)
+{
+  finish();
+  if (conn_.transactionStatus() == PQTRANS_IDLE) {
+    pgresult_handle res;
+    res.exec(conn_, "BEGIN");
+    own_transaction_ = true;
+  }
+  std::string declare("DECLARE ");
+  declare += name_;
+  declare += " NO SCROLL CURSOR FOR ";
+  declare += sql;
+  return declare;
+}
+
+void
+pg_cursor::declared()
+{
+  row_ = -1;
+  open_ = true;
+}
+
+void
+pg_cursor::finish()
+{
+  pgresult_handle res;
+  if (open_) {
+    open_ = false;
+    // The cursor is gone if the transaction has ended or failed, and
+    // committing our own transaction closes it as well.
+    if (!own_transaction_
+	&& conn_.transactionStatus() == PQTRANS_INTRANS) {
+      std::string close("CLOSE ");
+      close += name_;
+      res.exec(conn_, close.c_str());
+    }
+  }
+  if (own_transaction_) {
+    own_transaction_ = false;
+    // Turns into a rollback if the transaction has failed.
+    res.exec(conn_, "COMMIT");
+  }
+}
+
+void
+pg_cursor::declare(const char *sql)
+{
+  res_.execBinary(conn_, begin(sql).c_str());
+  declared();
+}
+
+bool
+pg_cursor::next()
+{
+  if (!open_) {
+    return false;
+  }
+  ++row_;
+  if (row_ < res_.ntuples()) {
+    return true;
+  }
+  res_.execParamsCustom(conn_, fetch_.c_str(), 0, NULL, NULL, NULL, NULL, 1);
+  row_ = 0;
+  if (res_.ntuples() == 0) {
+    finish();
+    return false;
+  }
+  return true;
+}
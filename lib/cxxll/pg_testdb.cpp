@@ -19,7 +19,6 @@
 #include <cxxll/pg_testdb.hpp>
 
 #include <cxxll/fd_source.hpp>
-#include <cxxll/fd_sink.hpp>
 #include <cxxll/os.hpp>
 #include <cxxll/os_exception.hpp>
 #include <cxxll/pg_exception.hpp>
@@ -310,7 +309,5 @@ pg_testdb::dump_logs()
   fflush(stderr);
   fd_handle fd;
   fd.open_read_only(impl_->logfile.c_str());
-  fd_source source(fd.get());
-  fd_sink sink(STDERR_FILENO);
-  copy_source_to_sink(source, sink);
+  copy_fd_to_fd(fd.get(), STDERR_FILENO);
 }
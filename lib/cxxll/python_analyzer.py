@@ -15,7 +15,7 @@
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 # This file must be valid Python 2 and Python 3, so that we can use it
-# to analyze both language variants.  See python_imports.cpp for a
+# to analyze both language variants.  See python_analyzer_pool.cpp for a
 # description of the protocol.
 
 import struct
@@ -34,11 +34,19 @@ try:
 except NameError:
     unicodetype = str # Python 3
 
+def read_exactly(n):
+    data = instream.read(n)
+    if len(data) != n:
+        # The parent process has closed the pipe, possibly in the
+        # middle of a request.  This is the normal way to shut down.
+        sys.exit(0)
+    return data
+
 def read_number():
-    return struct.unpack(">I", instream.read(4))[0]
+    return struct.unpack(">I", read_exactly(4))[0]
 
 def read_string():
-    return instream.read(read_number())
+    return read_exactly(read_number())
 
 def write_number(n):
     outstream.write(struct.pack(">I", n))
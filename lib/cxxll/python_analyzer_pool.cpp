@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/python_analyzer_pool.hpp>
+#include <cxxll/os_exception.hpp>
+#include <cxxll/eof_exception.hpp>
+#include <cxxll/subprocess.hpp>
+#include <cxxll/fd_sink.hpp>
+#include <cxxll/fd_source.hpp>
+#include <cxxll/endian.hpp>
+#include <cxxll/hash.hpp>
+#include <cxxll/mutex.hpp>
+#include <cxxll/cond.hpp>
+#include <cxxll/task.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <map>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+
+/*
+  We use the following encoding to communicate with the Python
+  subprocesses:
+
+  Numbers are encoded as 32-bit unsigned values in big endian order.
+
+  Strings are encoded as their length (as a number), followed by their
+  bytes.
+
+  Arrays are encoded as a number, followed by a matching number of
+  array elements.
+
+  This encoding is not self-describing, it requires knowledge of the
+  types in the data stream.
+
+  To request parsing a self-contained piece of source code, the parent
+  process sends it as a single string.
+
+  The child process responds with the error message (a string,
+  possibly empty), the line number of the error (a number, zero in
+  case of no error), and the extracted imports, attributes, functions
+  and classes (arrays of strings).
+
+  The child process handles requests strictly in order, so the parent
+  process can send further requests before reading the response to
+  the first one.  To avoid a deadlock, the requests which have been
+  sent after the oldest unanswered request must fit into the pipe
+  buffer: the child process can block writing the response to that
+  request, and the parent process must then be able to complete its
+  own writes without the child process reading anything.
+*/
+
+using namespace cxxll;
+
+static const char PYTHON_SCRIPT[] = {
+#include "python_analyzer.py.inc"
+  , 0
+};
+
+// Maximum number of requests a worker takes from the queue at once.
+static const size_t max_batch = 16;
+
+// Number of memoized results.
+static const size_t memo_entries = 4096;
+
+python_analyzer_pool::result::result()
+  : error_line(0), version(0)
+{
+}
+
+class python_analyzer_pool::request {
+public:
+  std::vector<unsigned char> source_; // cleared after processing
+  std::vector<unsigned char> digest_; // SHA-256 of the source
+  result result_;
+  std::string failure_;		// set if the interpreter terminated
+  bool done_;
+
+  request()
+    : done_(false)
+  {
+  }
+};
+
+namespace {
+  typedef std::vector<const std::vector<unsigned char> *> sources_type;
+  typedef std::vector<python_analyzer_pool::result> results_type;
+
+  struct interpreter {
+    subprocess process_;
+    unsigned version_;
+    size_t capacity_;		// of the standard input pipe
+
+    interpreter(const char *python_path, unsigned version);
+
+    // Parses SOURCES, starting at index FIRST, and stores the
+    // results in RESULTS.  Returns the index of the first request
+    // without a result, which is less than sources.size() if the
+    // interpreter failed.  In this case, ERROR is set to a
+    // description of the failure.
+    size_t parse(const sources_type &sources, size_t first,
+		 results_type &results, std::string &error);
+
+    void send_string(const std::vector<unsigned char> &);
+    void receive(source &, python_analyzer_pool::result &);
+    std::string read_string(source &);
+    unsigned read_number(source &);
+    void read_array(source &, std::vector<std::string> &);
+  };
+
+  interpreter::interpreter(const char *python_path, unsigned version)
+    : version_(version), capacity_(PIPE_BUF)
+  {
+    process_.command(python_path);
+    process_.arg("-c");
+    process_.arg(PYTHON_SCRIPT);
+    process_.redirect(subprocess::in, subprocess::pipe);
+    process_.redirect(subprocess::out, subprocess::pipe);
+    // TODO: capture standard error
+    process_.start();
+#ifdef F_GETPIPE_SZ
+    int size = fcntl(process_.pipefd(subprocess::in), F_GETPIPE_SZ);
+    if (size > 0) {
+      capacity_ = size;
+    }
+#endif
+  }
+
+  size_t
+  interpreter::parse(const sources_type &sources, size_t first,
+		     results_type &results, std::string &error)
+  {
+    size_t sent = first;
+    size_t received = first;
+    // Bytes sent after the oldest unanswered request.
+    size_t queued = 0;
+    try {
+      fd_source src(process_.pipefd(subprocess::out));
+      while (received < sources.size()) {
+	while (sent < sources.size()) {
+	  size_t size = sizeof(unsigned) + sources[sent]->size();
+	  if (sent > received) {
+	    if (queued + size > capacity_) {
+	      break;
+	    }
+	    queued += size;
+	  }
+	  send_string(*sources[sent]);
+	  ++sent;
+	}
+	receive(src, results[received]);
+	++received;
+	if (received < sent) {
+	  queued -= sizeof(unsigned) + sources[received]->size();
+	}
+      }
+    } catch (eof_exception &) {
+      error = "unexpected termination of ";
+      error += process_.command();
+    } catch (os_exception &e) {
+      error = e.what();
+    }
+    return received;
+  }
+
+  void
+  interpreter::send_string(const std::vector<unsigned char> &str)
+  {
+    fd_sink sink(process_.pipefd(subprocess::in));
+    union {
+      unsigned number;
+      unsigned char buf[sizeof(unsigned)];
+    } u;
+    u.number = cpu_to_be_32(str.size());
+    sink.write(const_stringref(u.buf, sizeof(u.buf)));
+    sink.write(str);
+  }
+
+  void
+  interpreter::receive(source &src, python_analyzer_pool::result &result)
+  {
+    result.error = read_string(src);
+    result.error_line = read_number(src);
+    read_array(src, result.imports);
+    read_array(src, result.attributes);
+    read_array(src, result.functions);
+    read_array(src, result.classes);
+    result.version = version_;
+  }
+
+  unsigned
+  interpreter::read_number(source &src)
+  {
+    union {
+      unsigned number;
+      unsigned char buf[sizeof(unsigned)];
+    } u;
+    read_exactly(src, u.buf, sizeof(u.buf));
+    return be_to_cpu_32(u.number);
+  }
+
+  std::string
+  interpreter::read_string(source &src)
+  {
+    size_t size = read_number(src);
+    char buf[4096];
+    std::string result;
+    while (size > 0) {
+      size_t to_read = std::min(sizeof(buf), size);
+      read_exactly(src, reinterpret_cast<unsigned char *>(buf), to_read);
+      result.append(buf, to_read);
+      size -= to_read;
+    }
+    return result;
+  }
+
+  void
+  interpreter::read_array(source &src, std::vector<std::string> &res)
+  {
+    res.clear();
+    for (unsigned count = read_number(src); count > 0; --count) {
+      res.push_back(read_string(src));
+    }
+  }
+
+  // An interpreter which is (re)started when needed.
+  class interpreter_slot {
+    const char *path_;
+    unsigned version_;
+    std::tr1::shared_ptr<interpreter> interp_;
+  public:
+    interpreter_slot(const char *path, unsigned version);
+
+    // Parses SOURCES and stores the results in RESULTS.  If the
+    // interpreter terminates while processing a request, the request
+    // is retried once with a new interpreter, and if that fails as
+    // well, the error is stored in FAILURES.  Throws os_exception if
+    // the interpreter cannot be started.
+    void parse(const sources_type &sources, results_type &results,
+	       std::vector<std::string> &failures);
+
+    // Returns true if the interpreter has been started.
+    bool active() const;
+
+    // Terminates the interpreter.
+    void stop();
+  };
+
+  interpreter_slot::interpreter_slot(const char *path, unsigned version)
+    : path_(path), version_(version)
+  {
+  }
+
+  void
+  interpreter_slot::parse(const sources_type &sources, results_type &results,
+			  std::vector<std::string> &failures)
+  {
+    size_t done = 0;
+    size_t retried = sources.size();
+    while (done < sources.size()) {
+      if (!(interp_ && interp_->process_.running())) {
+	interp_.reset(new interpreter(path_, version_));
+      }
+      std::string error;
+      done = interp_->parse(sources, done, results, error);
+      if (done < sources.size()) {
+	interp_.reset();
+	if (done == retried) {
+	  failures.at(done) = error;
+	  ++done;
+	} else {
+	  retried = done;
+	}
+      }
+    }
+  }
+
+  bool
+  interpreter_slot::active() const
+  {
+    return interp_.get() != NULL;
+  }
+
+  void
+  interpreter_slot::stop()
+  {
+    interp_.reset();
+  }
+
+  // Parses the batch with Python 2, and the sources which Python 2
+  // rejects with Python 3.
+  void
+  process_batch(interpreter_slot &python2, interpreter_slot &python3,
+		const std::vector<python_analyzer_pool::request_ptr> &batch,
+		const sources_type &sources)
+  {
+    results_type results(sources.size());
+    std::vector<std::string> failures(sources.size());
+    python2.parse(sources, results, failures);
+
+    sources_type retry;
+    std::vector<size_t> indexes;
+    for (size_t i = 0; i < sources.size(); ++i) {
+      if (failures[i].empty() && results[i].error_line != 0) {
+	retry.push_back(sources[i]);
+	indexes.push_back(i);
+      }
+    }
+    if (!retry.empty()) {
+      results_type results3(retry.size());
+      std::vector<std::string> failures3(retry.size());
+      python3.parse(retry, results3, failures3);
+      for (size_t j = 0; j < retry.size(); ++j) {
+	size_t i = indexes[j];
+	if (!failures3[j].empty()) {
+	  failures[i].swap(failures3[j]);
+	} else if (results3[j].error_line == 0
+		   || results3[j].error_line > results[i].error_line) {
+	  // Pick the Python version whose parse error comes later.
+	  results[i] = results3[j];
+	}
+      }
+    }
+    for (size_t i = 0; i < sources.size(); ++i) {
+      batch[i]->result_ = results[i];
+      batch[i]->failure_.swap(failures[i]);
+    }
+  }
+}
+
+struct python_analyzer_pool::impl {
+  unsigned max_workers_;
+  unsigned idle_timeout_;
+
+  // Guards the remaining members and request::done_.
+  mutex mutex_;
+  cond work_cond_;		// new requests or stop_
+  cond done_cond_;		// completed requests
+  std::deque<request_ptr> queue_;
+  std::vector<std::tr1::shared_ptr<task> > tasks_;
+  unsigned idle_;		// workers waiting for requests
+  unsigned interpreters_;	// running interpreters
+  bool stop_;
+
+  // Memoized requests (pending or completed), keyed by the digest of
+  // the source code.  The most recently used entry comes first.
+  typedef std::list<request_ptr> memo_list;
+  memo_list memo_list_;
+  std::map<std::vector<unsigned char>, memo_list::iterator> memo_;
+
+  impl(unsigned workers, unsigned idle_timeout);
+  void worker() throw();
+
+  // Removes the next batch of requests from the queue.  Returns false
+  // if the pool is shutting down.  If TIMEOUT and no request arrives
+  // within the idle timeout, returns true with an empty batch.
+  bool take_batch(std::vector<request_ptr> &, bool timeout);
+
+  // Returns the memoized request for DIGEST, or a null pointer.
+  request_ptr memo_find(const std::vector<unsigned char> &digest);
+
+  // Adds the request to the memo, evicting old entries.
+  void memo_add(const request_ptr &);
+
+  // Removes the request from the memo.
+  void memo_remove(const request_ptr &);
+};
+
+python_analyzer_pool::impl::impl(unsigned workers, unsigned idle_timeout)
+  : max_workers_(std::max(workers, 1U)), idle_timeout_(idle_timeout),
+    idle_(0), interpreters_(0), stop_(false)
+{
+}
+
+void
+python_analyzer_pool::impl::worker() throw()
+{
+  // Writing to a terminated interpreter has to fail with EPIPE
+  // instead of terminating the whole process.
+  sigset_t sigpipe;
+  sigemptyset(&sigpipe);
+  sigaddset(&sigpipe, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+
+  interpreter_slot python2("/usr/bin/python", 2);
+  interpreter_slot python3("/usr/bin/python3", 3);
+  std::vector<request_ptr> batch;
+  sources_type sources;
+  unsigned interpreters = 0;	// contribution to interpreters_
+  while (take_batch(batch, interpreters > 0)) {
+    if (batch.empty()) {
+      // Idle timeout.
+      python2.stop();
+      python3.stop();
+      mutex::locker ml(&mutex_);
+      interpreters_ -= interpreters;
+      interpreters = 0;
+      continue;
+    }
+    sources.clear();
+    for (std::vector<request_ptr>::iterator
+	   p = batch.begin(), end = batch.end(); p != end; ++p) {
+      sources.push_back(&(*p)->source_);
+    }
+    try {
+      process_batch(python2, python3, batch, sources);
+      for (std::vector<request_ptr>::iterator
+	     p = batch.begin(), end = batch.end(); p != end; ++p) {
+	std::vector<unsigned char>().swap((*p)->source_);
+      }
+    } catch (std::exception &e) {
+      std::string failure(e.what());
+      if (failure.empty()) {
+	failure = "unknown error during Python analysis";
+      }
+      for (std::vector<request_ptr>::iterator
+	     p = batch.begin(), end = batch.end(); p != end; ++p) {
+	(*p)->failure_ = failure;
+      }
+    }
+    unsigned running = python2.active() + python3.active();
+    mutex::locker ml(&mutex_);
+    interpreters_ = interpreters_ - interpreters + running;
+    interpreters = running;
+    for (std::vector<request_ptr>::iterator
+	   p = batch.begin(), end = batch.end(); p != end; ++p) {
+      (*p)->done_ = true;
+      if (!(*p)->failure_.empty()) {
+	// The next attempt should use an interpreter again.
+	memo_remove(*p);
+      }
+    }
+    done_cond_.broadcast();
+  }
+  mutex::locker ml(&mutex_);
+  interpreters_ -= interpreters;
+}
+
+bool
+python_analyzer_pool::impl::take_batch(std::vector<request_ptr> &batch,
+				       bool timeout)
+{
+  batch.clear();
+  mutex::locker ml(&mutex_);
+  while (queue_.empty() && !stop_) {
+    ++idle_;
+    bool woken;
+    if (timeout && idle_timeout_ > 0) {
+      woken = work_cond_.timed_wait(mutex_, idle_timeout_);
+    } else {
+      work_cond_.wait(mutex_);
+      woken = true;
+    }
+    --idle_;
+    if (!woken && queue_.empty() && !stop_) {
+      return true;
+    }
+  }
+  if (stop_) {
+    return false;
+  }
+  // Leave some of the requests to the other idle workers.
+  size_t count = queue_.size() / (idle_ + 1);
+  count = std::max<size_t>(1, std::min(count, max_batch));
+  for (; count > 0; --count) {
+    batch.push_back(queue_.front());
+    queue_.pop_front();
+  }
+  return true;
+}
+
+python_analyzer_pool::request_ptr
+python_analyzer_pool::impl::memo_find(const std::vector<unsigned char> &digest)
+{
+  std::map<std::vector<unsigned char>, memo_list::iterator>::iterator
+    p(memo_.find(digest));
+  if (p == memo_.end()) {
+    return request_ptr();
+  }
+  memo_list_.splice(memo_list_.begin(), memo_list_, p->second);
+  return *p->second;
+}
+
+void
+python_analyzer_pool::impl::memo_add(const request_ptr &req)
+{
+  memo_list_.push_front(req);
+  memo_[req->digest_] = memo_list_.begin();
+  if (memo_list_.size() > memo_entries) {
+    memo_.erase(memo_list_.back()->digest_);
+    memo_list_.pop_back();
+  }
+}
+
+void
+python_analyzer_pool::impl::memo_remove(const request_ptr &req)
+{
+  std::map<std::vector<unsigned char>, memo_list::iterator>::iterator
+    p(memo_.find(req->digest_));
+  if (p != memo_.end() && *p->second == req) {
+    memo_list_.erase(p->second);
+    memo_.erase(p);
+  }
+}
+
+python_analyzer_pool::python_analyzer_pool(unsigned workers,
+					   unsigned idle_timeout)
+  : impl_(new impl(workers, idle_timeout))
+{
+}
+
+python_analyzer_pool::~python_analyzer_pool()
+{
+  {
+    mutex::locker ml(&impl_->mutex_);
+    impl_->stop_ = true;
+    impl_->work_cond_.broadcast();
+  }
+  for (std::vector<std::tr1::shared_ptr<task> >::iterator
+	 p = impl_->tasks_.begin(), end = impl_->tasks_.end(); p != end; ++p) {
+    (*p)->wait();
+  }
+}
+
+static mutex shared_mutex;
+static python_analyzer_pool *shared_pool; // guarded by shared_mutex
+
+python_analyzer_pool &
+python_analyzer_pool::shared()
+{
+  mutex::locker ml(&shared_mutex);
+  if (shared_pool == NULL) {
+    shared_pool = new python_analyzer_pool
+      (std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L));
+  }
+  return *shared_pool;
+}
+
+void
+python_analyzer_pool::shared_deinit()
+{
+  mutex::locker ml(&shared_mutex);
+  delete shared_pool;
+  shared_pool = NULL;
+}
+
+unsigned
+python_analyzer_pool::interpreters() const
+{
+  mutex::locker ml(&impl_->mutex_);
+  return impl_->interpreters_;
+}
+
+python_analyzer_pool::request_ptr
+python_analyzer_pool::submit(const std::vector<unsigned char> &source)
+{
+  request_ptr req(new request);
+  std::vector<unsigned char>::const_iterator nul
+    (std::find(source.begin(), source.end(), '\0'));
+  if (nul != source.end()) {
+    req->result_.error = "source code contains NUL character";
+    req->result_.error_line = 1 + std::count(source.begin(), nul, '\n');
+    req->result_.version = 2;
+    req->done_ = true;
+    return req;
+  }
+  std::vector<unsigned char> digest(hash(hash_sink::sha256, source));
+
+  mutex::locker ml(&impl_->mutex_);
+  if (request_ptr known = impl_->memo_find(digest)) {
+    return known;
+  }
+  req->source_ = source;
+  req->digest_.swap(digest);
+  if (impl_->idle_ == 0 && impl_->tasks_.size() < impl_->max_workers_) {
+    impl_->tasks_.push_back(std::tr1::shared_ptr<task>
+			    (new task(std::tr1::bind(&impl::worker,
+						     impl_.get()))));
+  } else {
+    impl_->work_cond_.signal();
+  }
+  impl_->queue_.push_back(req);
+  impl_->memo_add(req);
+  return req;
+}
+
+const python_analyzer_pool::result &
+python_analyzer_pool::wait(const request_ptr &req)
+{
+  {
+    mutex::locker ml(&impl_->mutex_);
+    while (!req->done_) {
+      impl_->done_cond_.wait(impl_->mutex_);
+    }
+  }
+  if (!req->failure_.empty()) {
+    throw os_exception().message(req->failure_);
+  }
+  return req->result_;
+}
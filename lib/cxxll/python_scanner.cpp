@@ -0,0 +1,1830 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/python_scanner.hpp>
+#include <cxxll/utf8.hpp>
+
+#include <set>
+
+#include <string.h>
+
+using namespace cxxll;
+
+namespace {
+  bool
+  is_name_start(char ch)
+  {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
+  }
+
+  bool
+  is_digit(char ch)
+  {
+    return ch >= '0' && ch <= '9';
+  }
+
+  bool
+  is_name_char(char ch)
+  {
+    return is_name_start(ch) || is_digit(ch);
+  }
+
+  bool
+  is_hex_digit(char ch)
+  {
+    return is_digit(ch) || (ch >= 'a' && ch <= 'f') || (ch >= 'A' && ch <= 'F');
+  }
+
+  bool
+  is_ascii(char ch)
+  {
+    return static_cast<unsigned char>(ch) < 0x80;
+  }
+
+  // Keywords in both Python 2 and Python 3.
+  const char *const keywords[] = {
+    "and", "as", "assert", "break", "class", "continue", "def", "del",
+    "elif", "else", "except", "finally", "for", "from", "global", "if",
+    "import", "in", "is", "lambda", "not", "or", "pass", "raise",
+    "return", "try", "while", "with", "yield", NULL
+  };
+
+  // Returns true if NAME is in the NULL-terminated LIST.
+  bool
+  in_list(const std::string &name, const char *const *list)
+  {
+    for (; *list; ++list) {
+      if (name == *list) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  bool
+  is_keyword(const std::string &name)
+  {
+    return in_list(name, keywords);
+  }
+
+  // Operators and delimiters, longest first.
+  const char *const operators[] = {
+    "**=", "//=", ">>=", "<<=", "...",
+    "**", "//", ">>", "<<", "<=", ">=", "==", "!=", "<>", "->",
+    "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "@=", ":=",
+    "+", "-", "*", "/", "%", "&", "|", "^", "~", "<", ">",
+    "(", ")", "[", "]", "{", "}", ",", ":", ".", ";", "@", "=", "`",
+    NULL
+  };
+
+  // Python versions which can accept the source code, as far as the
+  // scanner can tell.
+  struct versions {
+    bool python2;
+    bool python3;
+
+    versions();
+  };
+
+  versions::versions()
+    : python2(true), python3(true)
+  {
+  }
+
+  enum token_type {
+    name_token,
+    number_token,
+    string_token,
+    op_token,
+    newline_token,
+    indent_token,
+    dedent_token
+  };
+
+  struct token {
+    token_type type;
+    std::string text;		// names and operators only
+
+    explicit token(token_type);
+    token(token_type, const char *, size_t);
+
+    bool is_name(const char *) const;
+    bool is_op(const char *) const;
+  };
+
+  token::token(token_type t)
+    : type(t)
+  {
+  }
+
+  token::token(token_type t, const char *p, size_t length)
+    : type(t), text(p, length)
+  {
+  }
+
+  bool
+  token::is_name(const char *name) const
+  {
+    return type == name_token && text == name;
+  }
+
+  bool
+  token::is_op(const char *op) const
+  {
+    return type == op_token && text == op;
+  }
+
+  // Splits the source code into tokens, following the Python lexical
+  // rules, but without distinguishing keywords from names.
+  class tokenizer {
+    const char *p_;
+    const char *end_;
+    versions &versions_;
+    std::vector<unsigned> indents_;
+    std::string brackets_;	// currently open brackets
+    bool line_start_;
+    bool expect_indent_;	// the previous logical line ended in ':'
+
+    size_t newline_length() const;
+    void skip_comment();
+    void end_line();
+    bool indentation();
+    bool name();
+    bool number();
+    bool string();
+    bool op();
+  public:
+    std::vector<token> tokens;
+
+    tokenizer(const char *begin, const char *end, versions &);
+
+    // Returns false on tokenization and indentation errors.
+    bool run();
+  };
+
+  tokenizer::tokenizer(const char *begin, const char *end, versions &ver)
+    : p_(begin), end_(end), versions_(ver),
+      line_start_(true), expect_indent_(false)
+  {
+  }
+
+  size_t
+  tokenizer::newline_length() const
+  {
+    if (p_ == end_) {
+      return 0;
+    }
+    if (*p_ == '\n') {
+      return 1;
+    }
+    if (*p_ == '\r') {
+      if (end_ - p_ >= 2 && p_[1] == '\n') {
+	return 2;
+      }
+      return 1;
+    }
+    return 0;
+  }
+
+  void
+  tokenizer::skip_comment()
+  {
+    while (p_ != end_ && *p_ != '\n' && *p_ != '\r') {
+      ++p_;
+    }
+  }
+
+  void
+  tokenizer::end_line()
+  {
+    if (!tokens.empty()) {
+      token_type last = tokens.back().type;
+      if (last != newline_token && last != indent_token
+	  && last != dedent_token) {
+	expect_indent_ = tokens.back().is_op(":");
+	tokens.push_back(token(newline_token));
+      }
+    }
+    line_start_ = true;
+  }
+
+  // Processes the indentation at the start of a line.  Blank lines
+  // are skipped.
+  bool
+  tokenizer::indentation()
+  {
+    while (true) {
+      unsigned column = 0;
+      for (; p_ != end_; ++p_) {
+	if (*p_ == ' ') {
+	  ++column;
+	} else if (*p_ == '\t') {
+	  column = (column / 8 + 1) * 8;
+	} else if (*p_ == '\f') {
+	  column = 0;
+	} else {
+	  break;
+	}
+      }
+      if (p_ != end_ && *p_ == '#') {
+	skip_comment();
+      }
+      if (p_ == end_) {
+	return true;
+      }
+      if (size_t length = newline_length()) {
+	p_ += length;
+	continue;
+      }
+
+      if (column > indents_.back()) {
+	if (!expect_indent_) {
+	  return false;
+	}
+	indents_.push_back(column);
+	tokens.push_back(token(indent_token));
+      } else {
+	if (expect_indent_) {
+	  return false;
+	}
+	while (column < indents_.back()) {
+	  indents_.pop_back();
+	  tokens.push_back(token(dedent_token));
+	}
+	if (column != indents_.back()) {
+	  return false;
+	}
+      }
+      expect_indent_ = false;
+      line_start_ = false;
+      return true;
+    }
+  }
+
+  bool
+  tokenizer::name()
+  {
+    const char *start = p_;
+    while (p_ != end_ && is_name_char(*p_)) {
+      ++p_;
+    }
+    if (p_ != end_ && (*p_ == '\'' || *p_ == '"')) {
+      std::string prefix(start, p_);
+      for (std::string::iterator
+	     p = prefix.begin(), end = prefix.end(); p != end; ++p) {
+	if (*p >= 'A' && *p <= 'Z') {
+	  *p = *p - 'A' + 'a';
+	}
+      }
+      // Formatted string literals contain expressions, which are
+      // not covered here.
+      if (prefix == "r" || prefix == "u" || prefix == "b" || prefix == "br") {
+	return string();
+      }
+      if (prefix == "ur") {
+	versions_.python3 = false;
+	return string();
+      }
+      if (prefix == "rb") {
+	versions_.python2 = false;
+	return string();
+      }
+      return false;
+    }
+    if (p_ != end_ && !is_ascii(*p_)) {
+      // Non-ASCII identifiers are subject to normalization.
+      return false;
+    }
+    tokens.push_back(token(name_token, start, p_ - start));
+    return true;
+  }
+
+  bool
+  tokenizer::number()
+  {
+    const char *start = p_;
+    if (*p_ == '0' && end_ - p_ >= 2
+	&& (p_[1] == 'x' || p_[1] == 'X' || p_[1] == 'o' || p_[1] == 'O'
+	    || p_[1] == 'b' || p_[1] == 'B')) {
+      p_ += 2;
+      while (p_ != end_ && (is_hex_digit(*p_) || *p_ == '_')) {
+	++p_;
+      }
+    } else {
+      while (p_ != end_ && (is_digit(*p_) || *p_ == '_')) {
+	++p_;
+      }
+      if (p_ != end_ && *p_ == '.') {
+	++p_;
+	while (p_ != end_ && (is_digit(*p_) || *p_ == '_')) {
+	  ++p_;
+	}
+      }
+      if (p_ != end_ && (*p_ == 'e' || *p_ == 'E')) {
+	++p_;
+	if (p_ != end_ && (*p_ == '+' || *p_ == '-')) {
+	  ++p_;
+	}
+	while (p_ != end_ && (is_digit(*p_) || *p_ == '_')) {
+	  ++p_;
+	}
+      }
+    }
+    if (memchr(start, '_', p_ - start) != NULL) {
+      versions_.python2 = false;
+    }
+    if (p_ != end_ && (*p_ == 'j' || *p_ == 'J')) {
+      ++p_;
+    } else {
+      // Long integers and octal literals without "0o", such as
+      // "0755", are Python 2 syntax.
+      if (*start == '0') {
+	const char *q = start;
+	while (q != p_ && *q == '0') {
+	  ++q;
+	}
+	const char *nonzero = q;
+	while (q != p_ && is_digit(*q)) {
+	  ++q;
+	}
+	if (q == p_ && nonzero != p_) {
+	  versions_.python3 = false;
+	}
+      }
+      if (p_ != end_ && (*p_ == 'l' || *p_ == 'L')) {
+	versions_.python3 = false;
+	++p_;
+      }
+    }
+    if (p_ != end_ && (is_name_char(*p_) || !is_ascii(*p_))) {
+      return false;
+    }
+    tokens.push_back(token(number_token));
+    return true;
+  }
+
+  bool
+  tokenizer::string()
+  {
+    char quote = *p_;
+    bool triple = end_ - p_ >= 3 && p_[1] == quote && p_[2] == quote;
+    p_ += triple ? 3 : 1;
+    while (true) {
+      if (p_ == end_) {
+	return false;
+      }
+      char ch = *p_;
+      if (ch == '\\') {
+	++p_;
+	if (size_t length = newline_length()) {
+	  p_ += length;
+	} else if (p_ != end_) {
+	  ++p_;
+	}
+	continue;
+      }
+      if (ch == quote) {
+	if (!triple) {
+	  ++p_;
+	  break;
+	}
+	if (end_ - p_ >= 3 && p_[1] == quote && p_[2] == quote) {
+	  p_ += 3;
+	  break;
+	}
+      } else if (!triple && (ch == '\n' || ch == '\r')) {
+	return false;
+      }
+      ++p_;
+    }
+    tokens.push_back(token(string_token));
+    return true;
+  }
+
+  bool
+  tokenizer::op()
+  {
+    for (const char *const *op = operators; *op; ++op) {
+      size_t length = strlen(*op);
+      if (static_cast<size_t>(end_ - p_) < length
+	  || memcmp(p_, *op, length) != 0) {
+	continue;
+      }
+      if (length == 1) {
+	switch (**op) {
+	case '(':
+	case '[':
+	case '{':
+	  brackets_ += **op;
+	  break;
+	case ')':
+	case ']':
+	case '}':
+	  {
+	    char open = **op == ')' ? '(' : **op == ']' ? '[' : '{';
+	    if (brackets_.empty() || brackets_[brackets_.size() - 1] != open) {
+	      return false;
+	    }
+	    brackets_.resize(brackets_.size() - 1);
+	  }
+	  break;
+	}
+      }
+      tokens.push_back(token(op_token, p_, length));
+      p_ += length;
+      return true;
+    }
+    return false;
+  }
+
+  bool
+  tokenizer::run()
+  {
+    indents_.push_back(0);
+    while (true) {
+      if (line_start_ && brackets_.empty()) {
+	if (!indentation()) {
+	  return false;
+	}
+      }
+      while (p_ != end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\f')) {
+	++p_;
+      }
+      if (p_ == end_) {
+	break;
+      }
+      char ch = *p_;
+      if (ch == '#') {
+	skip_comment();
+      } else if (size_t length = newline_length()) {
+	p_ += length;
+	if (brackets_.empty()) {
+	  end_line();
+	}
+      } else if (ch == '\\') {
+	++p_;
+	size_t length = newline_length();
+	if (length == 0) {
+	  return false;
+	}
+	p_ += length;
+      } else if (is_name_start(ch)) {
+	if (!name()) {
+	  return false;
+	}
+      } else if (is_digit(ch)
+		 || (ch == '.' && end_ - p_ >= 2 && is_digit(p_[1]))) {
+	if (!number()) {
+	  return false;
+	}
+      } else if (ch == '\'' || ch == '"') {
+	if (!string()) {
+	  return false;
+	}
+      } else if (!op()) {
+	return false;
+      }
+    }
+    if (!brackets_.empty()) {
+      return false;
+    }
+    end_line();
+    return !expect_indent_;
+  }
+
+  // Statements whose header ends with ':' at the outermost level.
+  const char *const compound_keywords[] = {
+    "if", "elif", "else", "while", "for", "try", "except", "finally",
+    "with", "def", "class", "async", NULL
+  };
+
+  // Keywords which need an operand on their right.
+  const char *const prefix_keywords[] = {
+    "and", "or", "not", "in", "is", "if", "elif", "while", "for", "with",
+    "as", "assert", "del", "global", "def", "class", NULL
+  };
+
+  // Keywords which can only start a statement.
+  const char *const statement_keywords[] = {
+    "assert", "break", "class", "continue", "def", "del", "elif", "except",
+    "finally", "global", "import", "pass", "raise", "return", "try",
+    "while", "with", NULL
+  };
+
+  // Statements in which "as" can appear.
+  const char *const as_leaders[] = {
+    "import", "from", "with", "except", "async", NULL
+  };
+
+  // Keywords which need an operand on their left.
+  const char *const infix_keywords[] = {
+    "and", "or", "in", "is", "as", NULL
+  };
+
+  // Operators which need an operand on their right.
+  const char *const prefix_operators[] = {
+    "=", "+=", "-=", "*=", "/=", "//=", "%=", "**=", ">>=", "<<=",
+    "&=", "|=", "^=", "@=", ":=", "==", "!=", "<>", "<", ">", "<=", ">=",
+    "+", "-", "~", "/", "//", "%", "&", "|", "^", "<<", ">>", "**", "@",
+    "->", NULL
+  };
+
+  // Operators which cannot start an operand.
+  const char *const infix_operators[] = {
+    "=", "+=", "-=", "*=", "/=", "//=", "%=", "**=", ">>=", "<<=",
+    "&=", "|=", "^=", "@=", ":=", "==", "!=", "<>", "<", ">", "<=", ">=",
+    "/", "//", "%", "&", "|", "^", "<<", ">>", "**", "@", "->",
+    ".", ",", ";", ":", ")", "]", "}", NULL
+  };
+
+  // Assignment operators, which need a target on their left.
+  const char *const assignment_operators[] = {
+    "=", "+=", "-=", "*=", "/=", "//=", "%=", "**=", ">>=", "<<=",
+    "&=", "|=", "^=", "@=", NULL
+  };
+
+  // Statements which can precede "elif", "else", "except" and
+  // "finally" at the same indentation level.
+  const char *const elif_predecessors[] = {"if", "elif", NULL};
+  const char *const else_predecessors[] = {
+    "if", "elif", "for", "while", "except", "async", NULL
+  };
+  const char *const except_predecessors[] = {"try", "except", NULL};
+  const char *const finally_predecessors[] = {
+    "try", "except", "else", NULL
+  };
+
+  bool
+  is_op_in(const token &tok, const char *const *ops)
+  {
+    return tok.type == op_token && in_list(tok.text, ops);
+  }
+
+  // Rejects token sequences which no Python version accepts, as far
+  // as this is possible without a full parser: adjacent operands
+  // ("foo bar"), operators and keywords without a right operand
+  // ("x = = 1", "for x in :"), misplaced operators (". x", "f(, x)"),
+  // incomplete expressions ("a if b", "x[]", "{1:}", "lambda x"),
+  // misplaced keywords ("x = return"), clauses and decorators without
+  // their statement ("else:" after "x = 1"), some invalid assignment
+  // targets, parameter and argument lists ("f(x) = 1", "f(a=1, 2)",
+  // "def f(1):"), and Python 2 syntax mixed with Python 3 syntax.
+  class checker {
+    // State of a bracket nesting level.  The first element of
+    // frames_ is the current statement outside brackets.
+    struct frame {
+      char bracket;		// opening bracket, or 0
+      bool arguments;		// call arguments or parameters
+      bool subscript;		// subscription or slicing
+      bool parameters;		// parameters of a function definition
+      bool keywords;		// keyword argument seen
+      bool comprehension;	// "for" seen
+      bool pending_in;		// "for" without its "in"
+      bool entries;		// a dictionary or set entry has ended
+      bool dictionary;		// the first entry has a ':'
+      bool colon;		// the current entry has a ':'
+      unsigned conditionals;	// "if" expressions without their "else"
+      unsigned lambdas;		// lambdas without their ':'
+      bool lambda_seen;		// "lambda" seen
+
+      explicit frame(char);
+    };
+
+    const std::vector<token> &tokens_;
+    versions &versions_;
+    size_t pos_;
+    std::vector<frame> frames_;
+    size_t leader_;		// first token of the current statement
+    bool statement_start_;
+    bool annotation_;		// the statement has a variable annotation
+    bool assigned_;		// the statement has an assignment
+    bool closed_target_;	// the last closing bracket can end a target
+    // First token of the last line at each indentation level.
+    std::vector<std::string> blocks_;
+
+    unsigned depth() const;
+    const token *next() const;
+    const token *previous() const;
+    bool leader_is(const char *) const;
+    bool line_start() const;
+    bool operand_start() const;
+    bool operand_end(size_t) const;
+    bool statement_complete() const;
+    bool parameters_start() const;
+    bool adjacent_operands();
+    bool check_clause();
+    bool check_arguments();
+    bool check_operator();
+    bool check_keyword();
+    void advance();
+  public:
+    checker(const std::vector<token> &, versions &);
+
+    // Returns false if the source code is invalid.
+    bool run();
+  };
+
+  checker::frame::frame(char br)
+    : bracket(br), arguments(false), subscript(false), parameters(false),
+      keywords(false), comprehension(false), pending_in(false),
+      entries(false), dictionary(false), colon(false), conditionals(0),
+      lambdas(0), lambda_seen(false)
+  {
+  }
+
+  checker::checker(const std::vector<token> &tokens, versions &ver)
+    : tokens_(tokens), versions_(ver), pos_(0), frames_(1, frame(0)),
+      leader_(0), statement_start_(true), annotation_(false),
+      assigned_(false), closed_target_(false), blocks_(1)
+  {
+  }
+
+  unsigned
+  checker::depth() const
+  {
+    return frames_.size() - 1;
+  }
+
+  const token *
+  checker::next() const
+  {
+    if (pos_ + 1 < tokens_.size()) {
+      return &tokens_[pos_ + 1];
+    }
+    return NULL;
+  }
+
+  const token *
+  checker::previous() const
+  {
+    if (pos_ > 0) {
+      return &tokens_[pos_ - 1];
+    }
+    return NULL;
+  }
+
+  bool
+  checker::leader_is(const char *name) const
+  {
+    return tokens_[leader_].is_name(name);
+  }
+
+  // Whether the current token is the first one of a logical line.
+  bool
+  checker::line_start() const
+  {
+    const token *prev = previous();
+    return prev == NULL || prev->type == newline_token
+      || prev->type == indent_token || prev->type == dedent_token;
+  }
+
+  // Whether the token after the current one starts an operand.
+  bool
+  checker::operand_start() const
+  {
+    const token *tok = next();
+    if (tok == NULL) {
+      return false;
+    }
+    switch (tok->type) {
+    case number_token:
+    case string_token:
+      return true;
+    case name_token:
+      if (tok->text == "lambda") {
+	return true;
+      }
+      if (tok->text == "not") {
+	// Not "not in".
+	return !(pos_ + 2 < tokens_.size() && tokens_[pos_ + 2].is_name("in"));
+      }
+      return !is_keyword(tok->text);
+    default:
+      return false;
+    }
+  }
+
+  bool
+  checker::operand_end(size_t pos) const
+  {
+    const token &tok(tokens_[pos]);
+    switch (tok.type) {
+    case number_token:
+    case string_token:
+      return true;
+    case name_token:
+      return !is_keyword(tok.text);
+    case op_token:
+      return tok.is_op(")") || tok.is_op("]") || tok.is_op("}");
+    default:
+      return false;
+    }
+  }
+
+  // Whether the statement before the current token is complete:
+  // "x = a if b", "for x" and "lambda x" are not.
+  bool
+  checker::statement_complete() const
+  {
+    const frame &f(frames_.front());
+    return f.conditionals == 0 && f.lambdas == 0 && !f.pending_in;
+  }
+
+  // Whether the current '(' opens the parameters of a function
+  // definition.
+  bool
+  checker::parameters_start() const
+  {
+    return pos_ > 1 && tokens_[pos_ - 1].type == name_token
+      && tokens_[pos_ - 2].is_name("def");
+  }
+
+  // The current token ends an operand, and the next one starts
+  // another.  Only a few statements and string concatenation allow
+  // this.
+  bool
+  checker::adjacent_operands()
+  {
+    const token &tok(tokens_[pos_]);
+    if (tok.type == string_token && next()->type == string_token) {
+      return true;
+    }
+    if (statement_start_ && (tok.is_name("print") || tok.is_name("exec"))) {
+      versions_.python3 = false;
+      return true;
+    }
+    if ((statement_start_ && tok.is_name("nonlocal"))
+	|| tok.is_name("await")) {
+      versions_.python2 = false;
+      return true;
+    }
+    // Includes the soft keywords "match", "case" and "type", which
+    // would need a parser.
+    return false;
+  }
+
+  // "elif", "else", "except" and "finally" at the start of a line
+  // have to continue a matching statement at the same indentation
+  // level, and decorators have to precede a definition.
+  bool
+  checker::check_clause()
+  {
+    const token &tok(tokens_[pos_]);
+    std::string &last(blocks_.back());
+    bool valid = true;
+    if (tok.is_name("elif")) {
+      valid = in_list(last, elif_predecessors);
+    } else if (tok.is_name("else")) {
+      valid = in_list(last, else_predecessors);
+    } else if (tok.is_name("except")) {
+      valid = in_list(last, except_predecessors);
+    } else if (tok.is_name("finally")) {
+      valid = in_list(last, finally_predecessors);
+    }
+    if (last == "@"
+	&& !(tok.is_op("@") || tok.is_name("def") || tok.is_name("class")
+	     || tok.is_name("async"))) {
+      // A decorator without its definition.
+      valid = false;
+    }
+    if (tok.type == name_token || tok.is_op("@")) {
+      last = tok.text;
+    } else {
+      last.clear();
+    }
+    return valid;
+  }
+
+  // Positional arguments cannot follow keyword arguments ("f(a=1,
+  // 2)"), and parameters without a default cannot follow parameters
+  // with one ("def f(a=1, b)"), unless they are keyword-only.  The
+  // current token is a ',' in an argument list.
+  bool
+  checker::check_arguments()
+  {
+    frame &f(frames_.back());
+    const token *following = next();
+    if (!f.keywords || f.lambdas > 0 || following == NULL) {
+      return true;
+    }
+    if (following->is_op(")") || following->is_op("*")
+	|| following->is_op("**")) {
+      return true;
+    }
+    if (f.parameters && (following->is_op("/") || following->is_op("("))) {
+      // Positional-only marker, or a tuple parameter in Python 2.
+      return true;
+    }
+    if (following->type != name_token || pos_ + 2 == tokens_.size()) {
+      return false;
+    }
+    // The default of an annotated parameter is not checked.
+    const token &after(tokens_[pos_ + 2]);
+    return after.is_op("=") || (f.parameters && after.is_op(":"));
+  }
+
+  bool
+  checker::check_operator()
+  {
+    const token &tok(tokens_[pos_]);
+    const token *prev = previous();
+    const token *following = next();
+    frame &f(frames_.back());
+    if (tok.is_op("`") || tok.is_op("<>")) {
+      versions_.python3 = false;
+    } else if (tok.is_op("->") || tok.is_op(":=") || tok.is_op("@=")
+	       || (tok.is_op("@") && !statement_start_)) {
+      versions_.python2 = false;
+    } else if (tok.is_op(",") && depth() == 0
+	       && (leader_is("raise") || leader_is("except"))) {
+      // "raise E, value" and "except E, e:".
+      versions_.python3 = false;
+    }
+
+    if (statement_start_ && !tok.is_op("@")
+	&& is_op_in(tok, infix_operators)) {
+      return false;
+    }
+    if (prev != NULL && is_op_in(tok, infix_operators)
+	&& (prev->is_op("(") || prev->is_op("[") || prev->is_op("{")
+	    || prev->is_op(","))) {
+      // "f(, x)" and "f(=x)", but not "f()", "x[:]", "{**x}",
+      // "x, = y", "for x in y,:", "lambda x,: x" or "def f(x, /)".
+      bool closing = tok.is_op(")") || tok.is_op("]") || tok.is_op("}");
+      bool slice = tok.is_op(":")
+	&& (f.subscript || f.lambdas > 0
+	    || (depth() == 0 && (leader_is("for") || leader_is("async"))));
+      bool after_comma = prev->is_op(",")
+	&& ((tok.is_op("=") && depth() == 0) || tok.is_op("/"));
+      if (!(closing || slice || after_comma || tok.is_op("**"))) {
+	return false;
+      }
+    }
+    if (f.parameters && f.lambdas == 0 && prev->type == name_token
+	&& (tokens_[pos_ - 2].is_op("(") || tokens_[pos_ - 2].is_op(",")
+	    || tokens_[pos_ - 2].is_op("*") || tokens_[pos_ - 2].is_op("**"))
+	&& !(tok.is_op(",") || tok.is_op(")") || tok.is_op("=")
+	     || tok.is_op(":"))) {
+      // Parameter names are not expressions, "def f(a. b):".
+      return false;
+    }
+    if (tok.is_op(",") && prev != NULL && prev->type == name_token
+	&& is_keyword(prev->text)) {
+      // "return , x".
+      return false;
+    }
+    if (tok.is_op(";") && depth() > 0) {
+      return false;
+    }
+    if (tok.is_op(".") && !leader_is("from")) {
+      // Attribute references need an object and a name.  Relative
+      // imports are the exception.
+      if (!operand_end(pos_ - 1)
+	  || following == NULL || following->type != name_token) {
+	return false;
+      }
+    }
+    if (tok.is_op("=") && depth() == 0 && tokens_[leader_].type == name_token
+	&& is_keyword(tokens_[leader_].text) && !leader_is("lambda")) {
+      // "if x = y:".
+      return false;
+    }
+    if (tok.is_op(":") && depth() == 0 && f.lambdas == 0
+	&& !in_list(tokens_[leader_].text, compound_keywords)) {
+      // Variable annotation, "x: int = 0".
+      if ((tokens_[leader_].type == name_token
+	   && is_keyword(tokens_[leader_].text))
+	  || assigned_ || following == NULL
+	  || following->type == newline_token) {
+	// "x = y: int".
+	return false;
+      }
+      versions_.python2 = false;
+      annotation_ = true;
+    }
+    if (depth() == 0 && f.lambdas == 0 && !annotation_
+	&& is_op_in(tok, assignment_operators)) {
+      // Assignment targets end in a name, a subscription or a
+      // parenthesized target list, but not in a literal ("1 = x") or
+      // a call ("f(x) = 1").  Annotations can be strings.
+      if (prev->is_name("None") || f.lambda_seen) {
+	// "None = 1" and "f = lambda: x = 1".
+	return false;
+      }
+      assigned_ = true;
+      if (prev->is_name("True") || prev->is_name("False")) {
+	versions_.python3 = false;
+      }
+      if (!((prev->type == name_token && !is_keyword(prev->text))
+	    || prev->is_op(",")
+	    || ((prev->is_op(")") || prev->is_op("]")) && closed_target_))) {
+	return false;
+      }
+    }
+    if (tok.is_op("=") && depth() > 0 && f.lambdas == 0) {
+      // Within brackets, '=' only introduces keyword arguments and
+      // defaults.  Parameters can be annotated or (in Python 2)
+      // tuples, so only literal parameter names are rejected.
+      bool name_start = tokens_[pos_ - 2].is_op("(")
+	|| tokens_[pos_ - 2].is_op(",");
+      if (f.parameters) {
+	if ((prev->type == number_token || prev->type == string_token)
+	    && name_start) {
+	  return false;
+	}
+      } else if (!(f.arguments && prev->type == name_token && name_start)) {
+	return false;
+      }
+    }
+    if (tok.is_op("**") && prev != NULL && !operand_end(pos_ - 1)) {
+      // "f(*a* **b)" and "(**b)".  Outside of calls, definitions and
+      // lambdas, only dictionaries can be unpacked.
+      if (!(prev->is_op("(") || prev->is_op(",") || prev->is_op("{")
+	    || prev->is_name("lambda"))
+	  || !(f.lambdas > 0 || f.bracket == '{' || f.arguments
+	       || f.parameters)) {
+	return false;
+      }
+    }
+    if (tok.is_op("*") && prev != NULL && prev->type == op_token
+	&& !operand_end(pos_ - 1)
+	&& !(prev->is_op("(") || prev->is_op("[") || prev->is_op("{")
+	     || prev->is_op(",") || prev->is_op("=") || prev->is_op(":")
+	     || prev->is_op(";"))) {
+      // "a * *b" and "(***b)".
+      return false;
+    }
+    if (tok.is_op("...") && prev != NULL && operand_end(pos_ - 1)) {
+      // "os...path".
+      return false;
+    }
+    if (tok.is_op("->")
+	&& !(depth() == 0 && prev->is_op(")")
+	     && (leader_is("def") || leader_is("async")))) {
+      return false;
+    }
+    if (tok.is_op("{") && prev != NULL && operand_end(pos_ - 1)) {
+      // "x{}", but not "print {}" in Python 2.
+      if (!(pos_ - 1 == leader_
+	    && (prev->is_name("print") || prev->is_name("exec")))) {
+	return false;
+      }
+      versions_.python3 = false;
+    }
+    if (tok.is_op(",") && depth() == 0
+	&& (leader_is("if") || leader_is("elif") || leader_is("while")
+	    || tokens_[leader_].is_op("@"))) {
+      // "if a, b:" and "@a, b".
+      return false;
+    }
+    if (tok.is_op(",") && f.comprehension && !f.pending_in
+	&& f.lambdas == 0) {
+      // "[x for x in 1, 2]" is valid in Python 2 only, and other
+      // comprehensions have a single iterable.
+      if (f.bracket != '[') {
+	return false;
+      }
+      versions_.python3 = false;
+    }
+    if (tok.is_op(":") && f.lambdas == 0 && depth() > 0
+	&& !(f.subscript || f.bracket == '{' || f.parameters)) {
+      // "f(a: b)" and "[: x]".
+      return false;
+    }
+    if (tok.is_op(":") && !f.subscript && following != NULL
+	&& (following->is_op(")") || following->is_op("]")
+	    || following->is_op("}") || following->is_op(",")
+	    || following->is_op(":") || following->is_op("="))) {
+      // Annotation or dictionary entry without a value, "{1:}" and
+      // "x: = 1".
+      return false;
+    }
+    if ((tok.is_op("(") || (tok.is_op(",") && f.parameters))
+	&& f.lambdas == 0 && following != NULL) {
+      // Parameters start with a name, "def f(1):".
+      if ((tok.is_op(",") || parameters_start())
+	  && !((following->type == name_token
+		&& !is_keyword(following->text))
+	       || following->is_op("*") || following->is_op("**")
+	       || following->is_op("/") || following->is_op("(")
+	       || following->is_op(")"))) {
+	return false;
+      }
+    }
+    if (tok.is_op(")") && f.parameters && following != NULL
+	&& !(following->is_op(":") || following->is_op("->"))) {
+      // "def f(x), :".
+      return false;
+    }
+
+    // Conditional expressions, "a if b else c", end at these
+    // delimiters.
+    if ((tok.is_op(",") || tok.is_op(":") || tok.is_op(")")
+	 || tok.is_op("]") || tok.is_op("}"))
+	&& f.conditionals > 0) {
+      return false;
+    }
+    // "for" targets end with "in", and lambda parameters with ':'.
+    if ((tok.is_op(":") || tok.is_op(")") || tok.is_op("]")
+	 || tok.is_op("}"))
+	&& f.pending_in) {
+      return false;
+    }
+    if ((tok.is_op(")") || tok.is_op("]") || tok.is_op("}"))
+	&& f.lambdas > 0) {
+      return false;
+    }
+    if (tok.is_op("[") && following != NULL && following->is_op("]")
+	&& prev != NULL && operand_end(pos_ - 1)) {
+      // Empty subscript, "x[]", but not "print []" in Python 2.
+      if (!(pos_ - 1 == leader_
+	    && (prev->is_name("print") || prev->is_name("exec")))) {
+	return false;
+      }
+      versions_.python3 = false;
+    }
+    if (f.bracket == '{' && f.lambdas == 0 && !f.comprehension) {
+      // Dictionary entries have a key and a value (or "**"), set
+      // entries do not.
+      if (tok.is_op(":")
+	  || (tok.is_op("**") && (prev->is_op("{") || prev->is_op(",")))) {
+	if (f.colon) {
+	  // "{'a': 'b' 'c': 'd'}".
+	  return false;
+	}
+	f.colon = true;
+      } else if ((tok.is_op(",") || tok.is_op("}"))
+		 && !(prev->is_op("{") || prev->is_op(","))) {
+	if (!f.entries) {
+	  f.entries = true;
+	  f.dictionary = f.colon;
+	} else if (f.colon != f.dictionary) {
+	  return false;
+	}
+	f.colon = false;
+      }
+    }
+    if (f.arguments && f.lambdas == 0) {
+      bool argument_start = prev != NULL
+	&& (prev->is_op("(") || prev->is_op(","));
+      if (tok.is_op(",") && !check_arguments()) {
+	return false;
+      } else if (tok.is_op("=") && prev->type == name_token
+		 && (tokens_[pos_ - 2].is_op("(")
+		     || tokens_[pos_ - 2].is_op(","))) {
+	f.keywords = true;
+      } else if (argument_start && (tok.is_op("*") || tok.is_op("**"))) {
+	if (f.parameters) {
+	  // Keyword-only parameters can come in any order.
+	  f.arguments = false;
+	} else if (tok.is_op("**")) {
+	  f.keywords = true;
+	}
+      }
+    }
+
+    if (tok.is_op("*") && following != NULL) {
+      if (following->is_op(",")) {
+	// Keyword-only arguments, "def f(*, a):".
+	if (prev == NULL || !(prev->is_op("(") || prev->is_op(",")
+			      || prev->is_name("lambda"))) {
+	  return false;
+	}
+	versions_.python2 = false;
+      } else if ((following->type == newline_token
+		  && !(prev != NULL && prev->is_name("import")))
+		 || is_op_in(*following, infix_operators)) {
+	// "f(*)" and "a * ]", but not "from m import *".
+	return false;
+      }
+    }
+    if (tok.is_op("/") && prev != NULL && prev->is_op(",")
+	&& following != NULL
+	&& (following->is_op(",") || following->is_op(")")
+	    || following->is_op(":"))) {
+      // Positional-only arguments, "def f(a, /):".
+      versions_.python2 = false;
+      return true;
+    }
+    if (is_op_in(tok, prefix_operators)) {
+      if (following == NULL || following->type == newline_token
+	  || is_op_in(*following, infix_operators)) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  bool
+  checker::check_keyword()
+  {
+    const token &tok(tokens_[pos_]);
+    const token *following = next();
+    if (following != NULL && following->is_name(tok.text.c_str())
+	&& !tok.is_name("not")) {
+      // "else else:".
+      return false;
+    }
+    if (statement_start_
+	&& (tok.is_name("else") || tok.is_name("try")
+	    || tok.is_name("finally"))
+	&& (following == NULL || !following->is_op(":"))) {
+      return false;
+    }
+    frame &f(frames_.back());
+    if (in_list(tok.text, infix_keywords)) {
+      const token *prev = previous();
+      if (prev == NULL
+	  || !(operand_end(pos_ - 1)
+	       || (tok.is_name("in") && prev->is_name("not")
+		   && operand_end(pos_ - 2))
+	       || (tok.is_name("in") && prev->is_op(",") && f.pending_in))) {
+	// "(is x)" and "not in x", but not "for x, in y".
+	return false;
+      }
+    }
+    if (in_list(tok.text, prefix_keywords)
+	&& (following == NULL || following->type == newline_token
+	    || is_op_in(*following, infix_operators))) {
+      return false;
+    }
+    if (tok.is_name("not") && pos_ > 0
+	&& !(following != NULL && following->is_name("in"))) {
+      // "not" binds less tightly than comparisons and arithmetic,
+      // "a == not b" and "a is not not b".
+      const token &prev(tokens_[pos_ - 1]);
+      if ((is_op_in(prev, prefix_operators)
+	   && !is_op_in(prev, assignment_operators) && !prev.is_op(":="))
+	  || (prev.is_name("not") && pos_ > 1
+	      && tokens_[pos_ - 2].is_name("is"))) {
+	return false;
+      }
+    }
+    if (!statement_start_ && in_list(tok.text, statement_keywords)
+	&& !(tok.is_name("import") && leader_is("from"))
+	&& !((tok.is_name("def") || tok.is_name("with"))
+	     && pos_ - 1 == leader_ && leader_is("async"))) {
+      // "x = return", "if class x:".
+      return false;
+    }
+    if ((tok.is_name("pass") || tok.is_name("break")
+	 || tok.is_name("continue"))
+	&& following != NULL && following->type != newline_token
+	&& !following->is_op(";")) {
+      // "pass x".
+      return false;
+    }
+    if (tok.is_name("yield") && !statement_start_) {
+      // "x = yield" and "(yield)", but not "f(yield)".
+      const token *prev = previous();
+      if (!((depth() == 0 && is_op_in(*prev, assignment_operators))
+	    || (prev->is_op("(") && !f.arguments))) {
+	return false;
+      }
+    }
+    if (tok.is_name("as") && !(tokens_[leader_].type == name_token
+			       && in_list(tokens_[leader_].text, as_leaders))) {
+      return false;
+    }
+    if (tok.is_name("from") && !statement_start_) {
+      // "yield from" and "raise E from cause".
+      const token *prev = previous();
+      if (!(prev->is_name("yield")
+	    || (leader_is("raise") && operand_end(pos_ - 1)))) {
+	return false;
+      }
+    }
+    if (tok.is_name("lambda")
+	&& !(following != NULL
+	     && ((following->type == name_token
+		  && !is_keyword(following->text))
+		 || following->is_op(":") || following->is_op("*")
+		 || following->is_op("**") || following->is_op("(")))) {
+      // "f(lambda)".
+      return false;
+    }
+    if (tok.is_name("def") || tok.is_name("class")) {
+      // "def f(...)" and "class C:" or "class C(...)".
+      if (following == NULL || following->type != name_token
+	  || pos_ + 2 == tokens_.size()) {
+	return false;
+      }
+      const token &after(tokens_[pos_ + 2]);
+      if (!(after.is_op("(") || (tok.is_name("class") && after.is_op(":")))) {
+	return false;
+      }
+    }
+    if (tok.is_name("lambda")) {
+      ++f.lambdas;
+      f.lambda_seen = true;
+    } else if (tok.is_name("for")) {
+      if (f.pending_in) {
+	return false;
+      }
+      f.pending_in = true;
+    } else if (tok.is_name("in")) {
+      f.pending_in = false;
+    }
+    if (!statement_start_) {
+      if (tok.is_name("if")) {
+	if (f.pending_in) {
+	  return false;
+	}
+	// Comprehensions have conditions without "else".
+	if (!f.comprehension) {
+	  ++f.conditionals;
+	}
+      } else if (tok.is_name("else")) {
+	if (f.conditionals == 0 || following == NULL
+	    || following->type == newline_token
+	    || is_op_in(*following, infix_operators)) {
+	  return false;
+	}
+	--f.conditionals;
+      } else if (tok.is_name("for")
+		 && !(pos_ - 1 == leader_ && previous()->is_name("async"))) {
+	// A comprehension, but not an "async for" statement.
+	// Generator expressions need parentheses.
+	if (f.conditionals > 0 || depth() == 0) {
+	  return false;
+	}
+	f.comprehension = true;
+      }
+    }
+    return true;
+  }
+
+  // Moves to the next token and determines if it starts a statement.
+  void
+  checker::advance()
+  {
+    const token &tok(tokens_[pos_]);
+    bool start = false;
+    switch (tok.type) {
+    case newline_token:
+      start = true;
+      break;
+    case indent_token:
+      blocks_.push_back(std::string());
+      start = true;
+      break;
+    case dedent_token:
+      blocks_.pop_back();
+      start = true;
+      break;
+    case op_token:
+      if (tok.text.size() == 1) {
+	switch (tok.text[0]) {
+	case '(':
+	  frames_.push_back(frame('('));
+	  if (pos_ > 0 && operand_end(pos_ - 1)) {
+	    frames_.back().arguments = true;
+	    frames_.back().parameters = parameters_start();
+	  }
+	  break;
+	case '[':
+	  frames_.push_back(frame('['));
+	  frames_.back().subscript = pos_ > 0 && operand_end(pos_ - 1);
+	  break;
+	case '{':
+	  frames_.push_back(frame('{'));
+	  break;
+	case ')':
+	case ']':
+	  // Neither calls nor comprehensions can be assigned to.
+	  closed_target_ = !frames_.back().comprehension
+	    && !(frames_.back().arguments && !frames_.back().parameters);
+	  frames_.pop_back();
+	  break;
+	case '}':
+	  closed_target_ = false;
+	  frames_.pop_back();
+	  break;
+	case ';':
+	  start = depth() == 0;
+	  break;
+	case ':':
+	  // Only the ':' of a compound statement header starts a new
+	  // statement, not that of a lambda, slice or annotation.
+	  if (frames_.back().lambdas > 0) {
+	    --frames_.back().lambdas;
+	  } else {
+	    start = depth() == 0
+	      && tokens_[leader_].type == name_token
+	      && in_list(tokens_[leader_].text, compound_keywords);
+	  }
+	  break;
+	}
+      }
+      break;
+    default:
+      break;
+    }
+    ++pos_;
+    statement_start_ = start;
+    if (start) {
+      leader_ = pos_;
+      annotation_ = false;
+      assigned_ = false;
+    }
+  }
+
+  bool
+  checker::run()
+  {
+    for (; pos_ < tokens_.size(); advance()) {
+      const token &tok(tokens_[pos_]);
+      if (statement_start_) {
+	if (!statement_complete()) {
+	  return false;
+	}
+	frames_.front() = frame(0);
+      }
+      if (line_start() && tok.type != indent_token
+	  && tok.type != dedent_token && !check_clause()) {
+	return false;
+      }
+      if (tok.type == dedent_token && blocks_.back() == "@") {
+	return false;
+      }
+      if ((tok.type == newline_token || tok.is_op(";"))
+	  && tokens_[leader_].type == name_token
+	  && in_list(tokens_[leader_].text, compound_keywords)
+	  && !leader_is("async")) {
+	// A compound statement header without its ':', "if x".
+	// "async" can be a name in older Python versions.
+	return false;
+      }
+      if (tok.type == op_token) {
+	if (!check_operator()) {
+	  return false;
+	}
+      } else if (tok.type == name_token && is_keyword(tok.text)
+		 && !check_keyword()) {
+	return false;
+      }
+      if (tok.is_name("from") && !statement_start_) {
+	// "yield from" and "raise ... from".
+	versions_.python2 = false;
+      } else if (tok.is_name("async")) {
+	const token *following = next();
+	if (following != NULL && (following->is_name("def")
+				  || following->is_name("for")
+				  || following->is_name("with"))) {
+	  versions_.python2 = false;
+	}
+      }
+      if (operand_end(pos_) && operand_start() && !adjacent_operands()) {
+	return false;
+      }
+    }
+    return statement_complete() && blocks_.back() != "@"
+      && (versions_.python2 || versions_.python3);
+  }
+
+  // Extracts the results from the token stream.
+  class extractor {
+    const std::vector<token> &tokens_;
+    size_t pos_;
+
+    bool at_name() const;
+    bool at_name(const char *) const;
+    bool at_op(const char *) const;
+    bool statement_start() const;
+    bool statement_end() const;
+    bool plain_name(std::string &);
+    bool dotted_name(std::string &);
+    bool import_statement();
+    bool from_statement();
+  public:
+    std::vector<std::string> imports;
+    std::set<std::string> attributes;
+    std::set<std::string> functions;
+    std::set<std::string> classes;
+
+    explicit extractor(const std::vector<token> &);
+
+    // Returns false if an import statement or definition cannot be
+    // parsed.
+    bool run();
+  };
+
+  extractor::extractor(const std::vector<token> &tokens)
+    : tokens_(tokens), pos_(0)
+  {
+  }
+
+  bool
+  extractor::at_name() const
+  {
+    return pos_ < tokens_.size() && tokens_[pos_].type == name_token;
+  }
+
+  bool
+  extractor::at_name(const char *name) const
+  {
+    return pos_ < tokens_.size() && tokens_[pos_].is_name(name);
+  }
+
+  bool
+  extractor::at_op(const char *op) const
+  {
+    return pos_ < tokens_.size() && tokens_[pos_].is_op(op);
+  }
+
+  bool
+  extractor::statement_start() const
+  {
+    if (pos_ == 0) {
+      return true;
+    }
+    const token &prev(tokens_[pos_ - 1]);
+    return prev.type == newline_token || prev.type == indent_token
+      || prev.type == dedent_token || prev.is_op(";") || prev.is_op(":");
+  }
+
+  bool
+  extractor::statement_end() const
+  {
+    return pos_ == tokens_.size() || tokens_[pos_].type == newline_token
+      || tokens_[pos_].is_op(";");
+  }
+
+  bool
+  extractor::plain_name(std::string &name)
+  {
+    if (!at_name() || is_keyword(tokens_[pos_].text)) {
+      return false;
+    }
+    name = tokens_[pos_].text;
+    ++pos_;
+    return true;
+  }
+
+  bool
+  extractor::dotted_name(std::string &name)
+  {
+    if (!plain_name(name)) {
+      return false;
+    }
+    while (at_op(".")) {
+      ++pos_;
+      std::string component;
+      if (!plain_name(component)) {
+	return false;
+      }
+      name += '.';
+      name += component;
+    }
+    return true;
+  }
+
+  // After "import".
+  bool
+  extractor::import_statement()
+  {
+    while (true) {
+      std::string name;
+      if (!dotted_name(name)) {
+	return false;
+      }
+      imports.push_back(name);
+      if (at_name("as")) {
+	++pos_;
+	if (!plain_name(name)) {
+	  return false;
+	}
+      }
+      if (!at_op(",")) {
+	return statement_end();
+      }
+      ++pos_;
+    }
+  }
+
+  // After "from".
+  bool
+  extractor::from_statement()
+  {
+    std::string module;
+    while (at_op(".") || at_op("...")) {
+      module += tokens_[pos_].text;
+      ++pos_;
+    }
+    if (!at_name("import")) {
+      std::string name;
+      if (!dotted_name(name)) {
+	return false;
+      }
+      module += name;
+      module += '.';
+    } else if (module.empty()) {
+      return false;
+    }
+    if (!at_name("import")) {
+      return false;
+    }
+    ++pos_;
+
+    if (at_op("*")) {
+      ++pos_;
+      imports.push_back(module + '*');
+      return statement_end();
+    }
+    bool parens = at_op("(");
+    if (parens) {
+      ++pos_;
+    }
+    while (true) {
+      std::string name;
+      if (!plain_name(name)) {
+	return false;
+      }
+      imports.push_back(module + name);
+      if (at_name("as")) {
+	++pos_;
+	if (!plain_name(name)) {
+	  return false;
+	}
+      }
+      if (!at_op(",")) {
+	break;
+      }
+      ++pos_;
+      if (parens && at_op(")")) {
+	break;
+      }
+    }
+    if (parens) {
+      if (!at_op(")")) {
+	return false;
+      }
+      ++pos_;
+    }
+    return statement_end();
+  }
+
+  bool
+  extractor::run()
+  {
+    while (pos_ < tokens_.size()) {
+      const token &tok(tokens_[pos_]);
+      if (tok.is_name("import")) {
+	if (!statement_start()) {
+	  return false;
+	}
+	++pos_;
+	if (!import_statement()) {
+	  return false;
+	}
+      } else if (tok.is_name("from") && statement_start()) {
+	// Not "yield from" or "raise ... from".
+	++pos_;
+	if (!from_statement()) {
+	  return false;
+	}
+      } else if (tok.is_name("def") || tok.is_name("class")) {
+	// The interpreter-based analysis skips "async def".
+	bool async = pos_ > 0 && tokens_[pos_ - 1].is_name("async");
+	++pos_;
+	std::string name;
+	if (!plain_name(name)) {
+	  return false;
+	}
+	if (tok.text == "class") {
+	  classes.insert(name);
+	} else if (!async) {
+	  functions.insert(name);
+	}
+      } else if (tok.is_op(".")) {
+	++pos_;
+	if (at_name()) {
+	  std::string name;
+	  if (!plain_name(name)) {
+	    return false;
+	  }
+	  attributes.insert(name);
+	}
+      } else {
+	++pos_;
+      }
+    }
+    return true;
+  }
+
+  // Returns the normalized encoding declared in the first two lines,
+  // or an empty string.  See PEP 263.
+  std::string
+  coding_cookie(const char *p, const char *end)
+  {
+    for (int line = 0; line < 2 && p != end; ++line) {
+      const char *eol = p;
+      while (eol != end && *eol != '\n' && *eol != '\r') {
+	++eol;
+      }
+      const char *q = p;
+      while (q != eol && (*q == ' ' || *q == '\t' || *q == '\f')) {
+	++q;
+      }
+      if (q != eol && *q == '#') {
+	std::string comment(q, eol);
+	for (size_t pos = comment.find("coding"); pos != std::string::npos;
+	     pos = comment.find("coding", pos + 1)) {
+	  size_t i = pos + 6;
+	  if (i == comment.size() || (comment[i] != ':' && comment[i] != '=')) {
+	    continue;
+	  }
+	  ++i;
+	  while (i < comment.size() && (comment[i] == ' ' || comment[i] == '\t')) {
+	    ++i;
+	  }
+	  std::string encoding;
+	  for (; i < comment.size(); ++i) {
+	    char ch = comment[i];
+	    if (ch >= 'A' && ch <= 'Z') {
+	      encoding += ch - 'A' + 'a';
+	    } else if (ch == '_') {
+	      encoding += '-';
+	    } else if (is_name_char(ch) || ch == '-' || ch == '.') {
+	      encoding += ch;
+	    } else {
+	      break;
+	    }
+	  }
+	  if (!encoding.empty()) {
+	    return encoding;
+	  }
+	}
+      } else if (q != eol) {
+	break;
+      }
+      p = eol;
+      if (p != end && *p == '\r') {
+	++p;
+      }
+      if (p != end && *p == '\n') {
+	++p;
+      }
+    }
+    return std::string();
+  }
+
+  bool
+  is_utf8_encoding(const std::string &encoding)
+  {
+    return encoding == "utf-8" || encoding == "utf8";
+  }
+
+  bool
+  is_latin1_encoding(const std::string &encoding)
+  {
+    return encoding == "latin-1" || encoding == "latin1"
+      || encoding == "iso-8859-1" || encoding == "iso8859-1"
+      || encoding == "iso-latin-1";
+  }
+
+  bool
+  is_ascii_encoding(const std::string &encoding)
+  {
+    return encoding == "ascii" || encoding == "us-ascii";
+  }
+
+  // Returns true if at least one Python version accepts the encoding
+  // of the source code, and both decode identifiers in the same way.
+  // Updates VER if only one version accepts it.
+  bool
+  supported_encoding(const char *begin, const char *end, versions &ver)
+  {
+    bool bom = end - begin >= 3 && memcmp(begin, "\xEF\xBB\xBF", 3) == 0;
+    std::string encoding(coding_cookie(begin + (bom ? 3 : 0), end));
+    bool utf8 = bom || encoding.empty() || is_utf8_encoding(encoding);
+    if (bom && !(encoding.empty() || is_utf8_encoding(encoding))) {
+      return false;
+    }
+    if (!(utf8 || is_latin1_encoding(encoding) || is_ascii_encoding(encoding))) {
+      return false;
+    }
+    bool ascii = true;
+    for (const char *p = begin + (bom ? 3 : 0); p != end; ++p) {
+      if (!is_ascii(*p)) {
+	ascii = false;
+	break;
+      }
+    }
+    if (ascii) {
+      return true;
+    }
+    if (utf8) {
+      // Python 2 rejects undeclared non-ASCII characters, but Python
+      // 3 accepts them.
+      if (encoding.empty() && !bom) {
+	ver.python2 = false;
+      }
+      return is_valid_utf8(std::string(begin, end));
+    }
+    return is_latin1_encoding(encoding);
+  }
+}
+
+struct python_scanner::impl {
+  std::vector<std::string> imports_;
+  std::vector<std::string> attributes_;
+  std::vector<std::string> functions_;
+  std::vector<std::string> classes_;
+
+  void clear();
+};
+
+void
+python_scanner::impl::clear()
+{
+  imports_.clear();
+  attributes_.clear();
+  functions_.clear();
+  classes_.clear();
+}
+
+python_scanner::python_scanner()
+  : impl_(new impl)
+{
+}
+
+python_scanner::~python_scanner()
+{
+}
+
+bool
+python_scanner::scan(const std::vector<unsigned char> &source)
+{
+  impl_->clear();
+  const char *begin = reinterpret_cast<const char *>(source.data());
+  const char *end = begin + source.size();
+  if (source.empty()) {
+    return true;
+  }
+  versions ver;
+  if (memchr(begin, '\0', source.size()) != NULL
+      || !supported_encoding(begin, end, ver)) {
+    return false;
+  }
+  if (end - begin >= 3 && memcmp(begin, "\xEF\xBB\xBF", 3) == 0) {
+    begin += 3;
+  }
+
+  tokenizer tok(begin, end, ver);
+  if (!tok.run()) {
+    return false;
+  }
+  checker chk(tok.tokens, ver);
+  if (!chk.run()) {
+    return false;
+  }
+  extractor ext(tok.tokens);
+  if (!ext.run()) {
+    return false;
+  }
+  impl_->imports_.swap(ext.imports);
+  impl_->attributes_.assign(ext.attributes.begin(), ext.attributes.end());
+  impl_->functions_.assign(ext.functions.begin(), ext.functions.end());
+  impl_->classes_.assign(ext.classes.begin(), ext.classes.end());
+  return true;
+}
+
+const std::vector<std::string> &
+python_scanner::imports() const
+{
+  return impl_->imports_;
+}
+
+const std::vector<std::string> &
+python_scanner::attributes() const
+{
+  return impl_->attributes_;
+}
+
+const std::vector<std::string> &
+python_scanner::functions() const
+{
+  return impl_->functions_;
+}
+
+const std::vector<std::string> &
+python_scanner::classes() const
+{
+  return impl_->classes_;
+}
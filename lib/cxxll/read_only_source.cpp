@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/read_only_source.hpp>
+
+using namespace cxxll;
+
+read_only_source::read_only_source(source *src)
+  : source_(src)
+{
+}
+
+read_only_source::~read_only_source()
+{
+}
+
+size_t
+read_only_source::read(unsigned char *buf, size_t len)
+{
+  return source_->read(buf, len);
+}
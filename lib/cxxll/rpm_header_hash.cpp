@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/rpm_header_hash.hpp>
+#include <cxxll/rpm_parser_exception.hpp>
+#include <cxxll/source.hpp>
+#include <cxxll/hash.hpp>
+#include <cxxll/base16.hpp>
+
+#include <cstring>
+#include <vector>
+
+using namespace cxxll;
+
+namespace {
+  // Size of the legacy RPM lead.
+  const size_t LEAD_SIZE = 96;
+
+  // Size of the header intro (magic, reserved, index length, data
+  // length).
+  const size_t INTRO_SIZE = 16;
+
+  // Same limits as in librpm.
+  const unsigned MAX_TAGS = 0xffff;
+  const unsigned MAX_DATA = 0xffffff;
+
+  inline unsigned
+  get_be_32(const unsigned char *p)
+  {
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  }
+
+  // Reads a header structure and appends it to BUF.  Returns the
+  // length of the data part.
+  unsigned
+  read_header(source &src, std::vector<unsigned char> &buf)
+  {
+    static const unsigned char magic[] = {0x8e, 0xad, 0xe8, 0x01};
+    size_t start = buf.size();
+    buf.resize(start + INTRO_SIZE);
+    read_exactly(src, &buf[start], INTRO_SIZE);
+    if (memcmp(&buf[start], magic, sizeof(magic)) != 0) {
+      throw rpm_parser_exception("invalid RPM header magic");
+    }
+    unsigned il = get_be_32(&buf[start + 8]);
+    unsigned dl = get_be_32(&buf[start + 12]);
+    if (il == 0 || il > MAX_TAGS || dl > MAX_DATA) {
+      throw rpm_parser_exception("RPM header size out of range");
+    }
+    size_t size = il * 16U + dl;
+    buf.resize(start + INTRO_SIZE + size);
+    read_exactly(src, &buf[start + INTRO_SIZE], size);
+    return dl;
+  }
+}
+
+std::string
+cxxll::rpm_header_hash(source &src)
+{
+  std::vector<unsigned char> buf(LEAD_SIZE);
+  read_exactly(src, &buf[0], LEAD_SIZE);
+  static const unsigned char lead_magic[] = {0xed, 0xab, 0xee, 0xdb};
+  if (memcmp(&buf[0], lead_magic, sizeof(lead_magic)) != 0) {
+    throw rpm_parser_exception("invalid RPM lead");
+  }
+
+  // The signature header is padded to a multiple of 8 bytes.
+  buf.clear();
+  unsigned sig_dl = read_header(src, buf);
+  unsigned padding = (8 - (sig_dl % 8)) % 8;
+  if (padding > 0) {
+    unsigned char pad[8];
+    read_exactly(src, pad, padding);
+  }
+
+  // SHA1HEADER covers the main header, including its intro.
+  buf.clear();
+  read_header(src, buf);
+  hash_sink sha1(hash_sink::sha1);
+  sha1.write(buf);
+  std::vector<unsigned char> digest;
+  sha1.digest(digest);
+  return base16_encode(digest.begin(), digest.end());
+}
@@ -25,6 +25,12 @@ source::~source()
 {
 }
 
+const_stringref
+source::borrow(size_t)
+{
+  return const_stringref();
+}
+
 void
 cxxll::read_exactly(source &src, unsigned char *p, size_t count)
 {
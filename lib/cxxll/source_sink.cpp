@@ -27,11 +27,31 @@ using namespace cxxll;
 unsigned long long
 cxxll::copy_source_to_sink(source &src, sink &dst)
 {
+  unsigned char buf[copy_buffer_size];
+  return copy_source_to_sink(src, dst, buf, sizeof(buf));
+}
+
+unsigned long long
+cxxll::copy_source_to_sink(source &src, sink &dst,
+			   unsigned char *buf, size_t buffer_size)
+{
+  assert(buffer_size > 0);
   unsigned long long count = 0;
-  unsigned char buf[8192];
   while (true) {
-    size_t ret = src.read(buf, sizeof(buf));
-    assert(ret <= sizeof(buf));
+    const_stringref borrowed(src.borrow(buffer_size));
+    if (borrowed.empty()) {
+      break;
+    }
+    assert(borrowed.size() <= buffer_size);
+    dst.write(borrowed);
+    count += borrowed.size();
+  }
+
+  // The source does not support borrowing, or has reached the end
+  // of the stream.
+  while (true) {
+    size_t ret = src.read(buf, buffer_size);
+    assert(ret <= buffer_size);
     if (ret == 0) {
       break;
     }
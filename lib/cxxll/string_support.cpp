@@ -81,27 +81,6 @@ namespace {
     }
     return first;
   }
-
-  void
-  strip_inplace(std::string &s)
-  {
-    std::string::iterator p(s.begin());
-    std::string::iterator end(s.end());
-    while (p != end && whitespace(*p)) {
-      ++p;
-    }
-    s.erase(s.begin(), p);
-    p = s.end();
-    end = s.begin();
-    while (p != end) {
-      --p;
-      if (!whitespace(*p)) {
-	++p;
-	s.erase(p, s.end());
-	break;
-      }
-    }
-  }
 }
 
 // Parses an unsigned long long while skipping white space.
@@ -126,6 +105,27 @@ cxxll::parse_unsigned_long_long(const std::string &text,
   return true;
 }
 
+void
+cxxll::strip_inplace(std::string &s)
+{
+  std::string::iterator p(s.begin());
+  std::string::iterator end(s.end());
+  while (p != end && whitespace(*p)) {
+    ++p;
+  }
+  s.erase(s.begin(), p);
+  p = s.end();
+  end = s.begin();
+  while (p != end) {
+    --p;
+    if (!whitespace(*p)) {
+      ++p;
+      s.erase(p, s.end());
+      break;
+    }
+  }
+}
+
 std::string
 cxxll::strip(const std::string &s)
 {
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/select.h>
 #include <unistd.h>
@@ -38,6 +39,7 @@ using namespace cxxll;
 struct cxxll::url_source::impl {
   std::string url_;
   std::string effective_url_;
+  std::string range_;	     // HTTP range, empty if not applicable
 
   curl_handle curl_;
   CURLM *multi_;
@@ -112,8 +114,9 @@ cxxll::url_source::impl::check()
   long status = 0;
   curl_easy_getinfo(curl_.raw, CURLINFO_RESPONSE_CODE, &status);
   // A response code of 0 is used if the protocol does not support
-  // response codes.
-  if (status != 200 && status != 0) {
+  // response codes.  206 is the response code for range requests.
+  if (status != 200 && status != 0
+      && !(status == 206 && !range_.empty())) {
     char *primary_ip = NULL;
     curl_easy_getinfo(curl_.raw, CURLINFO_PRIMARY_IP, &primary_ip);
     long primary_port = 0;
@@ -177,6 +180,12 @@ cxxll::url_source::impl::connect()
   if (ret != CURLE_OK) {
     throw curl_exception(curl_easy_strerror(ret)).url(url);
   }
+  if (!range_.empty()) {
+    ret = curl_easy_setopt(curl, CURLOPT_RANGE, range_.c_str());
+    if (ret != CURLE_OK) {
+      throw curl_exception(curl_easy_strerror(ret)).url(url);
+    }
+  }
 
   // The following settings should detect connectivity issues.  The
   // throughput limit is fairly low, but it should allow us to detect
@@ -320,6 +329,20 @@ cxxll::url_source::~url_source()
 {
 }
 
+void
+cxxll::url_source::range(unsigned long long first, unsigned long long last)
+{
+  if (impl_->connected_) {
+    raise<std::logic_error>("url_source::range() called after connect()");
+  }
+  if (first > last) {
+    raise<std::logic_error>("url_source::range(): invalid range");
+  }
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%llu-%llu", first, last);
+  impl_->range_ = buf;
+}
+
 void
 cxxll::url_source::connect()
 {
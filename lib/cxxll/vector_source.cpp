@@ -42,3 +42,15 @@ vector_source::read(unsigned char *buf, size_t len)
   position += to_copy;
   return to_copy;
 }
+
+const_stringref
+vector_source::borrow(size_t len)
+{
+  if (position >= source->size()) {
+    return const_stringref();
+  }
+  size_t to_borrow = std::min(len, source->size() - position);
+  const_stringref result(source->data() + position, to_borrow);
+  position += to_borrow;
+  return result;
+}
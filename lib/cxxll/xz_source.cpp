@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/xz_source.hpp>
+#include <cxxll/decompress_exception.hpp>
+#include <cxxll/raise.hpp>
+
+#include <cstring>
+#include <new>
+
+#include <lzma.h>
+
+using namespace cxxll;
+
+enum {
+  BUFFER_SIZE = 64 * 1024
+};
+
+struct xz_source::impl {
+  source *source_;
+  lzma_stream stream_;
+  unsigned char buffer_[BUFFER_SIZE];
+  bool input_end_;
+  bool end_seen_;
+
+  impl(source *src)
+    : source_(src), input_end_(false), end_seen_(false)
+  {
+    lzma_stream init = LZMA_STREAM_INIT;
+    stream_ = init;
+    // LZMA_CONCATENATED matches the behavior of gunzip_source for
+    // multiple concatenated streams.
+    lzma_ret ret = lzma_stream_decoder
+      (&stream_, UINT64_MAX, LZMA_CONCATENATED);
+    if (ret != LZMA_OK) {
+      raise<std::bad_alloc>();
+    }
+  }
+
+  ~impl()
+  {
+    lzma_end(&stream_);
+  }
+
+  static const char *message(lzma_ret);
+
+  size_t read(unsigned char *buf, size_t length)
+  {
+    if (end_seen_ || length == 0) {
+      return 0;
+    }
+    stream_.next_out = buf;
+    stream_.avail_out = length;
+    while (true) {
+      if (stream_.avail_in == 0 && !input_end_) {
+	size_t ret = source_->read(buffer_, sizeof(buffer_));
+	if (ret == 0) {
+	  input_end_ = true;
+	} else {
+	  stream_.next_in = buffer_;
+	  stream_.avail_in = ret;
+	}
+      }
+      // With LZMA_CONCATENATED, the decoder reports the end of the
+      // data only after it has seen LZMA_FINISH.
+      lzma_ret err = lzma_code(&stream_, input_end_ ? LZMA_FINISH : LZMA_RUN);
+      switch (err) {
+      case LZMA_OK:
+	if (stream_.avail_out != 0) {
+	  continue;
+	}
+	return length;
+      case LZMA_STREAM_END:
+	end_seen_ = true;
+	return stream_.next_out - buf;
+      default:
+	throw decompress_exception(message(err));
+      }
+    }
+  }
+};
+
+const char *
+xz_source::impl::message(lzma_ret err)
+{
+  switch (err) {
+  case LZMA_MEM_ERROR:
+    return "xz: out of memory";
+  case LZMA_FORMAT_ERROR:
+    return "xz: invalid stream header";
+  case LZMA_OPTIONS_ERROR:
+    return "xz: unsupported compression options";
+  case LZMA_DATA_ERROR:
+    return "xz: compressed data is corrupt";
+  case LZMA_BUF_ERROR:
+    return "xz: unexpected end of stream";
+  default:
+    return "xz: decompression error";
+  }
+}
+
+xz_source::xz_source(source *src)
+  : impl_(new impl(src))
+{
+}
+
+xz_source::~xz_source()
+{
+}
+
+size_t
+xz_source::read(unsigned char *buf, size_t length)
+{
+  return impl_->read(buf, length);
+}
@@ -17,71 +17,358 @@
  */
 
 #include <cxxll/zip_file.hpp>
-#include <cxxll/source.hpp>
-#include <cxxll/source_sink.hpp>
-#include <cxxll/vector_sink.hpp>
-#include <cxxll/os_exception.hpp>
 #include <cxxll/raise.hpp>
 
-#include <archive.h>
-#include <archive_entry.h>
+#include <climits>
+#include <cstring>
+
+#include <zlib.h>
+
+using namespace cxxll;
+
+namespace {
+  enum {
+    LOCAL_HEADER_SIGNATURE = 0x04034b50,
+    CENTRAL_HEADER_SIGNATURE = 0x02014b50,
+    END_SIGNATURE = 0x06054b50,
+    END64_LOCATOR_SIGNATURE = 0x07064b50,
+    END64_SIGNATURE = 0x06064b50,
+
+    LOCAL_HEADER_SIZE = 30,
+    CENTRAL_HEADER_SIZE = 46,
+    END_SIZE = 22,
+    END64_LOCATOR_SIZE = 20,
+    END64_SIZE = 56,
+
+    // The end of central directory record is followed by a comment
+    // of at most this size.
+    MAX_COMMENT_SIZE = 0xFFFF,
+
+    ZIP64_EXTRA_ID = 1,
+    FLAG_ENCRYPTED = 1,
+    METHOD_STORED = 0,
+    METHOD_DEFLATED = 8,
+
+    // Deflate cannot compress better than this, so larger sizes in
+    // the central directory are bogus.
+    MAX_DEFLATE_RATIO = 1032
+  };
+
+  inline unsigned
+  le16(const unsigned char *p)
+  {
+    return p[0] | (p[1] << 8);
+  }
+
+  inline unsigned
+  le32(const unsigned char *p)
+  {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+  }
+
+  inline unsigned long long
+  le64(const unsigned char *p)
+  {
+    return le32(p) | ((unsigned long long)le32(p + 4) << 32);
+  }
+}
 
 bool
 cxxll::zip_file::has_signature(const std::vector<unsigned char> &vec)
 {
-  return vec.size() > 4 && vec.at(0) == 'P' && vec.at(1) == 'K'
-    && vec.at(2) == 3 && vec.at(3) == 4;
+  return has_signature(vec.data(), vec.size());
 }
 
-struct cxxll::zip_file::impl : source {
-  const std::vector<unsigned char> *buffer_;
-  archive *archive_;
-  archive_entry *entry_;
+bool
+cxxll::zip_file::has_signature(const unsigned char *p, size_t length)
+{
+  return length > 4 && p[0] == 'P' && p[1] == 'K' && p[2] == 3 && p[3] == 4;
+}
+
+struct cxxll::zip_file::impl {
+  const unsigned char *data_;
+  size_t size_;
+  z_stream stream_;
+  bool stream_initialized_;
+
+  // Position in the central directory.
+  bool directory_loaded_;
+  unsigned long long entries_remaining_;
+  size_t next_entry_;
+  size_t directory_end_;
+
+  // The current entry, from its central directory header.
+  bool has_entry_;
+  size_t name_offset_;
+  unsigned name_length_;
+  unsigned flags_;
+  unsigned method_;
+  unsigned crc_;
+  unsigned long long compressed_size_;
+  unsigned long long uncompressed_size_;
+  unsigned long long local_offset_;
 
-  impl(const std::vector<unsigned char> *buffer);
+  impl(const unsigned char *, size_t);
   ~impl();
 
-  size_t read(unsigned char *, size_t);
+  const unsigned char *data() const
+  {
+    return data_;
+  }
+
+  size_t size() const
+  {
+    return size_;
+  }
+
+  // Returns true if LENGTH bytes at OFFSET are within the first LIMIT
+  // bytes of the buffer.
+  static bool in_range(unsigned long long offset, unsigned long long length,
+		       unsigned long long limit)
+  {
+    return offset <= limit && length <= limit - offset;
+  }
+
+  void load_directory();
+  void load_entry();
+  void parse_zip64_extra(size_t offset, unsigned length);
+  size_t local_data();
+  void check_entry();
+  void check_crc(const unsigned char *, size_t);
+  void inflate_entry(size_t offset, std::vector<unsigned char> &);
 };
 
-cxxll::zip_file::impl::impl(const std::vector<unsigned char> *buffer)
-  : buffer_(buffer), archive_(archive_read_new())
+cxxll::zip_file::impl::impl(const unsigned char *data, size_t size)
+  : data_(data), size_(size), stream_initialized_(false), directory_loaded_(false),
+    entries_remaining_(0), next_entry_(0), directory_end_(0),
+    has_entry_(false)
 {
-  if (archive_ == NULL) {
-    raise<std::bad_alloc>();
+  memset(&stream_, 0, sizeof(stream_));
+}
+
+cxxll::zip_file::impl::~impl()
+{
+  if (stream_initialized_) {
+    inflateEnd(&stream_);
+  }
+}
+
+void
+cxxll::zip_file::impl::load_directory()
+{
+  directory_loaded_ = true;
+  if (size() < END_SIZE) {
+    throw exception("end of central directory not found");
+  }
+
+  // Search backwards for the end of central directory record.  The
+  // comment which follows it can contain the signature, too, so
+  // check that the comment length is consistent.
+  size_t end = size() - END_SIZE;
+  size_t lowest = end > MAX_COMMENT_SIZE ? end - MAX_COMMENT_SIZE : 0;
+  while (true) {
+    if (le32(data() + end) == END_SIGNATURE
+	&& le16(data() + end + 20) <= size() - end - END_SIZE) {
+      break;
+    }
+    if (end == lowest) {
+      throw exception("end of central directory not found");
+    }
+    --end;
+  }
+
+  unsigned long long entries = le16(data() + end + 10);
+  unsigned long long directory_size = le32(data() + end + 12);
+  unsigned long long directory_offset = le32(data() + end + 16);
+  if (entries == 0xFFFF || directory_size == 0xFFFFFFFF
+      || directory_offset == 0xFFFFFFFF) {
+    if (end < END64_LOCATOR_SIZE) {
+      throw exception("ZIP64 end of central directory locator not found");
+    }
+    const unsigned char *locator = data() + end - END64_LOCATOR_SIZE;
+    if (le32(locator) != END64_LOCATOR_SIGNATURE) {
+      throw exception("ZIP64 end of central directory locator not found");
+    }
+    unsigned long long end64 = le64(locator + 8);
+    if (!in_range(end64, END64_SIZE, size())
+	|| le32(data() + end64) != END64_SIGNATURE) {
+      throw exception("ZIP64 end of central directory not found");
+    }
+    entries = le64(data() + end64 + 32);
+    directory_size = le64(data() + end64 + 40);
+    directory_offset = le64(data() + end64 + 48);
+  } else if (le16(data() + end + 4) != 0 || le16(data() + end + 6) != 0) {
+    throw exception("multi-disk ZIP files are not supported");
   }
-  if (archive_read_support_format_zip(archive_) != ARCHIVE_OK
-      || (archive_read_open_memory(archive_,
-				   const_cast<unsigned char *>(buffer->data()),
-				   buffer->size())
-	  != ARCHIVE_OK)
-      || (entry_ = archive_entry_new2(archive_)) == NULL) {
-    archive_read_free(archive_);
-    raise<std::runtime_error>("archive_read_support_format_zip");
+  if (!in_range(directory_offset, directory_size, size())) {
+    throw exception("central directory out of bounds");
   }
+  entries_remaining_ = entries;
+  next_entry_ = directory_offset;
+  directory_end_ = directory_offset + directory_size;
 }
 
-cxxll::zip_file::impl::~impl()
+void
+cxxll::zip_file::impl::load_entry()
 {
-  archive_entry_free(entry_);
-  archive_read_free(archive_);
+  if (!in_range(next_entry_, CENTRAL_HEADER_SIZE, directory_end_)) {
+    throw exception("central directory truncated");
+  }
+  const unsigned char *p = data() + next_entry_;
+  if (le32(p) != CENTRAL_HEADER_SIGNATURE) {
+    throw exception("central directory header not found");
+  }
+  flags_ = le16(p + 8);
+  method_ = le16(p + 10);
+  crc_ = le32(p + 16);
+  compressed_size_ = le32(p + 20);
+  uncompressed_size_ = le32(p + 24);
+  name_length_ = le16(p + 28);
+  unsigned extra_length = le16(p + 30);
+  unsigned comment_length = le16(p + 32);
+  local_offset_ = le32(p + 42);
+  name_offset_ = next_entry_ + CENTRAL_HEADER_SIZE;
+  unsigned long long variable =
+    name_length_ + extra_length + comment_length;
+  if (!in_range(name_offset_, variable, directory_end_)) {
+    throw exception("central directory truncated");
+  }
+  parse_zip64_extra(name_offset_ + name_length_, extra_length);
+  next_entry_ = name_offset_ + variable;
 }
 
+void
+cxxll::zip_file::impl::parse_zip64_extra(size_t offset, unsigned length)
+{
+  // The ZIP64 extended information field only contains the values
+  // whose 32-bit central directory fields are saturated, in this
+  // order.
+  unsigned long long *fields[3] = {
+    &uncompressed_size_, &compressed_size_, &local_offset_
+  };
+  size_t end = offset + length;
+  while (end - offset >= 4) {
+    unsigned id = le16(data() + offset);
+    unsigned field_length = le16(data() + offset + 2);
+    offset += 4;
+    if (field_length > end - offset) {
+      throw exception("malformed extra field");
+    }
+    if (id == ZIP64_EXTRA_ID) {
+      size_t p = offset;
+      for (unsigned i = 0; i < 3; ++i) {
+	if (*fields[i] == 0xFFFFFFFF) {
+	  if (p + 8 > offset + field_length) {
+	    throw exception("malformed ZIP64 extra field");
+	  }
+	  *fields[i] = le64(data() + p);
+	  p += 8;
+	}
+      }
+    }
+    offset += field_length;
+  }
+}
+
+// Returns the offset of the compressed data of the current entry.
 size_t
-cxxll::zip_file::impl::read(unsigned char *buffer, size_t length)
+cxxll::zip_file::impl::local_data()
 {
-  ssize_t ret = archive_read_data(archive_, buffer, length);
-  if (ret < 0) {
-    throw os_exception(archive_errno(archive_))
-      .message(archive_error_string(archive_))
-      .path2(archive_entry_pathname(entry_))
-      .function(archive_read_data).length(length);
+  if (!in_range(local_offset_, LOCAL_HEADER_SIZE, size())) {
+    throw exception("local header out of bounds");
+  }
+  const unsigned char *p = data() + local_offset_;
+  if (le32(p) != LOCAL_HEADER_SIGNATURE) {
+    throw exception("local header not found");
+  }
+  // The local header can have a different extra field than the
+  // central directory.
+  size_t offset = local_offset_ + LOCAL_HEADER_SIZE
+    + le16(p + 26) + le16(p + 28);
+  if (!in_range(offset, compressed_size_, size())) {
+    throw exception("compressed data out of bounds");
+  }
+  return offset;
+}
+
+void
+cxxll::zip_file::impl::check_entry()
+{
+  if (!has_entry_) {
+    raise<std::logic_error>("zip_file::data without current entry");
+  }
+  if (flags_ & FLAG_ENCRYPTED) {
+    throw exception("encrypted ZIP entries are not supported");
+  }
+  if (method_ != METHOD_STORED && method_ != METHOD_DEFLATED) {
+    throw exception("unsupported ZIP compression method");
+  }
+  if (method_ == METHOD_STORED && compressed_size_ != uncompressed_size_) {
+    throw exception("uncompressed size mismatch");
+  }
+}
+
+void
+cxxll::zip_file::impl::check_crc(const unsigned char *p, size_t length)
+{
+  unsigned long crc = crc32(0, NULL, 0);
+  while (length > 0) {
+    unsigned chunk = length > UINT_MAX ? UINT_MAX : length;
+    crc = crc32(crc, p, chunk);
+    p += chunk;
+    length -= chunk;
+  }
+  if (crc != crc_) {
+    throw exception("CRC mismatch");
+  }
+}
+
+void
+cxxll::zip_file::impl::inflate_entry(size_t offset,
+				     std::vector<unsigned char> &target)
+{
+  if (compressed_size_ > UINT_MAX || uncompressed_size_ > UINT_MAX) {
+    throw exception("compressed entry too large");
+  }
+  if (stream_initialized_) {
+    if (inflateReset(&stream_) != Z_OK) {
+      throw exception("inflateReset failed");
+    }
+  } else {
+    // Raw deflate data, without zlib header.
+    if (inflateInit2(&stream_, -MAX_WBITS) != Z_OK) {
+      raise<std::bad_alloc>();
+    }
+    stream_initialized_ = true;
+  }
+  unsigned char dummy;
+  stream_.next_in = const_cast<unsigned char *>(data() + offset);
+  stream_.avail_in = compressed_size_;
+  stream_.next_out = target.empty() ? &dummy : target.data();
+  stream_.avail_out = target.size();
+  int ret = inflate(&stream_, Z_FINISH);
+  if (ret == Z_STREAM_END) {
+    if (stream_.total_out != uncompressed_size_) {
+      throw exception("uncompressed size mismatch");
+    }
+  } else if (ret == Z_BUF_ERROR && stream_.avail_out == 0) {
+    throw exception("uncompressed size mismatch");
+  } else if (ret == Z_BUF_ERROR) {
+    throw exception("deflate stream truncated");
+  } else if (ret == Z_MEM_ERROR) {
+    raise<std::bad_alloc>();
+  } else {
+    throw exception(stream_.msg ? stream_.msg : "inflate failed");
   }
-  return ret;
 }
 
 cxxll::zip_file::zip_file(const std::vector<unsigned char> *buffer)
-  : impl_(new impl(buffer))
+  : impl_(new impl(buffer->data(), buffer->size()))
+{
+}
+
+cxxll::zip_file::zip_file(const unsigned char *data, size_t size)
+  : impl_(new impl(data, size))
 {
 }
 
@@ -92,34 +379,94 @@ cxxll::zip_file::~zip_file()
 bool
 cxxll::zip_file::next()
 {
-  int ret = archive_read_next_header2(impl_->archive_, impl_->entry_);
-  if (ret == ARCHIVE_EOF) {
+  impl &i(*impl_);
+  if (!i.directory_loaded_) {
+    i.load_directory();
+  }
+  i.has_entry_ = false;
+  if (i.entries_remaining_ == 0) {
     return false;
-  } else if (ret != ARCHIVE_OK) {
-    throw os_exception(archive_errno(impl_->archive_))
-      .message(archive_error_string(impl_->archive_))
-      .function(archive_read_next_header2);
   }
+  i.load_entry();
+  --i.entries_remaining_;
+  i.has_entry_ = true;
   return true;
 }
 
 std::string
 cxxll::zip_file::name() const
 {
-  return archive_entry_pathname(impl_->entry_);
+  const impl &i(*impl_);
+  if (!i.has_entry_) {
+    return std::string();
+  }
+  const char *p = reinterpret_cast<const char *>(i.data() + i.name_offset_);
+  return std::string(p, p + i.name_length_);
+}
+
+unsigned long long
+cxxll::zip_file::size() const
+{
+  return impl_->has_entry_ ? impl_->uncompressed_size_ : 0;
 }
 
 void
 cxxll::zip_file::data(std::vector<unsigned char> &target)
 {
+  impl &i(*impl_);
   target.clear();
-  vector_sink sink;
-  sink.data.swap(target);
-  try {
-    copy_source_to_sink(*impl_, sink);
-  } catch (...) {
-    sink.data.swap(target);
-    throw;
-  }
-  sink.data.swap(target);
+  i.check_entry();
+  size_t offset = i.local_data();
+  unsigned long long max_size = i.compressed_size_;
+  if (i.method_ == METHOD_DEFLATED) {
+    max_size = max_size * MAX_DEFLATE_RATIO + 1024;
+  }
+  if (i.uncompressed_size_ > max_size
+      || i.uncompressed_size_ > target.max_size()) {
+    throw exception("uncompressed size mismatch");
+  }
+
+  // Reuses the capacity of the target vector.
+  target.resize(i.uncompressed_size_);
+  if (i.method_ == METHOD_STORED) {
+    if (!target.empty()) {
+      memcpy(target.data(), i.data() + offset, target.size());
+    }
+  } else {
+    i.inflate_entry(offset, target);
+  }
+  i.check_crc(target.data(), target.size());
+}
+
+bool
+cxxll::zip_file::data_in_place(const unsigned char *&ptr, size_t &length)
+{
+  impl &i(*impl_);
+  i.check_entry();
+  if (i.method_ != METHOD_STORED) {
+    return false;
+  }
+  size_t offset = i.local_data();
+  i.check_crc(i.data() + offset, i.compressed_size_);
+  ptr = i.data() + offset;
+  length = i.compressed_size_;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+// cxxll::zip_file::exception
+
+cxxll::zip_file::exception::exception(const char *what)
+  : what_(what)
+{
+}
+
+cxxll::zip_file::exception::~exception() throw()
+{
+}
+
+const char *
+cxxll::zip_file::exception::what() const throw()
+{
+  return what_.c_str();
 }
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/zstd_source.hpp>
+#include <cxxll/decompress_exception.hpp>
+#include <cxxll/raise.hpp>
+
+#include <new>
+#include <string>
+#include <vector>
+
+#include <zstd.h>
+
+using namespace cxxll;
+
+struct zstd_source::impl {
+  source *source_;
+  ZSTD_DStream *stream_;
+  std::vector<unsigned char> buffer_;
+  ZSTD_inBuffer in_;
+  bool input_end_;
+  bool frame_done_;
+  bool end_seen_;
+
+  impl(source *src)
+    : source_(src), stream_(ZSTD_createDStream()),
+      buffer_(ZSTD_DStreamInSize()), input_end_(false), frame_done_(false),
+      end_seen_(false)
+  {
+    if (stream_ == NULL) {
+      raise<std::bad_alloc>();
+    }
+    if (ZSTD_isError(ZSTD_initDStream(stream_))) {
+      ZSTD_freeDStream(stream_);
+      raise<std::bad_alloc>();
+    }
+    in_.src = &buffer_.front();
+    in_.size = 0;
+    in_.pos = 0;
+  }
+
+  ~impl()
+  {
+    ZSTD_freeDStream(stream_);
+  }
+
+  size_t read(unsigned char *buf, size_t length)
+  {
+    if (end_seen_ || length == 0) {
+      return 0;
+    }
+    ZSTD_outBuffer out;
+    out.dst = buf;
+    out.size = length;
+    out.pos = 0;
+    while (true) {
+      if (in_.pos == in_.size && !input_end_) {
+	size_t ret = source_->read(&buffer_.front(), buffer_.size());
+	if (ret == 0) {
+	  input_end_ = true;
+	} else {
+	  in_.size = ret;
+	  in_.pos = 0;
+	}
+      }
+      if (input_end_ && in_.pos == in_.size && frame_done_) {
+	end_seen_ = true;
+	return out.pos;
+      }
+      size_t before = out.pos;
+      // Returns 0 once a frame has been decoded and flushed
+      // completely.  Further input is treated as another frame.
+      size_t ret = ZSTD_decompressStream(stream_, &out, &in_);
+      if (ZSTD_isError(ret)) {
+	std::string msg("zstd: ");
+	msg += ZSTD_getErrorName(ret);
+	throw decompress_exception(msg.c_str());
+      }
+      frame_done_ = ret == 0;
+      if (out.pos == out.size) {
+	return length;
+      }
+      if (input_end_ && in_.pos == in_.size && !frame_done_
+	  && out.pos == before) {
+	throw decompress_exception("zstd: unexpected end of stream");
+      }
+    }
+  }
+};
+
+zstd_source::zstd_source(source *src)
+  : impl_(new impl(src))
+{
+}
+
+zstd_source::~zstd_source()
+{
+}
+
+size_t
+zstd_source::read(unsigned char *buf, size_t length)
+{
+  return impl_->read(buf, length);
+}
@@ -18,6 +18,8 @@
 
 #include <symboldb/database.hpp>
 #include <symboldb/update_elf_closure.hpp>
+#include <symboldb/update_elf_symbol_resolution.hpp>
+#include <symboldb/write_set_snapshot.hpp>
 #include <cxxll/rpm_dependency.hpp>
 #include <cxxll/rpm_file_info.hpp>
 #include <cxxll/rpm_package_info.hpp>
@@ -26,20 +28,26 @@
 #include <cxxll/elf_image.hpp>
 #include <cxxll/elf_symbol_definition.hpp>
 #include <cxxll/elf_symbol_reference.hpp>
+#include <cxxll/elf_symbol_batch.hpp>
 #include <cxxll/pgconn_handle.hpp>
 #include <cxxll/pgresult_handle.hpp>
+#include <cxxll/pg_cursor.hpp>
 #include <cxxll/pg_encode_array.hpp>
 #include <cxxll/pg_exception.hpp>
 #include <cxxll/pg_query.hpp>
 #include <cxxll/pg_response.hpp>
 #include <cxxll/pg_split_statement.hpp>
+#include <cxxll/base16.hpp>
 #include <cxxll/hash.hpp>
 #include <cxxll/java_class.hpp>
+#include <cxxll/java_class_batch.hpp>
 #include <cxxll/maven_url.hpp>
 #include <cxxll/raise.hpp>
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <libpq-fe.h>
 
@@ -426,6 +434,20 @@ database::package_by_digest(const std::vector<unsigned char> &digest)
   return package_id(get_id(res));
 }
 
+database::package_id
+database::package_by_header_hash(const std::string &hash)
+{
+  if (hash.size() != 40) {
+    raise<std::logic_error>("invalid header hash length");
+  }
+  pgresult_handle res;
+  pg_query_binary
+    (impl_->conn, res,
+     "SELECT package_id FROM " PACKAGE_TABLE " WHERE hash = decode($1, 'hex')",
+     hash);
+  return package_id(get_id(res));
+}
+
 void
 database::add_package_dependency(package_id pkg, const rpm_dependency &dep)
 {
@@ -587,7 +609,8 @@ database::add_symlink(package_id pkg, const rpm_file_info &info)
 
 void
 database::add_elf_image(contents_id cid, const elf_image &image,
-			const char *soname)
+			const char *soname,
+			elf_image::symbol_selection symbols)
 {
   assert(impl_->conn.transactionStatus() == PQTRANS_INTRANS);
   const char *interp;
@@ -601,8 +624,9 @@ database::add_elf_image(contents_id cid, const elf_image &image,
     (impl_->conn, res,
      "INSERT INTO " ELF_FILE_TABLE
      " (contents_id, ei_class, ei_data, e_type, e_machine, arch, soname,"
-     " interp, build_id)"
-     " VALUES ($1, $2, $3, $4, $5, $6::symboldb.elf_arch, $7, $8, $9)",
+     " interp, build_id, symbols)"
+     " VALUES ($1, $2, $3, $4, $5, $6::symboldb.elf_arch, $7, $8, $9,"
+     " $10::symboldb.elf_symbol_selection)",
      cid.value(),
      static_cast<int>(image.ei_class()),
      static_cast<int>(image.ei_data()),
@@ -611,7 +635,8 @@ database::add_elf_image(contents_id cid, const elf_image &image,
      image.arch(),
      soname,
      interp,
-     image.build_id().empty() ? NULL : &image.build_id());
+     image.build_id().empty() ? NULL : &image.build_id(),
+     elf_image::to_string(symbols));
 
   elf_image::program_header_range phdr(image);
   while (phdr.next()) {
@@ -675,6 +700,147 @@ database::add_elf_symbol_reference(contents_id cid,
      ref.visibility());
 }
 
+namespace {
+  // Builds rows for COPY ... FROM STDIN in text format.
+  struct copy_buffer {
+    pgconn_handle &conn;
+    std::vector<char> data;
+
+    copy_buffer(pgconn_handle &c)
+      : conn(c)
+    {
+    }
+
+    void text(const char *str)
+    {
+      if (str == NULL) {
+	static const char null[] = "\\N";
+	data.insert(data.end(), null, null + 2);
+	return;
+      }
+      for (; *str; ++str) {
+	char ch = *str;
+	switch (ch) {
+	case '\\':
+	case '\t':
+	case '\n':
+	case '\r':
+	  data.push_back('\\');
+	  data.push_back(ch == '\t' ? 't'
+			 : ch == '\n' ? 'n'
+			 : ch == '\r' ? 'r' : ch);
+	  break;
+	default:
+	  data.push_back(ch);
+	}
+      }
+    }
+
+    void number(long long value)
+    {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%lld", value);
+      data.insert(data.end(), buf, buf + strlen(buf));
+    }
+
+    void boolean(bool value)
+    {
+      data.push_back(value ? 't' : 'f');
+    }
+
+    void separator()
+    {
+      data.push_back('\t');
+    }
+
+    // Terminates the row and sends the buffered data if necessary.
+    void end_row()
+    {
+      data.push_back('\n');
+      if (data.size() > 128 * 1024) {
+	flush();
+      }
+    }
+
+    void flush()
+    {
+      if (!data.empty()) {
+	conn.putCopyData(data.data(), data.size());
+	data.clear();
+      }
+    }
+  };
+}
+
+void
+database::add_elf_symbols(contents_id cid, const elf_symbol_batch &batch)
+{
+  assert(impl_->conn.transactionStatus() == PQTRANS_INTRANS);
+  copy_buffer buf(impl_->conn);
+
+  const elf_symbol_batch::definitions &defs(batch.defs);
+  if (defs.size() > 0) {
+    pgresult_handle copy;
+    copy.exec(impl_->conn,
+	      "COPY " ELF_DEFINITION_TABLE
+	      " (contents_id, name, version, primary_version, symbol_type,"
+	      " binding, section, xsection, visibility) FROM STDIN");
+    for (size_t i = 0, end = defs.size(); i < end; ++i) {
+      buf.number(cid.value());
+      buf.separator();
+      buf.text(batch.string(defs.name[i]));
+      buf.separator();
+      buf.text(batch.string(defs.version[i]));
+      buf.separator();
+      buf.boolean(defs.default_version[i]);
+      buf.separator();
+      buf.number(defs.type[i]);
+      buf.separator();
+      buf.number(defs.binding[i]);
+      buf.separator();
+      buf.number(static_cast<short>(defs.section[i]));
+      buf.separator();
+      if (defs.has_xsection(i)) {
+	buf.number(static_cast<int>(defs.xsection[i]));
+      } else {
+	buf.text(NULL);
+      }
+      buf.separator();
+      buf.text(elf_symbol::visibility_name(defs.visibility[i]));
+      buf.end_row();
+    }
+    buf.flush();
+    impl_->conn.putCopyEnd();
+    copy.getresult(impl_->conn);
+  }
+
+  const elf_symbol_batch::symbols &refs(batch.refs);
+  if (refs.size() > 0) {
+    pgresult_handle copy;
+    copy.exec(impl_->conn,
+	      "COPY " ELF_REFERENCE_TABLE
+	      " (contents_id, name, version, symbol_type, binding, visibility)"
+	      " FROM STDIN");
+    for (size_t i = 0, end = refs.size(); i < end; ++i) {
+      buf.number(cid.value());
+      buf.separator();
+      buf.text(batch.string(refs.name[i]));
+      buf.separator();
+      buf.text(batch.string(refs.version[i]));
+      buf.separator();
+      buf.number(refs.type[i]);
+      buf.separator();
+      buf.number(refs.binding[i]);
+      buf.separator();
+      buf.text(elf_symbol::visibility_name(refs.visibility[i]));
+      buf.end_row();
+    }
+    buf.flush();
+    impl_->conn.putCopyEnd();
+    copy.getresult(impl_->conn);
+  }
+}
+
 void
 database::add_elf_needed(contents_id cid, const char *name)
 {
@@ -755,47 +921,248 @@ database::add_xml_error(contents_id cid, const char *message, unsigned line,
 //////////////////////////////////////////////////////////////////////
 // Java classes.
 
+namespace {
+  // Copies the fields or methods of the batch into a staging table
+  // with columns (seq, access_flags, name, descriptor).
+  void
+  copy_java_members(pgconn_handle &conn, copy_buffer &buf, const char *sql,
+		    const java_class_batch &batch,
+		    const java_class_batch::members &members)
+  {
+    if (members.size() == 0) {
+      return;
+    }
+    pgresult_handle copy;
+    copy.exec(conn, sql);
+    for (size_t row = 0, rows = batch.size(); row < rows; ++row) {
+      for (unsigned i = members.begin(row), end = members.end[row];
+	   i < end; ++i) {
+	buf.number(row);
+	buf.separator();
+	buf.number(members.access_flags[i]);
+	buf.separator();
+	buf.text(batch.string(members.name[i]));
+	buf.separator();
+	buf.text(batch.string(members.descriptor[i]));
+	buf.end_row();
+      }
+    }
+    buf.flush();
+    conn.putCopyEnd();
+    copy.getresult(conn);
+  }
+
+  const char *
+  java_member_kind(unsigned char tag)
+  {
+    switch (tag) {
+    case java_class::CONSTANT_Fieldref:
+      return "field";
+    case java_class::CONSTANT_Methodref:
+      return "method";
+    case java_class::CONSTANT_InterfaceMethodref:
+      return "interface_method";
+    }
+    raise<std::logic_error>("invalid Java member reference tag");
+  }
+}
+
 void
 database::add_java_class(contents_id cid, const cxxll::java_class &jc)
 {
-  // FIXME: This needs a transaction.
+  java_class_batch batch;
+  batch.add(jc);
+  add_java_classes(cid, batch);
+}
+
+void
+database::add_java_classes(contents_id cid, const java_class_batch &batch)
+{
   assert(impl_->conn.transactionStatus() == PQTRANS_INTRANS);
+  if (batch.size() == 0) {
+    return;
+  }
+
+  // Stage the batch in temporary tables, and intern the classes with
+  // a fixed number of statements.
   pgresult_handle res;
-  std::vector<unsigned char> digest(hash(hash_sink::sha256, jc.buffer()));
-  std::string this_class(jc.this_class());
-  pg_query_binary
-    (impl_->conn, res, "SELECT * FROM symboldb.intern_java_class"
-     " ($1, $2, $3, $4)", digest,
-     this_class, jc.super_class(), static_cast<int>(jc.access_flags()));
-  int classid;
-  bool added;
-  pg_response(res, 0, classid, added);
-  if (added) {
-    for (unsigned i= 0, end = jc.interface_count(); i < end; ++i) {
-      pg_query
-	(impl_->conn, res,
-	 "INSERT INTO symboldb.java_interface (class_id, name) VALUES ($1, $2)",
-	 classid, jc.interface(i));
+  res.exec(impl_->conn, "CREATE TEMPORARY TABLE add_java_classes ("
+	   " seq INTEGER NOT NULL,"
+	   " digest BYTEA NOT NULL,"
+	   " name TEXT NOT NULL COLLATE \"C\","
+	   " super_class TEXT NOT NULL COLLATE \"C\","
+	   " access_flags INTEGER NOT NULL,"
+	   " class_id INTEGER,"
+	   " major_version INTEGER NOT NULL,"
+	   " minor_version INTEGER NOT NULL,"
+	   " added BOOLEAN NOT NULL DEFAULT FALSE) ON COMMIT DROP");
+  res.exec(impl_->conn, "CREATE TEMPORARY TABLE add_java_interfaces ("
+	   " seq INTEGER NOT NULL,"
+	   " name TEXT NOT NULL COLLATE \"C\") ON COMMIT DROP");
+  res.exec(impl_->conn, "CREATE TEMPORARY TABLE add_java_references ("
+	   " seq INTEGER NOT NULL,"
+	   " name TEXT NOT NULL COLLATE \"C\") ON COMMIT DROP");
+  res.exec(impl_->conn, "CREATE TEMPORARY TABLE add_java_fields ("
+	   " seq INTEGER NOT NULL,"
+	   " access_flags INTEGER NOT NULL,"
+	   " name TEXT NOT NULL COLLATE \"C\","
+	   " descriptor TEXT NOT NULL COLLATE \"C\") ON COMMIT DROP");
+  res.exec(impl_->conn, "CREATE TEMPORARY TABLE add_java_methods ("
+	   " seq INTEGER NOT NULL,"
+	   " access_flags INTEGER NOT NULL,"
+	   " name TEXT NOT NULL COLLATE \"C\","
+	   " descriptor TEXT NOT NULL COLLATE \"C\") ON COMMIT DROP");
+  res.exec(impl_->conn, "CREATE TEMPORARY TABLE add_java_member_references ("
+	   " seq INTEGER NOT NULL,"
+	   " kind symboldb.java_member_kind NOT NULL,"
+	   " class_name TEXT NOT NULL COLLATE \"C\","
+	   " name TEXT NOT NULL COLLATE \"C\","
+	   " descriptor TEXT NOT NULL COLLATE \"C\") ON COMMIT DROP");
+
+  copy_buffer buf(impl_->conn);
+  {
+    pgresult_handle copy;
+    copy.exec(impl_->conn, "COPY add_java_classes"
+	      " (seq, digest, name, super_class, access_flags,"
+	      " major_version, minor_version) FROM STDIN");
+    for (size_t row = 0, rows = batch.size(); row < rows; ++row) {
+      const unsigned char *digest = batch.digest_of(row);
+      buf.number(row);
+      buf.separator();
+      buf.text(("\\x" + base16_encode
+		(digest, digest + java_class_batch::digest_size)).c_str());
+      buf.separator();
+      buf.text(batch.string(batch.name[row]));
+      buf.separator();
+      buf.text(batch.string(batch.super_class[row]));
+      buf.separator();
+      buf.number(batch.access_flags[row]);
+      buf.separator();
+      buf.number(batch.major_version[row]);
+      buf.separator();
+      buf.number(batch.minor_version[row]);
+      buf.end_row();
     }
-    std::vector<std::string> classes(jc.class_references());
-    std::sort(classes.begin(), classes.end());
-    std::vector<std::string>::iterator end =
-      std::unique(classes.begin(), classes.end());
-    for (std::vector<std::string>::iterator p = classes.begin();
-	 p != end; ++p) {
-      const std::string &name(*p);
-      if (name != "java/lang/Object" && name != "java/lang/String"
-	  && name != this_class) {
-	pg_query(impl_->conn, res,
-		 "INSERT INTO symboldb.java_class_reference (class_id, name)"
-		 " VALUES ($1, $2)", classid, name);
+    buf.flush();
+    impl_->conn.putCopyEnd();
+    copy.getresult(impl_->conn);
+  }
+  if (!batch.interfaces.empty()) {
+    pgresult_handle copy;
+    copy.exec(impl_->conn, "COPY add_java_interfaces FROM STDIN");
+    for (size_t row = 0, rows = batch.size(); row < rows; ++row) {
+      for (unsigned i = batch.interfaces_begin(row),
+	     end = batch.interfaces_end[row]; i < end; ++i) {
+	buf.number(row);
+	buf.separator();
+	buf.text(batch.string(batch.interfaces[i]));
+	buf.end_row();
       }
     }
+    buf.flush();
+    impl_->conn.putCopyEnd();
+    copy.getresult(impl_->conn);
   }
-  pg_query
-    (impl_->conn, res,
-     "INSERT INTO symboldb.java_class_contents"
-     " (class_id, contents_id) VALUES ($1, $2)", classid, cid.value());
+  if (!batch.references.empty()) {
+    pgresult_handle copy;
+    copy.exec(impl_->conn, "COPY add_java_references FROM STDIN");
+    for (size_t row = 0, rows = batch.size(); row < rows; ++row) {
+      for (unsigned i = batch.references_begin(row),
+	     end = batch.references_end[row]; i < end; ++i) {
+	buf.number(row);
+	buf.separator();
+	buf.text(batch.string(batch.references[i]));
+	buf.end_row();
+      }
+    }
+    buf.flush();
+    impl_->conn.putCopyEnd();
+    copy.getresult(impl_->conn);
+  }
+  copy_java_members(impl_->conn, buf, "COPY add_java_fields FROM STDIN",
+		    batch, batch.fields);
+  copy_java_members(impl_->conn, buf, "COPY add_java_methods FROM STDIN",
+		    batch, batch.methods);
+  if (batch.member_refs.size() > 0) {
+    const java_class_batch::member_references &refs(batch.member_refs);
+    pgresult_handle copy;
+    copy.exec(impl_->conn, "COPY add_java_member_references FROM STDIN");
+    for (size_t row = 0, rows = batch.size(); row < rows; ++row) {
+      for (unsigned i = refs.begin(row), end = refs.end[row]; i < end; ++i) {
+	buf.number(row);
+	buf.separator();
+	buf.text(java_member_kind(refs.tag[i]));
+	buf.separator();
+	buf.text(batch.string(refs.class_name[i]));
+	buf.separator();
+	buf.text(batch.string(refs.name[i]));
+	buf.separator();
+	buf.text(batch.string(refs.descriptor[i]));
+	buf.end_row();
+      }
+    }
+    buf.flush();
+    impl_->conn.putCopyEnd();
+    copy.getresult(impl_->conn);
+  }
+
+  // Classes which are already known.
+  res.exec(impl_->conn, "UPDATE add_java_classes t SET class_id = jc.class_id"
+	   " FROM symboldb.java_class jc WHERE jc.digest = t.digest");
+  // New classes.  The batch can contain the same class several times
+  // (under different names in the archive).
+  res.exec(impl_->conn,
+	   "INSERT INTO symboldb.java_class"
+	   " (digest, name, super_class, access_flags,"
+	   " major_version, minor_version)"
+	   " SELECT DISTINCT ON (digest) digest, name, super_class, access_flags,"
+	   " major_version, minor_version"
+	   " FROM add_java_classes WHERE class_id IS NULL ORDER BY digest, seq");
+  res.exec(impl_->conn,
+	   "UPDATE add_java_classes t SET class_id = jc.class_id, added = TRUE"
+	   " FROM symboldb.java_class jc"
+	   " WHERE t.class_id IS NULL AND jc.digest = t.digest");
+  // Interfaces, references and members are only stored for new
+  // classes.  Malformed classes can contain duplicate members.
+  res.exec(impl_->conn,
+	   "INSERT INTO symboldb.java_interface (class_id, name)"
+	   " SELECT DISTINCT t.class_id, i.name FROM add_java_interfaces i"
+	   " JOIN add_java_classes t USING (seq) WHERE t.added");
+  res.exec(impl_->conn,
+	   "INSERT INTO symboldb.java_class_reference (class_id, name)"
+	   " SELECT DISTINCT t.class_id, r.name FROM add_java_references r"
+	   " JOIN add_java_classes t USING (seq) WHERE t.added");
+  res.exec(impl_->conn,
+	   "INSERT INTO symboldb.java_field"
+	   " (class_id, access_flags, name, descriptor)"
+	   " SELECT DISTINCT ON (t.class_id, f.name, f.descriptor)"
+	   " t.class_id, f.access_flags, f.name, f.descriptor"
+	   " FROM add_java_fields f"
+	   " JOIN add_java_classes t USING (seq) WHERE t.added");
+  res.exec(impl_->conn,
+	   "INSERT INTO symboldb.java_method"
+	   " (class_id, access_flags, name, descriptor)"
+	   " SELECT DISTINCT ON (t.class_id, m.name, m.descriptor)"
+	   " t.class_id, m.access_flags, m.name, m.descriptor"
+	   " FROM add_java_methods m"
+	   " JOIN add_java_classes t USING (seq) WHERE t.added");
+  res.exec(impl_->conn,
+	   "INSERT INTO symboldb.java_member_reference"
+	   " (class_id, kind, class_name, name, descriptor)"
+	   " SELECT DISTINCT t.class_id, r.kind, r.class_name, r.name,"
+	   " r.descriptor FROM add_java_member_references r"
+	   " JOIN add_java_classes t USING (seq) WHERE t.added");
+  // The contents can already refer to some of the classes if it is
+  // stored with more than one batch.
+  pg_query(impl_->conn, res,
+	   "INSERT INTO symboldb.java_class_contents (class_id, contents_id)"
+	   " SELECT DISTINCT class_id, $1 FROM add_java_classes t"
+	   " WHERE NOT EXISTS (SELECT 1 FROM symboldb.java_class_contents jcc"
+	   " WHERE jcc.class_id = t.class_id AND jcc.contents_id = $1)",
+	   cid.value());
+  res.exec(impl_->conn, "DROP TABLE add_java_classes, add_java_interfaces,"
+	   " add_java_references, add_java_fields, add_java_methods,"
+	   " add_java_member_references");
 }
 
 void
@@ -919,6 +1286,52 @@ void
 database::update_package_set_caches(package_set_id set)
 {
   update_elf_closure(impl_->conn, set, NULL);
+  update_elf_symbol_resolution(impl_->conn, set);
+}
+
+void
+database::write_set_snapshot(package_set_id set, const char *path)
+{
+  pgresult_handle res;
+  res.exec(impl_->conn,
+	   "BEGIN TRANSACTION ISOLATION LEVEL REPEATABLE READ READ ONLY");
+  try {
+    ::write_set_snapshot(impl_->conn, set, path);
+  } catch (...) {
+    // Do not leave the connection in the (possibly failed)
+    // transaction.
+    try {
+      res.exec(impl_->conn, "ROLLBACK");
+    } catch (pg_exception &) {
+    }
+    throw;
+  }
+  res.exec(impl_->conn, "ROLLBACK");
+}
+
+// DSO name used for grouping exported symbols.  Mirrors the soname
+// synthesis in update_elf_closure().
+#define DSO_SONAME \
+  "(COALESCE(ef.soname, regexp_replace(f.name, '^.*/', '')) COLLATE \"C\")"
+
+void
+database::dso_consumers(package_set_id set, dso_consumer_map &result)
+{
+  result.clear();
+  pgresult_handle res;
+  pg_query_binary
+    (impl_->conn, res,
+     "SELECT ef.arch::text, " DSO_SONAME ", COUNT(DISTINCT ec.file_id)"
+     " FROM symboldb.elf_closure ec"
+     " JOIN symboldb.file f ON f.file_id = ec.needed"
+     " JOIN symboldb.elf_file ef USING (contents_id)"
+     " WHERE ec.set_id = $1 GROUP BY 1, 2", set.value());
+  std::pair<std::string, std::string> key;
+  long long count;
+  for (int row = 0, end = res.ntuples(); row < end; ++row) {
+    pg_response(res, row, key.first, key.second, count);
+    result[key] = count;
+  }
 }
 
 static void
@@ -998,15 +1411,14 @@ void
 database::referenced_package_digests
   (std::vector<std::vector<unsigned char> > &digests)
 {
-  pgresult_handle res;
-  res.execBinary
-    (impl_->conn,
-     "SELECT digest FROM " PACKAGE_SET_MEMBER_TABLE
+  pg_cursor cursor(impl_->conn);
+  cursor.declare
+    ("SELECT digest FROM " PACKAGE_SET_MEMBER_TABLE
      " JOIN " PACKAGE_DIGEST_TABLE " USING (package_id)"
      " ORDER BY digest");
   std::vector<unsigned char> digest;
-  for (int i = 0, end = res.ntuples(); i < end; ++i) {
-    pg_response(res, i, digest);
+  while (cursor.next()) {
+    pg_response(cursor.result(), cursor.row(), digest);
     digests.push_back(digest);
   }
 }
@@ -1235,18 +1647,16 @@ struct database::files_with_digest::impl {
   std::tr1::shared_ptr<database::impl> impl_;
   std::vector<unsigned char> rpm_digest_;
   std::string file_name_;
-  pgresult_handle res_;
-  int row_;
+  pg_cursor cursor_;
   impl(database &, const std::vector<unsigned char> &);
 };
 
 database::files_with_digest::impl::impl
   (database &db, const std::vector<unsigned char> &digest)
-  : impl_(db.impl_), row_(0)
+  : impl_(db.impl_), cursor_(impl_->conn)
 {
-  pg_query_binary
-    (impl_->conn, res_,
-     "SELECT pd.digest, f.name"
+  cursor_.declare
+    ("SELECT pd.digest, f.name"
      " FROM symboldb.package_digest pd"
      " JOIN symboldb.file f USING (package_id)"
      " JOIN symboldb.file_contents fc USING (contents_id)"
@@ -1266,10 +1676,9 @@ database::files_with_digest::~files_with_digest()
 bool
 database::files_with_digest::next()
 {
-  if (impl_->row_ <= impl_->res_.ntuples()) {
-    pg_response(impl_->res_, impl_->row_,
+  if (impl_->cursor_.next()) {
+    pg_response(impl_->cursor_.result(), impl_->cursor_.row(),
 		impl_->rpm_digest_, impl_->file_name_);
-    ++impl_->row_;
     return true;
   }
   return false;
@@ -1286,3 +1695,177 @@ database::files_with_digest::file_name() const
 {
   return impl_->file_name_;
 }
+
+//////////////////////////////////////////////////////////////////////
+// database::files_with_build_id
+
+struct database::files_with_build_id::impl {
+  std::tr1::shared_ptr<database::impl> impl_;
+  int package_;
+  int contents_;
+  std::string nevra_;
+  std::string file_name_;
+  pgresult_handle res_;
+  int row_;
+  impl(database &, const std::vector<unsigned char> &);
+};
+
+database::files_with_build_id::impl::impl
+  (database &db, const std::vector<unsigned char> &build_id)
+  : impl_(db.impl_), package_(0), contents_(0), row_(0)
+{
+  // The index on elf_file.build_id makes this a single index probe,
+  // followed by index lookups for the file names.
+  pg_query_binary
+    (impl_->conn, res_,
+     "SELECT p.package_id, f.contents_id, symboldb.nevra(p), f.name"
+     " FROM symboldb.elf_file ef"
+     " JOIN symboldb.file f USING (contents_id)"
+     " JOIN symboldb.package p USING (package_id)"
+     " WHERE ef.build_id = $1"
+     " ORDER BY 3, 4", build_id);
+}
+
+database::files_with_build_id::files_with_build_id
+  (database &db, const std::vector<unsigned char> &build_id)
+  : impl_(new impl(db, build_id))
+{
+}
+
+database::files_with_build_id::~files_with_build_id()
+{
+}
+
+bool
+database::files_with_build_id::next()
+{
+  if (impl_->row_ < impl_->res_.ntuples()) {
+    pg_response(impl_->res_, impl_->row_, impl_->package_, impl_->contents_,
+		impl_->nevra_, impl_->file_name_);
+    ++impl_->row_;
+    return true;
+  }
+  return false;
+}
+
+database::package_id
+database::files_with_build_id::package() const
+{
+  return package_id(impl_->package_);
+}
+
+database::contents_id
+database::files_with_build_id::contents() const
+{
+  return contents_id(impl_->contents_);
+}
+
+const std::string &
+database::files_with_build_id::nevra() const
+{
+  return impl_->nevra_;
+}
+
+const std::string &
+database::files_with_build_id::file_name() const
+{
+  return impl_->file_name_;
+}
+
+//////////////////////////////////////////////////////////////////////
+// database::exported_symbols
+
+struct database::exported_symbols::impl {
+  std::tr1::shared_ptr<database::impl> impl_;
+  pg_cursor cursor_;
+  std::string arch_;
+  std::string soname_;
+  std::string name_;
+  std::string version_;
+  bool default_version_;
+  short type_;
+  impl(database &, package_set_id);
+};
+
+database::exported_symbols::impl::impl(database &db, package_set_id set)
+  : impl_(db.impl_), cursor_(impl_->conn),
+    default_version_(false), type_(0)
+{
+  // All sort keys use the "C" collation, so that clients can merge
+  // the results with plain string comparisons.
+  cursor_.declare
+    ("SELECT DISTINCT ON (1, 2, 3, 4)"
+     " ef.arch::text COLLATE \"C\", " DSO_SONAME ","
+     " ed.name, COALESCE(ed.version, ''), ed.primary_version,"
+     " ed.symbol_type"
+     " FROM symboldb.package_set_member psm"
+     " JOIN symboldb.file f USING (package_id)"
+     " JOIN symboldb.elf_file ef USING (contents_id)"
+     " JOIN symboldb.elf_definition ed USING (contents_id)"
+     " WHERE psm.set_id = $1"
+     " AND ef.e_type = 3" // ET_DYN
+     // Position-independent executables are ET_DYN, too.  Skip
+     // files with an interpreter unless they have a soname (as
+     // libc.so.6 does).
+     " AND (ef.soname IS NOT NULL OR ef.interp IS NULL)"
+     " AND ed.binding <> 0" // STB_LOCAL
+     " AND ed.visibility IN ('default', 'protected')"
+     " ORDER BY 1, 2, 3, 4, 5 DESC, 6", set.value());
+}
+
+database::exported_symbols::exported_symbols(database &db, package_set_id set)
+  : impl_(new impl(db, set))
+{
+}
+
+database::exported_symbols::~exported_symbols()
+{
+}
+
+bool
+database::exported_symbols::next()
+{
+  if (impl_->cursor_.next()) {
+    pg_response(impl_->cursor_.result(), impl_->cursor_.row(),
+		impl_->arch_, impl_->soname_, impl_->name_, impl_->version_,
+		impl_->default_version_, impl_->type_);
+    return true;
+  }
+  return false;
+}
+
+const std::string &
+database::exported_symbols::arch() const
+{
+  return impl_->arch_;
+}
+
+const std::string &
+database::exported_symbols::soname() const
+{
+  return impl_->soname_;
+}
+
+const std::string &
+database::exported_symbols::name() const
+{
+  return impl_->name_;
+}
+
+const std::string &
+database::exported_symbols::version() const
+{
+  return impl_->version_;
+}
+
+bool
+database::exported_symbols::default_version() const
+{
+  return impl_->default_version_;
+}
+
+int
+database::exported_symbols::type() const
+{
+  return impl_->type_;
+}
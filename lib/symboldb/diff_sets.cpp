@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <symboldb/diff_sets.hpp>
+#include <symboldb/database.hpp>
+#include <symboldb/options.hpp>
+
+#include <cstdio>
+
+namespace {
+  // An exported_symbols iterator positioned on its current row.
+  struct symbol_stream {
+    database::exported_symbols rows;
+    bool valid;
+
+    symbol_stream(database &db, database::package_set_id set)
+      : rows(db, set), valid(false)
+    {
+      advance();
+    }
+
+    void advance()
+    {
+      valid = rows.next();
+    }
+  };
+
+  // Compares the sort keys of the current rows, in the order used by
+  // the database.
+  int
+  compare(const database::exported_symbols &left,
+	  const database::exported_symbols &right)
+  {
+    int result = left.arch().compare(right.arch());
+    if (result == 0) {
+      result = left.soname().compare(right.soname());
+    }
+    if (result == 0) {
+      result = left.name().compare(right.name());
+    }
+    if (result == 0) {
+      result = left.version().compare(right.version());
+    }
+    return result;
+  }
+
+  long long
+  consumers(const database::dso_consumer_map &map,
+	    const database::exported_symbols &sym)
+  {
+    database::dso_consumer_map::const_iterator p
+      (map.find(std::make_pair(sym.arch(), sym.soname())));
+    if (p == map.end()) {
+      return 0;
+    }
+    return p->second;
+  }
+
+  void
+  print(FILE *out, const char *what, const database::exported_symbols &sym,
+	long long count)
+  {
+    fprintf(out, "%s\t%s\t%s\t%s\t%s\t%lld\n", what, sym.arch().c_str(),
+	    sym.soname().c_str(), sym.name().c_str(), sym.version().c_str(),
+	    count);
+  }
+}
+
+int
+symboldb_diff_sets(const symboldb_options &opt, database &db,
+		   const char *old_name, const char *new_name)
+{
+  return symboldb_diff_sets(opt, db, old_name, new_name, stdout);
+}
+
+int
+symboldb_diff_sets(const symboldb_options &opt, database &db,
+		   const char *old_name, const char *new_name, FILE *out)
+{
+  database::package_set_id old_set = db.lookup_package_set(old_name);
+  if (old_set == database::package_set_id()) {
+    fprintf(stderr, "error: invalid package set: %s\n", old_name);
+    return 1;
+  }
+  database::package_set_id new_set = db.lookup_package_set(new_name);
+  if (new_set == database::package_set_id()) {
+    fprintf(stderr, "error: invalid package set: %s\n", new_name);
+    return 1;
+  }
+
+  // The cursors require a transaction.
+  db.txn_begin();
+  database::dso_consumer_map old_consumers;
+  database::dso_consumer_map new_consumers;
+  db.dso_consumers(old_set, old_consumers);
+  db.dso_consumers(new_set, new_consumers);
+
+  // Both streams are sorted by the same key, so a single merge pass
+  // produces the difference.  Consumers are counted in the set which
+  // contains the symbol (the old set for removed symbols).
+  unsigned long long removed = 0, added = 0, changed = 0;
+  {
+    symbol_stream left(db, old_set);
+    symbol_stream right(db, new_set);
+    while (left.valid || right.valid) {
+      int cmp;
+      if (!left.valid) {
+	cmp = 1;
+      } else if (!right.valid) {
+	cmp = -1;
+      } else {
+	cmp = compare(left.rows, right.rows);
+      }
+      if (cmp < 0) {
+	print(out, "removed", left.rows, consumers(old_consumers, left.rows));
+	++removed;
+	left.advance();
+      } else if (cmp > 0) {
+	print(out, "added", right.rows, consumers(new_consumers, right.rows));
+	++added;
+	right.advance();
+      } else {
+	if (left.rows.default_version() != right.rows.default_version()
+	    || left.rows.type() != right.rows.type()) {
+	  print(out, "changed", right.rows, consumers(new_consumers, right.rows));
+	  ++changed;
+	}
+	left.advance();
+	right.advance();
+      }
+    }
+  }
+  db.txn_commit();
+
+  if (opt.output != symboldb_options::quiet) {
+    fprintf(stderr, "info: %llu removed, %llu added, %llu changed\n",
+	    removed, added, changed);
+  }
+  return 0;
+}
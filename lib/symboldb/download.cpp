@@ -21,6 +21,6 @@
 using namespace cxxll;
 
 download_options::download_options()
-  : cache_mode(check_cache)
+  : cache_mode(check_cache), prefix(0)
 {
 }
@@ -31,11 +31,16 @@
 #include <cxxll/bounded_ordered_queue.hpp>
 #include <cxxll/os.hpp>
 #include <cxxll/source_sink.hpp>
+#include <cxxll/rpm_header_hash.hpp>
+#include <cxxll/rpm_parser_exception.hpp>
+#include <cxxll/eof_exception.hpp>
+#include <cxxll/rpm_package_info.hpp>
 
 #include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <set>
+#include <utility>
 #include <vector>
 
 #include <unistd.h>
@@ -47,6 +52,7 @@ namespace {
     std::string name;
     std::string href;
     checksum csum;
+    unsigned long long header_end; // 0 if unknown
   };
 
   //////////////////////////////////////////////////////////////////////
@@ -116,6 +122,9 @@ namespace {
     // Cache bypass for RPM downloads.
     download_options dopts_no_cache_;
 
+    // Header-only downloads.  These honor --no-net.
+    download_options dopts_header_;
+
     // Called by the constructor to do the actual work.
     void process(database &);
 
@@ -128,6 +137,10 @@ namespace {
     // Called by download_url() to skip URLs already in the database.
     bool download_fast_track(database &, const rpm_url &);
 
+    // Called by download_url() to skip URLs whose RPM header is
+    // already in the database.  Only the RPM headers are downloaded.
+    bool download_header_fast_track(database &, const rpm_url &);
+
     static mutex stderr_mutex;
   };
 
@@ -140,6 +153,10 @@ namespace {
       queue_(opt.download_threads, 0), count_(0), wait_time_(0), load_(load)
   {
     dopts_no_cache_.cache_mode = download_options::no_cache;
+    dopts_header_ = opt.download();
+    if (dopts_header_.cache_mode != download_options::only_cache) {
+      dopts_header_.cache_mode = download_options::no_cache;
+    }
     process(db);
   }
 
@@ -258,6 +275,47 @@ namespace {
     return false;
   }
 
+  bool
+  downloader::download_header_fast_track(database &db, const rpm_url &url)
+  {
+    std::string header_hash;
+    try {
+      // Without a header range in the metadata, or if the server
+      // ignores the range, we stop reading after the headers.
+      download_options dopts(dopts_header_);
+      dopts.prefix = url.header_end;
+      header_hash = rpm_header_hash
+	(*download(dopts, db, url.href.c_str()));
+    } catch (curl_exception &) {
+      // Errors are reported by the regular download.
+      return false;
+    } catch (rpm_parser_exception &) {
+      return false;
+    } catch (eof_exception &) {
+      return false;
+    }
+    database::package_id pid = db.package_by_header_hash(header_hash);
+    if (pid == database::package_id()) {
+      return false;
+    }
+    if (opt_.output == symboldb_options::verbose) {
+      mutex::locker ml(&stderr_mutex);
+      fprintf(stderr, "info: skipping %s (header %s)\n",
+	      url.href.c_str(), header_hash.c_str());
+    }
+    db.txn_begin_no_sync();
+    db.add_package_url(pid, url.href.c_str());
+    // Record the digest from the repository metadata, so that
+    // download_fast_track() recognizes this representation next time.
+    if (url.csum.length != checksum::no_length && url.csum.length > 0) {
+      db.add_package_digest(pid, url.csum.value, url.csum.length);
+    }
+    db.txn_commit();
+    mutex::locker ml(&mutex_);
+    pids_.insert(pid);
+    return true;
+  }
+
   void
   downloader::download_url(database &db, file_cache &fcache, const rpm_url &url)
   {
@@ -270,6 +328,10 @@ namespace {
     to_load.url = url.href;
     to_load.csum = url.csum;
     to_load.download = !fcache.lookup_path(url.csum, to_load.rpm_path);
+    if (to_load.download && opt_.header_fast_track
+	&& download_header_fast_track(db, url)) {
+      return;
+    }
     if (to_load.download) {
       if (opt_.output != symboldb_options::quiet) {
 	mutex::locker ml(&stderr_mutex);
@@ -312,6 +374,65 @@ namespace {
     }
   }
 
+  //////////////////////////////////////////////////////////////////////
+  // Reading the package list
+
+  typedef std::vector<std::pair<rpm_package_info, rpm_url> > package_list;
+
+  // PRIMARY is a repomd::primary or repomd::primary_db object.
+  template <class Primary> void
+  add_packages(Primary &primary, package_list &packages)
+  {
+    while (primary.next()) {
+      rpm_url rurl;
+      rurl.name = primary.info().name;
+      rurl.href = primary.href();
+      rurl.csum = primary.checksum();
+      rurl.header_end = primary.header_end();
+      packages.push_back(std::make_pair(primary.info(), rurl));
+    }
+  }
+
+  void
+  add_packages(const package_list &packages,
+	       package_set_consolidator<rpm_url> &pset)
+  {
+    for (package_list::const_iterator p = packages.begin(),
+	   end = packages.end(); p != end; ++p) {
+      pset.add(p->first, p->second);
+    }
+  }
+
+  // Reads the package list from the SQLite version of the primary
+  // metadata.  Returns false (and adds nothing to PSET) if this
+  // fails, so that the caller can fall back to the XML version.
+  bool
+  add_packages_db(const symboldb_options &opt, database &db,
+		  const repomd &rp, package_set_consolidator<rpm_url> &pset)
+  {
+    package_list packages;
+    try {
+      repomd::primary_xml compressed
+	(rp, opt.download_always_cache(), db, "primary_db");
+      repomd::primary_db primary(&compressed, rp.base_url.c_str());
+      add_packages(primary, packages);
+    } catch (curl_exception &e) {
+      if (opt.output != symboldb_options::quiet) {
+	dump("warning: ", e, stderr);
+	fprintf(stderr, "warning: falling back to XML metadata\n");
+      }
+      return false;
+    } catch (std::exception &e) {
+      if (opt.output != symboldb_options::quiet) {
+	fprintf(stderr, "warning: %s: %s\n", rp.base_url.c_str(), e.what());
+	fprintf(stderr, "warning: falling back to XML metadata\n");
+      }
+      return false;
+    }
+    add_packages(packages, pset);
+    return true;
+  }
+
 } // anonymous namespace
 
 int
@@ -337,15 +458,15 @@ symboldb_download_repo(const symboldb_options &opt, database &db,
     }
     repomd rp;
     rp.acquire(opt.download(), db, url);
+    if (repomd::primary_xml::available(rp, "primary_db")
+	&& add_packages_db(opt, db, rp, pset)) {
+      continue;
+    }
     repomd::primary_xml primary_xml(rp, opt.download_always_cache(), db);
     repomd::primary primary(&primary_xml, rp.base_url.c_str());
-    while (primary.next()) {
-      rpm_url rurl;
-      rurl.name = primary.info().name;
-      rurl.href = primary.href();
-      rurl.csum = primary.checksum();
-      pset.add(primary.info(), rurl);
-    }
+    package_list packages;
+    add_packages(primary, packages);
+    add_packages(packages, pset);
   }
 
   std::vector<rpm_url> urls(pset.values());
@@ -97,8 +97,12 @@ download(const download_options &opt, database &db,
     }
     break;
   case download_options::no_cache:
-    return std::tr1::shared_ptr<cxxll::source>(new url_source(url));
+    break;
   case download_options::check_cache:
+    if (opt.prefix > 0) {
+      // The cache cannot be validated without a full request.
+      break;
+    }
     {
       std::tr1::shared_ptr<cxxll::url_source> net(new url_source(url));
       net->connect();
@@ -113,5 +117,13 @@ download(const download_options &opt, database &db,
     }
   }
 
+  if (opt.prefix > 0) {
+    std::tr1::shared_ptr<url_source> net(new url_source(url));
+    net->range(0, opt.prefix - 1);
+    return net;
+  }
+  if (opt.cache_mode == download_options::no_cache) {
+    return std::tr1::shared_ptr<cxxll::source>(new url_source(url));
+  }
   return std::tr1::shared_ptr<cxxll::source>(new download_source(db, url));
 }
@@ -24,9 +24,10 @@
 using namespace cxxll;
 
 symboldb_options::symboldb_options()
-  : output(standard), download_threads(3),
+  : output(standard), download_threads(3), load_threads(1),
     no_net(false), ignore_download_errors(false), randomize(false),
-    transient_rpms(false)
+    transient_rpms(false), header_fast_track(false),
+    elf_symbols(elf_image::all_symbols)
 {
 }
 
@@ -46,6 +47,17 @@ symboldb_options::add_exclude_name(const char *pattern)
   exclude_names_.push_back(pattern);
 }
 
+void
+symboldb_options::set_elf_symbols(const char *selection)
+{
+  try {
+    elf_symbols = elf_image::symbol_selection_from_string(selection);
+  } catch (std::runtime_error &) {
+    throw usage_error("invalid --elf-symbols value \"" + quote(selection)
+		      + "\" (expected \"dynsym\", \"global\" or \"all\")");
+  }
+}
+
 regex_handle
 symboldb_options::exclude_name() const
 {
@@ -18,25 +18,89 @@
 
 #include <symboldb/repomd.hpp>
 #include <cxxll/expat_source.hpp>
+#include <cxxll/const_stringref.hpp>
 #include <cxxll/string_support.hpp>
 #include <cxxll/checksum.hpp>
 #include <cxxll/url.hpp>
 #include <cxxll/raise.hpp>
 
+#include <cstring>
+
 using namespace cxxll;
 
+namespace {
+  // Element names recognized by the primary.xml parser.  Elements
+  // are identified by these numbers to avoid string copies.
+  enum element_id {
+    E_OTHER,
+    E_METADATA,
+    E_PACKAGE,
+    E_NAME,
+    E_ARCH,
+    E_VERSION,
+    E_CHECKSUM,
+    E_SIZE,
+    E_LOCATION,
+    E_FORMAT,
+    E_SOURCERPM,
+    E_HEADER_RANGE
+  };
+
+  struct element_name {
+    const char *name;
+    size_t length;
+    element_id id;
+  };
+
+#define ELEMENT(name, id) {name, sizeof(name) - 1, id}
+  const element_name element_names[] = {
+    ELEMENT("metadata", E_METADATA),
+    ELEMENT("package", E_PACKAGE),
+    ELEMENT("name", E_NAME),
+    ELEMENT("arch", E_ARCH),
+    ELEMENT("version", E_VERSION),
+    ELEMENT("checksum", E_CHECKSUM),
+    ELEMENT("size", E_SIZE),
+    ELEMENT("location", E_LOCATION),
+    ELEMENT("format", E_FORMAT),
+    ELEMENT("rpm:sourcerpm", E_SOURCERPM),
+    ELEMENT("rpm:header-range", E_HEADER_RANGE),
+  };
+#undef ELEMENT
+
+  element_id
+  intern_element(const_stringref name)
+  {
+    const element_name *end = element_names
+      + sizeof(element_names) / sizeof(element_names[0]);
+    for (const element_name *p = element_names; p != end; ++p) {
+      if (p->length == name.size()
+	  && memcmp(p->name, name.data(), p->length) == 0) {
+	return p->id;
+      }
+    }
+    return E_OTHER;
+  }
+}
+
 struct repomd::primary::impl {
   expat_source source_;
   std::string base_url_;
   rpm_package_info info_;
   std::string href_;
   cxxll::checksum checksum_;
+  unsigned long long header_end_;
+
+  // Scratch buffers, reused across packages.
+  std::string attr1_;
+  std::string attr2_;
+  std::string text_;
 
   impl(source *src, const char *base_url)
     : source_(src), base_url_(base_url)
   {
     source_.next();
-    if (source_.name() != "metadata") {
+    if (intern_element(source_.name_ref()) != E_METADATA) {
       // FIXME: proper exception
       raise<std::runtime_error>("invalid root element: " + source_.name());
     }
@@ -56,6 +120,7 @@ struct repomd::primary::impl {
     checksum_.type = hash_sink::sha256;
     checksum_.value.clear();
     checksum_.length = checksum::no_length;
+    header_end_ = 0;
   }
 
   void validate()
@@ -79,6 +144,18 @@ struct repomd::primary::impl {
 
   void check_attr(const char *name, const std::string &);
 
+  // Copies the attribute value to TARGET, reusing its storage.
+  // Missing attributes result in an empty string.
+  void attribute(const char *name, std::string &target)
+  {
+    const char *value = source_.attribute_ptr(name);
+    if (value == NULL) {
+      target.clear();
+    } else {
+      target.assign(value);
+    }
+  }
+
   bool next()
   {
     clear();
@@ -87,7 +164,7 @@ struct repomd::primary::impl {
       if (source_.state() == expat_source::END) {
 	return false;
       } else if (source_.state() == expat_source::START
-		 && source_.name() == "package") {
+		 && intern_element(source_.name_ref()) == E_PACKAGE) {
 	break;
       } else {
 	source_.skip();
@@ -95,10 +172,13 @@ struct repomd::primary::impl {
     }
 
     // At <package>.
-    if (source_.attribute("type") != "rpm") {
-      // FIXME: proper exception
-      raise<std::runtime_error>("invalid package type: "
-			       + source_.attribute("type"));
+    {
+      const char *type = source_.attribute_ptr("type");
+      if (type == NULL || strcmp(type, "rpm") != 0) {
+	// FIXME: proper exception
+	raise<std::runtime_error>(std::string("invalid package type: ")
+				  + (type == NULL ? "" : type));
+      }
     }
     source_.next();
 
@@ -109,42 +189,54 @@ struct repomd::primary::impl {
 	source_.skip();
 	continue;
       }
-      std::string tag(source_.name());
-      if (tag == "name") {
+      switch (intern_element(source_.name_ref())) {
+      case E_NAME:
 	source_.next();
-	info_.name = source_.text_and_next();
+	source_.text_and_next(info_.name);
 	source_.unnest();
-      } else if (tag == "arch") {
+	break;
+      case E_ARCH:
 	source_.next();
-	info_.arch = source_.text_and_next();
+	source_.text_and_next(info_.arch);
 	source_.unnest();
-      } else if (tag == "version") {
+	break;
+      case E_VERSION:
 	process_version();
-      } else if (tag == "checksum") {
-	std::string type(source_.attribute("type"));
+	break;
+      case E_CHECKSUM:
+	attribute("type", attr1_);
 	source_.next();
+	source_.text_and_next(text_);
 	// FIXME: proper exception
-	checksum_.set_hexadecimal(type.c_str(), checksum_.length,
-				  source_.text_and_next().c_str());
+	checksum_.set_hexadecimal(attr1_.c_str(), checksum_.length,
+				  text_.c_str());
 	source_.unnest();
-      } else if (tag == "size") {
+	break;
+      case E_SIZE:
+	attribute("package", attr1_);
 	// FIXME: proper exception
-	parse_unsigned_long_long(source_.attribute("package"),
-				 checksum_.length);
+	parse_unsigned_long_long(attr1_, checksum_.length);
 	source_.skip();
-      } else if (tag == "location") {
-	std::string xmlbase(source_.attribute("xml:base"));
-	if (xmlbase.empty()) {
-	  href_ = url_combine_yum(base_url_.c_str(),
-				  source_.attribute("href").c_str());
-	} else {
-	  href_ = url_combine_yum(xmlbase.c_str(),
-				  source_.attribute("href").c_str());
+	break;
+      case E_LOCATION:
+	{
+	  const char *xmlbase = source_.attribute_ptr("xml:base");
+	  const char *href = source_.attribute_ptr("href");
+	  if (href == NULL) {
+	    href = "";
+	  }
+	  if (xmlbase == NULL || *xmlbase == '\0') {
+	    href_ = url_combine_yum(base_url_.c_str(), href);
+	  } else {
+	    href_ = url_combine_yum(xmlbase, href);
+	  }
 	}
 	source_.skip();
-      } else if (tag == "format") {
+	break;
+      case E_FORMAT:
 	process_format();
-      } else {
+	break;
+      default:
 	source_.skip();
       }
     }
@@ -156,11 +248,14 @@ struct repomd::primary::impl {
 
   void process_version()
   {
-    info_.version = strip(source_.attribute("ver"));
-    info_.release = strip(source_.attribute("rel"));
+    attribute("ver", info_.version);
+    strip_inplace(info_.version);
+    attribute("rel", info_.release);
+    strip_inplace(info_.release);
     unsigned long long epoch;
-    std::string epochstr(strip(source_.attribute("epoch")));
-    if (!parse_unsigned_long_long(epochstr, epoch)
+    attribute("epoch", attr1_);
+    strip_inplace(attr1_);
+    if (!parse_unsigned_long_long(attr1_, epoch)
 	|| epoch != (static_cast<unsigned long long>
 		     (static_cast<int>(epoch)))) {
       // FIXME: proper exception
@@ -181,13 +276,29 @@ struct repomd::primary::impl {
 	source_.skip();
 	continue;
       }
-      if (source_.name() == "rpm:sourcerpm") {
+      switch (intern_element(source_.name_ref())) {
+      case E_SOURCERPM:
 	source_.next();
 	if (source_.state() == expat_source::TEXT) {
-	  info_.source_rpm = source_.text_and_next();
+	  source_.text_and_next(info_.source_rpm);
 	}
 	source_.unnest();
-      } else {
+	break;
+      case E_HEADER_RANGE:
+	{
+	  unsigned long long start;
+	  unsigned long long end;
+	  attribute("start", attr1_);
+	  attribute("end", attr2_);
+	  if (parse_unsigned_long_long(attr1_, start)
+	      && parse_unsigned_long_long(attr2_, end)
+	      && start < end) {
+	    header_end_ = end;
+	  }
+	}
+	source_.skip();
+	break;
+      default:
 	source_.skip();
       }
     }
@@ -239,3 +350,9 @@ repomd::primary::href() const
 {
   return impl_->href_;
 }
+
+unsigned long long
+repomd::primary::header_end() const
+{
+  return impl_->header_end_;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <symboldb/repomd.hpp>
+#include <cxxll/string_support.hpp>
+#include <cxxll/checksum.hpp>
+#include <cxxll/url.hpp>
+#include <cxxll/raise.hpp>
+#include <cxxll/fd_handle.hpp>
+#include <cxxll/fd_sink.hpp>
+#include <cxxll/source_sink.hpp>
+#include <cxxll/temporary_directory.hpp>
+
+#include <stdexcept>
+
+#include <fcntl.h>
+
+#include <sqlite3.h>
+
+using namespace cxxll;
+
+namespace {
+  // Column numbers in the result of the query below.
+  enum {
+    C_NAME,
+    C_ARCH,
+    C_EPOCH,
+    C_VERSION,
+    C_RELEASE,
+    C_SOURCERPM,
+    C_CHECKSUM_TYPE,
+    C_CHECKSUM,
+    C_SIZE,
+    C_LOCATION_BASE,
+    C_LOCATION_HREF,
+    C_HEADER_START,
+    C_HEADER_END
+  };
+
+  const char QUERY[] =
+    "SELECT name, arch, epoch, version, release, rpm_sourcerpm,"
+    " checksum_type, pkgId, size_package, location_base, location_href,"
+    " rpm_header_start, rpm_header_end"
+    " FROM packages ORDER BY pkgKey";
+}
+
+struct repomd::primary_db::impl {
+  std::string path_;
+  std::string base_url_;
+  sqlite3 *db_;
+  sqlite3_stmt *stmt_;
+  rpm_package_info info_;
+  std::string href_;
+  cxxll::checksum checksum_;
+  unsigned long long header_end_;
+
+  // Holds the database file if it was copied from a source.
+  std::tr1::shared_ptr<temporary_directory> tempdir_;
+
+  // Scratch buffers, reused across packages.
+  std::string text1_;
+  std::string text2_;
+
+  impl(const char *path, const char *base_url)
+    : path_(path), base_url_(base_url), db_(NULL), stmt_(NULL)
+  {
+    int ret = sqlite3_open_v2(path, &db_, SQLITE_OPEN_READONLY, NULL);
+    if (ret == SQLITE_OK) {
+      ret = sqlite3_prepare_v2(db_, QUERY, sizeof(QUERY), &stmt_, NULL);
+    }
+    if (ret != SQLITE_OK) {
+      // The destructor does not run if the constructor throws.
+      std::string msg(error_message());
+      sqlite3_finalize(stmt_);
+      sqlite3_close(db_);
+      raise<std::runtime_error>(msg);
+    }
+  }
+
+  ~impl()
+  {
+    sqlite3_finalize(stmt_);
+    sqlite3_close(db_);
+  }
+
+  std::string error_message() const;
+
+  // Copies the column value to TARGET.  NULL values result in an
+  // empty string.
+  void column(int col, std::string &target)
+  {
+    const unsigned char *value = sqlite3_column_text(stmt_, col);
+    if (value == NULL) {
+      target.clear();
+    } else {
+      target.assign(reinterpret_cast<const char *>(value),
+		    sqlite3_column_bytes(stmt_, col));
+    }
+  }
+
+  void check_column(const char *name, const std::string &);
+
+  bool next()
+  {
+    switch (sqlite3_step(stmt_)) {
+    case SQLITE_ROW:
+      break;
+    case SQLITE_DONE:
+      return false;
+    default:
+      raise<std::runtime_error>(error_message());
+    }
+
+    column(C_NAME, info_.name);
+    if (info_.name.empty()) {
+      // FIXME: proper exception
+      raise<std::runtime_error>(path_ + ": missing package name");
+    }
+    column(C_ARCH, info_.arch);
+    check_column("arch", info_.arch);
+    column(C_VERSION, info_.version);
+    strip_inplace(info_.version);
+    column(C_RELEASE, info_.release);
+    strip_inplace(info_.release);
+    {
+      // Same treatment of invalid epochs as in the primary.xml parser.
+      unsigned long long epoch;
+      column(C_EPOCH, text1_);
+      strip_inplace(text1_);
+      if (!parse_unsigned_long_long(text1_, epoch)
+	  || epoch != (static_cast<unsigned long long>
+		       (static_cast<int>(epoch)))) {
+	info_.version.clear();
+	info_.epoch = -1;
+      } else {
+	info_.epoch = epoch;
+      }
+    }
+    check_column("version", info_.version);
+    column(C_SOURCERPM, info_.source_rpm);
+    info_.hash.clear();
+
+    column(C_CHECKSUM_TYPE, text1_);
+    column(C_CHECKSUM, text2_);
+    check_column("pkgId", text2_);
+    if (sqlite3_column_type(stmt_, C_SIZE) == SQLITE_NULL) {
+      // FIXME: proper exception
+      raise<std::runtime_error>(path_ + ": missing size_package column"
+				" in package: " + info_.name);
+    }
+    // FIXME: proper exception
+    checksum_.set_hexadecimal(text1_.c_str(),
+			      sqlite3_column_int64(stmt_, C_SIZE),
+			      text2_.c_str());
+
+    column(C_LOCATION_BASE, text1_);
+    column(C_LOCATION_HREF, text2_);
+    check_column("location_href", text2_);
+    if (text1_.empty()) {
+      href_ = url_combine_yum(base_url_.c_str(), text2_.c_str());
+    } else {
+      href_ = url_combine_yum(text1_.c_str(), text2_.c_str());
+    }
+
+    sqlite3_int64 start = sqlite3_column_int64(stmt_, C_HEADER_START);
+    sqlite3_int64 end = sqlite3_column_int64(stmt_, C_HEADER_END);
+    if (start >= 0 && start < end) {
+      header_end_ = end;
+    } else {
+      header_end_ = 0;
+    }
+    return true;
+  }
+};
+
+std::string
+repomd::primary_db::impl::error_message() const
+{
+  std::string msg(path_);
+  msg += ": ";
+  if (db_ == NULL) {
+    msg += "could not open database";
+  } else {
+    msg += sqlite3_errmsg(db_);
+  }
+  return msg;
+}
+
+void
+repomd::primary_db::impl::check_column(const char *name,
+				       const std::string &value)
+{
+  if (value.empty()) {
+    std::string msg(path_);
+    msg += ": missing ";
+    msg += name;
+    msg += " column in package: ";
+    msg += info_.name;
+    raise<std::runtime_error>(msg); // FIXME
+  }
+}
+
+repomd::primary_db::primary_db(const char *path, const char *base_url)
+  : impl_(new impl(path, base_url))
+{
+}
+
+repomd::primary_db::primary_db(source *src, const char *base_url)
+{
+  std::tr1::shared_ptr<temporary_directory> dir(new temporary_directory);
+  std::string path(dir->path("primary.sqlite"));
+  {
+    fd_handle fd;
+    fd.open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    fd_sink sink(fd.get());
+    copy_source_to_sink(*src, sink);
+    fd.close();
+  }
+  impl_.reset(new impl(path.c_str(), base_url));
+  impl_->tempdir_ = dir;
+}
+
+repomd::primary_db::~primary_db()
+{
+}
+
+bool
+repomd::primary_db::next()
+{
+  return impl_->next();
+}
+
+const rpm_package_info &
+repomd::primary_db::info() const
+{
+  return impl_->info_;
+}
+
+const checksum &
+repomd::primary_db::checksum() const
+{
+  return impl_->checksum_;
+}
+
+const std::string &
+repomd::primary_db::href() const
+{
+  return impl_->href_;
+}
+
+unsigned long long
+repomd::primary_db::header_end() const
+{
+  return impl_->header_end_;
+}
@@ -20,6 +20,8 @@
 #include <symboldb/download.hpp>
 #include <cxxll/memory_range_source.hpp>
 #include <cxxll/gunzip_source.hpp>
+#include <cxxll/xz_source.hpp>
+#include <cxxll/zstd_source.hpp>
 #include <cxxll/string_support.hpp>
 #include <cxxll/url.hpp>
 #include <cxxll/curl_exception.hpp>
@@ -31,31 +33,89 @@
 
 using namespace cxxll;
 
+namespace {
+  enum compression {
+    unsupported_compression,
+    gzip_compression,
+    zstd_compression,
+    xz_compression
+  };
+
+  // Determines the compression format of a metadata file from the
+  // file name suffix.
+  compression
+  href_compression(const std::string &href)
+  {
+    if (ends_with(href, ".gz")) {
+      return gzip_compression;
+    } else if (ends_with(href, ".zst")) {
+      return zstd_compression;
+    } else if (ends_with(href, ".xz")) {
+      return xz_compression;
+    }
+    return unsupported_compression;
+  }
+
+  // Returns the first TYPE entry in a supported format, or NULL.
+  const repomd::entry *
+  find_entry(const repomd &rp, const char *type)
+  {
+    for (std::vector<repomd::entry>::const_iterator p = rp.entries.begin(),
+	   end = rp.entries.end(); p != end; ++p) {
+      if (p->type == type
+	  && href_compression(p->href) != unsupported_compression) {
+	return &*p;
+      }
+    }
+    return NULL;
+  }
+
+  std::tr1::shared_ptr<source>
+  decompressor(compression comp, source *compressed)
+  {
+    std::tr1::shared_ptr<source> result;
+    switch (comp) {
+    case gzip_compression:
+      result.reset(new gunzip_source(compressed));
+      break;
+    case zstd_compression:
+      result.reset(new zstd_source(compressed));
+      break;
+    case xz_compression:
+      result.reset(new xz_source(compressed));
+      break;
+    case unsupported_compression:
+      break;
+    }
+    return result;
+  }
+}
+
 struct repomd::primary_xml::impl {
   std::string url_;
   std::tr1::shared_ptr<source> compressed_;
-  gunzip_source gzsource_;
+  std::tr1::shared_ptr<source> decompressed_;
   hash_sink hash_;
   checksum expected_;
 
   impl(const std::string &url, const checksum &expected,
-       std::tr1::shared_ptr<source> compressed)
-    : url_(url), compressed_(compressed),
-      gzsource_(compressed_.get()), hash_(expected.type),
-      expected_(expected)
+       std::tr1::shared_ptr<source> compressed,
+       std::tr1::shared_ptr<source> decompressed)
+    : url_(url), compressed_(compressed), decompressed_(decompressed),
+      hash_(expected.type), expected_(expected)
   {
   }
 
   size_t
   read(unsigned char *buf, size_t len)
   {
-    size_t ret = gzsource_.read(buf, len);
+    size_t ret = decompressed_->read(buf, len);
     if (ret == 0) {
       // All data has been read.  Check the digest.
       std::vector<unsigned char> digest;
       hash_.digest(digest);
       if (digest != expected_.value) {
-	std::string msg("compressed data does not match ");
+	std::string msg("decompressed data does not match ");
 	msg += hash_sink::to_string(expected_.type);
 	msg += " checksum (actual ";
 	msg += base16_encode(digest.begin(), digest.end());
@@ -75,29 +135,51 @@ struct repomd::primary_xml::impl {
 repomd::primary_xml::primary_xml(const repomd &rp,
 				 const download_options &opt, database &db)
 {
-  for (std::vector<repomd::entry>::const_iterator p = rp.entries.begin(),
-	 end = rp.entries.end(); p != end; ++p) {
-    if (p->type == "primary" && ends_with(p->href, ".xml.gz")) {
-      download_options dopt(opt);
-      {
-	// Check the cache for staleness if the file name does not
-	// contain the hash.
-	std::string digest
-	  (base16_encode(p->checksum.value.begin(), p->checksum.value.end()));
-	if ((digest.empty() || p->href.find(digest) == std::string::npos)
-	    && dopt.cache_mode == download_options::always_cache) {
-	  dopt.cache_mode = download_options::check_cache;
-	}
-      }
-      std::string entry_url(url_combine_yum(rp.base_url.c_str(), p->href.c_str()));
-      std::tr1::shared_ptr<source> compressed =
-	download(dopt, db, entry_url.c_str());
-      impl_.reset(new impl(entry_url, p->checksum, compressed));
-      return;
+  init(rp, opt, db, "primary");
+}
+
+repomd::primary_xml::primary_xml(const repomd &rp,
+				 const download_options &opt, database &db,
+				 const char *type)
+{
+  init(rp, opt, db, type);
+}
+
+bool
+repomd::primary_xml::available(const repomd &rp, const char *type)
+{
+  return find_entry(rp, type) != NULL;
+}
+
+void
+repomd::primary_xml::init(const repomd &rp,
+			  const download_options &opt, database &db,
+			  const char *type)
+{
+  const repomd::entry *p = find_entry(rp, type);
+  if (p == NULL) {
+    // FIXME: use a more specific exception
+    raise<std::runtime_error>(rp.base_url + ": could not find " + type);
+  }
+  compression comp = href_compression(p->href);
+  download_options dopt(opt);
+  {
+    // Check the cache for staleness if the file name does not
+    // contain the hash.
+    std::string digest
+      (base16_encode(p->checksum.value.begin(), p->checksum.value.end()));
+    if ((digest.empty() || p->href.find(digest) == std::string::npos)
+	&& dopt.cache_mode == download_options::always_cache) {
+      dopt.cache_mode = download_options::check_cache;
     }
   }
-  // FIXME: use a more specific exception
-  raise<std::runtime_error>(rp.base_url + ": could not find primary.xml");
+  std::string entry_url(url_combine_yum(rp.base_url.c_str(), p->href.c_str()));
+  std::tr1::shared_ptr<source> compressed =
+    download(dopt, db, entry_url.c_str());
+  // The digest is computed over the decompressed data, so it has
+  // to be checked against the open checksum.
+  impl_.reset(new impl(entry_url, p->open_checksum, compressed,
+		       decompressor(comp, compressed.get())));
 }
 
 repomd::primary_xml::~primary_xml()
@@ -24,8 +24,7 @@
 #include <symboldb/options.hpp>
 #include <cxxll/elf_exception.hpp>
 #include <cxxll/elf_image.hpp>
-#include <cxxll/elf_symbol_definition.hpp>
-#include <cxxll/elf_symbol_reference.hpp>
+#include <cxxll/elf_symbol_batch.hpp>
 #include <cxxll/fd_handle.hpp>
 #include <cxxll/fd_source.hpp>
 #include <cxxll/hash.hpp>
@@ -40,18 +39,29 @@
 #include <cxxll/tee_sink.hpp>
 #include <cxxll/base16.hpp>
 #include <cxxll/java_class.hpp>
+#include <cxxll/java_class_batch.hpp>
+#include <cxxll/java_class_results.hpp>
 #include <cxxll/zip_file.hpp>
 #include <cxxll/os_exception.hpp>
 #include <cxxll/python_analyzer.hpp>
+#include <cxxll/python_scanner.hpp>
 #include <cxxll/string_support.hpp>
 #include <cxxll/vector_source.hpp>
 #include <cxxll/expat_source.hpp>
 #include <cxxll/maven_url.hpp>
 #include <cxxll/looks_like_xml.hpp>
 #include <cxxll/raise.hpp>
+#include <cxxll/task.hpp>
+#include <cxxll/mutex.hpp>
+#include <cxxll/cond.hpp>
+#include <cxxll/bounded_ordered_queue.hpp>
 
+#include <deque>
 #include <map>
+#include <set>
 #include <sstream>
+#include <tr1/functional>
+#include <tr1/memory>
 
 #include <cassert>
 #include <cstdio>
@@ -63,35 +73,35 @@
 
 using namespace cxxll;
 
-static void
-dump_def(const symboldb_options &opt, database &db,
-	 database::contents_id cid, const char *elf_path,
-	 const elf_symbol_definition &def)
-{
-  if (def.symbol_name.empty()) {
-    return;
-  }
-  if (opt.output == symboldb_options::verbose) {
-    fprintf(stderr, "%s DEF %s %s 0x%llx%s\n",
-	    elf_path, def.symbol_name.c_str(), def.vda_name.c_str(),
-	    def.value, def.default_version ? " [default]" : "");
-  }
-  db.add_elf_symbol_definition(cid, def);
+namespace {
+  // A database update recorded during the analysis of a file, to be
+  // applied later by the thread which owns the database connection.
+  typedef std::tr1::function<void(database &, database::contents_id)>
+    db_action;
+  typedef std::vector<db_action> db_actions;
 }
 
+// Prints the symbols in the batch (for verbose output).
 static void
-dump_ref(const symboldb_options &opt, database &db,
-	 database::contents_id cid, const char *elf_path,
-	 const elf_symbol_reference &ref)
+dump_symbols(const std::string &elf_path,
+	     std::tr1::shared_ptr<elf_symbol_batch> batch,
+	     database &, database::contents_id)
 {
-  if (ref.symbol_name.empty()) {
-    return;
+  const elf_symbol_batch::definitions &defs(batch->defs);
+  for (size_t i = 0, end = defs.size(); i < end; ++i) {
+    const char *version = batch->string(defs.version[i]);
+    fprintf(stderr, "%s DEF %s %s 0x%llx%s\n",
+	    elf_path.c_str(), batch->string(defs.name[i]),
+	    version ? version : "",
+	    defs.value[i], defs.default_version[i] ? " [default]" : "");
   }
-  if (opt.output == symboldb_options::verbose) {
+  const elf_symbol_batch::symbols &refs(batch->refs);
+  for (size_t i = 0, end = refs.size(); i < end; ++i) {
+    const char *version = batch->string(refs.version[i]);
     fprintf(stderr, "%s REF %s %s\n",
-	    elf_path, ref.symbol_name.c_str(), ref.vna_name.c_str());
+	    elf_path.c_str(), batch->string(refs.name[i]),
+	    version ? version : "");
   }
-  db.add_elf_symbol_reference(cid, ref);
 }
 
 // Locks the package digest in the database.  Used to prevent
@@ -113,36 +123,69 @@ is_elf(const std::vector<unsigned char> data)
     && data.at(3) == 'F';
 }
 
-// Loads an ELF image.
+// Adapters from db_action to the database member functions.
+
 static void
-load_elf(const symboldb_options &opt, database &db,
-	 database::contents_id cid, const rpm_file_entry &file)
+store_elf_symbols(std::tr1::shared_ptr<elf_symbol_batch> batch,
+		  database &db, database::contents_id cid)
 {
-  try {
-    // Used for error reporting.
-    const char *elf_path = file.infos.front().name.c_str();
+  db.add_elf_symbols(cid, *batch);
+}
+
+static void
+store_elf_string(void (database::*add)(database::contents_id, const char *),
+		 const std::string &str,
+		 database &db, database::contents_id cid)
+{
+  (db.*add)(cid, str.c_str());
+}
+
+static void
+store_elf_dynamic(unsigned long long tag, unsigned long long number,
+		  database &db, database::contents_id cid)
+{
+  db.add_elf_dynamic(cid, tag, number);
+}
+
+static void
+store_elf_image(std::tr1::shared_ptr<elf_image> image,
+		bool soname_seen, const std::string &soname,
+		elf_image::symbol_selection symbols,
+		database &db, database::contents_id cid)
+{
+  db.add_elf_image(cid, *image, soname_seen ? soname.c_str() : NULL,
+		   symbols);
+}
 
-    elf_image image(file.contents.data(), file.contents.size());
+// Analyzes an ELF image.  The image refers to FILE, which has to
+// outlive the recorded actions.
+static void
+load_elf(const symboldb_options &opt, const rpm_file_entry &file,
+	 db_actions &actions)
+{
+  using std::tr1::bind;
+  using namespace std::tr1::placeholders;
+  try {
+    std::tr1::shared_ptr<elf_image> image
+      (new elf_image(file.contents.data(), file.contents.size()));
     {
-      elf_image::symbol_range symbols(image);
-      while (symbols.next()) {
-	if (symbols.definition()) {
-	  dump_def(opt, db, cid, elf_path, *symbols.definition());
-	} else if (symbols.reference()) {
-	  dump_ref(opt, db, cid, elf_path, *symbols.reference());
-	} else {
-	  raise<std::logic_error>("unknown elf_symbol type");
-	}
+      std::tr1::shared_ptr<elf_symbol_batch> batch(new elf_symbol_batch);
+      image->symbols(*batch, opt.elf_symbols);
+      if (opt.output == symboldb_options::verbose) {
+	actions.push_back(bind(dump_symbols, file.infos.front().name,
+			       batch, _1, _2));
       }
+      actions.push_back(bind(store_elf_symbols, batch, _1, _2));
     }
     std::string soname;
     bool soname_seen = false;
     {
-      elf_image::dynamic_section_range dyn(image);
+      elf_image::dynamic_section_range dyn(*image);
       while (dyn.next()) {
 	switch (dyn.type()) {
 	case elf_image::dynamic_section_range::needed:
-	  db.add_elf_needed(cid, dyn.text().c_str());
+	  actions.push_back(bind(store_elf_string, &database::add_elf_needed,
+				 dyn.text(), _1, _2));
 	  break;
 	case elf_image::dynamic_section_range::soname:
 	  if (soname_seen) {
@@ -152,7 +195,9 @@ load_elf(const symboldb_options &opt, database &db,
 	      std::ostringstream out;
 	      out << "duplicate soname ignored: " << dyn.text()
 		  << ", previous soname: " << soname;
-	      db.add_elf_error(cid, out.str().c_str());
+	      actions.push_back(bind(store_elf_string,
+				     &database::add_elf_error,
+				     out.str(), _1, _2));
 	    }
 	  } else {
 	    soname = dyn.text();
@@ -160,10 +205,12 @@ load_elf(const symboldb_options &opt, database &db,
 	  }
 	  break;
 	case elf_image::dynamic_section_range::rpath:
-	  db.add_elf_rpath(cid, dyn.text().c_str());
+	  actions.push_back(bind(store_elf_string, &database::add_elf_rpath,
+				 dyn.text(), _1, _2));
 	  break;
 	case elf_image::dynamic_section_range::runpath:
-	  db.add_elf_runpath(cid, dyn.text().c_str());
+	  actions.push_back(bind(store_elf_string, &database::add_elf_runpath,
+				 dyn.text(), _1, _2));
 	  break;
 	case elf_image::dynamic_section_range::other:
 	  {
@@ -171,7 +218,8 @@ load_elf(const symboldb_options &opt, database &db,
 	    long long number = dyn.number();
 	    // Skip NULL entries.
 	    if (tag != 0 || number != 0) {
-	      db.add_elf_dynamic(cid, dyn.tag(), dyn.number());
+	      actions.push_back(bind(store_elf_dynamic,
+				     dyn.tag(), dyn.number(), _1, _2));
 	    }
 	  }
 	  break;
@@ -180,10 +228,11 @@ load_elf(const symboldb_options &opt, database &db,
     }
     // We used to derive the soname from the file name, but because of
     // hardlinks (and deduplication), we no longer can do this here.
-    const char *sonameptr = soname_seen ? soname.c_str() : NULL;
-    db.add_elf_image(cid, image, sonameptr);
-  } catch (elf_exception e) {
-    db.add_elf_error(cid, e.what());
+    actions.push_back(bind(store_elf_image, image, soname_seen, soname,
+			   opt.elf_symbols, _1, _2));
+  } catch (elf_exception &e) {
+    actions.push_back(bind(store_elf_string, &database::add_elf_error,
+			   std::string(e.what()), _1, _2));
   }
 }
 
@@ -202,44 +251,94 @@ is_python_path(const rpm_file_info &info)
   return ends_with(info.name, ".py");
 }
 
-// Loads python source code.
+// Stores the names extracted from Python source code.
 static void
-load_python(const symboldb_options &, database &db, python_analyzer &pya,
-	    database::contents_id cid, const rpm_file_entry &file)
+store_python_names(database &db, database::contents_id cid,
+		   const std::vector<std::string> &imports,
+		   const std::vector<std::string> &attributes,
+		   const std::vector<std::string> &functions,
+		   const std::vector<std::string> &classes)
 {
-  if (db.has_python_analysis(cid)) {
-    return;
-  }
-  if (!pya.parse(file.contents)) {
-    db.add_python_error(cid, pya.error_line(), pya.error_message().c_str());
-    return;
-  }
   for (std::vector<std::string>::const_iterator
-	 p = pya.imports().begin(), end = pya.imports().end(); p != end; ++p) {
+	 p = imports.begin(), end = imports.end(); p != end; ++p) {
     db.add_python_import(cid, p->c_str());
   }
   for (std::vector<std::string>::const_iterator
-	 p = pya.attributes().begin(), end = pya.attributes().end();
-       p != end; ++p) {
+	 p = attributes.begin(), end = attributes.end(); p != end; ++p) {
     db.add_python_attribute(cid, p->c_str());
   }
   for (std::vector<std::string>::const_iterator
-	 p = pya.functions().begin(), end = pya.functions().end();
-       p != end; ++p) {
+	 p = functions.begin(), end = functions.end(); p != end; ++p) {
     db.add_python_function_def(cid, p->c_str());
   }
   for (std::vector<std::string>::const_iterator
-	 p = pya.classes().begin(), end = pya.classes().end();
-       p != end; ++p) {
+	 p = classes.begin(), end = classes.end(); p != end; ++p) {
     db.add_python_class_def(cid, p->c_str());
   }
 }
 
-// Loads XML-like content.
+// Stores the results of the analysis started with
+// python_analyzer::submit().
 static void
-load_xml(const symboldb_options &, database &db,
-	 database::contents_id cid, const rpm_file_entry &file)
+store_python(database &db, python_analyzer &pya, database::contents_id cid)
 {
+  if (!pya.wait()) {
+    db.add_python_error(cid, pya.error_line(), pya.error_message().c_str());
+    return;
+  }
+  store_python_names(db, cid, pya.imports(), pya.attributes(),
+		     pya.functions(), pya.classes());
+}
+
+// Stores the results of a successful python_scanner::scan().
+static void
+store_python_scan(std::tr1::shared_ptr<python_scanner> scanner,
+		  database &db, database::contents_id cid)
+{
+  store_python_names(db, cid, scanner->imports(), scanner->attributes(),
+		     scanner->functions(), scanner->classes());
+}
+
+// Loads python source code.
+static void
+load_python(const symboldb_options &, database &db, python_analyzer &pya,
+	    database::contents_id cid, const rpm_file_entry &file)
+{
+  if (db.has_python_analysis(cid)) {
+    return;
+  }
+  std::tr1::shared_ptr<python_scanner> scanner(new python_scanner);
+  if (scanner->scan(file.contents)) {
+    store_python_scan(scanner, db, cid);
+    return;
+  }
+  pya.submit(file.contents);
+  store_python(db, pya, cid);
+}
+
+static void
+store_xml_error(const std::string &message, unsigned line,
+		const std::vector<unsigned char> &before,
+		const std::vector<unsigned char> &after,
+		database &db, database::contents_id cid)
+{
+  db.add_xml_error(cid, message.c_str(), line, before, after);
+}
+
+static void
+store_maven_url(const maven_url &url,
+		database &db, database::contents_id cid)
+{
+  db.add_maven_url(cid, url);
+}
+
+// Analyzes XML-like content.
+static void
+load_xml(const symboldb_options &, const rpm_file_entry &file,
+	 db_actions &actions)
+{
+  using std::tr1::bind;
+  using namespace std::tr1::placeholders;
   vector_source src(&file.contents);
   expat_source source(&src);
 
@@ -250,12 +349,13 @@ load_xml(const symboldb_options &, database &db,
   } catch (expat_source::malformed &e) {
     std::vector<unsigned char> before(e.before().begin(), e.before().end());
     std::vector<unsigned char> after(e.after().begin(), e.after().end());
-    db.add_xml_error(cid, e.message(), e.line(), before, after);
+    actions.push_back(bind(store_xml_error, std::string(e.message()),
+			   e.line(), before, after, _1, _2));
   }
   for (std::vector<maven_url>::const_iterator
 	 p = result.begin(), end = result.end();
        p != end; ++p) {
-      db.add_maven_url(cid, *p);
+    actions.push_back(bind(store_maven_url, *p, _1, _2));
   }
 }
 
@@ -356,87 +456,287 @@ prepare_load(const char *rpm_path, const rpm_file_entry &file,
 }
 
 static void
-load_zip(database &db,
-	 database::contents_id cid, const rpm_file_entry &file)
+store_java_results(std::tr1::shared_ptr<java_class_results> results,
+		   database &db, database::contents_id cid)
 {
-  zip_file zip(&file.contents);
-  std::vector<unsigned char> data;
-  while (true) {
-    try {
-      if (!zip.next()) {
-	break;
-      }
-    } catch (os_exception &e) {
-      // FIXME: Use proper, zip_file-specific exception.
-      // zip.name() is not necessarily valid at this point.
-      db.add_java_error(cid, e.what(), "");
-      // Exit the loop because the file is likely corrupted significantly.
-      break;
-    }
-    try {
-      zip.data(data);
-    } catch (os_exception &e) {
-      // FIXME: Use proper, zip_file-specific exception.
-      db.add_java_error(cid, e.what(), zip.name());
-    }
-    if (java_class::has_signature(data)) {
-      try {
-	java_class jc(&data);
-	db.add_java_class(cid, jc);
-      } catch (java_class::exception &e) {
-	db.add_java_error(cid, e.what(), zip.name());
-      }
-    }
+  if (results->batch.size() > 0) {
+    db.add_java_classes(cid, results->batch);
+  }
+  for (std::vector<std::pair<std::string, std::string> >::const_iterator
+	 p = results->errors.begin(), end = results->errors.end();
+       p != end; ++p) {
+    db.add_java_error(cid, p->second.c_str(), p->first);
   }
 }
 
 static void
-do_load_formats(const symboldb_options &opt, database &db, python_analyzer &pya,
-		database::contents_id cid, const rpm_file_entry &file)
-{
-  if (is_elf(file.contents)) {
-    load_elf(opt, db, cid, file);
-  } else if (looks_like_xml(file.contents.begin(), file.contents.end())) {
-    load_xml(opt, db, cid, file);
-  } else if (is_python(file.contents)
-	     || check_any(file.infos, is_python_path)) {
-    load_python(opt, db, pya, cid, file);
-  } else if (java_class::has_signature(file.contents)) {
-    try {
-      java_class jc(&file.contents);
-      db.add_java_class(cid, jc);
-    } catch (java_class::exception &e) {
-      db.add_java_error(cid, e.what(), "");
-    }
-  }
-  if (zip_file::has_signature(file.contents)) {
-    load_zip(db, cid, file);
+record_java_results(std::tr1::shared_ptr<java_class_results> results,
+		    db_actions &actions)
+{
+  using std::tr1::bind;
+  using namespace std::tr1::placeholders;
+  if (results->batch.size() > 0 || !results->errors.empty()) {
+    actions.push_back(bind(store_java_results, results, _1, _2));
   }
 }
 
+// Loads the classes in a ZIP file, descending into nested archives.
+// Classes and errors are attributed to the contents of the outer
+// file, and stored with a single batch, so that a class which occurs
+// in more than one nesting level is recorded once.
+static void
+load_zip(const symboldb_options &opt, const rpm_file_entry &file,
+	 db_actions &actions)
+{
+  std::tr1::shared_ptr<java_class_results> results(new java_class_results);
+  parse_java_archive(file.contents.data(), file.contents.size(),
+		     opt.load_threads, *results);
+  record_java_results(results, actions);
+}
+
 static inline bool
 unpack_files(const rpm_package_info &pkginfo)
 {
   return pkginfo.kind == rpm_package_info::binary;
 }
 
+namespace {
+  // A file from the RPM payload, together with the results of the
+  // processing steps which do not need database access (hashing and
+  // format analysis).  These steps can run on a worker thread.
+  struct file_job {
+    rpm_file_entry file;
+    bool regular;		// false for directories and symlinks
+
+    // The following are set by prepare().
+    std::vector<unsigned char> digest;
+    std::vector<unsigned char> preview;
+
+    // The following are set by analyze_formats().
+    bool analyzed;
+    db_actions actions;		// format-specific database updates
+    std::tr1::shared_ptr<python_analyzer> python; // pending Python analysis
+
+    std::string error;		// exception from a worker thread
+
+    file_job()
+      : regular(false), analyzed(false)
+    {
+    }
+
+    // Computes the digest and the preview.  Throws on digest mismatch.
+    void prepare(const char *rpm_path);
+
+    // Analyzes the file contents and records the database updates.
+    void analyze_formats(const symboldb_options &);
+
+    // Calls prepare(), and analyze_formats() if FORMATS.
+    void analyze(const symboldb_options &, const char *rpm_path,
+		 bool formats);
+  };
+
+  void
+  file_job::prepare(const char *rpm_path)
+  {
+    prepare_load(rpm_path, file, digest, preview);
+    for (std::vector<rpm_file_info>::iterator
+	   p = file.infos.begin(), end = file.infos.end(); p != end; ++p) {
+      p->normalize_name();
+    }
+  }
+
+  void
+  file_job::analyze_formats(const symboldb_options &opt)
+  {
+    analyzed = true;
+    if (is_elf(file.contents)) {
+      load_elf(opt, file, actions);
+    } else if (looks_like_xml(file.contents.begin(), file.contents.end())) {
+      load_xml(opt, file, actions);
+    } else if (is_python(file.contents)
+	       || check_any(file.infos, is_python_path)) {
+      // The native scanner handles most files.  For the rest, the
+      // analysis runs in the interpreter pool while the other files
+      // are processed, and add_files() stores the results.
+      std::tr1::shared_ptr<python_scanner> scanner(new python_scanner);
+      if (scanner->scan(file.contents)) {
+	using std::tr1::bind;
+	using namespace std::tr1::placeholders;
+	actions.push_back(bind(store_python_scan, scanner, _1, _2));
+      } else {
+	python.reset(new python_analyzer);
+	python->submit(file.contents);
+      }
+    } else if (java_class::has_signature(file.contents)) {
+      std::tr1::shared_ptr<java_class_results>
+	results(new java_class_results);
+      results->add(file.contents, std::string());
+      record_java_results(results, actions);
+    }
+    if (zip_file::has_signature(file.contents)) {
+      load_zip(opt, file, actions);
+    }
+  }
+
+  void
+  file_job::analyze(const symboldb_options &opt, const char *rpm_path,
+		    bool formats)
+  {
+    prepare(rpm_path);
+    if (formats) {
+      analyze_formats(opt);
+    }
+  }
+
+  // Runs file_job::analyze() on worker threads.  Jobs are retrieved
+  // in submission order with next(), so that the database updates
+  // happen in a deterministic order.
+  class analysis_pool {
+    typedef std::tr1::shared_ptr<file_job> job_ptr;
+    const symboldb_options &opt_;
+    const char *rpm_path_;
+    bool formats_;
+    unsigned window_;		// maximum number of jobs in flight
+    unsigned long long submitted_;
+    bounded_ordered_queue<unsigned long long, job_ptr> queue_;
+    std::deque<job_ptr> pending_;
+    std::vector<std::tr1::shared_ptr<task> > tasks_;
+
+    // Guards done_ and stop_.
+    mutex mutex_;
+    cond cond_;
+    std::set<file_job *> done_;
+    bool stop_;
+
+    void worker() throw();
+    void close();
+  public:
+    analysis_pool(const symboldb_options &, const char *rpm_path,
+		  bool formats);
+    ~analysis_pool();
+
+    // Returns true if submit() would not block.
+    bool can_submit() const;
+
+    // Queues the job for analysis (unless it is not a regular file).
+    void submit(job_ptr);
+
+    // Waits for the oldest job and returns it, or returns a null
+    // pointer if there are no pending jobs.  Re-throws errors from
+    // the analysis as runtime_error.
+    job_ptr next();
+  };
+
+  analysis_pool::analysis_pool(const symboldb_options &opt,
+			       const char *rpm_path, bool formats)
+    : opt_(opt), rpm_path_(rpm_path), formats_(formats),
+      window_(2 * opt.load_threads), submitted_(0),
+      queue_(opt.load_threads), stop_(false)
+  {
+    for (unsigned i = 0; i < opt.load_threads; ++i) {
+      tasks_.push_back(std::tr1::shared_ptr<task>
+		       (new task(std::tr1::bind(&analysis_pool::worker,
+						this))));
+    }
+  }
+
+  analysis_pool::~analysis_pool()
+  {
+    {
+      mutex::locker ml(&mutex_);
+      stop_ = true;
+    }
+    close();
+    for (std::vector<std::tr1::shared_ptr<task> >::iterator
+	   p = tasks_.begin(), end = tasks_.end(); p != end; ++p) {
+      (*p)->wait();
+    }
+  }
+
+  void
+  analysis_pool::close()
+  {
+    if (queue_.producers() > 0) {
+      queue_.remove_producer();
+    }
+  }
+
+  void
+  analysis_pool::worker() throw()
+  {
+    unsigned long long seq;
+    job_ptr job;
+    while (queue_.pop(seq, job)) {
+      bool stop;
+      {
+	mutex::locker ml(&mutex_);
+	stop = stop_;
+      }
+      if (!stop) {
+	try {
+	  job->analyze(opt_, rpm_path_, formats_);
+	} catch (std::exception &e) {
+	  job->error = e.what();
+	  if (job->error.empty()) {
+	    job->error = "unknown error during file analysis";
+	  }
+	}
+      }
+      mutex::locker ml(&mutex_);
+      done_.insert(job.get());
+      cond_.broadcast();
+    }
+  }
+
+  bool
+  analysis_pool::can_submit() const
+  {
+    return pending_.size() < window_;
+  }
+
+  void
+  analysis_pool::submit(job_ptr job)
+  {
+    if (job->regular) {
+      queue_.push(submitted_++, job);
+    }
+    pending_.push_back(job);
+  }
+
+  analysis_pool::job_ptr
+  analysis_pool::next()
+  {
+    if (pending_.empty()) {
+      return job_ptr();
+    }
+    job_ptr job(pending_.front());
+    pending_.pop_front();
+    if (job->regular) {
+      mutex::locker ml(&mutex_);
+      while (done_.find(job.get()) == done_.end()) {
+	cond_.wait(mutex_);
+      }
+      done_.erase(job.get());
+    }
+    if (!job->error.empty()) {
+      raise<std::runtime_error>(job->error);
+    }
+    return job;
+  }
+}
+
 static void
 add_files(const symboldb_options &opt, database &db, python_analyzer &pya,
 	  const rpm_package_info &pkginfo, database::package_id pkg,
-	  const char *rpm_path, rpm_file_entry &file)
+	  file_job &job)
 {
-  std::vector<unsigned char> digest;
-  std::vector<unsigned char> preview;
-  prepare_load(rpm_path, file, digest, preview);
-
-  file.infos.front().normalize_name();
-
+  rpm_file_entry &file(job.file);
   database::file_id fid;
   database::contents_id cid;
   database::attribute_id aid;
   bool added;
   int contents_length;
-  db.add_file(pkg, file.infos.front(), digest, preview, fid, cid,
+  db.add_file(pkg, file.infos.front(), job.digest, job.preview, fid, cid,
 	      added, contents_length);
 
   bool looks_like_python =
@@ -448,7 +748,6 @@ add_files(const symboldb_options &opt, database &db, python_analyzer &pya,
 	 p = file.infos.begin() + 1, end = file.infos.end();
 	 p != end; ++p) {
       assert(!p->ghost());
-      p->normalize_name();
       aid = db.intern_file_attribute(*p);
       db.add_file(pkg, p->name, p->mtime, p->ino, cid, aid);
       looks_like_python = looks_like_python
@@ -457,8 +756,17 @@ add_files(const symboldb_options &opt, database &db, python_analyzer &pya,
   }
 
   if (added) {
-    if (unpack_files(pkginfo)) {
-      do_load_formats(opt, db, pya, cid, file);
+    if (unpack_files(pkginfo) && !job.analyzed) {
+      // Sequential mode defers the analysis until it is needed.
+      job.analyze_formats(opt);
+    }
+    for (db_actions::iterator p = job.actions.begin(),
+	   end = job.actions.end(); p != end; ++p) {
+      (*p)(db, cid);
+    }
+    if (job.python) {
+      // New contents cannot have been analyzed before.
+      store_python(db, *job.python, cid);
     }
   } else {
     // We might recognize additonal files as Python files if they are
@@ -469,8 +777,26 @@ add_files(const symboldb_options &opt, database &db, python_analyzer &pya,
   }
   // If the contents in the database was truncated, update it with the
   // longer version.
-  if (static_cast<size_t>(contents_length) < preview.size()) {
-    db.update_contents_preview(cid, preview);
+  if (static_cast<size_t>(contents_length) < job.preview.size()) {
+    db.update_contents_preview(cid, job.preview);
+  }
+}
+
+// Writes a file from the payload to the database.
+static void
+store_file(const symboldb_options &opt, database &db, python_analyzer &pya,
+	   const rpm_package_info &pkginfo, database::package_id pkg,
+	   file_job &job)
+{
+  if (job.regular) {
+    add_files(opt, db, pya, pkginfo, pkg, job);
+  } else {
+    rpm_file_info &info(job.file.infos.front());
+    if (info.is_directory()) {
+      db.add_directory(pkg, info);
+    } else {
+      db.add_symlink(pkg, info);
+    }
   }
 }
 
@@ -521,7 +847,6 @@ load_rpm_internal(const symboldb_options &opt, database &db,
   // We can destroy the lock immediately because we are running in a
   // transaction.
   lock_rpm(db, pkginfo);
-  rpm_file_entry file;
 
   database::package_id pkg;
   if (!db.intern_package(rpmparser.package(), pkg)) {
@@ -540,23 +865,39 @@ load_rpm_internal(const symboldb_options &opt, database &db,
   scripts(opt, db, pkg, rpmparser);
   triggers(opt, db, pkg, rpmparser);
 
+  const bool formats = unpack_files(pkginfo);
+  std::tr1::shared_ptr<analysis_pool> pool;
+  if (opt.load_threads > 1) {
+    pool.reset(new analysis_pool(opt, rpm_path, formats));
+  }
+
   // FIXME: We should not read arbitrary files into memory, only ELF
   // files.
-  while (rpmparser.read_file(file)) {
-    if (file.infos.size() > 1) {
-      // Hard links, so this is a real file.
-      add_files(opt, db, pya, pkginfo, pkg, rpm_path, file);
-      continue;
+  while (true) {
+    std::tr1::shared_ptr<file_job> job(new file_job);
+    if (!rpmparser.read_file(job->file)) {
+      break;
     }
-
-    assert(!file.infos.empty());
-    rpm_file_info &info(file.infos.front());
-    if (info.is_directory()) {
-      db.add_directory(pkg, info);
-    } else if (info.is_symlink()) {
-      db.add_symlink(pkg, info);
+    assert(!job->file.infos.empty());
+    const rpm_file_info &info(job->file.infos.front());
+    // Hard links are always real files.
+    job->regular = job->file.infos.size() > 1
+      || !(info.is_directory() || info.is_symlink());
+    if (pool) {
+      while (!pool->can_submit()) {
+	store_file(opt, db, pya, pkginfo, pkg, *pool->next());
+      }
+      pool->submit(job);
     } else {
-      add_files(opt, db, pya, pkginfo, pkg, rpm_path, file);
+      if (job->regular) {
+	job->prepare(rpm_path);
+      }
+      store_file(opt, db, pya, pkginfo, pkg, *job);
+    }
+  }
+  if (pool) {
+    while (std::tr1::shared_ptr<file_job> job = pool->next()) {
+      store_file(opt, db, pya, pkginfo, pkg, *job);
     }
   }
   return pkg;
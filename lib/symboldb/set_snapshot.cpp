@@ -0,0 +1,520 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <symboldb/set_snapshot.hpp>
+#include <cxxll/mapped_file.hpp>
+#include <cxxll/raise.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <stdlib.h>
+#include <string.h>
+
+using namespace cxxll;
+
+const char set_snapshot::magic[8] = {'s', 'y', 'm', 'b', 's', 'n', 'a', 'p'};
+const uint32_t set_snapshot::version;
+const uint32_t set_snapshot::none;
+
+namespace {
+  enum table {
+    table_packages, table_elf_files, table_files, table_definitions,
+    table_references, table_program_headers, table_needed, table_closure,
+    no_table
+  };
+
+  // What the values in a column refer to.
+  enum target {
+    values, string_ids, package_rows, elf_rows, optional_elf_rows, file_rows
+  };
+
+  struct column_spec {
+    table tab;
+    target tgt;
+  };
+
+  // Indexed by set_snapshot::section.
+  const column_spec column_specs[set_snapshot::section_count] = {
+    {no_table, values},             // string_offsets
+    {no_table, values},             // string_data
+    {table_packages, string_ids},   // package_name
+    {table_packages, string_ids},   // package_nevra
+    {table_packages, string_ids},   // package_arch
+    {table_elf_files, values},      // elf_type
+    {table_elf_files, values},      // elf_machine
+    {table_elf_files, values},      // elf_class
+    {table_elf_files, string_ids},  // elf_arch
+    {table_elf_files, string_ids},  // elf_soname
+    {table_elf_files, string_ids},  // elf_interp
+    {table_files, package_rows},    // file_package
+    {table_files, string_ids},      // file_name
+    {table_files, values},          // file_mode
+    {table_files, string_ids},      // file_user
+    {table_files, string_ids},      // file_group
+    {table_files, optional_elf_rows}, // file_elf
+    {table_definitions, elf_rows},  // definition_elf
+    {table_definitions, string_ids}, // definition_name
+    {table_definitions, string_ids}, // definition_version
+    {table_definitions, values},    // definition_type
+    {table_definitions, values},    // definition_binding
+    {table_definitions, values},    // definition_visibility
+    {table_definitions, values},    // definition_default_version
+    {table_references, elf_rows},   // reference_elf
+    {table_references, string_ids}, // reference_name
+    {table_references, string_ids}, // reference_version
+    {table_references, values},     // reference_type
+    {table_references, values},     // reference_binding
+    {table_references, values},     // reference_visibility
+    {table_program_headers, elf_rows}, // program_header_elf
+    {table_program_headers, values}, // program_header_type
+    {table_program_headers, values}, // program_header_flags
+    {table_needed, elf_rows},       // needed_elf
+    {table_needed, string_ids},     // needed_name
+    {table_closure, file_rows},     // closure_file
+    {table_closure, file_rows},     // closure_needed
+  };
+
+  void
+  invalid(const char *path, const char *what) __attribute__((noreturn));
+
+  void
+  invalid(const char *path, const char *what)
+  {
+    std::string msg("invalid snapshot file ");
+    msg += path;
+    msg += ": ";
+    msg += what;
+    raise<std::runtime_error>(msg);
+  }
+
+  // Returns the index of the first element in the column whose value
+  // is not less than LIMIT, or SIZE if there is no such element.
+  size_t
+  find_out_of_range(const uint32_t *column, size_t size, uint32_t limit)
+  {
+    // Check blocks without branches, and look for the row afterwards.
+    enum { block = 4096 };
+    for (size_t start = 0; start < size; start += block) {
+      size_t end = std::min<size_t>(size, start + block);
+      uint32_t bad = 0;
+      for (size_t i = start; i < end; ++i) {
+	bad |= column[i] >= limit;
+      }
+      if (bad) {
+	for (size_t i = start; i < end; ++i) {
+	  if (column[i] >= limit) {
+	    return i;
+	  }
+	}
+      }
+    }
+    return size;
+  }
+
+  template <class Predicate> void
+  select_rows(const uint32_t *column, size_t size, Predicate pred,
+	      std::vector<uint32_t> &rows)
+  {
+    enum { block = 4096 };
+    uint32_t buf[block];
+    for (size_t start = 0; start < size; start += block) {
+      size_t end = std::min<size_t>(size, start + block);
+      size_t n = 0;
+      for (size_t i = start; i < end; ++i) {
+	buf[n] = i;
+	n += pred(column[i]);
+      }
+      rows.insert(rows.end(), buf, buf + n);
+    }
+  }
+
+  struct equal_to {
+    uint32_t value;
+    bool operator()(uint32_t v) const
+    {
+      return v == value;
+    }
+  };
+
+  struct in_range {
+    uint32_t first;
+    uint32_t last;
+    bool operator()(uint32_t v) const
+    {
+      return v - first < last - first;
+    }
+  };
+
+  struct any_bits {
+    uint32_t mask;
+    bool operator()(uint32_t v) const
+    {
+      return (v & mask) != 0;
+    }
+  };
+} // namespace
+
+struct set_snapshot::impl {
+  mapped_file file;
+  const uint64_t *offsets;
+  const char *data;
+  size_t strings;
+  packages_table packages;
+  elf_files_table elf_files;
+  files_table files;
+  definitions_table definitions;
+  references_table references;
+  program_headers_table program_headers;
+  needed_table needed;
+  closure_table closure;
+
+  impl(const char *path);
+
+  const_stringref string(uint32_t id) const
+  {
+    return const_stringref(data + offsets[id], offsets[id + 1] - offsets[id]);
+  }
+};
+
+set_snapshot::impl::impl(const char *path)
+  : file(path)
+{
+  const unsigned char *base = file.data();
+  size_t size = file.size();
+  if (size < sizeof(file_header) + section_count * sizeof(section_entry)) {
+    invalid(path, "file too short");
+  }
+  const file_header *header = reinterpret_cast<const file_header *>(base);
+  if (memcmp(header->magic, set_snapshot::magic, sizeof(header->magic)) != 0) {
+    invalid(path, "bad magic value");
+  }
+  if (header->version != set_snapshot::version) {
+    invalid(path, "unsupported version");
+  }
+  if (header->sections != section_count) {
+    invalid(path, "wrong number of sections");
+  }
+  const section_entry *entries =
+    reinterpret_cast<const section_entry *>(header + 1);
+
+  const uint32_t *columns[section_count];
+  size_t lengths[section_count];
+  for (int i = 0; i < section_count; ++i) {
+    size_t width;
+    switch (i) {
+    case string_offsets:
+      width = sizeof(uint64_t);
+      break;
+    case string_data:
+      width = 1;
+      break;
+    default:
+      width = sizeof(uint32_t);
+    }
+    const section_entry &e(entries[i]);
+    if (e.offset % 8 != 0 || e.offset > size
+	|| e.length > (size - e.offset) / width) {
+      invalid(path, "section out of bounds");
+    }
+    columns[i] = reinterpret_cast<const uint32_t *>(base + e.offset);
+    lengths[i] = e.length;
+  }
+
+  // String dictionary.
+  offsets = reinterpret_cast<const uint64_t *>(columns[string_offsets]);
+  data = reinterpret_cast<const char *>(columns[string_data]);
+  if (lengths[string_offsets] < 2 || offsets[0] != 0 || offsets[1] != 0) {
+    invalid(path, "missing empty string");
+  }
+  strings = lengths[string_offsets] - 1;
+  for (size_t i = 0; i < strings; ++i) {
+    if (offsets[i] > offsets[i + 1]) {
+      invalid(path, "string offsets not sorted");
+    }
+  }
+  if (offsets[strings] != lengths[string_data]) {
+    invalid(path, "string offsets do not match data");
+  }
+  if (strings >= none) {
+    invalid(path, "too many strings");
+  }
+
+  // Row counts are determined by the first column of each table.
+  size_t rows[no_table];
+  for (int i = 0; i < no_table; ++i) {
+    rows[i] = none;
+  }
+  for (int i = 0; i < section_count; ++i) {
+    const column_spec &spec(column_specs[i]);
+    if (spec.tab == no_table) {
+      continue;
+    }
+    if (rows[spec.tab] == none) {
+      rows[spec.tab] = lengths[i];
+      if (lengths[i] >= none) {
+	invalid(path, "too many rows");
+      }
+    } else if (rows[spec.tab] != lengths[i]) {
+      invalid(path, "column length mismatch");
+    }
+  }
+
+  for (int i = 0; i < section_count; ++i) {
+    const column_spec &spec(column_specs[i]);
+    size_t limit;
+    switch (spec.tgt) {
+    case values:
+      continue;
+    case string_ids:
+      limit = strings;
+      break;
+    case package_rows:
+      limit = rows[table_packages];
+      break;
+    case elf_rows:
+      limit = rows[table_elf_files];
+      break;
+    case optional_elf_rows:
+      // none is larger than any row number, so it has to be checked
+      // separately.
+      for (size_t j = 0; j < lengths[i]; ++j) {
+	if (columns[i][j] >= rows[table_elf_files] && columns[i][j] != none) {
+	  invalid(path, "invalid row reference");
+	}
+      }
+      continue;
+    case file_rows:
+      limit = rows[table_files];
+      break;
+    default:
+      abort();
+    }
+    if (find_out_of_range(columns[i], lengths[i], limit) != lengths[i]) {
+      invalid(path, "invalid reference");
+    }
+  }
+
+  packages.size = rows[table_packages];
+  packages.name = columns[package_name];
+  packages.nevra = columns[package_nevra];
+  packages.arch = columns[package_arch];
+
+  elf_files.size = rows[table_elf_files];
+  elf_files.type = columns[elf_type];
+  elf_files.machine = columns[elf_machine];
+  elf_files.elf_class = columns[elf_class];
+  elf_files.arch = columns[elf_arch];
+  elf_files.soname = columns[elf_soname];
+  elf_files.interp = columns[elf_interp];
+
+  files.size = rows[table_files];
+  files.package = columns[file_package];
+  files.name = columns[file_name];
+  files.mode = columns[file_mode];
+  files.user = columns[file_user];
+  files.group = columns[file_group];
+  files.elf = columns[file_elf];
+
+  definitions.size = rows[table_definitions];
+  definitions.elf = columns[definition_elf];
+  definitions.name = columns[definition_name];
+  definitions.version = columns[definition_version];
+  definitions.type = columns[definition_type];
+  definitions.binding = columns[definition_binding];
+  definitions.visibility = columns[definition_visibility];
+  definitions.default_version = columns[definition_default_version];
+
+  references.size = rows[table_references];
+  references.elf = columns[reference_elf];
+  references.name = columns[reference_name];
+  references.version = columns[reference_version];
+  references.type = columns[reference_type];
+  references.binding = columns[reference_binding];
+  references.visibility = columns[reference_visibility];
+
+  program_headers.size = rows[table_program_headers];
+  program_headers.elf = columns[program_header_elf];
+  program_headers.type = columns[program_header_type];
+  program_headers.flags = columns[program_header_flags];
+
+  needed.size = rows[table_needed];
+  needed.elf = columns[needed_elf];
+  needed.name = columns[needed_name];
+
+  closure.size = rows[table_closure];
+  closure.file = columns[closure_file];
+  closure.needed = columns[closure_needed];
+}
+
+set_snapshot::set_snapshot(const char *path)
+  : impl_(new impl(path))
+{
+}
+
+set_snapshot::~set_snapshot()
+{
+}
+
+size_t
+set_snapshot::string_count() const
+{
+  return impl_->strings;
+}
+
+const_stringref
+set_snapshot::string(uint32_t id) const
+{
+  if (id >= impl_->strings) {
+    raise<std::out_of_range>("set_snapshot::string");
+  }
+  return impl_->string(id);
+}
+
+bool
+set_snapshot::find_string(const_stringref str, uint32_t &id) const
+{
+  size_t low = 0;
+  size_t high = impl_->strings;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (impl_->string(mid) < str) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low < impl_->strings && impl_->string(low) == str) {
+    id = low;
+    return true;
+  }
+  return false;
+}
+
+std::pair<uint32_t, uint32_t>
+set_snapshot::prefix_range(const_stringref prefix) const
+{
+  // The strings with the prefix form a contiguous range which
+  // starts at the first string not less than the prefix.
+  size_t low = 0;
+  size_t high = impl_->strings;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (impl_->string(mid) < prefix) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  size_t first = low;
+  high = impl_->strings;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    const_stringref s(impl_->string(mid));
+    if (s.size() >= prefix.size()
+	&& memcmp(s.data(), prefix.data(), prefix.size()) == 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return std::make_pair(uint32_t(first), uint32_t(low));
+}
+
+const set_snapshot::packages_table &
+set_snapshot::packages() const
+{
+  return impl_->packages;
+}
+
+const set_snapshot::elf_files_table &
+set_snapshot::elf_files() const
+{
+  return impl_->elf_files;
+}
+
+const set_snapshot::files_table &
+set_snapshot::files() const
+{
+  return impl_->files;
+}
+
+const set_snapshot::definitions_table &
+set_snapshot::definitions() const
+{
+  return impl_->definitions;
+}
+
+const set_snapshot::references_table &
+set_snapshot::references() const
+{
+  return impl_->references;
+}
+
+const set_snapshot::program_headers_table &
+set_snapshot::program_headers() const
+{
+  return impl_->program_headers;
+}
+
+const set_snapshot::needed_table &
+set_snapshot::needed() const
+{
+  return impl_->needed;
+}
+
+const set_snapshot::closure_table &
+set_snapshot::closure() const
+{
+  return impl_->closure;
+}
+
+void
+set_snapshot::select_equal(const uint32_t *column, size_t size,
+			   uint32_t value, std::vector<uint32_t> &rows)
+{
+  equal_to pred = {value};
+  select_rows(column, size, pred, rows);
+}
+
+void
+set_snapshot::select_range(const uint32_t *column, size_t size,
+			   uint32_t first, uint32_t last,
+			   std::vector<uint32_t> &rows)
+{
+  if (first < last) {
+    in_range pred = {first, last};
+    select_rows(column, size, pred, rows);
+  }
+}
+
+void
+set_snapshot::select_bits(const uint32_t *column, size_t size,
+			  uint32_t mask, std::vector<uint32_t> &rows)
+{
+  any_bits pred = {mask};
+  select_rows(column, size, pred, rows);
+}
+
+std::pair<size_t, size_t>
+set_snapshot::equal_range(const uint32_t *column, size_t size, uint32_t value)
+{
+  std::pair<const uint32_t *, const uint32_t *> r
+    (std::equal_range(column, column + size, value));
+  return std::make_pair(size_t(r.first - column), size_t(r.second - column));
+}
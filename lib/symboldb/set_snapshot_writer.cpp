@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <symboldb/set_snapshot_writer.hpp>
+#include <cxxll/fd_handle.hpp>
+#include <cxxll/fd_sink.hpp>
+#include <cxxll/os_exception.hpp>
+#include <cxxll/raise.hpp>
+
+#include <stdexcept>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cxxll;
+
+struct set_snapshot_writer::impl {
+  std::string path;
+  std::string temp;
+  fd_handle fd;
+  uint64_t offset;
+  std::vector<uint64_t> string_offsets;
+  std::string string_buffer;
+  std::string last_string;
+  bool strings_written;
+  bool committed;
+  set_snapshot::section_entry entries[set_snapshot::section_count];
+  bool written[set_snapshot::section_count];
+
+  impl(const char *);
+  void append(const void *, size_t);
+  void align();
+  void flush_strings();
+  void write_strings();
+};
+
+set_snapshot_writer::impl::impl(const char *p)
+  : path(p), offset(0), strings_written(false), committed(false)
+{
+  memset(entries, 0, sizeof(entries));
+  memset(written, 0, sizeof(written));
+  temp = fd.mkstemp((path + ".").c_str());
+  // Reserve space for the header, which is written by commit().
+  std::vector<char> header(sizeof(set_snapshot::file_header)
+			   + sizeof(entries));
+  append(header.data(), header.size());
+  align();
+  entries[set_snapshot::string_data].offset = offset;
+  string_offsets.push_back(0);
+}
+
+void
+set_snapshot_writer::impl::append(const void *data, size_t length)
+{
+  fd_sink(fd.get()).write(const_stringref(data, length));
+  offset += length;
+}
+
+void
+set_snapshot_writer::impl::align()
+{
+  static const char zeros[8] = {0};
+  if (offset % 8 != 0) {
+    append(zeros, 8 - offset % 8);
+  }
+}
+
+void
+set_snapshot_writer::impl::flush_strings()
+{
+  append(string_buffer.data(), string_buffer.size());
+  string_buffer.clear();
+}
+
+void
+set_snapshot_writer::impl::write_strings()
+{
+  if (strings_written) {
+    return;
+  }
+  if (string_offsets.size() < 2) {
+    raise<std::logic_error>("set_snapshot_writer: missing empty string");
+  }
+  flush_strings();
+  entries[set_snapshot::string_data].length = string_offsets.back();
+  align();
+  entries[set_snapshot::string_offsets].offset = offset;
+  entries[set_snapshot::string_offsets].length = string_offsets.size();
+  append(string_offsets.data(), string_offsets.size() * sizeof(uint64_t));
+  written[set_snapshot::string_data] = true;
+  written[set_snapshot::string_offsets] = true;
+  strings_written = true;
+  std::vector<uint64_t>().swap(string_offsets);
+}
+
+set_snapshot_writer::set_snapshot_writer(const char *path)
+  : impl_(new impl(path))
+{
+}
+
+set_snapshot_writer::~set_snapshot_writer()
+{
+  if (!impl_->committed) {
+    unlink(impl_->temp.c_str());
+  }
+}
+
+uint32_t
+set_snapshot_writer::add_string(const_stringref str)
+{
+  if (impl_->strings_written) {
+    raise<std::logic_error>("set_snapshot_writer: string after column");
+  }
+  size_t id = impl_->string_offsets.size() - 1;
+  if (id == 0 ? !str.empty() : !(const_stringref(impl_->last_string) < str)) {
+    raise<std::logic_error>("set_snapshot_writer: strings out of order");
+  }
+  if (id >= set_snapshot::none) {
+    raise<std::runtime_error>("set_snapshot_writer: too many strings");
+  }
+  impl_->string_buffer.append(str.data(), str.size());
+  impl_->string_offsets.push_back(impl_->string_offsets.back() + str.size());
+  str.str(impl_->last_string);
+  if (impl_->string_buffer.size() >= 1024 * 1024) {
+    impl_->flush_strings();
+  }
+  return id;
+}
+
+void
+set_snapshot_writer::write(set_snapshot::section sec,
+			   const std::vector<uint32_t> &column)
+{
+  if (sec <= set_snapshot::string_data || sec >= set_snapshot::section_count
+      || impl_->written[sec]) {
+    raise<std::logic_error>("set_snapshot_writer: invalid section");
+  }
+  if (column.size() >= set_snapshot::none) {
+    raise<std::runtime_error>("set_snapshot_writer: too many rows");
+  }
+  impl_->write_strings();
+  impl_->align();
+  impl_->entries[sec].offset = impl_->offset;
+  impl_->entries[sec].length = column.size();
+  impl_->append(column.data(), column.size() * sizeof(uint32_t));
+  impl_->written[sec] = true;
+}
+
+void
+set_snapshot_writer::commit()
+{
+  impl_->write_strings();
+  for (int i = 0; i < set_snapshot::section_count; ++i) {
+    if (!impl_->written[i]) {
+      raise<std::logic_error>("set_snapshot_writer: missing section");
+    }
+  }
+  set_snapshot::file_header header;
+  memcpy(header.magic, set_snapshot::magic, sizeof(header.magic));
+  header.version = set_snapshot::version;
+  header.sections = set_snapshot::section_count;
+  if (lseek(impl_->fd.get(), 0, SEEK_SET) != 0) {
+    throw os_exception().function(::lseek).fd(impl_->fd.get())
+      .path(impl_->temp);
+  }
+  fd_sink sink(impl_->fd.get());
+  sink.write(const_stringref(&header, sizeof(header)));
+  sink.write(const_stringref(impl_->entries, sizeof(impl_->entries)));
+  // mkstemp creates the file with mode 0600.  Use the permissions a
+  // regular file created by open() would get.
+  mode_t mask = umask(0);
+  umask(mask);
+  if (fchmod(impl_->fd.get(), 0666 & ~mask) != 0) {
+    throw os_exception().function(::fchmod).fd(impl_->fd.get())
+      .path(impl_->temp);
+  }
+  impl_->fd.close();
+  if (rename(impl_->temp.c_str(), impl_->path.c_str()) != 0) {
+    throw os_exception().function(::rename).path(impl_->temp)
+      .path2(impl_->path);
+  }
+  impl_->committed = true;
+}
@@ -19,6 +19,7 @@
 #include <symboldb/update_elf_closure.hpp>
 #include <cxxll/pgresult_handle.hpp>
 #include <cxxll/pgconn_handle.hpp>
+#include <cxxll/pg_cursor.hpp>
 #include <cxxll/pg_exception.hpp>
 #include <cxxll/pg_query.hpp>
 #include <cxxll/pg_response.hpp>
@@ -249,10 +250,9 @@ update_elf_closure(pgconn_handle &conn, database::package_set_id id,
   // Obtain the list of SONAME providers.  There can be multiple DSOs
   // which have the same SONAME, and packages can conflict and install
   // different files at the same path.
-  pgresult_handle res;
-  pg_query_binary
-    (conn, res,
-     "SELECT ef.arch::text, COALESCE(ef.soname, ''), file_id, f.name, p.name"
+  pg_cursor cursor(conn);
+  cursor.declare
+    ("SELECT ef.arch::text, COALESCE(ef.soname, ''), file_id, f.name, p.name"
      " FROM symboldb.package_set_member psm"
      " JOIN symboldb.package p USING (package_id)"
      " JOIN symboldb.file f USING (package_id)"
@@ -267,8 +267,9 @@ update_elf_closure(pgconn_handle &conn, database::package_set_id id,
     int fid;
     std::string file_name;
     std::string pkg;
-    for (int row = 0, end = res.ntuples(); row < end; ++row) {
-      pg_response(res, row, arch, soname, fid, file_name, pkg);
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
+		  arch, soname, fid, file_name, pkg);
       if (soname.empty()) {
 	soname = synthesize_soname(file_name);
       }
@@ -280,9 +281,8 @@ update_elf_closure(pgconn_handle &conn, database::package_set_id id,
   ignore_some_conflicts(arch_soname);
 
   dependency_map closure;
-  pg_query_binary
-    (conn, res,
-     "SELECT ef.arch::text, en.name, file_id, f.name"
+  cursor.declare
+    ("SELECT ef.arch::text, en.name, file_id, f.name"
      " FROM symboldb.package_set_member psm"
      " JOIN symboldb.file f USING (package_id)"
      " JOIN symboldb.elf_file ef USING (contents_id)"
@@ -294,8 +294,8 @@ update_elf_closure(pgconn_handle &conn, database::package_set_id id,
     std::string needed_name;
     int fid;
     std::string needing_path;
-    for (int row = 0, end = res.ntuples(); row < end; ++row) {
-      pg_response(res, row,
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
 		  arch, needed_name, fid, needing_path);
       database::file_id needing_file(fid);
       database::file_id library =
@@ -345,13 +345,13 @@ update_elf_closure(pgconn_handle &conn, database::package_set_id id,
     fprintf(stderr, "info: closure: finished\n");
   }
   arch_soname.clear();
-  res.close();
 
   if (conflicts && conflicts->skip_update()) {
     return;
   }
 
   // Load the closure into the database.
+  pgresult_handle res;
   res.exec(conn, "CREATE TEMPORARY TABLE update_elf_closure ("
 	   " file_id INTEGER NOT NULL,"
 	   " needed INTEGER NOT NULL) ON COMMIT DROP");
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <symboldb/update_elf_symbol_resolution.hpp>
+#include <cxxll/pgresult_handle.hpp>
+#include <cxxll/pg_query.hpp>
+
+#include <cassert>
+
+using namespace cxxll;
+
+void
+update_elf_symbol_resolution(pgconn_handle &conn, database::package_set_id id)
+{
+  assert(conn.transactionStatus() == PQTRANS_INTRANS);
+  pgresult_handle res;
+
+  res.exec(conn, "CREATE TEMPORARY TABLE update_elf_symbol_resolution ("
+	   " file_id INTEGER NOT NULL,"
+	   " name TEXT NOT NULL COLLATE \"C\","
+	   " version TEXT COLLATE \"C\","
+	   " provider INTEGER,"
+	   " status symboldb.elf_symbol_resolution_status NOT NULL)"
+	   " ON COMMIT DROP");
+
+  // Matching definitions in the closure of each file.  A versioned
+  // reference binds to a definition with the same version (default
+  // or not).  An unversioned reference binds to an unversioned
+  // definition or to the default version.  Local and hidden
+  // definitions are not visible to other DSOs.
+  pg_query(conn, res,
+	   "INSERT INTO update_elf_symbol_resolution"
+	   " SELECT file_id, name, version, provider, CASE"
+	   "  WHEN COUNT(*) OVER (PARTITION BY file_id, name, version) > 1"
+	   "   THEN 'multiple'"
+	   "  ELSE 'resolved' END::symboldb.elf_symbol_resolution_status"
+	   " FROM (SELECT DISTINCT f.file_id, er.name, er.version,"
+	   "  ec.needed AS provider"
+	   " FROM symboldb.package_set_member psm"
+	   " JOIN symboldb.file f USING (package_id)"
+	   " JOIN symboldb.elf_reference er USING (contents_id)"
+	   " JOIN symboldb.elf_closure ec"
+	   "  ON ec.set_id = $1 AND ec.file_id = f.file_id"
+	   " JOIN symboldb.file nf ON nf.file_id = ec.needed"
+	   " JOIN symboldb.elf_definition ed"
+	   "  ON ed.contents_id = nf.contents_id AND ed.name = er.name"
+	   " WHERE psm.set_id = $1"
+	   " AND ed.binding <> 0" // STB_LOCAL
+	   " AND ed.visibility IN ('default', 'protected')"
+	   " AND (ed.version = er.version"
+	   "  OR (er.version IS NULL"
+	   "   AND (ed.version IS NULL OR ed.primary_version)))) x",
+	   id.value());
+  res.exec(conn, "CREATE INDEX ON update_elf_symbol_resolution"
+	   " (file_id, name)");
+
+  // References without any matching definition.
+  pg_query(conn, res,
+	   "INSERT INTO update_elf_symbol_resolution"
+	   " SELECT DISTINCT f.file_id, er.name, er.version, NULL::INTEGER,"
+	   " 'unresolved'::symboldb.elf_symbol_resolution_status"
+	   " FROM symboldb.package_set_member psm"
+	   " JOIN symboldb.file f USING (package_id)"
+	   " JOIN symboldb.elf_reference er USING (contents_id)"
+	   " WHERE psm.set_id = $1"
+	   " AND NOT EXISTS (SELECT 1 FROM update_elf_symbol_resolution u"
+	   "  WHERE u.file_id = f.file_id AND u.name = er.name"
+	   "  AND u.version IS NOT DISTINCT FROM er.version)",
+	   id.value());
+  res.exec(conn, "ANALYZE update_elf_symbol_resolution");
+
+  // Only apply the differences, to reduce churn in the (large)
+  // result table.
+  pg_query(conn, res,
+	   "DELETE FROM symboldb.elf_symbol_resolution esr"
+	   " WHERE set_id = $1"
+	   " AND NOT EXISTS (SELECT 1 FROM update_elf_symbol_resolution u"
+	   "  WHERE esr.file_id = u.file_id AND esr.name = u.name"
+	   "  AND esr.version IS NOT DISTINCT FROM u.version"
+	   "  AND esr.provider IS NOT DISTINCT FROM u.provider"
+	   "  AND esr.status = u.status)",
+	   id.value());
+  pg_query(conn, res,
+	   "INSERT INTO symboldb.elf_symbol_resolution"
+	   " (set_id, file_id, name, version, provider, status)"
+	   " SELECT $1, * FROM (SELECT file_id, name, version, provider, status"
+	   " FROM update_elf_symbol_resolution"
+	   " EXCEPT SELECT file_id, name, version, provider, status"
+	   " FROM symboldb.elf_symbol_resolution"
+	   " WHERE set_id = $1) x", id.value());
+  res.exec(conn, "DROP TABLE update_elf_symbol_resolution");
+}
@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <symboldb/write_set_snapshot.hpp>
+#include <symboldb/set_snapshot_writer.hpp>
+#include <cxxll/pg_cursor.hpp>
+#include <cxxll/pg_response.hpp>
+#include <cxxll/raise.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <tr1/unordered_map>
+
+using namespace cxxll;
+
+// The packages, files and ELF contents of the set.  Referenced as $1.
+#define SNAPSHOT_SET							\
+  "WITH sp AS (SELECT p.package_id, p.name, p.arch,"			\
+  "  symboldb.nevra(p) AS nevra"					\
+  "  FROM symboldb.package_set_member psm"				\
+  "  JOIN symboldb.package p USING (package_id)"			\
+  "  WHERE psm.set_id = $1),"						\
+  " sf AS (SELECT f.file_id, f.package_id, f.contents_id, f.name,"	\
+  "  fa.mode, fa.user_name, fa.group_name"				\
+  "  FROM sp JOIN symboldb.file f USING (package_id)"			\
+  "  JOIN symboldb.file_attribute fa USING (attribute_id)),"		\
+  " sc AS (SELECT DISTINCT contents_id FROM sf) "
+
+// Symbol visibility as STV_* constant.
+#define SNAPSHOT_VISIBILITY(alias)					\
+  " CASE " alias ".visibility WHEN 'default' THEN 0"			\
+  " WHEN 'internal' THEN 1 WHEN 'hidden' THEN 2 ELSE 3 END"
+
+namespace {
+  typedef std::tr1::unordered_map<std::string, uint32_t> string_map;
+  typedef std::tr1::unordered_map<int, uint32_t> row_map;
+
+  uint32_t
+  lookup(const string_map &strings, const std::string &str)
+  {
+    string_map::const_iterator p(strings.find(str));
+    if (p == strings.end()) {
+      raise<std::runtime_error>("snapshot string not in dictionary: " + str);
+    }
+    return p->second;
+  }
+
+  uint32_t
+  lookup(const row_map &rows, int key)
+  {
+    row_map::const_iterator p(rows.find(key));
+    if (p == rows.end()) {
+      raise<std::runtime_error>("snapshot row reference not found");
+    }
+    return p->second;
+  }
+
+  void
+  write_strings(pgconn_handle &conn, database::package_set_id set,
+		set_snapshot_writer &writer, string_map &strings)
+  {
+    // The explicit collation of the first branch applies to the
+    // entire union.
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT s FROM (SELECT ''::text COLLATE \"C\" AS s"
+       " UNION SELECT name FROM sp"
+       " UNION SELECT nevra FROM sp"
+       " UNION SELECT arch FROM sp"
+       " UNION SELECT name FROM sf"
+       " UNION SELECT user_name FROM sf"
+       " UNION SELECT group_name FROM sf"
+       " UNION SELECT COALESCE(ef.arch::text, '')"
+       "  FROM symboldb.elf_file ef JOIN sc USING (contents_id)"
+       " UNION SELECT COALESCE(ef.soname, '')"
+       "  FROM symboldb.elf_file ef JOIN sc USING (contents_id)"
+       " UNION SELECT COALESCE(ef.interp, '')"
+       "  FROM symboldb.elf_file ef JOIN sc USING (contents_id)"
+       " UNION SELECT ed.name"
+       "  FROM symboldb.elf_definition ed JOIN sc USING (contents_id)"
+       " UNION SELECT COALESCE(ed.version, '')"
+       "  FROM symboldb.elf_definition ed JOIN sc USING (contents_id)"
+       " UNION SELECT er.name"
+       "  FROM symboldb.elf_reference er JOIN sc USING (contents_id)"
+       " UNION SELECT COALESCE(er.version, '')"
+       "  FROM symboldb.elf_reference er JOIN sc USING (contents_id)"
+       " UNION SELECT en.name"
+       "  FROM symboldb.elf_needed en JOIN sc USING (contents_id)"
+       ") x ORDER BY s", set.value());
+    std::string str;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(), str);
+      strings[str] = writer.add_string(str);
+    }
+  }
+
+  void
+  write_packages(pgconn_handle &conn, database::package_set_id set,
+		 set_snapshot_writer &writer, const string_map &strings,
+		 row_map &packages)
+  {
+    std::vector<uint32_t> name, nevra, arch;
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT package_id, name, nevra, arch FROM sp"
+       " ORDER BY nevra COLLATE \"C\", package_id", set.value());
+    int package_id;
+    std::string name_str, nevra_str, arch_str;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
+		  package_id, name_str, nevra_str, arch_str);
+      packages[package_id] = name.size();
+      name.push_back(lookup(strings, name_str));
+      nevra.push_back(lookup(strings, nevra_str));
+      arch.push_back(lookup(strings, arch_str));
+    }
+    writer.write(set_snapshot::package_name, name);
+    writer.write(set_snapshot::package_nevra, nevra);
+    writer.write(set_snapshot::package_arch, arch);
+  }
+
+  void
+  write_elf_files(pgconn_handle &conn, database::package_set_id set,
+		  set_snapshot_writer &writer, const string_map &strings,
+		  row_map &elf_files)
+  {
+    std::vector<uint32_t> type, machine, elf_class, arch, soname, interp;
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT ef.contents_id, ef.e_type, ef.e_machine, ef.ei_class,"
+       " COALESCE(ef.arch::text, ''), COALESCE(ef.soname, ''),"
+       " COALESCE(ef.interp, '')"
+       " FROM symboldb.elf_file ef JOIN sc USING (contents_id)"
+       " ORDER BY ef.contents_id", set.value());
+    int contents_id, type_val, machine_val;
+    short class_val;
+    std::string arch_str, soname_str, interp_str;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
+		  contents_id, type_val, machine_val, class_val,
+		  arch_str, soname_str, interp_str);
+      elf_files[contents_id] = type.size();
+      type.push_back(type_val);
+      machine.push_back(machine_val);
+      elf_class.push_back(class_val);
+      arch.push_back(lookup(strings, arch_str));
+      soname.push_back(lookup(strings, soname_str));
+      interp.push_back(lookup(strings, interp_str));
+    }
+    writer.write(set_snapshot::elf_type, type);
+    writer.write(set_snapshot::elf_machine, machine);
+    writer.write(set_snapshot::elf_class, elf_class);
+    writer.write(set_snapshot::elf_arch, arch);
+    writer.write(set_snapshot::elf_soname, soname);
+    writer.write(set_snapshot::elf_interp, interp);
+  }
+
+  void
+  write_files(pgconn_handle &conn, database::package_set_id set,
+	      set_snapshot_writer &writer, const string_map &strings,
+	      const row_map &packages, const row_map &elf_files,
+	      row_map &files)
+  {
+    std::vector<uint32_t> package, name, mode, user, group, elf;
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT file_id, package_id, contents_id, name, mode,"
+       " user_name, group_name FROM sf"
+       " ORDER BY name COLLATE \"C\", file_id", set.value());
+    int file_id, package_id, contents_id, mode_val;
+    std::string name_str, user_str, group_str;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
+		  file_id, package_id, contents_id, name_str, mode_val,
+		  user_str, group_str);
+      files[file_id] = package.size();
+      package.push_back(lookup(packages, package_id));
+      name.push_back(lookup(strings, name_str));
+      mode.push_back(mode_val);
+      user.push_back(lookup(strings, user_str));
+      group.push_back(lookup(strings, group_str));
+      row_map::const_iterator p(elf_files.find(contents_id));
+      elf.push_back(p == elf_files.end() ? set_snapshot::none : p->second);
+    }
+    writer.write(set_snapshot::file_package, package);
+    writer.write(set_snapshot::file_name, name);
+    writer.write(set_snapshot::file_mode, mode);
+    writer.write(set_snapshot::file_user, user);
+    writer.write(set_snapshot::file_group, group);
+    writer.write(set_snapshot::file_elf, elf);
+  }
+
+  void
+  write_definitions(pgconn_handle &conn, database::package_set_id set,
+		    set_snapshot_writer &writer, const string_map &strings,
+		    const row_map &elf_files)
+  {
+    std::vector<uint32_t> elf, name, version, type, binding, visibility,
+      default_version;
+    // Rows are sorted by ELF file within a symbol, which matches the
+    // order of the elf_files table.
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT ed.contents_id, ed.name, COALESCE(ed.version, ''),"
+       " ed.primary_version, ed.symbol_type, ed.binding,"
+       SNAPSHOT_VISIBILITY("ed")
+       " FROM symboldb.elf_definition ed JOIN sc USING (contents_id)"
+       " ORDER BY ed.name COLLATE \"C\","
+       " COALESCE(ed.version, '') COLLATE \"C\", ed.contents_id",
+       set.value());
+    int contents_id, visibility_val;
+    std::string name_str, version_str;
+    bool default_version_val;
+    short type_val, binding_val;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
+		  contents_id, name_str, version_str, default_version_val,
+		  type_val, binding_val, visibility_val);
+      elf.push_back(lookup(elf_files, contents_id));
+      name.push_back(lookup(strings, name_str));
+      version.push_back(lookup(strings, version_str));
+      type.push_back(type_val);
+      binding.push_back(binding_val);
+      visibility.push_back(visibility_val);
+      default_version.push_back(default_version_val);
+    }
+    writer.write(set_snapshot::definition_elf, elf);
+    writer.write(set_snapshot::definition_name, name);
+    writer.write(set_snapshot::definition_version, version);
+    writer.write(set_snapshot::definition_type, type);
+    writer.write(set_snapshot::definition_binding, binding);
+    writer.write(set_snapshot::definition_visibility, visibility);
+    writer.write(set_snapshot::definition_default_version,
+		 default_version);
+  }
+
+  void
+  write_references(pgconn_handle &conn, database::package_set_id set,
+		   set_snapshot_writer &writer, const string_map &strings,
+		   const row_map &elf_files)
+  {
+    std::vector<uint32_t> elf, name, version, type, binding, visibility;
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT er.contents_id, er.name, COALESCE(er.version, ''),"
+       " er.symbol_type, er.binding,"
+       SNAPSHOT_VISIBILITY("er")
+       " FROM symboldb.elf_reference er JOIN sc USING (contents_id)"
+       " ORDER BY er.name COLLATE \"C\","
+       " COALESCE(er.version, '') COLLATE \"C\", er.contents_id",
+       set.value());
+    int contents_id, visibility_val;
+    std::string name_str, version_str;
+    short type_val, binding_val;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
+		  contents_id, name_str, version_str,
+		  type_val, binding_val, visibility_val);
+      elf.push_back(lookup(elf_files, contents_id));
+      name.push_back(lookup(strings, name_str));
+      version.push_back(lookup(strings, version_str));
+      type.push_back(type_val);
+      binding.push_back(binding_val);
+      visibility.push_back(visibility_val);
+    }
+    writer.write(set_snapshot::reference_elf, elf);
+    writer.write(set_snapshot::reference_name, name);
+    writer.write(set_snapshot::reference_version, version);
+    writer.write(set_snapshot::reference_type, type);
+    writer.write(set_snapshot::reference_binding, binding);
+    writer.write(set_snapshot::reference_visibility, visibility);
+  }
+
+  void
+  write_program_headers(pgconn_handle &conn, database::package_set_id set,
+			set_snapshot_writer &writer, const row_map &elf_files)
+  {
+    std::vector<uint32_t> elf, type, flags;
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT eph.contents_id, eph.type,"
+       " eph.readable, eph.writable, eph.executable"
+       " FROM symboldb.elf_program_header eph JOIN sc USING (contents_id)"
+       " ORDER BY eph.contents_id, eph.file_offset", set.value());
+    int contents_id;
+    long long type_val;
+    bool readable, writable, executable;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(),
+		  contents_id, type_val, readable, writable, executable);
+      elf.push_back(lookup(elf_files, contents_id));
+      type.push_back(type_val);
+      // PF_R, PF_W, PF_X.
+      flags.push_back((readable ? 4 : 0) | (writable ? 2 : 0)
+		      | (executable ? 1 : 0));
+    }
+    writer.write(set_snapshot::program_header_elf, elf);
+    writer.write(set_snapshot::program_header_type, type);
+    writer.write(set_snapshot::program_header_flags, flags);
+  }
+
+  void
+  write_needed(pgconn_handle &conn, database::package_set_id set,
+	       set_snapshot_writer &writer, const string_map &strings,
+	       const row_map &elf_files)
+  {
+    std::vector<uint32_t> elf, name;
+    pg_cursor cursor(conn);
+    cursor.declare
+      (SNAPSHOT_SET
+       "SELECT en.contents_id, en.name"
+       " FROM symboldb.elf_needed en JOIN sc USING (contents_id)"
+       " ORDER BY en.contents_id, en.name COLLATE \"C\"", set.value());
+    int contents_id;
+    std::string name_str;
+    while (cursor.next()) {
+      pg_response(cursor.result(), cursor.row(), contents_id, name_str);
+      elf.push_back(lookup(elf_files, contents_id));
+      name.push_back(lookup(strings, name_str));
+    }
+    writer.write(set_snapshot::needed_elf, elf);
+    writer.write(set_snapshot::needed_name, name);
+  }
+
+  void
+  write_closure(pgconn_handle &conn, database::package_set_id set,
+		set_snapshot_writer &writer, const row_map &files)
+  {
+    // The file IDs are translated to rows in the files table, and
+    // the result is sorted by these rows.
+    std::vector<std::pair<uint32_t, uint32_t> > pairs;
+    {
+      pg_cursor cursor(conn);
+      cursor.declare
+	("SELECT file_id, needed FROM symboldb.elf_closure"
+	 " WHERE set_id = $1", set.value());
+      int file_id, needed_id;
+      while (cursor.next()) {
+	pg_response(cursor.result(), cursor.row(), file_id, needed_id);
+	pairs.push_back(std::make_pair(lookup(files, file_id),
+				       lookup(files, needed_id)));
+      }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<uint32_t> file, needed;
+    file.reserve(pairs.size());
+    needed.reserve(pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+      file.push_back(pairs[i].first);
+      needed.push_back(pairs[i].second);
+    }
+    writer.write(set_snapshot::closure_file, file);
+    writer.write(set_snapshot::closure_needed, needed);
+  }
+} // namespace
+
+void
+write_set_snapshot(pgconn_handle &conn, database::package_set_id set,
+		   const char *path)
+{
+  set_snapshot_writer writer(path);
+  row_map packages;
+  row_map elf_files;
+  row_map files;
+  {
+    string_map strings;
+    write_strings(conn, set, writer, strings);
+    write_packages(conn, set, writer, strings, packages);
+    write_elf_files(conn, set, writer, strings, elf_files);
+    write_files(conn, set, writer, strings, packages, elf_files, files);
+    write_definitions(conn, set, writer, strings, elf_files);
+    write_references(conn, set, writer, strings, elf_files);
+    write_needed(conn, set, writer, strings, elf_files);
+  }
+  write_program_headers(conn, set, writer, elf_files);
+  write_closure(conn, set, writer, files);
+  writer.commit();
+}
@@ -45,6 +45,10 @@ CREATE TYPE symboldb.rpm_dependency_kind AS ENUM (
 CREATE TYPE symboldb.elf_visibility AS ENUM
   ('default', 'internal', 'hidden', 'protected');
 
+-- Symbol tables loaded into elf_definition and elf_reference.
+CREATE TYPE symboldb.elf_symbol_selection AS ENUM
+  ('dynsym', 'global', 'all');
+
 CREATE DOMAIN symboldb.elf_byte AS SMALLINT
   CHECK (VALUE BETWEEN 0 AND 255);
 CREATE DOMAIN symboldb.elf_short AS INTEGER
@@ -312,7 +316,8 @@ CREATE TABLE symboldb.elf_file (
   arch symboldb.elf_arch,
   soname TEXT COLLATE "C",
   interp TEXT COLLATE "C",
-  build_id BYTEA CHECK (LENGTH(build_id) > 0)
+  build_id BYTEA CHECK (LENGTH(build_id) > 0),
+  symbols symboldb.elf_symbol_selection NOT NULL
 );
 
 CREATE TABLE symboldb.elf_program_header (
@@ -345,6 +350,8 @@ CREATE TABLE symboldb.elf_definition (
   -- xsection is only present when section is SHN_XINDEX.
   CHECK ((xsection IS NOT NULL) = (section = -1))
 );
+COMMENT ON COLUMN symboldb.elf_definition.primary_version IS
+  'true for the default version (foo@@VERS), false for foo@VERS';
 
 CREATE TABLE symboldb.elf_reference (
   contents_id INTEGER NOT NULL
@@ -394,6 +401,25 @@ CREATE TABLE symboldb.elf_closure (
   needed INTEGER NOT NULL REFERENCES symboldb.file
 );
 
+-- Outcome of resolving an ELF symbol reference against the
+-- DSOs in the elf_closure of the referencing file.
+CREATE TYPE symboldb.elf_symbol_resolution_status AS ENUM
+  ('resolved', 'unresolved', 'multiple');
+
+-- One row per reference and providing DSO.  Unresolved references
+-- have a NULL provider.  For 'multiple', there is one row for each
+-- DSO which defines the symbol.
+CREATE TABLE symboldb.elf_symbol_resolution (
+  set_id INTEGER NOT NULL REFERENCES symboldb.package_set
+    ON DELETE CASCADE,
+  file_id INTEGER NOT NULL REFERENCES symboldb.file,
+  name TEXT NOT NULL CHECK(length(name) > 0) COLLATE "C",
+  version TEXT CHECK (LENGTH(version) > 0) COLLATE "C",
+  provider INTEGER REFERENCES symboldb.file,
+  status symboldb.elf_symbol_resolution_status NOT NULL,
+  CHECK ((provider IS NULL) = (status = 'unresolved'))
+);
+
 -- Java classes.
 
 CREATE TABLE symboldb.java_class (
@@ -401,27 +427,11 @@ CREATE TABLE symboldb.java_class (
   access_flags INTEGER NOT NULL CHECK (access_flags BETWEEN 0 AND 65536),
   name TEXT NOT NULL CHECK(LENGTH(name) > 0) COLLATE "C",
   digest BYTEA NOT NULL UNIQUE CHECK(LENGTH(digest) = 32),
-  super_class TEXT NOT NULL COLLATE "C"
+  super_class TEXT NOT NULL COLLATE "C",
+  major_version INTEGER NOT NULL CHECK (major_version BETWEEN 0 AND 65535),
+  minor_version INTEGER NOT NULL CHECK (minor_version BETWEEN 0 AND 65535)
 );
 
-CREATE FUNCTION symboldb.intern_java_class (
-  digest BYTEA, name TEXT, super_class TEXT, access_flags INTEGER,
-  OUT cid INTEGER, OUT added BOOLEAN
-) LANGUAGE plpgsql AS $$
-BEGIN
-  SELECT class_id INTO cid
-    FROM symboldb.java_class jc WHERE jc.digest = $1;
-  IF FOUND THEN
-    added := FALSE;
-    RETURN;
-  END IF;
-  INSERT INTO symboldb.java_class (digest, name, super_class, access_flags)
-     VALUES ($1, $2, $3, $4) RETURNING class_id INTO cid;
-  added := TRUE;
-  RETURN;
-END;
-$$;
-
 CREATE TABLE symboldb.java_interface (
   class_id INTEGER NOT NULL REFERENCES symboldb.java_class ON DELETE CASCADE,
   name TEXT NOT NULL CHECK(LENGTH(name) > 0) COLLATE "C"
@@ -432,6 +442,36 @@ CREATE TABLE symboldb.java_class_reference (
   name TEXT NOT NULL CHECK (LENGTH(name) > 0) COLLATE "C"
 );
 
+CREATE TABLE symboldb.java_field (
+  class_id INTEGER NOT NULL REFERENCES symboldb.java_class ON DELETE CASCADE,
+  access_flags INTEGER NOT NULL CHECK (access_flags BETWEEN 0 AND 65535),
+  name TEXT NOT NULL CHECK (LENGTH(name) > 0) COLLATE "C",
+  descriptor TEXT NOT NULL CHECK (LENGTH(descriptor) > 0) COLLATE "C"
+);
+
+CREATE TABLE symboldb.java_method (
+  class_id INTEGER NOT NULL REFERENCES symboldb.java_class ON DELETE CASCADE,
+  access_flags INTEGER NOT NULL CHECK (access_flags BETWEEN 0 AND 65535),
+  name TEXT NOT NULL CHECK (LENGTH(name) > 0) COLLATE "C",
+  descriptor TEXT NOT NULL CHECK (LENGTH(descriptor) > 0) COLLATE "C"
+);
+
+CREATE TYPE symboldb.java_member_kind AS ENUM (
+  'field',
+  'method',
+  'interface_method'
+);
+
+CREATE TABLE symboldb.java_member_reference (
+  class_id INTEGER NOT NULL REFERENCES symboldb.java_class ON DELETE CASCADE,
+  kind symboldb.java_member_kind NOT NULL,
+  class_name TEXT NOT NULL CHECK (LENGTH(class_name) > 0) COLLATE "C",
+  name TEXT NOT NULL CHECK (LENGTH(name) > 0) COLLATE "C",
+  descriptor TEXT NOT NULL CHECK (LENGTH(descriptor) > 0) COLLATE "C"
+);
+COMMENT ON TABLE symboldb.java_member_reference IS
+  'field and method references in the constant pool of a class';
+
 CREATE TABLE symboldb.java_error (
   contents_id INTEGER NOT NULL
     REFERENCES symboldb.file_contents ON DELETE CASCADE,
@@ -47,6 +47,8 @@ CREATE INDEX ON symboldb.symlink (target);
 ALTER TABLE symboldb.directory ADD PRIMARY KEY (package_id, name);
 CREATE INDEX ON symboldb.directory (name);
 
+CREATE INDEX ON symboldb.elf_file (build_id);
+
 CREATE INDEX ON symboldb.elf_program_header (contents_id);
 
 CREATE INDEX ON symboldb.elf_definition (contents_id);
@@ -69,6 +71,10 @@ CREATE INDEX ON symboldb.xml_error (contents_id);
 CREATE INDEX ON symboldb.elf_closure (file_id);
 CREATE INDEX ON symboldb.elf_closure (needed);
 
+CREATE INDEX ON symboldb.elf_symbol_resolution (set_id, file_id);
+CREATE INDEX ON symboldb.elf_symbol_resolution (name, version);
+CREATE INDEX ON symboldb.elf_symbol_resolution (provider);
+
 CREATE INDEX ON symboldb.java_class (name);
 CREATE INDEX ON symboldb.java_class (super_class);
 
@@ -78,6 +84,16 @@ CREATE INDEX ON symboldb.java_interface (name);
 ALTER TABLE symboldb.java_class_reference ADD PRIMARY KEY (name, class_id);
 CREATE INDEX ON symboldb.java_class_reference (class_id);
 
+ALTER TABLE symboldb.java_field ADD PRIMARY KEY (class_id, name, descriptor);
+CREATE INDEX ON symboldb.java_field (name);
+
+ALTER TABLE symboldb.java_method ADD PRIMARY KEY (class_id, name, descriptor);
+CREATE INDEX ON symboldb.java_method (name);
+
+ALTER TABLE symboldb.java_member_reference
+  ADD PRIMARY KEY (class_id, kind, class_name, name, descriptor);
+CREATE INDEX ON symboldb.java_member_reference (class_name, name);
+
 CREATE INDEX ON symboldb.java_error (contents_id, path);
 
 CREATE INDEX ON symboldb.java_maven_url (contents_id);
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// sourcebench measures the throughput of copy_source_to_sink over
+// the existing sources, for a range of buffer sizes.
+
+#include <cxxll/fd_handle.hpp>
+#include <cxxll/fd_sink.hpp>
+#include <cxxll/fd_source.hpp>
+#include <cxxll/gunzip_source.hpp>
+#include <cxxll/hash.hpp>
+#include <cxxll/memory_range_source.hpp>
+#include <cxxll/os.hpp>
+#include <cxxll/read_only_source.hpp>
+#include <cxxll/rpm_parser.hpp>
+#include <cxxll/sink.hpp>
+#include <cxxll/source_sink.hpp>
+#include <cxxll/string_support.hpp>
+#include <cxxll/temporary_directory.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <zlib.h>
+
+using namespace cxxll;
+
+namespace {
+  // Discards the data.
+  struct null_sink : sink {
+    void write(const_stringref) { }
+  };
+
+  const size_t buffer_sizes[] = {
+    4096, 8192, 64 * 1024, 256 * 1024, 1024 * 1024
+  };
+
+  void
+  report(const char *name, size_t buffer_size,
+	 unsigned long long bytes, double seconds)
+  {
+    printf("%-24s %8zu %10.1f MB/s\n", name, buffer_size,
+	   bytes / seconds / (1024 * 1024));
+  }
+
+  // Deterministic, moderately compressible data.
+  void
+  make_data(std::vector<unsigned char> &data, size_t size)
+  {
+    data.resize(size);
+    unsigned state = 1;
+    for (size_t i = 0; i < size; ++i) {
+      state = state * 1103515245 + 12345;
+      data[i] = "0123456789abcdef"[(state >> 16) & 15];
+    }
+  }
+
+  void
+  gzip_compress(const std::vector<unsigned char> &in,
+		std::vector<unsigned char> &out)
+  {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+		     16 + MAX_WBITS /* gzip */, 8, Z_DEFAULT_STRATEGY)
+	!= Z_OK) {
+      fprintf(stderr, "error: deflateInit2 failed\n");
+      exit(1);
+    }
+    out.resize(deflateBound(&stream, in.size()));
+    stream.next_in = const_cast<unsigned char *>(&in.front());
+    stream.avail_in = in.size();
+    stream.next_out = &out.front();
+    stream.avail_out = out.size();
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+      fprintf(stderr, "error: deflate failed\n");
+      exit(1);
+    }
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  unsigned long long megabytes = 256;
+  if (argc > 2
+      || (argc == 2 && (!parse_unsigned_long_long(argv[1], megabytes)
+			|| megabytes == 0))) {
+    fprintf(stderr, "usage: %s [MEGABYTES]\n", argv[0]);
+    return 2;
+  }
+
+  rpm_parser_init();
+
+  std::vector<unsigned char> data;
+  make_data(data, megabytes * 1024 * 1024);
+  std::vector<unsigned char> compressed;
+  gzip_compress(data, compressed);
+
+  temporary_directory tempdir;
+  std::string path(tempdir.path("data"));
+  {
+    fd_handle out;
+    out.open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    fd_sink sink(out.get());
+    sink.write(const_stringref(data));
+    out.close();
+  }
+
+  // Large enough for all buffer sizes, allocated once.
+  std::vector<unsigned char> buffer
+    (*std::max_element(buffer_sizes, buffer_sizes
+		       + sizeof(buffer_sizes) / sizeof(*buffer_sizes)));
+
+  printf("%-24s %8s %15s\n", "source", "buffer", "throughput");
+  for (const size_t *p = buffer_sizes;
+       p != buffer_sizes + sizeof(buffer_sizes) / sizeof(*buffer_sizes);
+       ++p) {
+    size_t buffer_size = *p;
+    {
+      memory_range_source src(&data.front(), data.size());
+      null_sink sink;
+      double start = ticks();
+      unsigned long long bytes = copy_source_to_sink
+	(src, sink, &buffer.front(), buffer_size);
+      report("memory (borrow)", buffer_size, bytes, ticks() - start);
+    }
+    {
+      memory_range_source mrsource(&data.front(), data.size());
+      read_only_source src(&mrsource);
+      null_sink sink;
+      double start = ticks();
+      unsigned long long bytes = copy_source_to_sink
+	(src, sink, &buffer.front(), buffer_size);
+      report("memory (read)", buffer_size, bytes, ticks() - start);
+    }
+    {
+      fd_handle handle;
+      handle.open_read_only(path.c_str());
+      fd_source src(handle.get());
+      null_sink sink;
+      double start = ticks();
+      unsigned long long bytes = copy_source_to_sink
+	(src, sink, &buffer.front(), buffer_size);
+      report("fd", buffer_size, bytes, ticks() - start);
+    }
+    {
+      fd_handle handle;
+      handle.open_read_only(path.c_str());
+      fd_source src(handle.get());
+      hash_sink sink(hash_sink::sha256);
+      double start = ticks();
+      unsigned long long bytes = copy_source_to_sink
+	(src, sink, &buffer.front(), buffer_size);
+      report("fd + sha256", buffer_size, bytes, ticks() - start);
+    }
+    {
+      memory_range_source mrsource(&compressed.front(), compressed.size());
+      gunzip_source src(&mrsource);
+      null_sink sink;
+      double start = ticks();
+      unsigned long long bytes = copy_source_to_sink
+	(src, sink, &buffer.front(), buffer_size);
+      report("gunzip", buffer_size, bytes, ticks() - start);
+    }
+  }
+  return 0;
+}
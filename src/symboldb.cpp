@@ -34,16 +34,20 @@
 #include <symboldb/download_repo.hpp>
 #include <symboldb/show_source_packages.hpp>
 #include <symboldb/expire.hpp>
+#include <symboldb/diff_sets.hpp>
 #include <cxxll/os.hpp>
+#include <cxxll/os_exception.hpp>
 #include <cxxll/base16.hpp>
 #include <cxxll/curl_exception.hpp>
 #include <cxxll/curl_exception_dump.hpp>
 #include <cxxll/file_handle.hpp>
+#include <cxxll/python_analyzer_pool.hpp>
 #include <symboldb/get_file.hpp>
 
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -168,6 +172,41 @@ do_file(const symboldb_options &opt, database &db, const char *arg)
   return 1;
 }
 
+static int
+do_build_id(const symboldb_options &, database &db, char **argv)
+{
+  int errors = 0;
+  for (; *argv; ++argv) {
+    std::string arg(*argv);
+    std::vector<unsigned char> build_id;
+    try {
+      base16_decode(arg.begin(), arg.end(), std::back_inserter(build_id));
+    } catch (base16_decode_exception &) {
+      build_id.clear();
+    }
+    if (build_id.empty()) {
+      fprintf(stderr, "error: not a hexadecimal build ID: %s\n", *argv);
+      ++errors;
+      continue;
+    }
+    database::files_with_build_id files(db, build_id);
+    bool found = false;
+    while (files.next()) {
+      printf("%s %s %s\n", arg.c_str(),
+	     files.nevra().c_str(), files.file_name().c_str());
+      found = true;
+    }
+    if (!found) {
+      fprintf(stderr, "error: could not locate build ID %s\n", *argv);
+      ++errors;
+    }
+  }
+  if (errors > 0) {
+    return 1;
+  }
+  return 0;
+}
+
 static int
 do_download(const symboldb_options &opt, database &db, const char *url)
 {
@@ -236,6 +275,24 @@ do_show_soname_conflicts(const symboldb_options &opt, database &db)
   }
 }
 
+static int
+do_snapshot_set(const symboldb_options &opt, database &db, const char *path)
+{
+  database::package_set_id pset = db.lookup_package_set(opt.set_name.c_str());
+  if (pset > database::package_set_id()) {
+    try {
+      db.write_set_snapshot(pset, path);
+    } catch (os_exception &e) {
+      fprintf(stderr, "error: could not write snapshot: %s\n", e.what());
+      return 1;
+    }
+    return 0;
+  } else {
+    fprintf(stderr, "error: invalid package set: %s\n", opt.set_name.c_str());
+    return 1;
+  }
+}
+
 static int
 do_run_example(const symboldb_options &opt, database &db, char **argv)
 {
@@ -304,6 +361,7 @@ usage(const char *progname, const char *error = NULL)
 "  %1$s --update-set=NAME [OPTIONS] RPM-FILE...\n"
 "  %1$s --update-set-from-repo=NAME [OPTIONS] URL...\n"
 "  %1$s --download [OPTIONS] URL\n"
+"  %1$s --build-id BUILD-ID...\n"
 "  %1$s --show-repomd [OPTIONS] URL\n"
 "  %1$s --show-primary [OPTIONS] URL\n"
 "  %1$s --download-repo [OPTIONS] URL...\n"
@@ -311,11 +369,16 @@ usage(const char *progname, const char *error = NULL)
 "  %1$s --show-source-packages [OPTIONS] URL...\n"
 "  %1$s --show-stale-cached-rpms [OPTIONS]\n"
 "  %1$s --show-soname-conflicts=PACKAGE-SET [OPTIONS]\n"
+"  %1$s --diff-sets=OLD-SET,NEW-SET [OPTIONS]\n"
+"  %1$s --snapshot-set=PACKAGE-SET [OPTIONS] FILE\n"
 "\nOptions:\n"
 "  --delete-rpms          delete downloaded RPMs after database loading\n"
+"  --header-fast-track    skip RPMs with known headers before downloading\n"
+"  --elf-symbols=WHICH    load dynsym, global or all ELF symbols (default: all)\n"
 "  --randomize            perform downloads in random order\n"
 "  --exclude-name=REGEXP  exclude packages whose name matches REGEXP\n"
 "  --download-threads=N   number of parallel downloads (default: 3)\n"
+"  --load-threads=N       threads for analyzing RPM contents (default: 1)\n"
 "  --quiet, -q            less output\n"
 "  --cache=DIR, -C        path to the cache (default: ~/.cache/symboldb)\n"
 "  --ignore-download-errors   process repositories with download errors\n"
@@ -326,6 +389,15 @@ usage(const char *progname, const char *error = NULL)
 }
 
 namespace {
+  // Stops the Python interpreters of the shared analyzer pool when
+  // main returns, whichever way it returns.
+  struct python_pool_guard {
+    ~python_pool_guard()
+    {
+      python_analyzer_pool::shared_deinit();
+    }
+  };
+
   namespace command {
     typedef enum {
       undefined = 1000,
@@ -340,11 +412,14 @@ namespace {
       download_repo,
       load_repo,
       file,
+      build_id,
       show_repomd,
       show_primary,
       show_source_packages,
       show_stale_cached_rpms,
       show_soname_conflicts,
+      diff_sets,
+      snapshot_set,
       expire,
       run_example,
     } type;
@@ -354,9 +429,12 @@ namespace {
       undefined = 2000,
       exclude_name,
       download_threads,
+      load_threads,
       ignore_download_errors,
       randomize,
       delete_rpms,
+      header_fast_track,
+      elf_symbols,
     } type;
   }
 }
@@ -366,6 +444,8 @@ main(int argc, char **argv)
 {
   symboldb_options opt;
   command::type cmd = command::undefined;
+  std::string diff_old_set;
+  std::string diff_new_set;
   {
     static const struct option long_options[] = {
       {"create-schema", no_argument, 0, command::create_schema},
@@ -379,6 +459,7 @@ main(int argc, char **argv)
       {"download-repo", no_argument, 0, command::download_repo},
       {"load-repo", no_argument, 0, command::load_repo},
       {"file", no_argument, 0, command::file},
+      {"build-id", no_argument, 0, command::build_id},
       {"show-repomd", no_argument, 0, command::show_repomd},
       {"show-primary", no_argument, 0, command::show_primary},
       {"show-source-packages", no_argument, 0, command::show_source_packages},
@@ -386,12 +467,17 @@ main(int argc, char **argv)
        command::show_stale_cached_rpms},
       {"show-soname-conflicts", required_argument, 0,
        command::show_soname_conflicts},
+      {"diff-sets", required_argument, 0, command::diff_sets},
+      {"snapshot-set", required_argument, 0, command::snapshot_set},
       {"expire", no_argument, 0, command::expire},
       {"run-example", no_argument, 0, command::run_example},
       {"exclude-name", required_argument, 0, options::exclude_name},
       {"download-threads", required_argument, 0, options::download_threads},
+      {"load-threads", required_argument, 0, options::load_threads},
       {"randomize", no_argument, 0, options::randomize},
       {"delete-rpms", no_argument, 0, options::delete_rpms},
+      {"header-fast-track", no_argument, 0, options::header_fast_track},
+      {"elf-symbols", required_argument, 0, options::elf_symbols},
       {"cache", required_argument, 0, 'C'},
       {"no-net", no_argument, 0, 'N'},
       {"ignore-download-errors", no_argument, 0,
@@ -421,12 +507,24 @@ main(int argc, char **argv)
       case command::update_set:
       case command::update_set_from_repo:
       case command::show_soname_conflicts:
+      case command::snapshot_set:
 	if (optarg[0] == '\0') {
 	  usage(argv[0], "invalid package set name");
 	}
 	cmd = static_cast<command::type>(ch);
 	opt.set_name = optarg;
 	break;
+      case command::diff_sets:
+	{
+	  const char *comma = strchr(optarg, ',');
+	  if (comma == NULL || comma == optarg || comma[1] == '\0') {
+	    usage(argv[0], "--diff-sets requires two package set names");
+	  }
+	  diff_old_set.assign(optarg, comma - optarg);
+	  diff_new_set = comma + 1;
+	}
+	cmd = static_cast<command::type>(ch);
+	break;
       case command::create_schema:
       case command::create_schema_base:
       case command::create_schema_index:
@@ -435,6 +533,7 @@ main(int argc, char **argv)
       case command::download_repo:
       case command::load_repo:
       case command::file:
+      case command::build_id:
       case command::show_repomd:
       case command::show_primary:
       case command::show_source_packages:
@@ -452,12 +551,28 @@ main(int argc, char **argv)
 	  usage(argv[0]);
 	}
 	break;
+      case options::load_threads:
+	opt.load_threads = atoi(optarg);
+	if (opt.load_threads == 0) {
+	  usage(argv[0]);
+	}
+	break;
       case options::randomize:
 	opt.randomize = true;
 	break;
       case options::delete_rpms:
 	opt.transient_rpms = true;
 	break;
+      case options::header_fast_track:
+	opt.header_fast_track = true;
+	break;
+      case options::elf_symbols:
+	try {
+	  opt.set_elf_symbols(optarg);
+	} catch (symboldb_options::usage_error &e) {
+	  usage(argv[0], e.what());
+	}
+	break;
       case options::ignore_download_errors:
 	opt.ignore_download_errors = true;
 	break;
@@ -473,6 +588,7 @@ main(int argc, char **argv)
     case command::show_source_packages:
     case command::download_repo:
     case command::load_repo:
+    case command::build_id:
     case command::run_example:
       if (argc == optind) {
 	usage(argv[0]);
@@ -482,6 +598,7 @@ main(int argc, char **argv)
     case command::create_schema_base:
     case command::create_schema_index:
     case command::show_soname_conflicts:
+    case command::diff_sets:
     case command::expire:
       if (argc != optind) {
 	usage(argv[0]);
@@ -497,6 +614,7 @@ main(int argc, char **argv)
     case command::file:
     case command::show_repomd:
     case command::show_primary:
+    case command::snapshot_set:
       if (argc - optind != 1) {
 	usage(argv[0]);
       }
@@ -505,6 +623,7 @@ main(int argc, char **argv)
 
   elf_image_init();
   rpm_parser_init();
+  python_pool_guard python_guard;
 
   try {
     database db;
@@ -531,6 +650,8 @@ main(int argc, char **argv)
       return symboldb_download_repo(opt, db, argv + optind, true);
     case command::file:
       return do_file(opt, db, argv[optind]);
+    case command::build_id:
+      return do_build_id(opt, db, argv + optind);
     case command::show_repomd:
       return do_show_repomd(opt, db, argv[optind]);
     case command::show_primary:
@@ -541,6 +662,11 @@ main(int argc, char **argv)
       return do_show_stale_cached_rpms(opt, db);
     case command::show_soname_conflicts:
       return do_show_soname_conflicts(opt, db);
+    case command::diff_sets:
+      return symboldb_diff_sets(opt, db, diff_old_set.c_str(),
+				diff_new_set.c_str());
+    case command::snapshot_set:
+      return do_snapshot_set(opt, db, argv[optind]);
     case command::expire:
       expire(opt, db);
       return 0;
@@ -10,18 +10,19 @@ Source0:        https://github.com/fweimer/symboldb/archive/v%{version}.tar.gz
 BuildRequires:	cmake
 BuildRequires:	curl-devel
 BuildRequires:	elfutils-devel
-BuildRequires:	elfutils-libelf-devel
 BuildRequires:	expat-devel
 BuildRequires:	gawk
-BuildRequires:	libarchive-devel
 BuildRequires:	nss-devel
 BuildRequires:	postgresql-contrib
 BuildRequires:	postgresql-devel
 BuildRequires:	postgresql-server
 BuildRequires:	rpm-devel
+BuildRequires:	sqlite-devel
 BuildRequires:	vim-common
 BuildRequires:	xmlto
+BuildRequires:	xz-devel
 BuildRequires:	zlib-devel
+BuildRequires:	libzstd-devel
 BuildRequires:  python
 BuildRequires:  python3
 
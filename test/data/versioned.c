@@ -0,0 +1,8 @@
+/* Test DSO with two versions of foo: foo@V1 (hidden, only reachable
+   through a versioned reference) and foo@@V2 (the default version).
+   Built by versioned.sh.  */
+
+int foo_v1(void) { return 1; }
+int foo_v2(void) { return 2; }
+__asm__(".symver foo_v1, foo@V1");
+__asm__(".symver foo_v2, foo@@V2");
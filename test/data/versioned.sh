@@ -0,0 +1,25 @@
+#!/bin/bash
+# Copyright (C) 2013 Red Hat, Inc.
+# Written by Florian Weimer <fweimer@redhat.com>
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Build the versioned.so test DSO.  We do not do this during regular
+# builds because the result depends on the toolchain.
+
+gcc -shared -fPIC -nostdlib -O2 -s \
+    -Wl,--version-script=versioned.map -Wl,-soname,libversioned.so \
+    -Wl,--build-id=none -Wl,--hash-style=gnu \
+    -Wl,-z,noseparate-code -Wl,-z,max-page-size=4096 \
+    -o versioned.so versioned.c
@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/elf_image.hpp>
+#include <cxxll/elf_exception.hpp>
+#include <cxxll/elf_symbol_definition.hpp>
+#include <cxxll/elf_symbol_reference.hpp>
+#include <cxxll/elf_symbol_batch.hpp>
+#include <cxxll/rpm_parser.hpp>
+#include <cxxll/rpm_file_entry.hpp>
+#include <cxxll/base16.hpp>
+#include <cxxll/read_file.hpp>
+
+#include <elf.h>
+
+#include "test.hpp"
+
+using namespace cxxll;
+
+namespace {
+  struct wall_binary {
+    const char *rpm;
+    unsigned char ei_class;
+    unsigned char ei_data;
+    const char *arch;
+    const char *interp;
+    const char *build_id;
+    const char *strlen_version;
+    unsigned long long edata;
+  };
+
+  const wall_binary binaries[] = {
+    {"test/data/sysvinit-tools-2.88-9.dsf.fc18.x86_64.rpm",
+     ELFCLASS64, ELFDATA2LSB, "x86_64", "/lib64/ld-linux-x86-64.so.2",
+     "36d9f2992247e4afaf292e939c4a3cb25204c142", "GLIBC_2.2.5", 0x203010},
+    {"test/data/sysvinit-tools-2.88-9.dsf.fc18.i686.rpm",
+     ELFCLASS32, ELFDATA2LSB, "i386", "/lib/ld-linux.so.2",
+     "6d359194281bdca4681036c84ddc74528db69d14", "GLIBC_2.0", 0x3008},
+    {"test/data/sysvinit-tools-2.88-9.dsf.fc18.ppc64.rpm",
+     ELFCLASS64, ELFDATA2MSB, "ppc64", "/lib64/ld64.so.1",
+     "20a51bec675baf2de0caaf1b214caba1bcd71372", "GLIBC_2.3", 0x20138},
+    {"test/data/sysvinit-tools-2.88-9.dsf.fc18.ppc.rpm",
+     ELFCLASS32, ELFDATA2MSB, "ppc", "/lib/ld.so.1",
+     "27fd63f96e6a8898ce1e6730b2ea4a29a71f89ed", "GLIBC_2.0", 0x2001c},
+    {NULL, 0, 0, NULL, NULL, NULL, NULL, 0}
+  };
+
+  void
+  read_wall(const char *rpm, std::vector<unsigned char> &contents)
+  {
+    rpm_parser parser(rpm);
+    rpm_file_entry file;
+    while (parser.read_file(file)) {
+      if (file.infos.at(0).name == "/usr/bin/wall") {
+	contents.swap(file.contents);
+	return;
+      }
+    }
+    CHECK(false);
+  }
+
+  void
+  check_wall(const wall_binary &b)
+  {
+    std::vector<unsigned char> contents;
+    read_wall(b.rpm, contents);
+    elf_image image(contents.data(), contents.size());
+    COMPARE_NUMBER(image.ei_class(), b.ei_class);
+    COMPARE_NUMBER(image.ei_data(), b.ei_data);
+    COMPARE_STRING(image.arch(), b.arch);
+    COMPARE_STRING(image.interp(), b.interp);
+    COMPARE_STRING(base16_encode(image.build_id().begin(),
+				 image.build_id().end()), b.build_id);
+
+    {
+      std::vector<std::string> needed;
+      elf_image::dynamic_section_range dyn(image);
+      while (dyn.next()) {
+	if (dyn.type() == elf_image::dynamic_section_range::needed) {
+	  needed.push_back(dyn.text());
+	}
+      }
+      COMPARE_NUMBER(needed.size(), 2U);
+      COMPARE_STRING(needed.at(0), "libcrypt.so.1");
+      COMPARE_STRING(needed.at(1), "libc.so.6");
+    }
+
+    {
+      bool seen_strlen = false;
+      bool seen_edata = false;
+      elf_image::symbol_range symbols(image);
+      while (symbols.next()) {
+	if (symbols.symbol_name() == "strlen") {
+	  CHECK(!symbols.is_definition());
+	  std::tr1::shared_ptr<elf_symbol_reference> ref
+	    (symbols.reference());
+	  CHECK(ref);
+	  CHECK(!symbols.definition());
+	  COMPARE_STRING(ref->symbol_name, "strlen");
+	  COMPARE_STRING(ref->vna_name, b.strlen_version);
+	  COMPARE_STRING(symbols.version_name().str(), b.strlen_version);
+	  COMPARE_NUMBER(ref->type, STT_FUNC);
+	  COMPARE_NUMBER(ref->binding, STB_GLOBAL);
+	  seen_strlen = true;
+	} else if (symbols.symbol_name() == "_edata") {
+	  CHECK(symbols.is_definition());
+	  std::tr1::shared_ptr<elf_symbol_definition> def
+	    (symbols.definition());
+	  CHECK(def);
+	  COMPARE_STRING(def->symbol_name, "_edata");
+	  COMPARE_NUMBER(def->value, b.edata);
+	  COMPARE_NUMBER(symbols.value(), b.edata);
+	  seen_edata = true;
+	}
+      }
+      CHECK(seen_strlen);
+      CHECK(seen_edata);
+    }
+
+    // The batch contains the same symbols as symbol_range.
+    {
+      elf_symbol_batch batch;
+      image.symbols(batch);
+      size_t def = 0;
+      size_t ref = 0;
+      elf_image::symbol_range symbols(image);
+      while (symbols.next()) {
+	if (symbols.symbol_name().empty()) {
+	  continue;
+	}
+	const elf_symbol_batch::symbols *cols;
+	size_t row;
+	if (symbols.is_definition()) {
+	  cols = &batch.defs;
+	  row = def++;
+	  CHECK(row < batch.defs.size());
+	  COMPARE_NUMBER(batch.defs.value.at(row), symbols.value());
+	  COMPARE_NUMBER(batch.defs.section.at(row), symbols.section());
+	  CHECK(batch.defs.default_version.at(row)
+		== symbols.default_version());
+	} else {
+	  cols = &batch.refs;
+	  row = ref++;
+	  CHECK(row < batch.refs.size());
+	}
+	COMPARE_STRING(batch.string(cols->name.at(row)),
+		       symbols.symbol_name().str());
+	if (symbols.version_name().empty()) {
+	  CHECK(cols->version.at(row) == elf_symbol_batch::no_string);
+	} else {
+	  COMPARE_STRING(batch.string(cols->version.at(row)),
+			 symbols.version_name().str());
+	}
+	COMPARE_NUMBER(cols->type.at(row), symbols.type());
+	COMPARE_NUMBER(cols->binding.at(row), symbols.binding());
+	COMPARE_NUMBER(cols->visibility.at(row),
+		       ELF64_ST_VISIBILITY(symbols.other()));
+      }
+      COMPARE_NUMBER(def, batch.defs.size());
+      COMPARE_NUMBER(ref, batch.refs.size());
+      CHECK(def > 0);
+      CHECK(ref > 0);
+
+      batch.clear();
+      CHECK(batch.arena.empty());
+      COMPARE_NUMBER(batch.defs.size(), 0U);
+      COMPARE_NUMBER(batch.refs.size(), 0U);
+    }
+
+    // Truncated images must be rejected (or parsed partially)
+    // without reading beyond the end of the buffer.
+    for (size_t size = 0; size < contents.size(); size += 97) {
+      std::vector<unsigned char> truncated
+	(contents.begin(), contents.begin() + size);
+      try {
+	elf_image truncated_image(truncated.data(), truncated.size());
+	elf_image::symbol_range symbols(truncated_image);
+	while (symbols.next()) {
+	}
+      } catch (elf_exception &) {
+      }
+    }
+  }
+
+  // Counts the symbols for the selection.  Sets LOCAL_TEST if a
+  // local symbol for test() (below) was found.
+  size_t
+  count_symbols(const elf_image &image,
+		elf_image::symbol_selection selection, bool &local_test)
+  {
+    local_test = false;
+    size_t count = 0;
+    elf_image::symbol_range symbols(image, selection);
+    while (symbols.next()) {
+      ++count;
+      if (symbols.binding() == STB_LOCAL
+	  && symbols.symbol_name() == "_ZL4testv") {
+	local_test = true;
+      }
+    }
+    return count;
+  }
+
+  // Uses the test binary itself, which is not stripped.
+  void
+  check_selection()
+  {
+    std::vector<unsigned char> contents;
+    read_file("/proc/self/exe", contents);
+    elf_image image(contents.data(), contents.size());
+    bool local_dynsym;
+    bool local_global;
+    bool local_all;
+    size_t dynsym = count_symbols(image, elf_image::dynsym_only,
+				  local_dynsym);
+    size_t global = count_symbols(image, elf_image::global_symbols,
+				  local_global);
+    size_t all = count_symbols(image, elf_image::all_symbols, local_all);
+    CHECK(dynsym < global);
+    CHECK(global < all);
+    CHECK(!local_dynsym);
+    CHECK(!local_global);
+    CHECK(local_all);
+
+    elf_symbol_batch batch;
+    image.symbols(batch, elf_image::dynsym_only);
+    CHECK(batch.defs.size() + batch.refs.size() <= dynsym);
+  }
+}
+
+// foo@V1 is hidden, foo@@V2 is the default version.
+static void
+check_versions()
+{
+  test_section ts("versioned.so");
+  std::vector<unsigned char> contents;
+  read_file("test/data/versioned.so", contents);
+  elf_image image(contents.data(), contents.size());
+  elf_image::symbol_range symbols(image);
+  unsigned found = 0;
+  while (symbols.next()) {
+    if (symbols.symbol_name().str() != "foo") {
+      continue;
+    }
+    CHECK(symbols.is_definition());
+    std::string version(symbols.version_name().str());
+    if (version == "V1") {
+      CHECK(!symbols.default_version());
+      CHECK(!symbols.definition()->default_version);
+      found |= 1;
+    } else if (version == "V2") {
+      CHECK(symbols.default_version());
+      CHECK(symbols.definition()->default_version);
+      found |= 2;
+    } else {
+      COMPARE_STRING(version, "V1 or V2");
+    }
+  }
+  COMPARE_NUMBER(found, 3U);
+}
+
+static void
+test()
+{
+  COMPARE_STRING(elf_image::to_string(elf_image::dynsym_only), "dynsym");
+  COMPARE_STRING(elf_image::to_string(elf_image::global_symbols), "global");
+  COMPARE_STRING(elf_image::to_string(elf_image::all_symbols), "all");
+  CHECK(elf_image::symbol_selection_from_string("dynsym")
+	== elf_image::dynsym_only);
+  CHECK(elf_image::symbol_selection_from_string("global")
+	== elf_image::global_symbols);
+  CHECK(elf_image::symbol_selection_from_string("all")
+	== elf_image::all_symbols);
+  try {
+    elf_image::symbol_selection_from_string("symtab");
+    CHECK(false);
+  } catch (std::runtime_error &) {
+  }
+
+  check_selection();
+  check_versions();
+
+  for (const wall_binary *p = binaries; p->rpm; ++p) {
+    check_wall(*p);
+  }
+
+  {
+    static const unsigned char not_elf[] = "#!/bin/sh\n";
+    try {
+      elf_image image(not_elf, sizeof(not_elf));
+      CHECK(false);
+    } catch (elf_exception &e) {
+      COMPARE_STRING(e.what(), "not an ELF image");
+    }
+  }
+}
+
+static test_register t("elf_image", test);
@@ -17,15 +17,43 @@
  */
 
 #include <cxxll/expat_source.hpp>
+#include <cxxll/const_stringref.hpp>
 #include <cxxll/string_source.hpp>
 
 #include "test.hpp"
 
 using namespace cxxll;
 
+static void
+test_text_and_next()
+{
+  string_source xml("<root><a>first</a><b>x<c/></b><d>y&amp;z</d></root>");
+  expat_source src(&xml);
+  std::string text("previous contents");
+  CHECK(src.next()); // <root>
+  CHECK(src.next()); // <a>
+  CHECK(src.next());
+  src.text_and_next(text);
+  COMPARE_STRING(text, "first");
+  CHECK(src.state() == expat_source::END);
+  CHECK(src.next()); // <b>
+  CHECK(src.next());
+  src.text_and_next(text);
+  COMPARE_STRING(text, "x");
+  CHECK(src.state() == expat_source::START);
+  src.skip(); // <c/>
+  CHECK(src.state() == expat_source::END);
+  CHECK(src.next()); // <d>
+  CHECK(src.name_ref() == "d");
+  CHECK(src.next());
+  src.text_and_next(text);
+  COMPARE_STRING(text, "y&z");
+}
+
 static void
 test()
 {
+  test_text_and_next();
   {
     string_source xml("<root></root>");
     //                 1234567890123
@@ -62,11 +90,17 @@ test()
     CHECK(src.attributes().size() == 1);
     COMPARE_STRING(src.attributes()["attribute"], "value");
     COMPARE_STRING(src.attribute("attribute"), "value");
+    COMPARE_STRING(src.attribute_ptr("attribute"), "value");
+    CHECK(src.attribute_ptr("attr") == NULL);
+    CHECK(src.attribute_ptr("attributes") == NULL);
+    CHECK(src.name_ref() == "root");
+    COMPARE_NUMBER(src.name_ref().size(), 4U);
     CHECK(src.next());
     CHECK(src.state() == expat_source::TEXT);
     COMPARE_NUMBER(src.line(), 1U);
     COMPARE_NUMBER(src.column(), 25U);
     COMPARE_STRING(src.text(), "text-element");
+    CHECK(src.text_ref() == "text-element");
     CHECK(src.next());
     CHECK(src.state() == expat_source::END);
     COMPARE_NUMBER(src.line(), 1U);
@@ -17,6 +17,8 @@
  */
 
 #include <cxxll/java_class.hpp>
+#include <cxxll/java_class_batch.hpp>
+#include <cxxll/hash.hpp>
 #include <cxxll/read_file.hpp>
 
 #include <algorithm>
@@ -67,6 +69,139 @@ test()
 	}
       }
     }
+    CHECK(jc.major_version() == 51);
+    CHECK(jc.minor_version() == 0);
+    CHECK(jc.field_count() == 7);
+    CHECK(jc.field(0).access_flags == 25);
+    COMPARE_STRING(jc.utf8_string(jc.field(0).name_index), "BYTE");
+    COMPARE_STRING(jc.utf8_string(jc.field(0).descriptor_index), "B");
+    COMPARE_STRING(jc.utf8_string(jc.field(6).descriptor_index),
+		   "Ljava/lang/String;");
+    CHECK(jc.method_count() == 8);
+    COMPARE_STRING(jc.utf8_string(jc.method(0).name_index), "<init>");
+    CHECK(jc.method(6).access_flags == 9);
+    COMPARE_STRING(jc.utf8_string(jc.method(6).name_index), "main");
+    COMPARE_STRING(jc.utf8_string(jc.method(6).descriptor_index),
+		   "([Ljava/lang/String;)V");
+    CHECK(jc.member_reference_count() == 10);
+    {
+      java_class::member_ref ref;
+      jc.member_reference(3, ref);
+      CHECK(ref.tag == java_class::CONSTANT_Methodref);
+      COMPARE_STRING(ref.class_name.str(), "java/lang/StringBuilder");
+      COMPARE_STRING(ref.name.str(), "append");
+      COMPARE_STRING(ref.descriptor.str(),
+		     "(Ljava/lang/String;)Ljava/lang/StringBuilder;");
+    }
+  }
+  {
+    java_class jc(&vec);
+    java_class_batch batch;
+    batch.add(jc);
+    batch.add(jc);
+    CHECK(batch.size() == 2);
+    for (unsigned row = 0; row < 2; ++row) {
+      COMPARE_STRING(batch.string(batch.name.at(row)),
+		     "com/redhat/symboldb/test/JavaClass");
+      COMPARE_STRING(batch.string(batch.super_class.at(row)),
+		     "java/lang/Thread");
+      CHECK(batch.access_flags.at(row) == jc.access_flags());
+      std::vector<unsigned char> digest(hash(hash_sink::sha256, vec));
+      CHECK(std::equal(digest.begin(), digest.end(), batch.digest_of(row)));
+      CHECK(batch.interfaces_end.at(row) - batch.interfaces_begin(row) == 2);
+      COMPARE_STRING(batch.string
+		     (batch.interfaces.at(batch.interfaces_begin(row))),
+		     "java/lang/Runnable");
+      // The class itself is filtered out.
+      unsigned begin = batch.references_begin(row);
+      CHECK(batch.references_end.at(row) - begin == 12);
+      COMPARE_STRING(batch.string(batch.references.at(begin)),
+		     "java/lang/AutoCloseable");
+      COMPARE_STRING(batch.string(batch.references.at(begin + 11)),
+		     "java/lang/Thread");
+      CHECK(batch.major_version.at(row) == 51);
+      CHECK(batch.minor_version.at(row) == 0);
+      begin = batch.fields.begin(row);
+      CHECK(batch.fields.end.at(row) - begin == 7);
+      COMPARE_STRING(batch.string(batch.fields.name.at(begin + 1)), "SHORT");
+      begin = batch.methods.begin(row);
+      CHECK(batch.methods.end.at(row) - begin == 8);
+      COMPARE_STRING(batch.string(batch.methods.name.at(begin + 7)),
+		     "toString");
+      COMPARE_STRING(batch.string(batch.methods.descriptor.at(begin + 7)),
+		     "()Ljava/lang/String;");
+      begin = batch.member_refs.begin(row);
+      CHECK(batch.member_refs.end.at(row) - begin == 10);
+      CHECK(batch.member_refs.tag.at(begin) == java_class::CONSTANT_Methodref);
+      COMPARE_STRING(batch.string(batch.member_refs.class_name.at(begin)),
+		     "java/lang/Thread");
+      COMPARE_STRING(batch.string(batch.member_refs.name.at(begin)),
+		     "<init>");
+    }
+    {
+      // A malformed class does not leave a partial row behind.  The
+      // descriptor of the first field is patched to constant pool
+      // index zero.
+      std::vector<unsigned char> broken(vec);
+      broken.at(1134) = 0;
+      broken.at(1135) = 0;
+      java_class bad(&broken);
+      size_t arena = batch.arena.size();
+      try {
+	batch.add(bad);
+	CHECK(false);
+      } catch (java_class::exception &) {
+      }
+      CHECK(batch.size() == 2);
+      CHECK(batch.arena.size() == arena);
+      CHECK(batch.methods.end.size() == 2);
+      CHECK(batch.member_refs.size() == 20);
+    }
+    batch.clear();
+    CHECK(batch.size() == 0);
+    CHECK(batch.arena.empty());
+  }
+  {
+    java_class jc(&vec);
+    // Plain strings refer to the class file.
+    const_stringref name(jc.this_class_ref());
+    COMPARE_STRING(name.str(), "com/redhat/symboldb/test/JavaClass");
+    CHECK(name.udata() > vec.data() && name.udata() < vec.data() + vec.size());
+    COMPARE_STRING(jc.super_class_ref().str(), "java/lang/Thread");
+    COMPARE_STRING(jc.interface_ref(1).str(), "java/lang/AutoCloseable");
+    std::vector<std::string> classes(jc.class_references());
+    CHECK(jc.class_reference_count() == 13);
+    CHECK(classes.size() == 13);
+    for (unsigned i = 0; i < classes.size(); ++i) {
+      COMPARE_STRING(jc.class_reference(i).str(), classes.at(i));
+    }
+
+    // Modified UTF-8 is converted if necessary.  Entry 89 is the
+    // string constant "\0a".  Entry 66 is "JavaClass.java", patched
+    // to start with a surrogate pair and an invalid byte.
+    COMPARE_STRING(jc.utf8_ref(89).str(), std::string("\0a", 2));
+    std::vector<unsigned char> patched(vec);
+    const unsigned char pair[] = {0xED, 0xA0, 0xBD, 0xED, 0xB8, 0x80, 0xFF};
+    std::copy(pair, pair + sizeof(pair), patched.begin() + 535);
+    jc.reset(&patched);
+    COMPARE_STRING(jc.utf8_ref(66).str(),
+		   "\xF0\x9F\x98\x80\xEF\xBF\xBDss.java");
+    COMPARE_STRING(jc.utf8_string(89), std::string("\0a", 2));
+    COMPARE_STRING(jc.this_class(), "com/redhat/symboldb/test/JavaClass");
+
+    // Names with NUL characters are rejected by the batch.  The class
+    // name starts at offset 678.
+    patched.at(679) = 0xC0;
+    patched.at(680) = 0x80;
+    jc.reset(&patched);
+    java_class_batch batch;
+    try {
+      batch.add(jc);
+      CHECK(false);
+    } catch (java_class::exception &e) {
+      COMPARE_STRING(e.what(), "NUL character in name");
+    }
+    CHECK(batch.size() == 0);
   }
 }
 
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/java_class_results.hpp>
+#include <cxxll/read_file.hpp>
+
+#include "test.hpp"
+
+#include <algorithm>
+
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+using namespace cxxll;
+
+static void
+append_le(std::vector<unsigned char> &out, unsigned long value, unsigned size)
+{
+  for (unsigned i = 0; i < size; ++i) {
+    out.push_back((value >> (8 * i)) & 0xFF);
+  }
+}
+
+typedef std::vector<std::pair<std::string, std::vector<unsigned char> > >
+  zip_entries;
+
+// Creates a ZIP archive with stored (uncompressed) entries.
+static std::vector<unsigned char>
+make_zip(const zip_entries &entries)
+{
+  std::vector<unsigned char> zip;
+  std::vector<unsigned char> directory;
+  for (zip_entries::const_iterator p = entries.begin(), end = entries.end();
+       p != end; ++p) {
+    const std::string &name(p->first);
+    const std::vector<unsigned char> &data(p->second);
+    unsigned long crc = crc32(crc32(0, NULL, 0), data.data(), data.size());
+    unsigned long offset = zip.size();
+
+    append_le(zip, 0x04034b50, 4);
+    append_le(zip, 20, 2);	// version needed to extract
+    append_le(zip, 0, 2);	// flags
+    append_le(zip, 0, 2);	// stored
+    append_le(zip, 0, 4);	// time and date
+    append_le(zip, crc, 4);
+    append_le(zip, data.size(), 4);
+    append_le(zip, data.size(), 4);
+    append_le(zip, name.size(), 2);
+    append_le(zip, 0, 2);	// extra field length
+    zip.insert(zip.end(), name.begin(), name.end());
+    zip.insert(zip.end(), data.begin(), data.end());
+
+    append_le(directory, 0x02014b50, 4);
+    append_le(directory, 20, 2); // version made by
+    append_le(directory, 20, 2); // version needed to extract
+    append_le(directory, 0, 2);
+    append_le(directory, 0, 2);
+    append_le(directory, 0, 4);
+    append_le(directory, crc, 4);
+    append_le(directory, data.size(), 4);
+    append_le(directory, data.size(), 4);
+    append_le(directory, name.size(), 2);
+    append_le(directory, 0, 2);	// extra field length
+    append_le(directory, 0, 2);	// comment length
+    append_le(directory, 0, 2);	// disk number
+    append_le(directory, 0, 2);	// internal attributes
+    append_le(directory, 0, 4);	// external attributes
+    append_le(directory, offset, 4);
+    directory.insert(directory.end(), name.begin(), name.end());
+  }
+  unsigned long directory_offset = zip.size();
+  zip.insert(zip.end(), directory.begin(), directory.end());
+  append_le(zip, 0x06054b50, 4);
+  append_le(zip, 0, 2);
+  append_le(zip, 0, 2);
+  append_le(zip, entries.size(), 2);
+  append_le(zip, entries.size(), 2);
+  append_le(zip, directory.size(), 4);
+  append_le(zip, directory_offset, 4);
+  append_le(zip, 0, 2);		// comment length
+  return zip;
+}
+
+// Returns the test class, renamed to com/redhat/symboldb/test/NAME.
+// NAME must have the same length as "JavaClass".
+static std::vector<unsigned char>
+renamed_class(const std::vector<unsigned char> &original, const char *name)
+{
+  static const char old_name[] = "symboldb/test/JavaClass";
+  const size_t old_length = strlen(old_name);
+  const size_t name_length = strlen("JavaClass");
+  std::vector<unsigned char> result(original);
+  for (size_t i = 0; i + old_length <= result.size(); ++i) {
+    if (memcmp(result.data() + i, old_name, old_length) == 0) {
+      memcpy(result.data() + i + old_length - name_length, name, name_length);
+    }
+  }
+  return result;
+}
+
+static std::string
+class_names(const java_class_results &results)
+{
+  std::string names;
+  const java_class_batch &batch(results.batch);
+  for (size_t row = 0; row < batch.size(); ++row) {
+    names += batch.string(batch.name[row]);
+    names += '\n';
+  }
+  return names;
+}
+
+static std::string
+error_paths(const java_class_results &results)
+{
+  std::string paths;
+  for (size_t i = 0; i < results.errors.size(); ++i) {
+    paths += results.errors[i].first;
+    paths += '\n';
+  }
+  return paths;
+}
+
+static void
+test()
+{
+  std::vector<unsigned char> original;
+  read_file("test/data/JavaClass.class", original);
+
+  // Enough class files for four chunks, with a few malformed ones
+  // and other entries in between.
+  const unsigned classes = 1100;
+  zip_entries entries;
+  std::string expected_names;
+  std::string expected_errors;
+  entries.push_back(std::make_pair(std::string("META-INF/MANIFEST.MF"),
+				   std::vector<unsigned char>(10, 'x')));
+  for (unsigned i = 0; i < classes; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "C%08u", i);
+    std::string path(std::string("pkg/") + name + ".class");
+    std::vector<unsigned char> data(renamed_class(original, name));
+    if (i % 100 == 50) {
+      data.resize(64);
+      expected_errors += "outer.jar!/" + path + '\n';
+    } else {
+      expected_names += "com/redhat/symboldb/test/";
+      expected_names += name;
+      expected_names += '\n';
+    }
+    entries.push_back(std::make_pair(path, data));
+    if (i == 500) {
+      entries.push_back(std::make_pair(std::string("pkg/README"),
+				       std::vector<unsigned char>(3, 'y')));
+    }
+  }
+  std::vector<unsigned char> zip(make_zip(entries));
+
+  {
+    java_class_results results;
+    parse_zip_classes(zip.data(), zip.size(), "outer.jar!/", classes, 4,
+		      results);
+    COMPARE_STRING(class_names(results), expected_names);
+    COMPARE_STRING(error_paths(results), expected_errors);
+  }
+  {
+    java_class_results results;
+    parse_zip_classes(zip.data(), zip.size(), "outer.jar!/", classes, 1,
+		      results);
+    COMPARE_STRING(class_names(results), expected_names);
+    COMPARE_STRING(error_paths(results), expected_errors);
+  }
+  {
+    // Small archives are processed in a single chunk.
+    java_class_results results;
+    zip_entries small(entries.begin(), entries.begin() + 101);
+    std::vector<unsigned char> small_zip(make_zip(small));
+    parse_zip_classes(small_zip.data(), small_zip.size(), "", 100, 4,
+		      results);
+    COMPARE_NUMBER(results.batch.size(), 99U);
+    COMPARE_NUMBER(results.errors.size(), 1U);
+  }
+  {
+    java_class_results results;
+    parse_zip_classes(zip.data(), zip.size(), "", 0, 4, results);
+    CHECK(results.batch.size() == 0);
+    CHECK(results.errors.empty());
+  }
+  {
+    // The same class in several chunks ends up in a single batch,
+    // with the string offsets of the later chunks adjusted.
+    const unsigned copies = 600;
+    zip_entries same;
+    for (unsigned i = 0; i < copies; ++i) {
+      char name[32];
+      snprintf(name, sizeof(name), "copy%u/JavaClass.class", i);
+      same.push_back(std::make_pair(std::string(name), original));
+    }
+    std::vector<unsigned char> same_zip(make_zip(same));
+    java_class_results results;
+    parse_zip_classes(same_zip.data(), same_zip.size(), "", copies, 4,
+		      results);
+    const java_class_batch &batch(results.batch);
+    COMPARE_NUMBER(batch.size(), copies);
+    CHECK(results.errors.empty());
+    for (unsigned row = 0; row < copies; ++row) {
+      COMPARE_STRING(batch.string(batch.name.at(row)),
+		     "com/redhat/symboldb/test/JavaClass");
+      CHECK(std::equal(batch.digest_of(0),
+		       batch.digest_of(0) + java_class_batch::digest_size,
+		       batch.digest_of(row)));
+      CHECK(batch.interfaces_end.at(row) - batch.interfaces_begin(row) == 2);
+      unsigned begin = batch.methods.begin(row);
+      CHECK(batch.methods.end.at(row) - begin == 8);
+      COMPARE_STRING(batch.string(batch.methods.name.at(begin + 7)),
+		     "toString");
+      begin = batch.member_refs.begin(row);
+      CHECK(batch.member_refs.end.at(row) - begin == 10);
+      COMPARE_STRING(batch.string(batch.member_refs.name.at(begin)),
+		     "<init>");
+    }
+  }
+  {
+    // A class which occurs in the outer archive and in two nested
+    // archives is collected into the same batch.
+    zip_entries inner;
+    inner.push_back(std::make_pair(std::string("JavaClass.class"), original));
+    inner.push_back(std::make_pair(std::string("Broken.class"),
+				   std::vector<unsigned char>
+				   (original.begin(), original.begin() + 64)));
+    zip_entries outer;
+    outer.push_back(std::make_pair(std::string("JavaClass.class"), original));
+    outer.push_back(std::make_pair(std::string("lib/a.jar"),
+				   make_zip(inner)));
+    outer.push_back(std::make_pair(std::string("lib/b.jar"),
+				   make_zip(inner)));
+    std::vector<unsigned char> outer_zip(make_zip(outer));
+    java_class_results results;
+    parse_java_archive(outer_zip.data(), outer_zip.size(), 4, results);
+    COMPARE_STRING(class_names(results),
+		   "com/redhat/symboldb/test/JavaClass\n"
+		   "com/redhat/symboldb/test/JavaClass\n"
+		   "com/redhat/symboldb/test/JavaClass\n");
+    COMPARE_STRING(error_paths(results),
+		   "lib/a.jar!/Broken.class\nlib/b.jar!/Broken.class\n");
+
+    // Archives nested too deeply are reported as errors.
+    std::vector<unsigned char> nested(make_zip(inner));
+    for (unsigned i = 0; i < 5; ++i) {
+      zip_entries level;
+      level.push_back(std::make_pair(std::string("n.jar"), nested));
+      nested = make_zip(level);
+    }
+    java_class_results deep;
+    parse_java_archive(nested.data(), nested.size(), 1, deep);
+    CHECK(deep.batch.size() == 0);
+    COMPARE_STRING(error_paths(deep), "n.jar!/n.jar!/n.jar!/n.jar!/n.jar\n");
+  }
+}
+
+static test_register t("java_class_results", test);
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/mapped_file.hpp>
+#include <cxxll/temporary_directory.hpp>
+#include <cxxll/fd_handle.hpp>
+#include <cxxll/fd_sink.hpp>
+#include <cxxll/os_exception.hpp>
+#include <cxxll/string_support.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.hpp"
+
+using namespace cxxll;
+
+static void
+test(void)
+{
+  temporary_directory tmp;
+  std::string path(tmp.path("file"));
+  {
+    fd_handle fd;
+    fd.open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+    mapped_file empty(path.c_str());
+    CHECK(empty.data() == NULL);
+    CHECK(empty.size() == 0);
+    fd_sink(fd.get()).write("0123456789");
+  }
+  {
+    mapped_file m(path.c_str());
+    CHECK(m.size() == 10);
+    CHECK(memcmp(m.data(), "0123456789", 10) == 0);
+    // The mapping survives the removal of the file.
+    CHECK(unlink(path.c_str()) == 0);
+    CHECK(m.data()[9] == '9');
+  }
+  try {
+    mapped_file m(path.c_str());
+    CHECK(false);
+  } catch (os_exception &e) {
+    CHECK(e.error_code() == ENOENT);
+    COMPARE_STRING(e.path(), path);
+  }
+}
+
+static test_register t("mapped_file", test);
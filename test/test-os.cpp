@@ -19,7 +19,10 @@
 #include <cxxll/os.hpp>
 #include <cxxll/fd_handle.hpp>
 #include <cxxll/os_exception.hpp>
+#include <cxxll/read_file.hpp>
 #include <cxxll/string_support.hpp>
+#include <cxxll/task.hpp>
+#include <cxxll/temporary_directory.hpp>
 
 #include "test.hpp"
 
@@ -30,6 +33,35 @@
 
 using namespace cxxll;
 
+// Writes "abc", waits, writes "def" and closes FD.  The reader
+// observes EAGAIN in between if the descriptor is non-blocking.
+static void
+slow_writer(int fd) throw()
+{
+  CHECK(write(fd, "abc", 3) == 3);
+  usleep(100 * 1000);
+  CHECK(write(fd, "def", 3) == 3);
+  close(fd);
+}
+
+// Reads FD until end-of-file after a delay, so that the pipe fills
+// up and a non-blocking writer observes EAGAIN.
+static void
+slow_reader(int fd, size_t *count) throw()
+{
+  usleep(100 * 1000);
+  char buf[4096];
+  while (true) {
+    ssize_t ret = read(fd, buf, sizeof(buf));
+    if (ret <= 0) {
+      CHECK(ret == 0);
+      break;
+    }
+    *count += ret;
+  }
+  close(fd);
+}
+
 static void
 test(void)
 {
@@ -117,6 +149,109 @@ test(void)
     CHECK(elapsed <= 0.11);
   }
 
+  {
+    temporary_directory dir;
+    std::string source_path(dir.path("source"));
+    std::string data;
+    for (int i = 0; i < 100000; ++i) {
+      data += static_cast<char>('a' + i % 26);
+    }
+    {
+      fd_handle h;
+      h.open(source_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+      CHECK(write(h.get(), data.data(), data.size())
+	    == static_cast<ssize_t>(data.size()));
+    }
+    std::vector<unsigned char> copied;
+
+    // Regular file to regular file, starting at the file offset.
+    {
+      fd_handle in;
+      in.open_read_only(source_path.c_str());
+      CHECK(lseek(in.get(), 3, SEEK_SET) == 3);
+      fd_handle out;
+      out.open(dir.path("copy").c_str(),
+	       O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+      CHECK(copy_fd_to_fd(in.get(), out.get()) == data.size() - 3);
+    }
+    read_file(dir.path("copy").c_str(), copied);
+    COMPARE_STRING(std::string(copied.begin(), copied.end()),
+		   data.substr(3));
+
+    // Pipe to regular file.
+    {
+      int pipefd[2];
+      CHECK(pipe2(pipefd, O_CLOEXEC) == 0);
+      fd_handle in(pipefd[0]);
+      {
+	fd_handle pipe_out(pipefd[1]);
+	CHECK(write(pipe_out.get(), "abc", 3) == 3);
+      }
+      fd_handle out;
+      out.open(dir.path("pipe").c_str(),
+	       O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+      CHECK(copy_fd_to_fd(in.get(), out.get()) == 3);
+    }
+    copied.clear();
+    read_file(dir.path("pipe").c_str(), copied);
+    COMPARE_STRING(std::string(copied.begin(), copied.end()), "abc");
+
+    // Non-blocking pipe to regular file.
+    {
+      int pipefd[2];
+      CHECK(pipe2(pipefd, O_CLOEXEC) == 0);
+      CHECK(fcntl(pipefd[0], F_SETFL, O_NONBLOCK) == 0);
+      fd_handle in(pipefd[0]);
+      fd_handle out;
+      out.open(dir.path("nonblock").c_str(),
+	       O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+      task writer(std::tr1::bind(slow_writer, pipefd[1]));
+      CHECK(copy_fd_to_fd(in.get(), out.get()) == 6);
+      writer.wait();
+    }
+    copied.clear();
+    read_file(dir.path("nonblock").c_str(), copied);
+    COMPARE_STRING(std::string(copied.begin(), copied.end()), "abcdef");
+
+    // Regular file to non-blocking pipe.  The file is larger than the
+    // pipe buffer.
+    {
+      std::string large(1024 * 1024, 'x');
+      {
+	fd_handle out;
+	out.open(dir.path("large").c_str(),
+		 O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+	CHECK(write(out.get(), large.data(), large.size())
+	      == static_cast<ssize_t>(large.size()));
+      }
+      int pipefd[2];
+      CHECK(pipe2(pipefd, O_CLOEXEC) == 0);
+      CHECK(fcntl(pipefd[1], F_SETFL, O_NONBLOCK) == 0);
+      fd_handle out(pipefd[1]);
+      fd_handle in;
+      in.open_read_only(dir.path("large").c_str());
+      size_t count = 0;
+      task reader(std::tr1::bind(slow_reader, pipefd[0], &count));
+      CHECK(copy_fd_to_fd(in.get(), out.get()) == large.size());
+      out.close();
+      reader.wait();
+      CHECK(count == large.size());
+    }
+
+    // Special file with a zero size.
+    {
+      fd_handle in;
+      in.open_read_only("/proc/self/status");
+      fd_handle out;
+      out.open(dir.path("status").c_str(),
+	       O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+      CHECK(copy_fd_to_fd(in.get(), out.get()) > 0);
+    }
+    copied.clear();
+    read_file(dir.path("status").c_str(), copied);
+    CHECK(starts_with(std::string(copied.begin(), copied.end()), "Name:"));
+  }
+
   // Check for file descriptor leaks.
   {
     fd_handle h;
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/pg_cursor.hpp>
+#include <cxxll/pg_testdb.hpp>
+#include <cxxll/pgconn_handle.hpp>
+#include <cxxll/pgresult_handle.hpp>
+#include <cxxll/pg_exception.hpp>
+#include <cxxll/pg_query.hpp>
+#include <cxxll/pg_response.hpp>
+
+#include "test.hpp"
+
+#include <stdio.h>
+
+using namespace cxxll;
+
+static void
+test()
+{
+  pg_testdb db;
+  pgconn_handle h(db.connect("template1"));
+  pgresult_handle r;
+  r.exec(h, "CREATE TEMPORARY TABLE numbers (n INTEGER NOT NULL)");
+  r.exec(h, "INSERT INTO numbers SELECT generate_series(1, 25)");
+
+  // Outside a transaction, the cursor provides its own.
+  {
+    pg_cursor c(h, 10);
+    CHECK(!c.next());
+    c.declare("SELECT n, n::text AS t FROM numbers"
+	      " WHERE n > $1 ORDER BY n", 3);
+    CHECK(h.transactionStatus() == PQTRANS_INTRANS);
+    int expected = 4;
+    int n;
+    std::string s;
+    while (c.next()) {
+      pg_response(c.result(), c.row(), n, s);
+      CHECK(n == expected);
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%d", n);
+      COMPARE_STRING(s, buf);
+      ++expected;
+      if (n == 15) {
+	// Statements can be interleaved with fetches.
+	pg_query_binary(h, r, "SELECT COUNT(*)::int FROM numbers WHERE n < $1",
+			n);
+	int count;
+	pg_response(r, 0, count);
+	CHECK(count == 14);
+      }
+    }
+    CHECK(expected == 26);
+    CHECK(h.transactionStatus() == PQTRANS_IDLE);
+    CHECK(!c.next());
+
+    // Reuse for another query.
+    c.declare("SELECT COUNT(*)::int FROM numbers");
+    CHECK(c.next());
+    pg_response(c.result(), c.row(), n);
+    CHECK(n == 25);
+    CHECK(!c.next());
+    CHECK(h.transactionStatus() == PQTRANS_IDLE);
+  }
+
+  // Early destruction ends the implicit transaction.
+  {
+    pg_cursor c(h, 2);
+    c.declare("SELECT n FROM numbers");
+    CHECK(c.next());
+    CHECK(c.next());
+    CHECK(c.next());
+  }
+  CHECK(h.transactionStatus() == PQTRANS_IDLE);
+
+  // Within a transaction, the cursor is closed, and the transaction
+  // stays open.
+  r.exec(h, "BEGIN");
+  {
+    pg_cursor c1(h, 7);
+    pg_cursor c2(h, 3);
+    c1.declare("SELECT n FROM numbers ORDER BY n");
+    c2.declare("SELECT n FROM numbers ORDER BY n DESC");
+    int n1, n2;
+    for (int i = 1; i <= 25; ++i) {
+      CHECK(c1.next());
+      CHECK(c2.next());
+      pg_response(c1.result(), c1.row(), n1);
+      pg_response(c2.result(), c2.row(), n2);
+      CHECK(n1 == i);
+      CHECK(n2 == 26 - i);
+    }
+    CHECK(!c1.next());
+    CHECK(!c2.next());
+    CHECK(h.transactionStatus() == PQTRANS_INTRANS);
+  }
+  {
+    pg_cursor c(h);
+    c.declare("SELECT n FROM numbers");
+    CHECK(c.next());
+  }
+  CHECK(h.transactionStatus() == PQTRANS_INTRANS);
+  r.exec(h, "SELECT COUNT(*) FROM pg_cursors");
+  COMPARE_STRING(r.getvalue(0, 0), "0");
+  r.exec(h, "COMMIT");
+
+  // Errors in the query are reported by declare().
+  {
+    pg_cursor c(h);
+    try {
+      c.declare("SELECT garbage FROM numbers");
+      CHECK(false);
+    } catch (pg_exception &e) {
+      COMPARE_STRING(e.sqlstate_, "42703");
+    }
+    CHECK(!c.next());
+  }
+  CHECK(h.transactionStatus() == PQTRANS_IDLE);
+}
+
+static test_register t("pg_cursor", test);
@@ -17,10 +17,16 @@
  */
 
 #include <cxxll/python_analyzer.hpp>
+#include <cxxll/python_analyzer_pool.hpp>
 #include <cxxll/read_file.hpp>
+#include <cxxll/os_exception.hpp>
+#include <cxxll/task.hpp>
+#include <cxxll/mutex.hpp>
 
 #include "test.hpp"
 
+#include <unistd.h>
+
 using namespace cxxll;
 
 static const char *const imports[] = {
@@ -120,6 +126,130 @@ test_byte(unsigned char byte, const char *msg)
   test_one(pya, "test/data/analysis.py");
 }
 
+static mutex check_lock;
+
+// Parses SOURCE repeatedly from a separate thread, using the shared
+// pool.
+static void
+background_parse(const std::vector<unsigned char> *source,
+		 unsigned version) throw()
+{
+  for (int i = 0; i < 10; ++i) {
+    bool ok;
+    unsigned actual;
+    try {
+      python_analyzer pya;
+      ok = pya.parse(*source);
+      actual = pya.version();
+    } catch (std::exception &) {
+      ok = false;
+      actual = 0;
+    }
+    if (!ok || actual != version) {
+      mutex::locker ml(&check_lock);
+      CHECK(ok);
+      COMPARE_NUMBER(actual, version);
+    }
+  }
+}
+
+static void
+test_pool()
+{
+  std::vector<unsigned char> src2;
+  std::vector<unsigned char> src3;
+  read_file("test/data/analysis.py", src2);
+  read_file("test/data/analysis3.py", src3);
+
+  {
+    std::vector<std::tr1::shared_ptr<task> > tasks;
+    for (unsigned k = 0; k < 4; ++k) {
+      tasks.push_back(std::tr1::shared_ptr<task>
+		      (new task(std::tr1::bind(&background_parse,
+					       k % 2 ? &src3 : &src2,
+					       k % 2 ? 3U : 2U))));
+    }
+    for (unsigned k = 0; k < tasks.size(); ++k) {
+      tasks.at(k)->wait();
+    }
+  }
+
+  // Deeply nested parentheses crash the Python 2 parser.  The
+  // interpreter is restarted, and the other requests in the same
+  // batch still succeed.
+  std::vector<unsigned char> crash(200, '(');
+  crash.push_back('1');
+  crash.insert(crash.end(), 200, ')');
+  const unsigned crash_index = 17;
+
+  python_analyzer_pool pool(2);
+  std::vector<python_analyzer_pool::request_ptr> requests;
+  for (unsigned i = 0; i < 40; ++i) {
+    if (i == crash_index) {
+      requests.push_back(pool.submit(crash));
+    } else {
+      requests.push_back(pool.submit(i % 2 ? src3 : src2));
+    }
+  }
+  for (unsigned i = 0; i < requests.size(); ++i) {
+    if (i == crash_index) {
+      try {
+	pool.wait(requests.at(i));
+	CHECK(false);
+      } catch (os_exception &e) {
+	CHECK(!e.message().empty());
+      }
+      // Failures are not memoized.
+      CHECK(pool.submit(crash) != requests.at(i));
+      continue;
+    }
+    // Identical sources share their request.
+    CHECK(requests.at(i) == requests.at(i % 2));
+    const python_analyzer_pool::result &r(pool.wait(requests.at(i)));
+    COMPARE_STRING(r.error, "");
+    COMPARE_NUMBER(r.error_line, 0U);
+    COMPARE_NUMBER(r.version, i % 2 ? 3U : 2U);
+    COMPARE_NUMBER(r.functions.size(), 3U);
+    COMPARE_NUMBER(r.classes.size(), 2U);
+  }
+
+  python_analyzer pya(pool);
+  pya.submit(src3);
+  CHECK(pya.wait());
+  COMPARE_NUMBER(pya.version(), 3U);
+  test_one(pya, "test/data/analysis.py");
+  COMPARE_NUMBER(pya.version(), 2U);
+}
+
+static void
+test_idle_timeout()
+{
+  python_analyzer_pool pool(1, 1);
+  COMPARE_NUMBER(pool.interpreters(), 0U);
+  python_analyzer pya(pool);
+  test_one(pya, "test/data/analysis.py");
+  COMPARE_NUMBER(pool.interpreters(), 1U);
+  test_one(pya, "test/data/analysis3.py");
+  COMPARE_NUMBER(pool.interpreters(), 2U);
+
+  // The interpreters are shut down after one idle second.
+  for (unsigned i = 0; i < 100 && pool.interpreters() > 0; ++i) {
+    usleep(100 * 1000);
+  }
+  COMPARE_NUMBER(pool.interpreters(), 0U);
+
+  // Memoized results do not need an interpreter.
+  test_one(pya, "test/data/analysis.py");
+  COMPARE_NUMBER(pool.interpreters(), 0U);
+
+  // New sources start one again.
+  std::vector<unsigned char> src;
+  read_file("test/data/analysis.py", src);
+  src.push_back('\n');
+  CHECK(pya.parse(src));
+  COMPARE_NUMBER(pool.interpreters(), 1U);
+}
+
 static void
 test()
 {
@@ -149,6 +279,8 @@ test()
   }
   test_byte(0, "source code contains NUL character");
   test_byte('=', "invalid syntax");
+  test_pool();
+  test_idle_timeout();
 }
 
 static test_register t("python_analyzer", test);
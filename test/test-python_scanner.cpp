@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/python_scanner.hpp>
+#include <cxxll/python_analyzer.hpp>
+#include <cxxll/read_file.hpp>
+
+#include "test.hpp"
+
+#include <string.h>
+
+using namespace cxxll;
+
+static const char *const imports[] = {
+  "direct",
+  "direct1",
+  "direct2",
+  "direct3",
+  "direct4",
+  "direct5",
+  "direct.nested",
+  "from1.id1",
+  "from2.id3",
+  "from2.id4",
+  "from3.id5",
+  "from3.id6",
+  "from4.nested1.id7",
+  "all1.*",
+  ".relative1",
+  ".relative.nested",
+  ".relative2.*",
+  ".relative.nested.id8",
+  ".relative.nested.id9",
+  "..relative3",
+  "..relative4.id10",
+  NULL
+};
+
+static const char *const attributes[] = {
+  "call",
+  "nestedattr1",
+  "nestedattr2",
+  "nestedattr4",
+  "nestedattr5",
+  "read",
+  "write",
+  NULL
+};
+
+static const char *const functions[] = {
+  "classmember",
+  "inner",
+  "outer",
+  NULL
+};
+
+static const char *const classes[] = {
+  "DefinedClass",
+  "NestedClass",
+  NULL
+};
+
+static void
+compare(const std::vector<std::string> &actual, const char *const *expected)
+{
+  const char *const *p;
+  for (p = expected; *p; ++p) {
+    COMPARE_STRING(*p, actual.at(p - expected));
+  }
+  size_t count = p - expected;
+  COMPARE_NUMBER(actual.size(), count);
+}
+
+static void
+test_file(const char *path)
+{
+  std::vector<unsigned char> src;
+  read_file(path, src);
+  python_scanner scanner;
+  CHECK(scanner.scan(src));
+  compare(scanner.imports(), imports);
+  compare(scanner.attributes(), attributes);
+  compare(scanner.functions(), functions);
+  compare(scanner.classes(), classes);
+}
+
+static std::vector<unsigned char>
+to_vector(const char *str)
+{
+  return std::vector<unsigned char>(str, str + strlen(str));
+}
+
+// Source code which the scanner handles.  The results must match
+// those of the Python interpreter.
+static const char *const supported[] = {
+  "",
+  "import a.b as c, d\nfrom x import (y,\n  z as w,)\n",
+  "s = 'import fake'  # import fake2\n"
+  "t = \"\"\"\nfrom q import r\n\"\"\"\n"
+  "u = r'\\'' + b\"x\\\"\" + ur'v.w'\n",
+  "from m \\\n  import n\nx = (a\n  .b)\n",
+  "def f():\n    yield\n    raise E\n"
+  "class C:\n\tdef g(self): return self.h\n",
+  "from ... import e\nfrom .m import *\nx = 1..real\n"
+  "y = 0x1F + 1e-5 + 3j + .5\n",
+  "# -*- coding: latin-1 -*-\n# caf\xe9\nimport os\n",
+  "# caf\xc3\xa9\nimport os\n",
+  "\xEF\xBB\xBFimport os.path\n",
+  "@a.b\ndef f(x=y.z): pass\n",
+  "if x: import y; import z\n",
+  "def g():\n    yield from x\n    raise E from y.z\n",
+  "async def f():\n    await x.y\n",
+  "x = [\n  1,  # comment\n\n  2]\r\nif x:\r\n\r\n    pass\r\n",
+  "print 'a' 'b', x.y\nif x: exec c.d in e\nx = `y` <> 0755L\n",
+  "def f(*, a) -> int: print(a.b, end='')\nx = lambda *, b: b @ c\n",
+  "x = y if not z else -w\nx = [y for y in z if y not in w]\n",
+  "try:\n  raise E, 'x'\nexcept E, e: pass\n",
+  "x, = y\nfor a, in b: pass\nz = c[::2, 1:]\n",
+  "def f(a, /, *, b): pass\n(x): int = 1\n",
+  "for g in lambda c: c.d, h: pass\nx = y. z\n",
+  "if a: pass\nelif b:\n  if c: pass\nelse: pass\n"
+  "try:\n  pass\nexcept E: pass\nelse: pass\nfinally: pass\n"
+  "for x in y:\n  pass\nelse: pass\n",
+  "print []\nx[1:] = f(key=lambda a, b=1: a if b else c, reverse=True)\n"
+  "x = [a if b else c for a in d if a]\ny = {1: a if b else c}\n",
+  "def g(a=1, *b, c, d=2, **e): pass\ny: 'str' = None\n(a, b) = c\n"
+  "x = {**a, 'b': lambda: 1, 'c' 'd': 2,}\ny = {*a, b}\n"
+  "def h(a: 'int' = 1, *, b: int): pass\n",
+  "from m import *\n@d\n@e(1)\nclass C(object):\n"
+  "  def g(self, a, *b, **c):\n    x = yield\n"
+  "    y = f((yield), lambda a,: a not in b)\n",
+  "x = [a for a in 1, 2]\nprint {}\n",
+  NULL
+};
+
+// Source code which has to be analyzed by the interpreter.
+static const char *const unsupported[] = {
+  "x = f'{a.b}'\n",
+  "x = 'unterminated\n",
+  "x = '''unterminated\n",
+  "x = (1\n",
+  "x = 1)\n",
+  "x = (1]\n",
+  "  x = 1\n",
+  "if x:\ny = 1\n",
+  "if x:\n    y = 1\n  z = 2\n",
+  "def f():\n",
+  "x = \xc3\xa9\n",
+  "# caf\xe9\nimport os\n",
+  "# coding: cp1252\nx = 1\n",
+  "x = 1 $ 2\n",
+  "x = 1 ? 2\n",
+  "import\n",
+  "from import x\n",
+  "from x import\n",
+  "from x import (y\n",
+  "x = import y\n",
+  "import x.if\n",
+  "def if(): pass\n",
+  "x = 1abc\n",
+  "x = 1 \\ 2\n",
+  "x = = 1\n",
+  "foo bar baz\n",
+  "def f(*, a): pass\nprint \"x\"\n",
+  "x = 1 +\n",
+  "f(a=)\n",
+  "x = (a) b\n",
+  "f = lambda: print 'x'\n",
+  "print 'x'\nasync def f(): pass\n",
+  "raise E, 'x'\nyield from y\n",
+  "x = `y`\nz = a @ b\n",
+  "x = 0755\ny = 1_000\n",
+  "x = ur'a' + rb'b'\n",
+  "# caf\xc3\xa9\nprint 'x'\n",
+  "match x:\n    case 1: pass\n",
+  "f(, x)\n",
+  "f(=x)\n",
+  "x = . y\n",
+  "x = {: 1}\n",
+  "x = (is y)\n",
+  "for x in :\n    pass\n",
+  "if x = y:\n    pass\n",
+  "if x:\n    pass\nelse else:\n    pass\n",
+  "x:\n",
+  "x = 1 if y\n",
+  "x = a if b else\n",
+  "x = a else b\n",
+  "x = [a if b for a in c]\n",
+  "f(a if b, c)\n",
+  "x = a[]\n",
+  "x = {1:}\n",
+  "x = {1:, 2: 3}\n",
+  "elif x: pass\n",
+  "else: pass\n",
+  "if x: pass\ny = 1\nelse: pass\n",
+  "try:\n  pass\nfinally: pass\nexcept: pass\n",
+  "f(a=1, 2)\n",
+  "f(**a, b)\n",
+  "def f(a=1, b): pass\n",
+  "1 = x\n",
+  "f(x) = 1\n",
+  "None = 1\n",
+  "[x for x in y] = z\n",
+  "f(1=2)\n",
+  "x = {1: : 2}\n",
+  "x = {1: 2, : 3}\n",
+  "f(*a* **b)\n",
+  "x = [a for b . c(d)]\n",
+  "for x . y:\n  pass\n",
+  "def f(a, 1=1): pass\n",
+  "x = {'a': 1, 'b' 'c'}\n",
+  "x = {1, 2: 3}\n",
+  "f(a: b)\n",
+  "x = [: a]\n",
+  "x = os...path\n",
+  "x = y{}\n",
+  "x = a * *b\n",
+  "x = [a] *\n",
+  "x = (**a)\n",
+  "def f(1): pass\n",
+  "def f(a. b): pass\n",
+  "def f(a), : pass\n",
+  "x = a -> b\n",
+  "if a, b: pass\n",
+  "with a,: pass\n",
+  "x = return\n",
+  "if class x: pass\n",
+  "x = f(lambda)\n",
+  "x = lambda a\n",
+  "def f\n",
+  "class C(B)\n",
+  "x = c as d\n",
+  "x = y from z\n",
+  "x = a is not not b\n",
+  "if not in b: pass\n",
+  "x = f(a, in b)\n",
+  "x = lambda: y = 1\n",
+  "x = y: int\n",
+  "x = {'a': 'b' 'c': 'd'}\n",
+  "x = {a for a in b, c}\n",
+  "@d\nx = 1\n",
+  "@d, e\ndef f(): pass\n",
+  "return , x\n",
+  "f(a; b)\n",
+  "pass x\n",
+  "def f():\n  x = f(yield)\n",
+  NULL
+};
+
+static void
+test_snippets()
+{
+  python_analyzer pya;
+  for (const char *const *p = supported; *p; ++p) {
+    std::vector<unsigned char> src(to_vector(*p));
+    python_scanner scanner;
+    if (!scanner.scan(src)) {
+      COMPARE_STRING(*p, "(supported)");
+      continue;
+    }
+    CHECK(pya.parse(src));
+    CHECK(scanner.imports() == pya.imports());
+    CHECK(scanner.attributes() == pya.attributes());
+    CHECK(scanner.functions() == pya.functions());
+    CHECK(scanner.classes() == pya.classes());
+  }
+  for (const char *const *p = unsupported; *p; ++p) {
+    python_scanner scanner;
+    if (scanner.scan(to_vector(*p))) {
+      COMPARE_STRING(*p, "(unsupported)");
+    }
+  }
+
+  std::vector<unsigned char> nul;
+  nul.push_back('x');
+  nul.push_back(0);
+  python_scanner scanner;
+  CHECK(!scanner.scan(nul));
+}
+
+static void
+test()
+{
+  test_file("test/data/analysis.py");
+  test_file("test/data/analysis3.py");
+  test_snippets();
+}
+
+static test_register t("python_scanner", test);
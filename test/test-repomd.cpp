@@ -21,6 +21,9 @@
 #include <cxxll/fd_source.hpp>
 #include <cxxll/rpm_package_info.hpp>
 #include <cxxll/base16.hpp>
+#include <cxxll/temporary_directory.hpp>
+
+#include <sqlite3.h>
 
 #include "test.hpp"
 
@@ -47,6 +50,7 @@ test_primary()
   COMPARE_STRING(primary.href(),
 		 "test/data/Packages/o/opensm-libs-3.3.15-3.fc18.x86_64.rpm");
   COMPARE_STRING(primary.info().source_rpm, "opensm-3.3.15-3.fc18.src.rpm");
+  COMPARE_NUMBER(primary.header_end(), 8104U);
 
   CHECK(primary.next());
   COMPARE_STRING(primary.info().name, "bind");
@@ -62,6 +66,7 @@ test_primary()
   COMPARE_STRING(primary.href(),
 		 "test/data/Packages/b/bind-9.9.2-5.P1.fc18.x86_64.rpm");
   COMPARE_STRING(primary.info().source_rpm, "bind-9.9.2-5.P1.fc18.src.rpm");
+  COMPARE_NUMBER(primary.header_end(), 100140U);
 
   CHECK(primary.next());
   COMPARE_STRING(primary.info().name, "oniguruma");
@@ -77,14 +82,126 @@ test_primary()
   COMPARE_STRING(primary.href(),
 		 "http://example.com/root/Packages/o/oniguruma-5.9.2-4.fc18.i686.rpm");
   COMPARE_STRING(primary.info().source_rpm, "oniguruma-5.9.2-4.fc18.src.rpm");
+  COMPARE_NUMBER(primary.header_end(), 5900U);
+
+  CHECK(!primary.next());
+}
+
+static void
+test_primary_db()
+{
+  temporary_directory tempdir;
+  std::string path(tempdir.path("primary.sqlite"));
+  {
+    // Subset of the createrepo schema.
+    sqlite3 *db;
+    CHECK(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+    CHECK(sqlite3_exec
+	  (db,
+	   "CREATE TABLE packages (pkgKey INTEGER PRIMARY KEY, pkgId TEXT,"
+	   " name TEXT, arch TEXT, version TEXT, epoch TEXT, release TEXT,"
+	   " rpm_sourcerpm TEXT, rpm_header_start INTEGER,"
+	   " rpm_header_end INTEGER, size_package INTEGER,"
+	   " location_href TEXT, location_base TEXT, checksum_type TEXT);"
+	   "INSERT INTO packages VALUES (2,"
+	   " 'e8914e18e2264100d40a422ba91be6f19a803a96c5a1e464a3fef2248ad1063b',"
+	   " 'bind', 'x86_64', '9.9.2', '32', '5.P1.fc18',"
+	   " 'bind-9.9.2-5.P1.fc18.src.rpm', 1384, 100140, 2182152,"
+	   " 'Packages/b/bind-9.9.2-5.P1.fc18.x86_64.rpm', NULL, 'sha256');"
+	   "INSERT INTO packages VALUES (1,"
+	   " 'c2c85a567d1b92dd6131bd326611b162ed485f6f97583e46459b430006908d66',"
+	   " 'opensm-libs', 'x86_64', '3.3.15', '0', '3.fc18',"
+	   " 'opensm-3.3.15-3.fc18.src.rpm', 1384, 8104, 62796,"
+	   " 'Packages/o/opensm-libs-3.3.15-3.fc18.x86_64.rpm', NULL, 'sha256');"
+	   "INSERT INTO packages VALUES (3,"
+	   " '4e03d256c6aacc905efdb83c7bd16bd452771758d1a0a80cea647cfe0f2c6314',"
+	   " 'oniguruma', 'i686', '5.9.2', '0', '4.fc18',"
+	   " 'oniguruma-5.9.2-4.fc18.src.rpm', NULL, NULL, 133156,"
+	   " 'Packages/o/oniguruma-5.9.2-4.fc18.i686.rpm',"
+	   " 'http://example.com/root/', 'sha256');",
+	   NULL, NULL, NULL) == SQLITE_OK);
+    sqlite3_close(db);
+  }
+
+  repomd::primary_db primary(path.c_str(), "test/data");
+  CHECK(primary.next());
+  COMPARE_STRING(primary.info().name, "opensm-libs");
+  COMPARE_STRING(primary.info().arch, "x86_64");
+  CHECK(primary.info().epoch == 0);
+  COMPARE_STRING(primary.info().version, "3.3.15");
+  COMPARE_STRING(primary.info().release, "3.fc18");
+  COMPARE_STRING(hash_sink::to_string(primary.checksum().type), "sha256");
+  COMPARE_STRING(base16_encode(primary.checksum().value.begin(),
+			       primary.checksum().value.end()),
+		 "c2c85a567d1b92dd6131bd326611b162ed485f6f97583e46459b430006908d66");
+  CHECK(primary.checksum().length == 62796);
+  COMPARE_STRING(primary.href(),
+		 "test/data/Packages/o/opensm-libs-3.3.15-3.fc18.x86_64.rpm");
+  COMPARE_STRING(primary.info().source_rpm, "opensm-3.3.15-3.fc18.src.rpm");
+  COMPARE_NUMBER(primary.header_end(), 8104U);
+
+  CHECK(primary.next());
+  COMPARE_STRING(primary.info().name, "bind");
+  CHECK(primary.info().epoch == 32);
+  COMPARE_STRING(primary.info().version, "9.9.2");
+  COMPARE_STRING(primary.info().release, "5.P1.fc18");
+  CHECK(primary.checksum().length == 2182152);
+  COMPARE_STRING(primary.href(),
+		 "test/data/Packages/b/bind-9.9.2-5.P1.fc18.x86_64.rpm");
+  COMPARE_NUMBER(primary.header_end(), 100140U);
+
+  CHECK(primary.next());
+  COMPARE_STRING(primary.info().name, "oniguruma");
+  COMPARE_STRING(primary.info().arch, "i686");
+  COMPARE_STRING(primary.href(),
+		 "http://example.com/root/Packages/o/oniguruma-5.9.2-4.fc18.i686.rpm");
+  COMPARE_NUMBER(primary.header_end(), 0U);
 
   CHECK(!primary.next());
+
+  {
+    // Same database, copied from a source.
+    fd_handle handle;
+    handle.open_read_only(path.c_str());
+    fd_source source(handle.get());
+    repomd::primary_db copy(&source, "test/data");
+    CHECK(copy.next());
+    COMPARE_STRING(copy.info().name, "opensm-libs");
+    COMPARE_NUMBER(copy.header_end(), 8104U);
+    CHECK(copy.next());
+    COMPARE_STRING(copy.info().name, "bind");
+    CHECK(copy.next());
+    COMPARE_STRING(copy.info().name, "oniguruma");
+    CHECK(!copy.next());
+  }
+}
+
+static void
+test_available()
+{
+  repomd rp;
+  rp.entries.resize(3);
+  rp.entries.at(0).type = "primary";
+  rp.entries.at(0).href = "repodata/primary.xml.gz";
+  rp.entries.at(1).type = "primary_db";
+  rp.entries.at(1).href = "repodata/primary.sqlite.bz2";
+  rp.entries.at(2).type = "filelists";
+  rp.entries.at(2).href = "repodata/filelists.xml.xz";
+  CHECK(repomd::primary_xml::available(rp, "primary"));
+  // bzip2 compression is not supported.
+  CHECK(!repomd::primary_xml::available(rp, "primary_db"));
+  CHECK(repomd::primary_xml::available(rp, "filelists"));
+  CHECK(!repomd::primary_xml::available(rp, "other"));
+  rp.entries.at(1).href = "repodata/primary.sqlite.xz";
+  CHECK(repomd::primary_xml::available(rp, "primary_db"));
 }
 
 static void
 test()
 {
   test_primary();
+  test_primary_db();
+  test_available();
 }
 
 static test_register t("repomd", test);
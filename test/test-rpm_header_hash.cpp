@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/rpm_header_hash.hpp>
+#include <cxxll/rpm_parser.hpp>
+#include <cxxll/rpm_parser_exception.hpp>
+#include <cxxll/rpm_package_info.hpp>
+#include <cxxll/eof_exception.hpp>
+#include <cxxll/fd_handle.hpp>
+#include <cxxll/fd_source.hpp>
+#include <cxxll/memory_range_source.hpp>
+#include <cxxll/read_file.hpp>
+
+#include "test.hpp"
+
+using namespace cxxll;
+
+static void
+test()
+{
+  static const char *const files[] = {
+    "test/data/cronie-1.4.10-7.fc19.x86_64.rpm",
+    "test/data/firewalld-0.2.12-5.fc18.noarch.rpm",
+    "test/data/rsh-0.17-72.fc19.src.rpm",
+    "test/data/shared-mime-info-1.1-1.fc18.x86_64.rpm",
+    NULL
+  };
+  for (const char *const *p = files; *p; ++p) {
+    test_section ts(*p);
+    rpm_parser parser(*p);
+    fd_handle handle;
+    handle.open_read_only(*p);
+    fd_source source(handle.get());
+    COMPARE_STRING(rpm_header_hash(source), parser.package().hash);
+  }
+
+  std::vector<unsigned char> data;
+  read_file("test/data/cronie-1.4.10-7.fc19.x86_64.rpm", data);
+  {
+    // Headers end at offset 16636.
+    memory_range_source source(data.data(), 16636);
+    COMPARE_STRING(rpm_header_hash(source),
+		   "2dbccfe56964e1091acac6cd856f08a5aaaa5ca0");
+  }
+  {
+    memory_range_source source(data.data(), 16635);
+    try {
+      rpm_header_hash(source);
+      CHECK(false);
+    } catch (eof_exception &) {
+    }
+  }
+  {
+    data.at(0) = 0;
+    memory_range_source source(data.data(), data.size());
+    try {
+      rpm_header_hash(source);
+      CHECK(false);
+    } catch (rpm_parser_exception &) {
+    }
+  }
+}
+
+static test_register t("rpm_header_hash", test);
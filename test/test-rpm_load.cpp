@@ -21,6 +21,9 @@
 
 #include <symboldb/database.hpp>
 #include <symboldb/update_elf_closure.hpp>
+#include <symboldb/update_elf_symbol_resolution.hpp>
+#include <symboldb/set_snapshot.hpp>
+#include <symboldb/diff_sets.hpp>
 #include <cxxll/dir_handle.hpp>
 #include <cxxll/pg_testdb.hpp>
 #include <cxxll/pgconn_handle.hpp>
@@ -30,6 +33,7 @@
 #include <cxxll/string_support.hpp>
 #include <cxxll/read_file.hpp>
 #include <cxxll/java_class.hpp>
+#include <cxxll/java_class_batch.hpp>
 #include <cxxll/base16.hpp>
 #include <cxxll/hash.hpp>
 #include <cxxll/checksum.hpp>
@@ -43,6 +47,8 @@
 
 #include "test.hpp"
 
+#include <algorithm>
+
 using namespace cxxll;
 
 static void
@@ -262,6 +268,79 @@ test_java_class(database &db, pgconn_handle &conn)
       }
     }
   }
+  pg_query_binary
+    (conn, res, "SELECT major_version, minor_version FROM symboldb.java_class"
+     " WHERE class_id = $1", classid);
+  {
+    int major, minor;
+    pg_response(res, 0, major, minor);
+    CHECK(major == 51);
+    CHECK(minor == 0);
+  }
+  pg_query_binary
+    (conn, res, "SELECT access_flags, descriptor FROM symboldb.java_field"
+     " WHERE class_id = $1 AND name = 'LONG'", classid);
+  CHECK(res.ntuples() == 1);
+  {
+    int flags;
+    std::string descriptor;
+    pg_response(res, 0, flags, descriptor);
+    CHECK(flags == 25);
+    COMPARE_STRING(descriptor, "J");
+  }
+  pg_query_binary
+    (conn, res, "SELECT COUNT(*) FROM symboldb.java_method"
+     " WHERE class_id = $1", classid);
+  {
+    long long count;
+    pg_response(res, 0, count);
+    CHECK(count == 8);
+  }
+  pg_query
+    (conn, res, "SELECT kind, name, descriptor"
+     " FROM symboldb.java_member_reference"
+     " WHERE class_id = $1 AND class_name = 'java/lang/StringBuilder'"
+     " ORDER BY name", classid);
+  CHECK(res.ntuples() == 3);
+  COMPARE_STRING(res.getvalue(0, 0), "method");
+  COMPARE_STRING(res.getvalue(0, 1), "<init>");
+  COMPARE_STRING(res.getvalue(1, 1), "append");
+  COMPARE_STRING(res.getvalue(1, 2),
+		 "(Ljava/lang/String;)Ljava/lang/StringBuilder;");
+  COMPARE_STRING(res.getvalue(2, 1), "toString");
+
+  {
+    // A batch with the same class twice, which is already known.
+    java_class_batch batch;
+    batch.add(jc);
+    batch.add(jc);
+    db.txn_begin_no_sync();
+    db.add_java_classes(/* fake */ database::contents_id(2), batch);
+    db.txn_commit();
+    res.execBinary
+      (conn, "SELECT class_id FROM symboldb.java_class_contents"
+       " WHERE contents_id = 2");
+    CHECK(res.ntuples() == 1);
+    int classid2;
+    pg_response(res, 0, classid2);
+    CHECK(classid2 == classid);
+    pg_query_binary
+      (conn, res, "SELECT COUNT(*) FROM symboldb.java_interface"
+       " WHERE class_id = $1", classid);
+    long long count;
+    pg_response(res, 0, count);
+    CHECK(count == 2);
+
+    // Storing the class again for the same contents does not fail.
+    db.txn_begin_no_sync();
+    db.add_java_classes(database::contents_id(2), batch);
+    db.add_java_classes(database::contents_id(2), batch);
+    db.txn_commit();
+    res.execBinary
+      (conn, "SELECT class_id FROM symboldb.java_class_contents"
+       " WHERE contents_id = 2");
+    CHECK(res.ntuples() == 1);
+  }
 
   res.exec
     (conn, "SELECT jc.name FROM symboldb.java_class jc"
@@ -392,10 +471,314 @@ increment_non_python_cid(pgconn_handle &dbh, database::contents_id &cid)
   cid = database::contents_id(cid1);
 }
 
+// Contents-related tables and their columns (except contents_id).
+// Used by dump_contents.
+static const char *const contents_tables[][2] = {
+  {"elf_file", "ei_class, ei_data, e_type, e_machine, arch, soname, interp,"
+   " build_id, symbols"},
+  {"elf_program_header", "type, file_offset, virt_addr, phys_addr,"
+   " file_size, memory_size, align, readable, writable, executable"},
+  {"elf_definition", "name, version, primary_version, symbol_type, binding,"
+   " section, xsection, visibility"},
+  {"elf_reference", "name, version, symbol_type, binding, visibility"},
+  {"elf_needed", "name"},
+  {"elf_rpath", "path"},
+  {"elf_runpath", "path"},
+  {"elf_dynamic", "tag, value"},
+  {"elf_error", "message"},
+  {"java_error", "message, path"},
+  {"java_maven_url", "url, type"},
+  {"xml_error", "message, line, before, after"},
+  {"python_import", "name"},
+  {"python_attribute", "name"},
+  {"python_function_def", "name"},
+  {"python_class_def", "name"},
+  {"python_error", "line, message"},
+};
+
+// Appends the result of the query to OUT, in CSV format.
+static void
+dump_query(pgconn_handle &dbh, const std::string &sql, std::string &out)
+{
+  pgresult_handle r;
+  r.exec(dbh, ("COPY (" + sql + ") TO STDOUT WITH (FORMAT CSV)").c_str());
+  std::string row;
+  while (dbh.getCopyData(row)) {
+    out += row;
+  }
+}
+
+// Returns the package and file data in the database, in a form which
+// does not depend on the order in which files were loaded (and hence
+// the values of the serial columns).
+static std::string
+dump_contents(pgconn_handle &dbh)
+{
+  std::string out;
+  dump_query(dbh, "SELECT symboldb.nevra(p), encode(hash, 'hex'), source,"
+	     " build_host, build_time FROM symboldb.package p ORDER BY 1",
+	     out);
+  dump_query(dbh, "SELECT symboldb.nevra(p), f.name, encode(fc.digest, 'hex'),"
+	     " fc.length, f.inode, f.mtime, fa.mode, fa.flags, fa.user_name,"
+	     " fa.group_name, fa.caps"
+	     " FROM symboldb.file f"
+	     " JOIN symboldb.package p USING (package_id)"
+	     " JOIN symboldb.file_contents fc USING (contents_id)"
+	     " JOIN symboldb.file_attribute fa USING (attribute_id)"
+	     " ORDER BY 1, 2", out);
+  for (size_t i = 0; i < sizeof(contents_tables) / sizeof(contents_tables[0]);
+       ++i) {
+    out += contents_tables[i][0];
+    out += '\n';
+    dump_query(dbh, std::string("SELECT encode(fc.digest, 'hex'), ROW(")
+	       + contents_tables[i][1] + ")::text FROM symboldb."
+	       + contents_tables[i][0] + " t"
+	       " JOIN symboldb.file_contents fc USING (contents_id)"
+	       " ORDER BY 1, 2", out);
+  }
+  dump_query(dbh, "SELECT encode(fc.digest, 'hex'), c.name,"
+	     " encode(c.digest, 'hex'), c.super_class, c.access_flags,"
+	     " c.major_version, c.minor_version"
+	     " FROM symboldb.java_class_contents jcc"
+	     " JOIN symboldb.java_class c USING (class_id)"
+	     " JOIN symboldb.file_contents fc USING (contents_id)"
+	     " ORDER BY 1, 2, 3", out);
+  dump_query(dbh, "SELECT encode(c.digest, 'hex'), m.kind, m.class_name,"
+	     " m.name, m.descriptor FROM symboldb.java_member_reference m"
+	     " JOIN symboldb.java_class c USING (class_id)"
+	     " ORDER BY 1, 2, 3, 4, 5", out);
+  return out;
+}
+
+// Resolution of an unversioned reference against foo@V1 (hidden) in
+// one DSO and foo@@V2 (default) in another, like the definitions in
+// test/data/versioned.so.  Only the default version can satisfy the
+// unversioned reference.  The fixture is rolled back at the end.
+static void
+test_symbol_versions(pgconn_handle &dbh)
+{
+  test_section ts("symbol versions");
+  pgresult_handle r;
+  r.exec(dbh, "BEGIN");
+  r.exec(dbh, "INSERT INTO symboldb.package_set (set_id, name)"
+	 " VALUES (900001, 'symbol-versions')");
+  r.exec(dbh, "INSERT INTO symboldb.package (package_id, kind, name,"
+	 " version, release, arch, hash, build_host, build_time, summary,"
+	 " description, license, rpm_group, normalized)"
+	 " VALUES (900001, 'binary', 'versioned', '1', '1', 'x86_64',"
+	 " decode(repeat('5a', 20), 'hex'), 'localhost',"
+	 " '2013-01-01', '', '', 'GPL', 'Test', FALSE)");
+  r.exec(dbh, "INSERT INTO symboldb.package_set_member"
+	 " VALUES (900001, 900001)");
+  r.exec(dbh, "INSERT INTO symboldb.file_contents"
+	 " SELECT 900000 + i, 0, decode(repeat(to_hex(i + 160), 32), 'hex'), ''"
+	 " FROM generate_series(1, 3) i");
+  r.exec(dbh, "INSERT INTO symboldb.file_attribute VALUES"
+	 " (900001, 33261, 0, 'root', 'root', '', FALSE,"
+	 " decode(repeat('5a', 16), 'hex'))");
+  r.exec(dbh, "INSERT INTO symboldb.file VALUES"
+	 " (900001, 900001, 900001, 900001, 1, 0, '/usr/lib64/libv1.so'),"
+	 " (900002, 900001, 900002, 900001, 2, 0, '/usr/lib64/libv2.so'),"
+	 " (900003, 900001, 900003, 900001, 3, 0, '/usr/bin/consumer')");
+  // STT_FUNC, STB_GLOBAL.
+  r.exec(dbh, "INSERT INTO symboldb.elf_definition (contents_id, name,"
+	 " version, primary_version, symbol_type, binding, section,"
+	 " visibility) VALUES"
+	 " (900001, 'foo', 'V1', FALSE, 2, 1, 6, 'default'),"
+	 " (900002, 'foo', 'V2', TRUE, 2, 1, 6, 'default')");
+  r.exec(dbh, "INSERT INTO symboldb.elf_reference VALUES"
+	 " (900003, 'foo', NULL, 2, 1, 'default'),"
+	 " (900003, 'foo', 'V1', 2, 1, 'default')");
+  r.exec(dbh, "INSERT INTO symboldb.elf_closure VALUES"
+	 " (900001, 900003, 900001), (900001, 900003, 900002)");
+  update_elf_symbol_resolution(dbh, database::package_set_id(900001));
+  r.exec(dbh, "SELECT COALESCE(version, '-'), provider, status"
+	 " FROM symboldb.elf_symbol_resolution"
+	 " WHERE set_id = 900001 AND file_id = 900003 AND name = 'foo'"
+	 " ORDER BY 1");
+  COMPARE_NUMBER(r.ntuples(), 2);
+  if (r.ntuples() == 2) {
+    // The unversioned reference binds to foo@@V2.
+    COMPARE_STRING(r.getvalue(0, 0), "-");
+    COMPARE_STRING(r.getvalue(0, 1), "900002");
+    COMPARE_STRING(r.getvalue(0, 2), "resolved");
+    // A versioned reference can bind to the non-default foo@V1.
+    COMPARE_STRING(r.getvalue(1, 0), "V1");
+    COMPARE_STRING(r.getvalue(1, 1), "900001");
+    COMPARE_STRING(r.getvalue(1, 2), "resolved");
+  }
+  r.exec(dbh, "ROLLBACK");
+}
+
+// Two package sets with a shared object which changes between them,
+// a position-independent executable (which must not be treated as a
+// DSO), a plugin without a soname, and a DSO with both a soname and
+// an interpreter (like libc.so.6).  The fixture is committed because
+// the database object uses its own connection, and deleted at the
+// end.
+static void
+test_diff_sets(const symboldb_options &opt, database &db, pgconn_handle &dbh)
+{
+  test_section ts("diff_sets");
+  pgresult_handle r;
+  r.exec(dbh, "INSERT INTO symboldb.package (package_id, kind, name,"
+	 " version, release, arch, hash, build_host, build_time, summary,"
+	 " description, license, rpm_group, normalized)"
+	 " SELECT i, 'binary', 'diff-sets', '1', i::text, 'x86_64',"
+	 " decode(repeat(to_hex(i - 900101 + 193), 20), 'hex'), 'localhost',"
+	 " '2013-01-01', '', '', 'GPL', 'Test', FALSE"
+	 " FROM generate_series(900101, 900102) i");
+  r.exec(dbh, "INSERT INTO symboldb.package_set VALUES"
+	 " (900101, 'diff-old'), (900102, 'diff-new')");
+  r.exec(dbh, "INSERT INTO symboldb.package_set_member VALUES"
+	 " (900101, 900101), (900102, 900102)");
+  r.exec(dbh, "INSERT INTO symboldb.file_contents"
+	 " SELECT i, 0, decode(repeat(to_hex(i - 900101 + 177), 32), 'hex'), ''"
+	 " FROM generate_series(900101, 900105) i");
+  r.exec(dbh, "INSERT INTO symboldb.file_attribute VALUES"
+	 " (900101, 33261, 0, 'root', 'root', '', FALSE,"
+	 " decode(repeat('c1', 16), 'hex'))");
+  r.exec(dbh, "INSERT INTO symboldb.file VALUES"
+	 " (900101, 900101, 900101, 900101, 1, 0, '/usr/lib64/libfoo.so.1'),"
+	 " (900102, 900101, 900103, 900101, 2, 0, '/usr/bin/prog'),"
+	 " (900103, 900101, 900104, 900101, 3, 0, '/usr/lib64/plugin.so'),"
+	 " (900104, 900101, 900105, 900101, 4, 0, '/lib64/libc.so.6'),"
+	 " (900105, 900102, 900102, 900101, 1, 0, '/usr/lib64/libfoo.so.1'),"
+	 " (900106, 900102, 900103, 900101, 2, 0, '/usr/bin/prog'),"
+	 " (900107, 900102, 900104, 900101, 3, 0, '/usr/lib64/plugin.so'),"
+	 " (900108, 900102, 900105, 900101, 4, 0, '/lib64/libc.so.6')");
+  // ET_DYN, EM_X86_64.
+  r.exec(dbh, "INSERT INTO symboldb.elf_file VALUES"
+	 " (900101, 2, 1, 3, 62, 'x86_64', 'libfoo.so.1', NULL, NULL, 'dynsym'),"
+	 " (900102, 2, 1, 3, 62, 'x86_64', 'libfoo.so.1', NULL, NULL, 'dynsym'),"
+	 " (900103, 2, 1, 3, 62, 'x86_64', NULL,"
+	 "  '/lib64/ld-linux-x86-64.so.2', NULL, 'dynsym'),"
+	 " (900104, 2, 1, 3, 62, 'x86_64', NULL, NULL, NULL, 'dynsym'),"
+	 " (900105, 2, 1, 3, 62, 'x86_64', 'libc.so.6',"
+	 "  '/lib64/ld-linux-x86-64.so.2', NULL, 'dynsym')");
+  // STT_NOTYPE = 0, STT_OBJECT = 1, STT_FUNC = 2, STB_GLOBAL = 1.
+  r.exec(dbh, "INSERT INTO symboldb.elf_definition (contents_id, name,"
+	 " version, primary_version, symbol_type, binding, section,"
+	 " visibility) VALUES"
+	 " (900101, 'bar', NULL, FALSE, 2, 1, 6, 'default'),"
+	 " (900101, 'baz', NULL, FALSE, 2, 1, 6, 'default'),"
+	 " (900101, 'foo', 'V1', TRUE, 2, 1, 6, 'default'),"
+	 " (900102, 'bar', NULL, FALSE, 1, 1, 6, 'default'),"
+	 " (900102, 'foo', 'V1', FALSE, 2, 1, 6, 'default'),"
+	 " (900102, 'qux', NULL, FALSE, 2, 1, 6, 'default'),"
+	 " (900103, 'main', NULL, FALSE, 2, 1, 6, 'default'),"
+	 " (900103, '_edata', NULL, FALSE, 0, 1, 6, 'default'),"
+	 " (900104, 'plugin_init', NULL, FALSE, 2, 1, 6, 'default'),"
+	 " (900105, 'printf', NULL, FALSE, 2, 1, 6, 'default')");
+  r.exec(dbh, "INSERT INTO symboldb.elf_closure VALUES"
+	 " (900101, 900102, 900101),"
+	 " (900102, 900106, 900105), (900102, 900107, 900105)");
+
+  // Exported symbols are returned in strictly increasing key order,
+  // which --diff-sets relies on.
+  {
+    db.txn_begin();
+    database::exported_symbols syms(db, database::package_set_id(900101));
+    std::vector<std::vector<std::string> > rows;
+    while (syms.next()) {
+      std::vector<std::string> key;
+      key.push_back(syms.arch());
+      key.push_back(syms.soname());
+      key.push_back(syms.name());
+      key.push_back(syms.version());
+      CHECK(rows.empty() || rows.back() < key);
+      rows.push_back(key);
+    }
+    CHECK(!syms.next());
+    db.txn_commit();
+    std::string keys;
+    for (size_t i = 0; i < rows.size(); ++i) {
+      keys += rows[i].at(1) + ' ' + rows[i].at(2) + ' ' + rows[i].at(3)
+	+ '\n';
+    }
+    COMPARE_STRING(keys,
+		   "libc.so.6 printf \n"
+		   "libfoo.so.1 bar \n"
+		   "libfoo.so.1 baz \n"
+		   "libfoo.so.1 foo V1\n"
+		   "plugin.so plugin_init \n");
+  }
+
+  {
+    FILE *out = tmpfile();
+    CHECK(out != NULL);
+    symboldb_options qopt(opt);
+    qopt.output = symboldb_options::quiet;
+    COMPARE_NUMBER(symboldb_diff_sets(qopt, db, "diff-old", "diff-new", out),
+		   0);
+    rewind(out);
+    std::string output;
+    char buf[256];
+    while (size_t ret = fread(buf, 1, sizeof(buf), out)) {
+      output.append(buf, ret);
+    }
+    COMPARE_STRING(output,
+		   "changed\tx86_64\tlibfoo.so.1\tbar\t\t2\n"
+		   "removed\tx86_64\tlibfoo.so.1\tbaz\t\t1\n"
+		   "changed\tx86_64\tlibfoo.so.1\tfoo\tV1\t2\n"
+		   "added\tx86_64\tlibfoo.so.1\tqux\t\t2\n");
+    CHECK(symboldb_diff_sets(qopt, db, "diff-old", "no-such-set", out) == 1);
+    fclose(out);
+  }
+
+  r.exec(dbh, "DELETE FROM symboldb.package_set"
+	 " WHERE set_id IN (900101, 900102)");
+  r.exec(dbh, "DELETE FROM symboldb.package"
+	 " WHERE package_id IN (900101, 900102)");
+  r.exec(dbh, "DELETE FROM symboldb.file_contents"
+	 " WHERE contents_id BETWEEN 900101 AND 900105");
+  r.exec(dbh, "DELETE FROM symboldb.file_attribute"
+	 " WHERE attribute_id = 900101");
+}
+
+// Loads the RPM files in test/data into DB.
+static void
+load_test_rpms(const symboldb_options &opt, database &db)
+{
+  database::package_id last_pkg_id(0);
+  static const char RPMDIR[] = "test/data";
+  std::string rpmdir_prefix(RPMDIR);
+  rpmdir_prefix += '/';
+  dir_handle rpmdir(RPMDIR);
+  while (dirent *e = rpmdir.readdir()) {
+    if (ends_with(std::string(e->d_name), ".rpm")) {
+      std::string rpmpath(rpmdir_prefix + e->d_name);
+      checksum csum;
+      hash_file(hash_sink::sha256, rpmpath.c_str(), csum);
+      csum.type = hash_sink::sha256;
+      // Copy the RPM file into the RPM cache.
+      {
+	std::tr1::shared_ptr<file_cache> fcache(opt.rpm_cache());
+	file_cache::add_sink sink(*fcache, csum);
+	fd_handle fd;
+	fd.open_read_only(rpmpath.c_str());
+	fd_source source(fd.get());
+	copy_source_to_sink(source, sink);
+	std::string p;
+	sink.finish(p);
+      }
+      rpm_package_info info;
+      database::package_id pkg
+	(rpm_load(opt, db, rpmpath.c_str(), info, &csum,
+		  ("file://" + rpmpath).c_str()));
+      CHECK(pkg > last_pkg_id);
+      last_pkg_id = pkg;
+      pkg = rpm_load(opt, db, rpmpath.c_str(), info, &csum, NULL);
+      CHECK(pkg == last_pkg_id);
+    }
+  }
+}
+
 static void
 test()
 {
   static const char DBNAME[] = "template1";
+  static const char PARALLEL_DBNAME[] = "rpm_load_parallel";
   pg_testdb testdb;
   {
     // Run this directly, to suppress notices.
@@ -403,6 +786,9 @@ test()
     pgresult_handle res;
     res.exec(db, database::SCHEMA_BASE);
     res.exec(db, database::SCHEMA_INDEX);
+    // Copy of the empty schema for the load_threads comparison.
+    res.exec(db, (std::string("CREATE DATABASE ") + PARALLEL_DBNAME
+		  + " TEMPLATE " + DBNAME).c_str());
   }
 
   temporary_directory cachedir;
@@ -411,41 +797,23 @@ test()
   opt.output = symboldb_options::quiet;
   database db(testdb.directory().c_str(), DBNAME);
 
+  load_test_rpms(opt, db);
+
   {
-    database::package_id last_pkg_id(0);
-    static const char RPMDIR[] = "test/data";
-    std::string rpmdir_prefix(RPMDIR);
-    rpmdir_prefix += '/';
-    dir_handle rpmdir(RPMDIR);
-    while (dirent *e = rpmdir.readdir()) {
-      if (ends_with(std::string(e->d_name), ".rpm")) {
-	std::string rpmpath(rpmdir_prefix + e->d_name);
-	checksum csum;
-	hash_file(hash_sink::sha256, rpmpath.c_str(), csum);
-	csum.type = hash_sink::sha256;
-	// Copy the RPM file into the RPM cache.
-	{
-	  std::tr1::shared_ptr<file_cache> fcache(opt.rpm_cache());
-	  file_cache::add_sink sink(*fcache, csum);
-	  fd_handle fd;
-	  fd.open_read_only(rpmpath.c_str());
-	  fd_source source(fd.get());
-	  copy_source_to_sink(source, sink);
-	  std::string p;
-	  sink.finish(p);
-	}
-	rpm_package_info info;
-	database::package_id pkg
-	  (rpm_load(opt, db, rpmpath.c_str(), info, &csum,
-		    ("file://" + rpmpath).c_str()));
-	CHECK(pkg > last_pkg_id);
-	last_pkg_id = pkg;
-	pkg = rpm_load(opt, db, rpmpath.c_str(), info, &csum, NULL);
-	CHECK(pkg == last_pkg_id);
-      }
-    }
-    opt.output = symboldb_options::standard;
+    // Loading with several analysis threads must produce the same
+    // database contents.
+    test_section ts("load_threads");
+    symboldb_options popt(opt);
+    popt.load_threads = 4;
+    database pdb(testdb.directory().c_str(), PARALLEL_DBNAME);
+    load_test_rpms(popt, pdb);
+    pgconn_handle dbh(testdb.connect(DBNAME));
+    pgconn_handle pdbh(testdb.connect(PARALLEL_DBNAME));
+    std::string sequential(dump_contents(dbh));
+    CHECK(sequential.find("sysvinit-tools") != std::string::npos);
+    COMPARE_STRING(dump_contents(pdbh), sequential);
   }
+  opt.output = symboldb_options::standard;
 
   {
     pgconn_handle dbh(testdb.connect(DBNAME));
@@ -869,7 +1237,76 @@ test()
     }
     r1.exec(dbh, "BEGIN");
     update_elf_closure(dbh, pset, NULL);
+    update_elf_symbol_resolution(dbh, pset);
+    r1.exec(dbh, "COMMIT");
+
+    // Symbol resolution.  The set does not contain glibc, so the C
+    // library references are unresolved.
+    r1.exec(dbh, "SELECT esr.version, esr.provider IS NULL, esr.status"
+	    " FROM symboldb.elf_symbol_resolution esr"
+	    " JOIN symboldb.file f USING (file_id)"
+	    " JOIN symboldb.package p USING (package_id)"
+	    " WHERE symboldb.nevra(p) = 'sysvinit-tools-2.88-9.dsf.fc18.x86_64'"
+	    " AND f.name = '/usr/bin/wall' AND esr.name = 'isatty'");
+    COMPARE_NUMBER(r1.ntuples(), 1);
+    COMPARE_STRING(r1.getvalue(0, 0), "GLIBC_2.2.5");
+    COMPARE_STRING(r1.getvalue(0, 1), "t");
+    COMPARE_STRING(r1.getvalue(0, 2), "unresolved");
+    r1.exec(dbh, "SELECT COUNT(*) FROM symboldb.elf_symbol_resolution");
+    std::string resolution_count(r1.getvalue(0, 0));
+    CHECK(resolution_count != "0");
+    // Recomputing the resolution does not change anything.
+    r1.exec(dbh, "BEGIN");
+    update_elf_symbol_resolution(dbh, pset);
     r1.exec(dbh, "COMMIT");
+    r1.exec(dbh, "SELECT COUNT(*) FROM symboldb.elf_symbol_resolution");
+    COMPARE_STRING(r1.getvalue(0, 0), resolution_count);
+    test_symbol_versions(dbh);
+
+    test_diff_sets(opt, db, dbh);
+
+    // Columnar snapshot of the package set.
+    {
+      std::string path(cachedir.path("set.snapshot"));
+      db.write_set_snapshot(pset, path.c_str());
+      set_snapshot snap(path.c_str());
+      uint32_t wall_name;
+      CHECK(snap.find_string("/usr/bin/wall", wall_name));
+      const set_snapshot::files_table &files(snap.files());
+      std::pair<size_t, size_t> range
+	(set_snapshot::equal_range(files.name, files.size, wall_name));
+      COMPARE_NUMBER(range.second - range.first, 1U);
+      const size_t wall = range.first;
+      COMPARE_STRING(snap.string(snap.packages().nevra[files.package[wall]])
+		     .str(), "sysvinit-tools-2.88-9.dsf.fc18.x86_64");
+      std::vector<uint32_t> rows;
+      set_snapshot::select_bits(files.mode, files.size, 06000, rows);
+      CHECK(std::find(rows.begin(), rows.end(), wall) != rows.end());
+      const uint32_t elf = files.elf[wall];
+      CHECK(elf != set_snapshot::none);
+      COMPARE_STRING(snap.string(snap.elf_files().arch[elf]).str(),
+		     "x86_64");
+      uint32_t isatty;
+      CHECK(snap.find_string("isatty", isatty));
+      const set_snapshot::references_table &refs(snap.references());
+      range = set_snapshot::equal_range(refs.name, refs.size, isatty);
+      CHECK(range.first < range.second);
+      bool found = false;
+      for (size_t i = range.first; i < range.second; ++i) {
+	if (refs.elf[i] == elf) {
+	  COMPARE_STRING(snap.string(refs.version[i]).str(), "GLIBC_2.2.5");
+	  found = true;
+	}
+      }
+      CHECK(found);
+      pg_query_binary
+	(dbh, r1,
+	 "SELECT COUNT(*)::int FROM symboldb.elf_closure WHERE set_id = $1",
+	 pset.value());
+      int closure_count;
+      pg_response(r1, 0, closure_count);
+      COMPARE_NUMBER(snap.closure().size, size_t(closure_count));
+    }
 
     std::vector<std::vector<unsigned char> > digests;
     db.referenced_package_digests(digests);
@@ -908,6 +1345,24 @@ test()
       }
     }
 
+    // Test build ID lookup.
+    {
+      std::vector<unsigned char> build_id;
+      base16_decode("36d9f2992247e4afaf292e939c4a3cb25204c142",
+		    std::back_inserter(build_id));
+      database::files_with_build_id files(db, build_id);
+      CHECK(files.next());
+      COMPARE_STRING(files.nevra(), "sysvinit-tools-2.88-9.dsf.fc18.x86_64");
+      COMPARE_STRING(files.file_name(), "/usr/bin/wall");
+      CHECK(files.package() > database::package_id());
+      CHECK(files.contents() > database::contents_id());
+      CHECK(!files.next());
+
+      build_id.assign(20, 0);
+      database::files_with_build_id none(db, build_id);
+      CHECK(!none.next());
+    }
+
     // Test contents preservation for files in /etc.
     {
       r1.exec(dbh, "SELECT LENGTH(contents) FROM symboldb.file_contents"
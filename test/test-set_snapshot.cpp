@@ -0,0 +1,313 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <symboldb/set_snapshot.hpp>
+#include <symboldb/set_snapshot_writer.hpp>
+#include <cxxll/temporary_directory.hpp>
+#include <cxxll/fd_handle.hpp>
+#include <cxxll/fd_sink.hpp>
+#include <cxxll/os.hpp>
+#include <cxxll/read_file.hpp>
+
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "test.hpp"
+
+using namespace cxxll;
+
+namespace {
+  typedef std::map<std::string, uint32_t> string_map;
+
+  const char *const strings[] = {
+    "", "/usr/bin/env", "/usr/bin/su", "/usr/lib64/libc.so.6",
+    "GLIBC_2.2.5", "bin", "coreutils", "coreutils-8.21-1.fc19.x86_64",
+    "getenv", "getenv_r", "getgid", "glibc", "glibc-2.17-1.fc19.x86_64",
+    "libc.so.6", "root", "setuid", "util-linux",
+    "util-linux-2.23-1.fc19.x86_64", "x86_64", NULL
+  };
+
+  std::vector<uint32_t>
+  column(uint32_t a, uint32_t b)
+  {
+    std::vector<uint32_t> v;
+    v.push_back(a);
+    v.push_back(b);
+    return v;
+  }
+
+  std::vector<uint32_t>
+  column(uint32_t a, uint32_t b, uint32_t c)
+  {
+    std::vector<uint32_t> v(column(a, b));
+    v.push_back(c);
+    return v;
+  }
+
+  // Writes a small snapshot.  If BAD_ELF, the ELF reference of the
+  // first definition is out of range.
+  void
+  write_snapshot(const char *path, bool bad_elf = false)
+  {
+    set_snapshot_writer w(path);
+    string_map s;
+    for (const char *const *p = strings; *p; ++p) {
+      s[*p] = w.add_string(*p);
+    }
+    // Packages: coreutils, glibc, util-linux.
+    w.write(set_snapshot::package_name,
+	    column(s["coreutils"], s["glibc"], s["util-linux"]));
+    w.write(set_snapshot::package_nevra,
+	    column(s["coreutils-8.21-1.fc19.x86_64"],
+		   s["glibc-2.17-1.fc19.x86_64"],
+		   s["util-linux-2.23-1.fc19.x86_64"]));
+    w.write(set_snapshot::package_arch,
+	    column(s["x86_64"], s["x86_64"], s["x86_64"]));
+    // ELF files: env, libc.so.6, su.
+    w.write(set_snapshot::elf_type, column(2, 3, 3));
+    w.write(set_snapshot::elf_machine, column(62, 62, 62));
+    w.write(set_snapshot::elf_class, column(2, 2, 2));
+    w.write(set_snapshot::elf_arch,
+	    column(s["x86_64"], s["x86_64"], s["x86_64"]));
+    w.write(set_snapshot::elf_soname, column(0, s["libc.so.6"], 0));
+    w.write(set_snapshot::elf_interp, column(0, 0, 0));
+    // Files, sorted by name.
+    w.write(set_snapshot::file_package, column(0, 2, 1));
+    w.write(set_snapshot::file_name,
+	    column(s["/usr/bin/env"], s["/usr/bin/su"],
+		   s["/usr/lib64/libc.so.6"]));
+    w.write(set_snapshot::file_mode, column(0100755, 0104755, 0100755));
+    w.write(set_snapshot::file_user,
+	    column(s["root"], s["root"], s["root"]));
+    w.write(set_snapshot::file_group,
+	    column(s["root"], s["root"], s["root"]));
+    w.write(set_snapshot::file_elf, column(0, 2, 1));
+    // Definitions, sorted by name.
+    w.write(set_snapshot::definition_elf, column(bad_elf ? 3 : 1, 1));
+    w.write(set_snapshot::definition_name,
+	    column(s["getenv"], s["getgid"]));
+    w.write(set_snapshot::definition_version,
+	    column(s["GLIBC_2.2.5"], s["GLIBC_2.2.5"]));
+    w.write(set_snapshot::definition_type, column(2, 2));
+    w.write(set_snapshot::definition_binding, column(1, 1));
+    w.write(set_snapshot::definition_visibility, column(0, 0));
+    w.write(set_snapshot::definition_default_version, column(1, 1));
+    // References, sorted by name.
+    w.write(set_snapshot::reference_elf, column(0, 2, 2));
+    w.write(set_snapshot::reference_name,
+	    column(s["getenv"], s["getenv"], s["setuid"]));
+    w.write(set_snapshot::reference_version,
+	    column(s["GLIBC_2.2.5"], s["GLIBC_2.2.5"], s["GLIBC_2.2.5"]));
+    w.write(set_snapshot::reference_type, column(2, 2, 2));
+    w.write(set_snapshot::reference_binding, column(1, 1, 1));
+    w.write(set_snapshot::reference_visibility, column(0, 0, 0));
+    w.write(set_snapshot::program_header_elf, column(0, 2));
+    w.write(set_snapshot::program_header_type, column(0x6474e551, 0x6474e551));
+    w.write(set_snapshot::program_header_flags, column(6, 7));
+    w.write(set_snapshot::needed_elf, column(0, 2));
+    w.write(set_snapshot::needed_name, column(s["libc.so.6"], s["libc.so.6"]));
+    w.write(set_snapshot::closure_file, column(0, 1));
+    w.write(set_snapshot::closure_needed, column(2, 2));
+    w.commit();
+  }
+
+  bool
+  is_invalid(const char *path)
+  {
+    try {
+      set_snapshot snap(path);
+    } catch (std::runtime_error &) {
+      return true;
+    }
+    return false;
+  }
+}
+
+static void
+test()
+{
+  temporary_directory tmp;
+  std::string path(tmp.path("snapshot"));
+  {
+    // The file mode follows the umask, not the mkstemp default.
+    mode_t old_mask = umask(022);
+    write_snapshot(path.c_str());
+    umask(old_mask);
+    struct stat st;
+    CHECK(stat(path.c_str(), &st) == 0);
+    COMPARE_NUMBER(st.st_mode & 0777, 0644U);
+  }
+  {
+    set_snapshot snap(path.c_str());
+    CHECK(snap.string_count() == sizeof(strings) / sizeof(strings[0]) - 1);
+    COMPARE_STRING(snap.string(0).str(), "");
+    uint32_t id;
+    CHECK(snap.find_string("getenv", id));
+    COMPARE_STRING(snap.string(id).str(), "getenv");
+    CHECK(!snap.find_string("getenvx", id));
+    CHECK(!snap.find_string("zzz", id));
+    CHECK(snap.find_string("", id));
+    CHECK(id == 0);
+
+    std::pair<uint32_t, uint32_t> range(snap.prefix_range("getenv"));
+    CHECK(range.second - range.first == 2);
+    COMPARE_STRING(snap.string(range.first).str(), "getenv");
+    COMPARE_STRING(snap.string(range.first + 1).str(), "getenv_r");
+    range = snap.prefix_range("/usr/bin/");
+    CHECK(range.second - range.first == 2);
+    range = snap.prefix_range("nothing");
+    CHECK(range.first == range.second);
+    range = snap.prefix_range("");
+    CHECK(range.first == 0);
+    CHECK(range.second == snap.string_count());
+
+    CHECK(snap.packages().size == 3);
+    CHECK(snap.elf_files().size == 3);
+    CHECK(snap.files().size == 3);
+    CHECK(snap.definitions().size == 2);
+    CHECK(snap.references().size == 3);
+    CHECK(snap.program_headers().size == 2);
+    CHECK(snap.needed().size == 2);
+    CHECK(snap.closure().size == 2);
+
+    // SUID programs which reference getenv.
+    const set_snapshot::files_table &files(snap.files());
+    std::vector<uint32_t> rows;
+    set_snapshot::select_bits(files.mode, files.size, 06000, rows);
+    CHECK(rows.size() == 1);
+    COMPARE_STRING(snap.string(files.name[rows.at(0)]).str(),
+		   "/usr/bin/su");
+    const uint32_t elf = files.elf[rows.at(0)];
+    CHECK(snap.find_string("getenv", id));
+    const set_snapshot::references_table &refs(snap.references());
+    std::pair<size_t, size_t> refrange
+      (set_snapshot::equal_range(refs.name, refs.size, id));
+    CHECK(refrange.second - refrange.first == 2);
+    bool found = false;
+    for (size_t i = refrange.first; i < refrange.second; ++i) {
+      found = found || refs.elf[i] == elf;
+    }
+    CHECK(found);
+
+    rows.clear();
+    set_snapshot::select_equal(refs.elf, refs.size, elf, rows);
+    CHECK(rows.size() == 2);
+    CHECK(rows.at(0) == 1);
+    CHECK(rows.at(1) == 2);
+
+    rows.clear();
+    range = snap.prefix_range("/usr/bin/");
+    set_snapshot::select_range(files.name, files.size,
+			       range.first, range.second, rows);
+    CHECK(rows.size() == 2);
+    CHECK(rows.at(0) == 0);
+    CHECK(rows.at(1) == 1);
+    set_snapshot::select_range(files.name, files.size, 5, 5, rows);
+    CHECK(rows.size() == 2);
+
+    const set_snapshot::program_headers_table &phdrs(snap.program_headers());
+    rows.clear();
+    set_snapshot::select_equal(phdrs.flags, phdrs.size, 7, rows);
+    CHECK(rows.size() == 1);
+    CHECK(phdrs.elf[rows.at(0)] == 2);
+    CHECK(snap.closure().needed[0] == 2);
+    CHECK(snap.packages().nevra[files.package[2]]
+	  == snap.packages().nevra[1]);
+  }
+
+  // Scans over several blocks.
+  {
+    std::vector<uint32_t> col;
+    for (uint32_t i = 0; i < 10000; ++i) {
+      col.push_back(i % 7);
+    }
+    std::vector<uint32_t> rows;
+    set_snapshot::select_equal(col.data(), col.size(), 3, rows);
+    CHECK(rows.size() == 1429);
+    CHECK(rows.front() == 3);
+    CHECK(rows.back() == 9999);
+    rows.clear();
+    set_snapshot::select_range(col.data(), col.size(), 5, 7, rows);
+    CHECK(rows.size() == 2856);
+    rows.clear();
+    set_snapshot::select_bits(col.data(), col.size(), 4, rows);
+    CHECK(rows.size() == 4284);
+  }
+
+  // Replacing the file does not affect existing mappings.
+  {
+    set_snapshot snap(path.c_str());
+    write_snapshot(path.c_str());
+    CHECK(snap.files().size == 3);
+  }
+
+  // Corrupted files.
+  CHECK(is_invalid("/dev/null"));
+  {
+    std::string bad(tmp.path("bad"));
+    write_snapshot(bad.c_str(), true);
+    CHECK(is_invalid(bad.c_str()));
+
+    std::vector<unsigned char> data;
+    read_file(path.c_str(), data);
+    CHECK(data.size() > 1000);
+    std::vector<unsigned char> copy(data);
+    copy.at(0) = 'S';
+    {
+      fd_handle fd;
+      fd.open(bad.c_str(), O_WRONLY | O_TRUNC);
+      fd_sink(fd.get()).write(copy);
+    }
+    CHECK(is_invalid(bad.c_str()));
+    copy = data;
+    copy.resize(copy.size() - 1);
+    {
+      fd_handle fd;
+      fd.open(bad.c_str(), O_WRONLY | O_TRUNC);
+      fd_sink(fd.get()).write(copy);
+    }
+    CHECK(is_invalid(bad.c_str()));
+  }
+
+  // Writer errors.
+  {
+    std::string other(tmp.path("other"));
+    {
+      set_snapshot_writer w(other.c_str());
+      w.add_string("");
+      w.add_string("b");
+      try {
+	w.add_string("a");
+	CHECK(false);
+      } catch (std::logic_error &) {
+      }
+      try {
+	w.commit();
+	CHECK(false);
+      } catch (std::logic_error &) {
+      }
+    }
+    CHECK(!path_exists(other.c_str()));
+  }
+}
+
+static test_register t("set_snapshot", test);
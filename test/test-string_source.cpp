@@ -17,6 +17,9 @@
  */
 
 #include <cxxll/string_source.hpp>
+#include <cxxll/string_sink.hpp>
+#include <cxxll/source_sink.hpp>
+#include <cxxll/read_only_source.hpp>
 #include <cxxll/eof_exception.hpp>
 #include "test.hpp"
 
@@ -76,6 +79,33 @@ test()
 		     std::string("dect", 5));
     }
   }
+  {
+    string_source src("abcde");
+    unsigned char buf[1];
+    CHECK(src.read(buf, 1) == 1);
+    const_stringref ref(src.borrow(3));
+    COMPARE_STRING(std::string(ref.data(), ref.size()), "bcd");
+    ref = src.borrow(3);
+    COMPARE_STRING(std::string(ref.data(), ref.size()), "e");
+    CHECK(src.borrow(3).empty());
+    CHECK(src.read(buf, 1) == 0);
+  }
+  {
+    string_source src("abcde");
+    string_sink sink;
+    unsigned char buf[2];
+    CHECK(copy_source_to_sink(src, sink, buf, sizeof(buf)) == 5);
+    COMPARE_STRING(sink.data, "abcde");
+  }
+  {
+    string_source strsrc("abcde");
+    read_only_source src(&strsrc);
+    CHECK(src.borrow(3).empty());
+    string_sink sink;
+    unsigned char buf[2];
+    CHECK(copy_source_to_sink(src, sink, buf, sizeof(buf)) == 5);
+    COMPARE_STRING(sink.data, "abcde");
+  }
 }
 
 static test_register t("string_source", test);
@@ -93,6 +93,20 @@ test()
 		     std::string("dect", 5));
     }
   }
+  {
+    std::vector<unsigned char> vec;
+    vector_source src(&vec);
+    CHECK(src.borrow(3).empty());
+    vec.push_back('a');
+    vec.push_back('b');
+    vec.push_back('c');
+    const_stringref ref(src.borrow(2));
+    COMPARE_STRING(std::string(ref.data(), ref.size()), "ab");
+    unsigned char buf[5];
+    CHECK(src.read(buf, sizeof(buf)) == 1);
+    CHECK(buf[0] == 'c');
+    CHECK(src.borrow(2).empty());
+  }
 }
 
 static test_register t("vector_source", test);
@@ -21,6 +21,22 @@
 
 #include "test.hpp"
 
+static void
+check_error(const std::vector<unsigned char> &buffer, const char *what)
+{
+  using namespace cxxll;
+  zip_file zip(&buffer);
+  try {
+    while (zip.next()) {
+      std::vector<unsigned char> data;
+      zip.data(data);
+    }
+    CHECK(false);
+  } catch (zip_file::exception &e) {
+    COMPARE_STRING(e.what(), what);
+  }
+}
+
 static void
 test()
 {
@@ -33,19 +49,86 @@ test()
     zip_file zip(&buffer);
     CHECK(zip.next());
     COMPARE_STRING(zip.name(), "data1");
+    CHECK(zip.size() == 29);
     std::vector<unsigned char> data;
     zip.data(data);
     COMPARE_STRING("data file 1 (not compressed)\n",
 		   std::string(data.begin(), data.end()));
     CHECK(zip.next());
     COMPARE_STRING(zip.name(), "data2");
-    data.clear();
+    CHECK(zip.size() == 80);
     zip.data(data);
     COMPARE_STRING("data file 2 (this should be compressed)\n"
 		   "data file 2 (this should be compressed)\n",
 		   std::string(data.begin(), data.end()));
     CHECK(!zip.next());
   }
+  {
+    // Entries can be skipped without decompressing them.
+    std::vector<unsigned char> buffer;
+    read_file("test/data/test.zip", buffer);
+    zip_file zip(&buffer);
+    CHECK(zip.next());
+    CHECK(zip.next());
+    COMPARE_STRING(zip.name(), "data2");
+    std::vector<unsigned char> data;
+    zip.data(data);
+    CHECK(data.size() == 80);
+    CHECK(!zip.next());
+  }
+  {
+    // Reading from a memory range, and stored data in place.
+    std::vector<unsigned char> buffer;
+    read_file("test/data/test.zip", buffer);
+    CHECK(zip_file::has_signature(buffer.data(), buffer.size()));
+    CHECK(!zip_file::has_signature(buffer.data(), 4));
+    zip_file zip(buffer.data(), buffer.size());
+    CHECK(zip.next());
+    const unsigned char *ptr = NULL;
+    size_t length = 0;
+    CHECK(zip.data_in_place(ptr, length));
+    CHECK(ptr > buffer.data() && ptr + length <= buffer.data() + buffer.size());
+    COMPARE_STRING(std::string(ptr, ptr + length),
+		   "data file 1 (not compressed)\n");
+    CHECK(zip.next());
+    CHECK(!zip.data_in_place(ptr, length));
+    CHECK(!zip.next());
+  }
+  {
+    // ZIP64 end of central directory and extra fields.
+    std::vector<unsigned char> buffer;
+    read_file("test/data/zip64.zip", buffer);
+    zip_file zip(&buffer);
+    CHECK(zip.next());
+    COMPARE_STRING(zip.name(), "a.txt");
+    CHECK(zip.size() == 12);
+    std::vector<unsigned char> data;
+    zip.data(data);
+    COMPARE_STRING(std::string(data.begin(), data.end()), "stored data\n");
+    CHECK(zip.next());
+    COMPARE_STRING(zip.name(), "Hello.class");
+    CHECK(zip.size() == 481);
+    zip.data(data);
+    CHECK(data.size() == 481);
+    COMPARE_STRING(std::string(data.begin(), data.begin() + 12),
+		   "Hello.class ");
+    CHECK(!zip.next());
+  }
+  {
+    std::vector<unsigned char> buffer;
+    read_file("test/data/test.zip", buffer);
+    std::vector<unsigned char> copy(buffer);
+    // Inside the stored data of data1.
+    copy.at(70) ^= 1;
+    check_error(copy, "CRC mismatch");
+    copy = buffer;
+    copy.resize(copy.size() - 1);
+    check_error(copy, "end of central directory not found");
+    copy = buffer;
+    copy.erase(copy.begin() + 40);
+    check_error(copy, "central directory header not found");
+    copy.clear();
+    check_error(copy, "end of central directory not found");
+  }
 }
-
 static test_register t("zip_file", test);
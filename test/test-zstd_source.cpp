@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2013 Red Hat, Inc.
+ * Written by Florian Weimer <fweimer@redhat.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cxxll/zstd_source.hpp>
+#include <cxxll/decompress_exception.hpp>
+#include <cxxll/memory_range_source.hpp>
+#include <cxxll/source_sink.hpp>
+#include <cxxll/vector_sink.hpp>
+#include <cxxll/string_source.hpp>
+
+#include "test.hpp"
+
+using namespace cxxll;
+
+static void
+test()
+{
+  // Output from: echo "some data" | zstd | xxd -i
+  static const unsigned char data[] = {
+  0x28, 0xb5, 0x2f, 0xfd, 0x04, 0x58, 0x51, 0x00, 0x00, 0x73, 0x6f, 0x6d,
+  0x65, 0x20, 0x64, 0x61, 0x74, 0x61, 0x0a, 0xd0, 0x96, 0x1f, 0xbe
+  };
+
+  {
+    memory_range_source mrsource(data, sizeof(data));
+    zstd_source source(&mrsource);
+    vector_sink vsink;
+    copy_source_to_sink(source, vsink);
+    COMPARE_STRING(std::string(vsink.data.begin(), vsink.data.end()),
+		   "some data\n");
+  }
+  {
+    std::string data2;
+    data2.append(data, data + sizeof(data));
+    data2.append(data, data + sizeof(data));
+    string_source stringsrc(data2);
+    zstd_source source(&stringsrc);
+    vector_sink vsink;
+    copy_source_to_sink(source, vsink);
+    COMPARE_STRING(std::string(vsink.data.begin(), vsink.data.end()),
+		   "some data\nsome data\n");
+  }
+  {
+    // Output buffer smaller than the decompressed data.
+    memory_range_source mrsource(data, sizeof(data));
+    zstd_source source(&mrsource);
+    std::string result;
+    unsigned char ch;
+    while (source.read(&ch, 1) == 1) {
+      result += static_cast<char>(ch);
+    }
+    COMPARE_STRING(result, "some data\n");
+    COMPARE_NUMBER(source.read(&ch, 1), 0U);
+  }
+  {
+    memory_range_source mrsource(data, sizeof(data) - 1);
+    zstd_source source(&mrsource);
+    vector_sink vsink;
+    bool caught = false;
+    try {
+      copy_source_to_sink(source, vsink);
+    } catch (decompress_exception &) {
+      caught = true;
+    }
+    CHECK(caught);
+  }
+}
+
+static test_register t("zstd_source", test);
@@ -25,6 +25,7 @@
 #include <cxxll/fd_handle.hpp>
 #include <cxxll/elf_image.hpp>
 #include <cxxll/rpm_parser.hpp>
+#include <cxxll/python_analyzer_pool.hpp>
 #include <cxxll/regex_handle.hpp>
 #include <cxxll/url_source.hpp>
 
@@ -348,6 +349,7 @@ run_tests(const char *pattern)
 
   rpm_parser_deinit();
   url_source_deinit();
+  python_analyzer_pool::shared_deinit();
 
   if (file_descriptors_valid(start_fds)) {
     std::vector<int> end_fds(file_descriptors());